@@ -0,0 +1,43 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * compositor/include/background.h - Desktop wallpaper
+ */
+
+#ifndef LWINDESK_BACKGROUND_H
+#define LWINDESK_BACKGROUND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "server.h"
+
+struct lw_output;
+
+/* A gradient color stop: position (0-1) and RGB (0-1) */
+struct lw_gradient_stop {
+    float pos, r, g, b;
+};
+
+/* Create the background scene tree (must be the first child of the root
+ * tree so it stays beneath workspaces and shell surfaces) */
+void lw_background_init(struct lw_server *server);
+
+/* Rasterize and place the wallpaper for an output.  Cheap when the output
+ * size is unchanged: only the node position is refreshed. */
+void lw_background_update(struct lw_output *output);
+
+/* Remove an output's wallpaper node */
+void lw_background_destroy(struct lw_output *output);
+
+/*
+ * Fill an XRGB8888 image with a vertical gradient.  Colors are
+ * interpolated per row and ordered-dithered to hide 8-bit banding.
+ */
+void lw_background_fill_gradient(uint32_t *pixels, int width, int height,
+                                  size_t stride,
+                                  const struct lw_gradient_stop *stops,
+                                  int nstops);
+
+#endif /* LWINDESK_BACKGROUND_H */
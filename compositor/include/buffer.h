@@ -0,0 +1,84 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * compositor/include/buffer.h - CPU pixel buffers for compositor-drawn content
+ */
+
+#ifndef LWINDESK_BUFFER_H
+#define LWINDESK_BUFFER_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wayland-server-core.h>
+#include <wlr/interfaces/wlr_buffer.h>
+
+/* Pooled buffer widths are rounded up to a multiple of this */
+#define LW_BUFFER_POOL_BUCKET 128
+/* Default cap on memory kept in idle pooled buffers */
+#define LW_BUFFER_POOL_DEFAULT_CAP (16 * 1024 * 1024)
+
+struct lw_buffer_pool;
+
+/*
+ * A wlr_buffer backed by plain malloc'd memory.  Used for everything the
+ * compositor rasterizes itself (title bars, wallpaper) and hands to the
+ * scene graph through a wlr_scene_buffer node.
+ */
+struct lw_pixel_buffer {
+    struct wlr_buffer base;
+    void *data;
+    size_t stride;
+    uint32_t format;                     /* DRM_FORMAT_* */
+
+    /* Pool bookkeeping (pool == NULL for standalone buffers) */
+    struct lw_buffer_pool *pool;
+    struct wl_list pool_link;            /* lw_buffer_pool.idle */
+    int bucket_width;
+    size_t capacity;
+};
+
+/*
+ * Recycles pixel buffers of the same bucket (width rounded up to
+ * LW_BUFFER_POOL_BUCKET, exact height) once the scene graph and every
+ * other holder have released them.  Idle buffers are kept most recently
+ * released first and trimmed from the tail to stay under max_bytes.
+ * Buffers may be acquired from any thread; all fields are protected by
+ * lock.
+ */
+struct lw_buffer_pool {
+    pthread_mutex_t lock;
+    struct wl_list idle;                 /* lw_pixel_buffer.pool_link */
+    size_t max_bytes;
+
+    /* Stats */
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t bytes_held;                   /* idle buffers */
+    size_t bytes_in_use;                 /* handed out, not yet released */
+
+    int outstanding;
+    bool destroyed;
+};
+
+/* Allocate a zero-filled standalone buffer.  Drop it with wlr_buffer_drop(). */
+struct lw_pixel_buffer *lw_pixel_buffer_create(int width, int height,
+                                                uint32_t format);
+
+struct lw_buffer_pool *lw_buffer_pool_create(size_t max_bytes);
+
+/* Free idle buffers; buffers still in use are freed on release */
+void lw_buffer_pool_destroy(struct lw_buffer_pool *pool);
+
+/*
+ * Get a buffer from the pool.  The stride may be larger than width * 4
+ * and the contents are undefined: callers must write every pixel.
+ * Drop it with wlr_buffer_drop(); it returns to the pool once unlocked.
+ */
+struct lw_pixel_buffer *lw_buffer_pool_acquire(struct lw_buffer_pool *pool,
+                                                int width, int height,
+                                                uint32_t format);
+
+#endif /* LWINDESK_BUFFER_H */
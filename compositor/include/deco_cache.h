@@ -0,0 +1,61 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * compositor/include/deco_cache.h - Title bar text and sprite cache
+ */
+
+#ifndef LWINDESK_DECO_CACHE_H
+#define LWINDESK_DECO_CACHE_H
+
+#include <stdint.h>
+#include <pango/pangocairo.h>
+#include <wlr/types/wlr_buffer.h>
+
+/* Number of shaped title layouts kept per cache */
+#define LW_DECO_LAYOUT_CACHE_SIZE 32
+
+struct lw_buffer_pool;
+
+struct lw_deco_layout_entry {
+    char *title;
+    uint32_t hash;
+    PangoLayout *layout;
+    int max_width;                       /* ellipsize width, -1 = none */
+    int text_w, text_h;
+    uint64_t last_used;
+};
+
+/*
+ * Everything render_titlebar() used to rebuild on each call: the Pango
+ * context and font, shaped layouts keyed by title, and the pre-rendered
+ * minimize/maximize/close button strip.  A cache is not thread-safe;
+ * each rendering thread owns its own.
+ */
+struct lw_deco_cache {
+    struct lw_buffer_pool *pool;         /* title bar buffers come from here */
+
+    PangoFontMap *font_map;
+    PangoContext *context;
+    PangoFontDescription *font;
+
+    struct lw_deco_layout_entry layouts[LW_DECO_LAYOUT_CACHE_SIZE];
+    uint64_t clock;
+
+    /* Button sprite (3 * LW_DECO_BUTTON_WIDTH wide, ARGB32) */
+    uint32_t *buttons;
+    int buttons_height;
+
+    uint64_t layout_hits;
+    uint64_t layout_misses;
+};
+
+struct lw_deco_cache *lw_deco_cache_create(struct lw_buffer_pool *pool);
+void lw_deco_cache_destroy(struct lw_deco_cache *cache);
+
+/* Render a complete title bar into a new buffer (NULL on failure) */
+struct wlr_buffer *lw_deco_cache_render_titlebar(struct lw_deco_cache *cache,
+                                                  int width, int height,
+                                                  const char *title);
+
+#endif /* LWINDESK_DECO_CACHE_H */
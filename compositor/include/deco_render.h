@@ -0,0 +1,86 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * compositor/include/deco_render.h - Title bar rasterization worker pool
+ */
+
+#ifndef LWINDESK_DECO_RENDER_H
+#define LWINDESK_DECO_RENDER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <wayland-server-core.h>
+
+#include "server.h"
+
+/* Number of title bar rendering threads */
+#define LW_DECO_WORKERS 2
+
+struct lw_deco_cache;
+
+enum lw_deco_job_state {
+    LW_DECO_JOB_QUEUED,
+    LW_DECO_JOB_RUNNING,
+    LW_DECO_JOB_DONE,
+};
+
+/*
+ * One title bar to rasterize.  state, the list links and the render
+ * inputs are protected by lw_deco_renderer.lock; view and view_link are
+ * only ever touched on the main thread.
+ */
+struct lw_deco_job {
+    struct wl_list link;                 /* lw_deco_renderer.queue / done */
+    enum lw_deco_job_state state;
+
+    int width, height;
+    char *title;
+    uint32_t generation;
+    struct wlr_buffer *result;
+
+    struct lw_view *view;                /* NULL once the view is gone */
+    struct wl_list view_link;            /* lw_decoration.jobs */
+};
+
+struct lw_deco_worker {
+    struct lw_deco_renderer *renderer;
+    pthread_t thread;
+    struct lw_deco_cache *cache;         /* per thread: caches aren't shared */
+};
+
+struct lw_deco_renderer {
+    struct lw_server *server;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct wl_list queue;                /* lw_deco_job.link, QUEUED */
+    struct wl_list done;                 /* lw_deco_job.link, DONE */
+    bool stopping;
+
+    struct lw_deco_worker workers[LW_DECO_WORKERS];
+    int worker_count;
+
+    /* Workers signal finished jobs to the main loop through this */
+    int event_fd;
+    struct wl_event_source *event_source;
+};
+
+/* Start the worker pool.  Returns NULL if threads can't be started;
+ * callers then render synchronously. */
+struct lw_deco_renderer *lw_deco_renderer_create(struct lw_server *server);
+
+/* Stop workers and drop unfinished jobs.  Call once views are gone. */
+void lw_deco_renderer_destroy(struct lw_deco_renderer *renderer);
+
+/* Queue a title bar for a view.  A not-yet-started job for the same
+ * view is updated in place instead of queueing another. */
+void lw_deco_renderer_submit(struct lw_deco_renderer *renderer,
+                             struct lw_view *view, int width, int height,
+                             const char *title);
+
+/* Forget a view's outstanding jobs; their results will be discarded */
+void lw_deco_renderer_cancel(struct lw_deco_renderer *renderer,
+                             struct lw_view *view);
+
+#endif /* LWINDESK_DECO_RENDER_H */
@@ -0,0 +1,48 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * compositor/include/histogram.h - Fixed-size lock-free latency histograms
+ */
+
+#ifndef LWINDESK_HISTOGRAM_H
+#define LWINDESK_HISTOGRAM_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Log-linear buckets over microseconds: values below 4 get one bucket
+ * each, then every power of two is split into 4 sub-buckets (~25%
+ * resolution), up to about 8 seconds.  Recording is a couple of relaxed
+ * atomic adds, so any thread may record or read without locking; a
+ * reader racing a writer sees a slightly stale but usable snapshot.
+ */
+#define LW_HISTOGRAM_SUB_BUCKETS 4
+#define LW_HISTOGRAM_BUCKETS 88
+
+struct lw_histogram {
+    _Atomic uint64_t buckets[LW_HISTOGRAM_BUCKETS];
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum_us;
+    _Atomic uint64_t max_us;
+};
+
+/* Record one sample, in microseconds */
+void lw_histogram_record(struct lw_histogram *hist, uint64_t us);
+
+/* Record the interval between two CLOCK_MONOTONIC timestamps */
+void lw_histogram_record_interval(struct lw_histogram *hist,
+                                  const struct timespec *start,
+                                  const struct timespec *end);
+
+/* Upper bound (us) of the bucket holding the given percentile (0-100);
+ * 0 if the histogram is empty */
+uint64_t lw_histogram_percentile(const struct lw_histogram *hist,
+                                 double percentile);
+
+uint64_t lw_histogram_count(const struct lw_histogram *hist);
+uint64_t lw_histogram_max(const struct lw_histogram *hist);
+
+#endif /* LWINDESK_HISTOGRAM_H */
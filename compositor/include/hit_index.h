@@ -0,0 +1,61 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * compositor/include/hit_index.h - Cursor hit testing over mapped views
+ */
+
+#ifndef LWINDESK_HIT_INDEX_H
+#define LWINDESK_HIT_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "server.h"
+#include "view.h"
+
+/*
+ * Views in stacking order (topmost first) with their layout position,
+ * collected from the scene graph.  Sizes (title bar width, surface
+ * extents) are read live at query time, so only stacking, position and
+ * visibility changes need to invalidate it; the index is rebuilt lazily
+ * on the next query.
+ */
+struct lw_hit_entry {
+    struct lw_view *view;
+    int x, y;                            /* view->scene_tree in layout */
+};
+
+struct lw_hit_index {
+    struct lw_hit_entry *entries;
+    int count;
+    int capacity;
+    bool dirty;
+
+    uint64_t queries;
+    uint64_t rebuilds;
+};
+
+/* Result of a hit test; view and layer both NULL means the desktop */
+struct lw_hit {
+    struct lw_view *view;
+    struct lw_layer_surface *layer;      /* shell panel instead of a view */
+    enum lw_deco_button button;          /* LW_DECO_NONE off the title bar */
+    struct wlr_surface *surface;         /* NULL on decorations */
+    double sx, sy;                       /* surface-local coordinates */
+};
+
+struct lw_hit_index *lw_hit_index_create(void);
+void lw_hit_index_destroy(struct lw_hit_index *index);
+
+/* Views moved, restacked, appeared or disappeared */
+void lw_hit_index_invalidate(struct lw_server *server);
+
+/* Resolve decoration button, view or layer surface, and surface under
+ * a layout point in one pass: top and overlay layers first, then views,
+ * then bottom and background layers.  Returns false if nothing but the
+ * wallpaper is there. */
+bool lw_hit_test(struct lw_server *server, double lx, double ly,
+                 struct lw_hit *hit);
+
+#endif /* LWINDESK_HIT_INDEX_H */
@@ -33,6 +33,14 @@ void lw_cursor_frame(struct wl_listener *listener, void *data);
 /* Process cursor movement (snap zone detection) */
 void lw_process_cursor_motion(struct lw_server *server, uint32_t time);
 
+/* Read LWINDESK_MOTION_COALESCE: unset/"off" processes every motion
+ * event, "frame" once per output frame, a number N once per N ms */
+void lw_input_init_motion(struct lw_server *server);
+void lw_input_finish_motion(struct lw_server *server);
+
+/* Run the deferred motion pass, if any (called from output frames) */
+void lw_cursor_flush_motion(struct lw_server *server);
+
 /* Seat request handlers */
 void lw_seat_request_cursor(struct wl_listener *listener, void *data);
 void lw_seat_request_set_selection(struct wl_listener *listener, void *data);
@@ -8,13 +8,55 @@
 #ifndef LWINDESK_IPC_H
 #define LWINDESK_IPC_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ipc_protocol.h"
 #include "server.h"
 
 /* Initialize IPC socket at $XDG_RUNTIME_DIR/lwindesk-ipc */
 int lw_ipc_init(struct lw_server *server);
 
-/* Send a newline-delimited message to all connected IPC clients */
-void lw_ipc_send(struct lw_server *server, const char *message);
+/* Queue an event (enum lw_ipc_type) with a fixed-size payload for every
+ * client subscribed to its class; payload may be NULL when size is 0.
+ * Output is flushed when the event loop goes idle. */
+void lw_ipc_send(struct lw_server *server, uint16_t type,
+                 const void *payload, size_t size);
+
+/* Send a state event: one that a newer event with the same type and
+ * key supersedes.  Clients that have fallen behind get only the latest. */
+void lw_ipc_send_state(struct lw_server *server, uint16_t type,
+                       uint32_t key, const void *payload, size_t size);
+
+/* Whether any client is subscribed to the event type (or the event
+ * trace is recording); lets callers skip building payloads nobody reads */
+bool lw_ipc_wants(struct lw_server *server, uint16_t type);
+
+/* Tell clients which workspace is active */
+void lw_ipc_send_workspace(struct lw_server *server);
+
+/* Tell clients which view has keyboard focus (NULL: none) */
+void lw_ipc_send_focus(struct lw_server *server, struct lw_view *view);
+
+/* Tell clients Task View opened, closed (view_id: the window picked, 0 if
+ * none) or highlights another window */
+void lw_ipc_send_overview(struct lw_server *server, bool visible,
+                          uint32_t view_id);
+
+/* Tell clients which snap zone a dragged window would drop into */
+void lw_ipc_send_snap_preview(struct lw_server *server,
+                              enum lw_snap_zone zone);
+
+/* Window list deltas (LW_IPC_CLASS_WINDOWS).  Views that are not
+ * mapped are skipped.  Title changes are held back and sent
+ * at most once per LW_IPC_TITLE_DELAY_MS per view. */
+void lw_ipc_send_view_created(struct lw_server *server, struct lw_view *view);
+void lw_ipc_send_view_destroyed(struct lw_server *server,
+                                struct lw_view *view);
+void lw_ipc_send_view_title(struct lw_server *server, struct lw_view *view);
+void lw_ipc_send_view_app_id(struct lw_server *server, struct lw_view *view);
+void lw_ipc_send_view_state(struct lw_server *server, struct lw_view *view);
 
 /* Clean up IPC resources */
 void lw_ipc_destroy(struct lw_server *server);
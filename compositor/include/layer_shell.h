@@ -0,0 +1,75 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * compositor/include/layer_shell.h - Layer shell surfaces (panels, menus)
+ */
+
+#ifndef LWINDESK_LAYER_SHELL_H
+#define LWINDESK_LAYER_SHELL_H
+
+#include <stdbool.h>
+#include <wlr/types/wlr_layer_shell_v1.h>
+#include <wlr/util/box.h>
+
+#include "server.h"
+
+/* zwlr_layer_shell_v1 layers, bottom to top */
+#define LW_LAYER_COUNT 4
+
+/*
+ * A layer surface lives on one output, in that output's scene tree for
+ * its layer, so it never mixes with the workspaces' views: focusing a
+ * window cannot restack it.  Its position comes from the anchors and
+ * the exclusive zones of the surfaces arranged before it.
+ */
+struct lw_layer_surface {
+    struct wl_list link;                 /* lw_output.layers[layer] */
+    struct lw_server *server;
+    struct lw_output *output;            /* NULL once the output is gone */
+    struct wlr_layer_surface_v1 *layer_surface;
+    struct wlr_scene_layer_surface_v1 *scene;
+    struct wlr_box box;                  /* layout coords, once arranged */
+    bool mapped;
+
+    struct wl_listener map;
+    struct wl_listener unmap;
+    struct wl_listener commit;
+    struct wl_listener new_popup;
+    struct wl_listener destroy;
+};
+
+/* Advertise zwlr_layer_shell_v1 and create the global layer trees */
+void lw_layer_shell_init(struct lw_server *server);
+
+/* Per-output layer trees; on destroy the output's surfaces are closed */
+void lw_layer_output_init(struct lw_output *output);
+void lw_layer_output_finish(struct lw_output *output);
+
+/*
+ * Place the output's layer surfaces and recompute its usable area
+ * (lw_output.usable_area).  Windows snapped or maximized on the output
+ * are fitted again when the usable area changes.
+ */
+void lw_layer_arrange(struct lw_output *output);
+
+/* Show or hide the output's layers below the overlay, for a fullscreen
+ * view on it */
+void lw_layer_output_cover(struct lw_output *output, bool cover);
+
+/* Usable area of the output at a layout point (or of the first output),
+ * in layout coordinates; false when there is no output */
+bool lw_layer_usable_area_at(struct lw_server *server, double lx, double ly,
+                             struct wlr_box *area);
+
+/* Mapped layer surface at a layout point: the top and overlay layers
+ * (above) or the bottom and background layers (below the views) */
+struct wlr_surface *lw_layer_surface_at(struct lw_server *server,
+                                        double lx, double ly, bool above,
+                                        double *sx, double *sy,
+                                        struct lw_layer_surface **out);
+
+/* Keyboard focus for a layer surface that asks for it */
+void lw_layer_focus(struct lw_layer_surface *layer);
+
+#endif /* LWINDESK_LAYER_SHELL_H */
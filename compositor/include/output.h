@@ -8,7 +8,13 @@
 #ifndef LWINDESK_OUTPUT_H
 #define LWINDESK_OUTPUT_H
 
+#include <stdint.h>
+#include <time.h>
+
+#include "histogram.h"
+#include "layer_shell.h"
 #include "server.h"
+#include "snap.h"
 
 struct lw_output {
     struct wl_list link;                 /* lw_server.outputs */
@@ -16,7 +22,57 @@ struct lw_output {
     struct wlr_output *wlr_output;
     struct wlr_scene_output *scene_output;
 
+    /* Frame scheduling: set when something on this output changed since
+     * the last commit.  output_frame() skips the commit (but still
+     * releases frame callbacks) while this is clear and the scene has
+     * no damage. */
+    bool dirty;
+
+    /* Frame counters, readable by IPC / debugging tools */
+    uint64_t frames_committed;
+    uint64_t frames_skipped;
+
+    /*
+     * Fullscreen view covering this output.  While set, everything else
+     * on the output is disabled so wlroots can scan the client buffer
+     * out directly.  scanning_out reports what the last committed frame
+     * actually did.
+     */
+    struct lw_view *fullscreen_view;
+    bool scanning_out;
+    uint64_t frames_scanout;
+    uint64_t frames_composited;
+
+    /*
+     * Frame timing, all in microseconds:
+     *   commit:  time spent in wlr_scene_output_commit()
+     *   latency: vblank (frame event) to commit submitted
+     *   present: commit submitted to the frame reaching the screen,
+     *            where the backend reports presentation
+     */
+    struct lw_histogram hist_commit;
+    struct lw_histogram hist_latency;
+    struct lw_histogram hist_present;
+    struct timespec last_present;        /* zero until the first present */
+    struct timespec last_commit_end;
+    bool awaiting_present;
+
+    /* Layer surfaces per layer, bottom to top, each layer's tree for this
+     * output (under lw_server.layer_trees), and the layout area they
+     * leave to windows; see lw_layer_arrange() */
+    struct wl_list layers[LW_LAYER_COUNT];   /* lw_layer_surface.link */
+    struct wlr_scene_tree *layer_trees[LW_LAYER_COUNT];
+    struct wlr_box usable_area;
+    /* Snap zones from the usable area, kept with it */
+    struct lw_snap_table snap;
+
+    /* Wallpaper node and the pixel size it was rasterized at */
+    struct wlr_scene_buffer *background;
+    int background_width, background_height;
+
     struct wl_listener frame;
+    struct wl_listener commit;
+    struct wl_listener present;
     struct wl_listener request_state;
     struct wl_listener destroy;
 };
@@ -24,4 +80,19 @@ struct lw_output {
 /* Handle a new output being connected */
 void lw_output_new(struct wl_listener *listener, void *data);
 
+/* Output layout changed: reposition per-output content */
+void lw_output_layout_change(struct wl_listener *listener, void *data);
+
+/* New client surface: schedule frames for its frame callbacks */
+void lw_output_new_surface(struct wl_listener *listener, void *data);
+
+/* Mark an output dirty and ask the backend for a frame */
+void lw_output_schedule_frame(struct lw_output *output);
+
+/* Mark every output intersecting a layout-space box dirty */
+void lw_output_damage_box(struct lw_server *server, const struct wlr_box *box);
+
+/* Mark every output dirty (e.g. after a workspace switch) */
+void lw_output_damage_all(struct lw_server *server);
+
 #endif /* LWINDESK_OUTPUT_H */
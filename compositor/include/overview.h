@@ -0,0 +1,78 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * compositor/include/overview.h - Task View overview drawn by the compositor
+ */
+
+#ifndef LWINDESK_OVERVIEW_H
+#define LWINDESK_OVERVIEW_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wlr/util/box.h>
+#include <xkbcommon/xkbcommon.h>
+
+#include "server.h"
+#include "view.h"
+
+/*
+ * Task View: the windows of one workspace in a grid, and a strip with a
+ * miniature of every workspace below it.  Thumbnails are scene buffers
+ * showing the clients' own current buffers (and title bars) scaled with
+ * a destination size, so opening it builds a few scene nodes and costs
+ * one composited frame; no window is captured or copied.  The nodes are
+ * rebuilt when windows or the workspace change, and a client commit
+ * points its thumbnails at the new buffer and refits them to its size.
+ */
+struct lw_overview_thumb {
+    struct lw_view *view;
+    struct wlr_scene_buffer *title;      /* NULL without decorations */
+    struct wlr_scene_buffer *content;
+    struct wlr_box box;                  /* layout coords, title included */
+    struct wlr_box cell;                 /* grid cell or desk it is fit to */
+};
+
+struct lw_overview_desk {
+    struct lw_workspace *workspace;
+    struct wlr_box box;                  /* layout coords */
+};
+
+struct lw_overview {
+    struct lw_server *server;
+    struct wlr_scene_tree *tree;         /* above the windows while open */
+    struct wlr_box area;                 /* the output it covers */
+    struct lw_workspace *workspace;      /* whose windows are in the grid */
+
+    struct lw_overview_thumb *windows;   /* grid, selectable */
+    int window_count;
+    int columns;
+    int selected;                        /* index in windows, -1: none */
+
+    struct lw_overview_thumb *minis;     /* inside the desks */
+    int mini_count;
+    struct lw_overview_desk *desks;
+    int desk_count;
+
+    struct wlr_scene_rect *highlight;    /* behind the selected window */
+};
+
+/* Open or close Task View; closing without activating anything */
+void lw_overview_show(struct lw_server *server);
+void lw_overview_hide(struct lw_server *server);
+void lw_overview_toggle(struct lw_server *server);
+
+/* Windows or workspaces came or went, or another workspace is active:
+ * lay out again (no-op while closed) */
+void lw_overview_refresh(struct lw_server *server);
+
+/* The view committed a new buffer or title bar */
+void lw_overview_view_changed(struct lw_view *view);
+
+/* Input while open; return true when consumed */
+bool lw_overview_handle_key(struct lw_server *server, xkb_keysym_t sym,
+                            uint32_t modifiers);
+bool lw_overview_handle_motion(struct lw_server *server, double lx, double ly);
+bool lw_overview_handle_button(struct lw_server *server, double lx, double ly);
+
+#endif /* LWINDESK_OVERVIEW_H */
@@ -8,6 +8,7 @@
 #ifndef LWINDESK_SERVER_H
 #define LWINDESK_SERVER_H
 
+#include <stdio.h>
 #include <wayland-server-core.h>
 #include <wlr/backend.h>
 #include <wlr/render/allocator.h>
@@ -24,17 +25,76 @@
 #include <wlr/types/wlr_xdg_decoration_v1.h>
 
 /* Forward declarations */
+struct lw_output;
 struct lw_view;
 struct lw_workspace;
+struct lw_deco_cache;
+struct lw_buffer_pool;
+struct lw_deco_renderer;
+struct lw_hit_index;
+struct lw_snapshot;
+struct lw_overview;
+struct lw_switcher;
+struct lw_thumbnail;
+struct lw_thumbnailer;
 
-/* Maximum number of connected IPC clients */
-#define LW_IPC_MAX_CLIENTS 8
+/* Pending connections the IPC listener queues before accepting */
+#define LW_IPC_LISTEN_BACKLOG SOMAXCONN
 
-/* IPC client connection */
+/* Largest request message a client may send (see ipc_protocol.h) */
+#define LW_IPC_MAX_REQUEST 512
+
+/* Receive buffer per client; holds many pipelined requests */
+#define LW_IPC_INBUF_SIZE 4096
+
+/* Queued output per client; a client that falls this far behind is
+ * disconnected */
+#define LW_IPC_OUTBUF_SIZE (64 * 1024)
+
+/* Title changes are sent at most this often per view (about a frame) */
+#define LW_IPC_TITLE_DELAY_MS 16
+
+/* Queued messages per client (power of two) */
+#define LW_IPC_OUTQ_LEN 1024
+
+/* A serialized message, shared by every client it is queued for */
+struct lw_ipc_buffer {
+    int refcount;
+    uint32_t len;
+    uint16_t type;
+    bool state;                          /* newer same type+key replaces */
+    uint32_t key;
+    int fd;                              /* sent along (SCM_RIGHTS) and
+                                            closed with the buffer, or -1 */
+    _Alignas(8) unsigned char data[];
+};
+
+/*
+ * IPC client connection.  Allocated per connection and never moved, so
+ * the event source can hold a pointer to it.  A disconnected client
+ * (fd < 0) sits on lw_ipc.closed until the next idle, since callers up
+ * the stack may still look at it.
+ */
 struct lw_ipc_client {
+    struct wl_list link;                 /* lw_ipc.clients or .closed */
+    uint32_t id;                         /* for logs, never reused */
     int fd;
     struct wl_event_source *event_source;
     struct lw_server *server;
+    /* Requests are decoded in place, so keep them aligned */
+    _Alignas(8) unsigned char inbuf[LW_IPC_INBUF_SIZE];
+    size_t inlen;
+
+    /* Event classes (enum lw_ipc_event_class) this client wants */
+    uint32_t subscriptions;
+
+    /* Outbound queue: entries [out_tail, out_head) wrap in outq, the
+     * first out_offset bytes of the tail entry are already sent */
+    struct lw_ipc_buffer **outq;         /* LW_IPC_OUTQ_LEN entries */
+    uint32_t out_head, out_tail;
+    size_t out_offset;
+    size_t out_bytes;                    /* queued, not yet sent */
+    bool want_writable;                  /* WL_EVENT_WRITABLE armed */
 };
 
 /* IPC state for shell communication */
@@ -42,8 +102,38 @@ struct lw_ipc {
     int listen_fd;
     struct wl_event_source *listen_source;
     char socket_path[256];
-    struct lw_ipc_client clients[LW_IPC_MAX_CLIENTS];
+    struct wl_list clients;              /* lw_ipc_client.link, connected */
+    struct wl_list closed;               /* disconnected, freed when idle */
     int client_count;
+    uint32_t next_client_id;
+    uint32_t subscriptions;              /* union over all clients */
+    uint32_t class_clients[32];          /* subscribers per class bit */
+
+    /* Queued output is flushed once per event loop iteration */
+    struct wl_event_source *flush_idle;
+
+    /* Views with a title change not yet sent (lw_view.ipc_title_link),
+     * sent together when title_timer fires */
+    struct wl_list title_pending;
+    struct wl_event_source *title_timer;
+
+    /* Counters for LW_IPC_REQUEST_QUEUE_STATS */
+    uint64_t messages_serialized;        /* buffers built */
+    uint64_t messages_queued;            /* buffer references queued */
+    uint64_t messages_coalesced;         /* replaced while queued */
+    uint64_t sendmsg_calls;
+    uint64_t bytes_sent;
+    uint64_t queue_high_water;           /* deepest client queue, bytes */
+    uint64_t slow_disconnects;           /* clients dropped for not reading */
+    uint64_t bytes_dropped;              /* queued output they never got */
+    uint64_t titles_coalesced;           /* title changes folded together */
+    uint64_t clients_accepted;
+    int clients_peak;                    /* most connected at once */
+
+    /* Event trace (LWINDESK_IPC_TRACE), NULL when not recording */
+    FILE *trace;
+    uint64_t trace_start_ns;
+    uint64_t trace_records;
 };
 
 /* Snap zones for Windows 11-style snap layouts */
@@ -65,6 +155,13 @@ enum lw_cursor_mode {
     LW_CURSOR_RESIZE,
 };
 
+/* When pointer motion is processed (LWINDESK_MOTION_COALESCE) */
+enum lw_motion_mode {
+    LW_MOTION_IMMEDIATE,                 /* every event (default) */
+    LW_MOTION_PER_FRAME,                 /* once per output frame */
+    LW_MOTION_TIMER,                     /* once per motion_interval_ms */
+};
+
 /* Main server state */
 struct lw_server {
     struct wl_display *wl_display;
@@ -74,15 +171,28 @@ struct lw_server {
     struct wlr_scene *scene;
     struct wlr_scene_output_layout *scene_layout;
 
+    /* Wallpaper: one buffer node per output, beneath everything else */
+    struct wlr_scene_tree *background_tree;
+
+    /* Every client surface, for frame callbacks (see output.c) */
+    struct wl_listener new_surface;
+
     struct wlr_xdg_shell *xdg_shell;
     struct wl_listener new_xdg_surface;
 
+    /* Layer shell: one tree per layer, bottom to top, each holding one
+     * tree per output (see layer_shell.c) */
+    struct wlr_layer_shell_v1 *layer_shell;
+    struct wl_listener new_layer_surface;
+    struct wlr_scene_tree *layer_trees[4];
+
     struct wlr_xdg_decoration_manager_v1 *xdg_decoration_mgr;
     struct wl_listener new_xdg_decoration;
 
     struct wlr_output_layout *output_layout;
     struct wl_list outputs;              /* lw_output.link */
     struct wl_listener new_output;
+    struct wl_listener layout_change;
 
     struct wlr_cursor *cursor;
     struct wlr_xcursor_manager *cursor_mgr;
@@ -92,6 +202,18 @@ struct lw_server {
     struct wl_listener cursor_axis;
     struct wl_listener cursor_frame;
 
+    /* Pointer motion coalescing: the cursor moves on every event and
+     * relative motion is forwarded as it comes, but focus, hit test and
+     * snap detection run once per frame/tick */
+    struct wlr_relative_pointer_manager_v1 *relative_pointer_mgr;
+    enum lw_motion_mode motion_mode;
+    int motion_interval_ms;
+    struct wl_event_source *motion_timer;
+    bool motion_pending;
+    uint32_t motion_time;                /* of the latest pending event */
+    uint64_t motion_events;              /* motion events received */
+    uint64_t motion_passes;              /* lw_process_cursor_motion runs */
+
     struct wlr_seat *seat;
     struct wl_listener new_input;
     struct wl_listener request_cursor;
@@ -100,11 +222,23 @@ struct lw_server {
 
     /* Views (windows) */
     struct wl_list views;                /* lw_view.link */
+    uint32_t next_view_id;               /* last lw_view.id handed out */
+    /* Views in stacking order for cursor hit tests */
+    struct lw_hit_index *hit_index;
 
-    /* Virtual desktops (workspaces) */
-    struct wl_list workspaces;           /* lw_workspace.link */
-    struct lw_workspace *active_workspace;
+    /* Title bar font, layout and sprite cache (main thread) */
+    struct lw_deco_cache *deco_cache;
+    /* Recycled pixel buffers for title bars */
+    struct lw_buffer_pool *buffer_pool;
+    /* Title bar worker threads (NULL: render on the main thread) */
+    struct lw_deco_renderer *deco_renderer;
+
+    /* Virtual desktops (workspaces), indexed by lw_workspace.index */
+    struct wlr_scene_tree *workspace_tree;   /* parent of their trees */
+    struct lw_workspace **workspaces;
     int workspace_count;
+    int workspace_capacity;
+    struct lw_workspace *active_workspace;
 
     /* Interactive move/resize state */
     enum lw_cursor_mode cursor_mode;
@@ -112,12 +246,29 @@ struct lw_server {
     double grab_x, grab_y;
     struct wlr_box grab_geobox;
     uint32_t resize_edges;
+    uint64_t resize_requests;            /* sizes the pointer asked for */
+    uint64_t resize_configures;          /* of those, sent to clients */
 
-    /* Snap state */
+    /* Snap state: the zone a drop would use, and the scene node showing
+     * it (built on first use: a fill and four outline rects) */
     enum lw_snap_zone pending_snap;
+    struct wlr_scene_tree *snap_preview;
+    struct wlr_scene_rect *snap_preview_rects[5];
+    struct lw_output *snap_preview_output;   /* NULL: hidden */
+    enum lw_snap_zone snap_preview_zone;
+
+    /* Task View (NULL while closed) */
+    struct lw_overview *overview;
+    /* Alt+Tab session (NULL while Alt+Tab is not held) */
+    struct lw_switcher *switcher;
+    uint32_t switcher_serial;
 
     /* IPC for shell communication */
     struct lw_ipc ipc;
+    /* Window/workspace state shared with IPC clients (NULL if unavailable) */
+    struct lw_snapshot *snapshot;
+    /* Window thumbnails shared with IPC clients (NULL if unavailable) */
+    struct lw_thumbnailer *thumbnailer;
 
     /* Keyboard shortcut state: track Super key for tap detection */
     bool super_pressed;
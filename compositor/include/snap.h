@@ -8,16 +8,49 @@
 #ifndef LWINDESK_SNAP_H
 #define LWINDESK_SNAP_H
 
+#include <wlr/util/box.h>
+
 #include "server.h"
 
-/* Determine which snap zone the cursor is in based on position */
+#define LW_SNAP_ZONE_COUNT (LW_SNAP_MAXIMIZE + 1)
+
+/*
+ * An output's snap zones, worked out whenever its usable area or layout
+ * position changes: the pointer bands along its edges that trigger a
+ * zone while a window is dragged, and the box each zone gives a window.
+ * All in layout coordinates.
+ */
+struct lw_snap_table {
+    struct wlr_box box;                  /* the whole output */
+    int left, right;                     /* x < left, x > right: side bands */
+    int top;                             /* y < top: top edge */
+    int top_corner, bottom_corner;       /* y < top_corner, y > bottom_corner */
+    struct wlr_box zones[LW_SNAP_ZONE_COUNT];  /* title bar included */
+};
+
+/* Recompute the output's table from its layout box and usable area */
+void lw_snap_output_update(struct lw_output *output);
+
+/* The output is going away: drop a preview shown on it */
+void lw_snap_output_finish(struct lw_output *output);
+
+/* Output at a layout point by the snap tables (or the first output) */
+struct lw_output *lw_snap_output_at(struct lw_server *server,
+                                    double lx, double ly);
+
+/* Determine which snap zone the cursor is in, and on which output */
 enum lw_snap_zone lw_snap_zone_at(struct lw_server *server,
-                                    double cursor_x, double cursor_y);
+                                    double cursor_x, double cursor_y,
+                                    struct lw_output **output);
 
-/* Get the geometry for a snap zone on a given output */
-struct wlr_box lw_snap_zone_geometry(struct wlr_output *output,
+/* Get the geometry for a snap zone on a given output (empty for none) */
+struct wlr_box lw_snap_zone_geometry(const struct lw_output *output,
                                       enum lw_snap_zone zone);
 
+/* Show where a drop would put the window (LW_SNAP_NONE hides it) */
+void lw_snap_preview_show(struct lw_server *server, struct lw_output *output,
+                          enum lw_snap_zone zone);
+
 /* Snap zone names (for IPC / shell communication) */
 const char *lw_snap_zone_name(enum lw_snap_zone zone);
 
@@ -0,0 +1,46 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * compositor/include/snapshot.h - Shared-memory window/workspace snapshot
+ */
+
+#ifndef LWINDESK_SNAPSHOT_H
+#define LWINDESK_SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ipc_protocol.h"
+#include "server.h"
+
+/*
+ * A struct lw_ipc_snapshot in a sealed-size memfd that IPC clients map
+ * read-only.  Changes only mark it dirty; it is rebuilt once per event
+ * loop iteration, and rewritten under the seqlock (and announced) only
+ * when the contents actually differ.
+ */
+struct lw_snapshot {
+    struct lw_server *server;
+    int fd;
+    int ro_fd;                           /* read-only, handed to clients */
+    struct lw_ipc_snapshot *shared;      /* the memfd mapping */
+    struct lw_ipc_snapshot *scratch;     /* next contents, built privately */
+    struct wl_event_source *idle;        /* pending rebuild */
+    uint64_t publishes;
+    uint64_t rebuilds;
+};
+
+struct lw_snapshot *lw_snapshot_create(struct lw_server *server);
+void lw_snapshot_destroy(struct lw_snapshot *snapshot);
+
+/* Window or workspace state changed; rebuild when the loop goes idle */
+void lw_snapshot_mark_dirty(struct lw_server *server);
+
+/* Current sequence number (even) */
+uint32_t lw_snapshot_seq(struct lw_snapshot *snapshot);
+
+/* Read-only fd for clients (owned by the snapshot), or -1 */
+int lw_snapshot_fd(struct lw_snapshot *snapshot);
+
+#endif /* LWINDESK_SNAPSHOT_H */
@@ -0,0 +1,51 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * compositor/include/switcher.h - Alt+Tab window switcher
+ */
+
+#ifndef LWINDESK_SWITCHER_H
+#define LWINDESK_SWITCHER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <xkbcommon/xkbcommon.h>
+
+#include "ipc_protocol.h"
+#include "server.h"
+#include "view.h"
+
+/*
+ * One Alt+Tab session, from the first Tab until Alt is released.  The
+ * entries are copied from the workspace's switcher list, which is kept
+ * in focus order as windows are focused, so opening costs one copy and
+ * each Tab just moves the index; nothing is walked or compared while
+ * Alt is held.  The shell draws the list from the SWITCHER events.
+ */
+struct lw_switcher {
+    struct lw_server *server;
+    uint32_t serial;
+    uint32_t ids[LW_IPC_SWITCHER_MAX];   /* view ids, most recent first */
+    int count;
+    int selected;                        /* index in ids */
+};
+
+/* Alt+Tab (backward: Alt+Shift+Tab): open the switcher on the window
+ * focused before the current one, or move the selection on */
+void lw_switcher_step(struct lw_server *server, bool backward);
+
+/* Alt released: activate the selected window and close */
+void lw_switcher_commit(struct lw_server *server);
+
+/* Close without activating anything */
+void lw_switcher_cancel(struct lw_server *server);
+
+/* Keys while open; return true when consumed */
+bool lw_switcher_handle_key(struct lw_server *server, xkb_keysym_t sym,
+                            uint32_t modifiers);
+
+/* The view is going away: drop it from an open switcher */
+void lw_switcher_view_removed(struct lw_view *view);
+
+#endif /* LWINDESK_SWITCHER_H */
@@ -0,0 +1,114 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * compositor/include/thumbnail.h - Shared-memory window thumbnails
+ */
+
+#ifndef LWINDESK_THUMBNAIL_H
+#define LWINDESK_THUMBNAIL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wayland-server-core.h>
+
+#include "ipc_protocol.h"
+#include "server.h"
+
+/* Largest thumbnail; windows are scaled down to fit, never up */
+#define LW_THUMBNAIL_MAX_WIDTH 320
+#define LW_THUMBNAIL_MAX_HEIGHT 240
+
+/* Refreshes per second per window (LWINDESK_THUMBNAIL_RATE) */
+#define LW_THUMBNAIL_DEFAULT_RATE 4
+/* Memory for all thumbnails together (LWINDESK_THUMBNAIL_BUDGET, MiB) */
+#define LW_THUMBNAIL_DEFAULT_BUDGET (16 * 1024 * 1024)
+
+struct lw_thumbnailer;
+
+/*
+ * One window's thumbnail: a struct lw_ipc_thumbnail and its pixels in a
+ * sealed-size memfd that IPC clients map read-only.  It exists only
+ * once a client has asked for it, and is redrawn from the buffer the
+ * window commits, when that commit carries damage, at most once per
+ * interval.  A commit that comes too early keeps its buffer locked
+ * until the interval is over, so the last frame of a burst still makes
+ * it in.
+ */
+struct lw_thumbnail {
+    struct lw_thumbnailer *thumbnailer;
+    struct lw_view *view;
+    struct wl_list link;                 /* lw_thumbnailer.lru */
+    int fd;
+    int ro_fd;                           /* read-only, handed to clients */
+    struct lw_ipc_thumbnail *shared;     /* the memfd mapping */
+    size_t size;
+
+    bool active;                         /* shown: keep it current */
+    bool stale;                          /* changed since the last redraw */
+    uint64_t next_ns;                    /* earliest next redraw */
+    struct wlr_buffer *pending;          /* locked until next_ns */
+};
+
+/*
+ * All thumbnails, least recently requested last.  Creating one that
+ * would go over the budget evicts from the tail first.
+ */
+struct lw_thumbnailer {
+    struct lw_server *server;
+    struct wl_list lru;                  /* lw_thumbnail.link */
+    size_t budget;
+    size_t bytes;
+    uint64_t interval_ns;
+    struct wl_event_source *timer;       /* redraws held back by the rate */
+    uint64_t timer_ns;                   /* when it fires, 0: disarmed */
+
+    /* Box filter scratch: per source column channel sums, and the
+     * source range of every destination column */
+    uint32_t *sums;
+    int sums_width;
+    int columns[LW_THUMBNAIL_MAX_WIDTH + 1];
+
+    /* Stats */
+    uint64_t redraws;
+    uint64_t deferred;                   /* commits held back by the rate */
+    uint64_t evictions;
+    uint64_t unreadable;                 /* buffers without CPU access */
+};
+
+struct lw_thumbnailer *lw_thumbnailer_create(struct lw_server *server);
+void lw_thumbnailer_destroy(struct lw_thumbnailer *thumbnailer);
+
+/* A client wants the view's thumbnail: create it (NULL if that fails)
+ * and keep it current until released */
+struct lw_thumbnail *lw_thumbnail_request(struct lw_view *view);
+
+/* The client stopped showing it; it stays until evicted */
+void lw_thumbnail_release(struct lw_view *view);
+
+/* The view committed; redraw if it has a thumbnail and took damage */
+void lw_thumbnail_view_commit(struct lw_view *view);
+
+/* The view unmapped or is going away: drop its thumbnail */
+void lw_thumbnail_view_destroy(struct lw_view *view);
+
+/* What to tell clients about it (size 0 for NULL) */
+struct lw_ipc_thumbnail_info lw_thumbnail_info(struct lw_view *view);
+
+/* Read-only fd for clients (owned by the thumbnail), or -1 */
+int lw_thumbnail_fd(struct lw_thumbnail *thumb);
+
+/*
+ * Shrink a 32-bit image with a box filter: every destination pixel is
+ * the average of the source pixels it covers, per byte channel.  With
+ * opaque set the alpha channel comes out 0xff whatever the source has
+ * there (XRGB8888).  Strides are in bytes.  scratch holds
+ * 4 * src_width sums and columns dst_width + 1 entries.
+ */
+void lw_thumbnail_downscale(uint32_t *dst, int dst_width, int dst_height,
+                            size_t dst_stride, const uint32_t *src,
+                            int src_width, int src_height, size_t src_stride,
+                            bool opaque, uint32_t *scratch, int *columns);
+
+#endif /* LWINDESK_THUMBNAIL_H */
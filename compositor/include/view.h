@@ -28,15 +28,22 @@ enum lw_deco_button {
 struct lw_decoration {
 	struct wlr_scene_buffer *titlebar_buffer;
 	struct wlr_buffer *titlebar_wlr_buffer;
-	int width;
-	char *cached_title;
+	int width;                  /* width of the buffer on screen */
+	int pending_width;          /* width last requested from the renderer */
+	char *cached_title;         /* title last requested from the renderer */
 	bool has_decorations;
+
+	/* Asynchronous rendering (see deco_render.c) */
+	struct wl_list jobs;        /* lw_deco_job.view_link */
+	uint32_t generation;
+	uint32_t applied_generation;
 };
 
 /* A view represents a single toplevel window */
 struct lw_view {
     struct wl_list link;                 /* lw_server.views */
     struct lw_server *server;
+    uint32_t id;                         /* IPC handle, never reused */
     struct wlr_xdg_toplevel *xdg_toplevel;
     struct wlr_scene_tree *scene_tree;
 
@@ -51,6 +58,12 @@ struct lw_view {
     struct wl_listener request_minimize;
     struct wl_listener request_fullscreen;
     struct wl_listener set_title;
+    struct wl_listener set_app_id;
+
+    /* lw_ipc.title_pending while a title update is held back */
+    struct wl_list ipc_title_link;
+    /* Shared-memory thumbnail, once a client asked for one */
+    struct lw_thumbnail *thumbnail;
 
     /* Server-side decorations */
     struct lw_decoration deco;
@@ -62,13 +75,30 @@ struct lw_view {
     bool is_minimized;
     enum lw_snap_zone snap_zone;
 
-    /* Workspace assignment */
+    /* Interactive resize: at most one configure in flight.  Sizes asked
+     * for meanwhile replace each other in resize_next, which goes out
+     * once the client acks (see lw_view_resize) */
+    uint32_t resize_serial;          /* 0: nothing in flight */
+    uint32_t resize_edges;           /* WLR_EDGE_* that move */
+    struct wlr_box resize_sent;      /* tree position, surface size */
+    struct wlr_box resize_next;
+    bool resize_queued;
+
+    /* Fullscreen: geometry to return to, and the output it covers */
+    bool is_fullscreen;
+    bool fullscreen_on_map;          /* requested before the first map */
+    struct wlr_box fullscreen_saved;
+    struct lw_output *fullscreen_output;
+    /* Disabled because a fullscreen view covers this view's output */
+    bool hidden_by_fullscreen;
+
+    /* Workspace assignment (NULL while unmapped) */
     struct lw_workspace *workspace;
+    struct wl_list workspace_link;   /* lw_workspace.views */
 
     /* Window state */
     int x, y;
     bool mapped;
-    bool is_shell_window;
 };
 
 /* Create a new view for a toplevel surface */
@@ -78,21 +108,55 @@ struct lw_view *lw_view_create(struct lw_server *server,
 /* Focus this view (raise + keyboard focus) */
 void lw_view_focus(struct lw_view *view);
 
-/* Snap a view to a zone */
+/* Focus this view wherever it is: switch to its workspace and
+ * unminimize it if needed (taskbar click, Task View pick) */
+void lw_view_activate(struct lw_view *view);
+
+/* Snap a view to a zone of the output it is on, or of the given one */
 void lw_view_snap(struct lw_view *view, enum lw_snap_zone zone);
+void lw_view_snap_on(struct lw_view *view, struct lw_output *output,
+                     enum lw_snap_zone zone);
+
+/*
+ * Ask the client for a new size during an interactive resize.  box is
+ * the scene tree position and the surface size; the edges not in edges
+ * stay where they are whatever size the client settles on.  Only one
+ * configure is in flight per view: while it is, the latest box waits.
+ */
+void lw_view_resize(struct lw_view *view, struct wlr_box box, uint32_t edges);
+
+/* The view committed: if that acked the resize in flight, place the
+ * view for the size it took and send the waiting one.  True if so. */
+bool lw_view_resize_commit(struct lw_view *view);
 
 /* Restore a view from snapped/maximized state */
 void lw_view_restore(struct lw_view *view);
 
+/* Enter or leave fullscreen on the output under the view */
+void lw_view_set_fullscreen(struct lw_view *view, bool fullscreen);
+
+/* Hide (or show again) what a fullscreen view covers, as its workspace
+ * is switched to (or away from) */
+void lw_view_fullscreen_cover(struct lw_view *view, bool cover);
+
 /* Minimize a view (hide from scene) */
 void lw_view_minimize(struct lw_view *view);
 
 /* Unminimize a view (show in scene) */
 void lw_view_unminimize(struct lw_view *view);
 
+/* Schedule a frame on every output the view covers */
+void lw_view_damage(struct lw_view *view);
+
 /* Close a view */
 void lw_view_close(struct lw_view *view);
 
+/* Minimize every mapped view on the active workspace (show desktop) */
+void lw_view_minimize_all(struct lw_server *server);
+
+/* Find a mapped view by its IPC id */
+struct lw_view *lw_view_from_id(struct lw_server *server, uint32_t id);
+
 /* Get the view at a given layout coordinate */
 struct lw_view *lw_view_at(struct lw_server *server, double lx, double ly,
                             struct wlr_surface **surface,
@@ -107,6 +171,10 @@ void lw_view_destroy_decorations(struct lw_view *view);
 /* Update decoration size to match window width */
 void lw_view_update_decorations(struct lw_view *view);
 
+/* Show a rendered title bar buffer; takes over the caller's reference */
+void lw_view_set_titlebar_buffer(struct lw_view *view,
+                                 struct wlr_buffer *buffer, int width);
+
 /* Check if a scene node is a decoration button, return the button type */
 enum lw_deco_button lw_deco_button_at(struct lw_server *server,
                                         double lx, double ly,
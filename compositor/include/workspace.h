@@ -8,28 +8,63 @@
 #ifndef LWINDESK_WORKSPACE_H
 #define LWINDESK_WORKSPACE_H
 
+#include "ipc_protocol.h"
 #include "server.h"
 
+/* Upper bound on workspaces; the table grows on demand up to this */
+#define LW_WORKSPACE_MAX 64
+
+/*
+ * Every workspace owns a scene tree under lw_server.workspace_tree, and
+ * the views on it live in that tree, so switching is one node disabled
+ * and one enabled.  Panels are layer surfaces, outside on every
+ * workspace.
+ */
 struct lw_workspace {
-    struct wl_list link;                 /* lw_server.workspaces */
     struct lw_server *server;
-    int index;
+    int index;                           /* slot in lw_server.workspaces */
     char name[64];
-    struct wl_list views;                /* views assigned to this workspace */
+    struct wl_list views;                /* lw_view.workspace_link, most
+                                            recently focused first */
     struct wlr_scene_tree *scene_tree;   /* scene tree for this workspace */
+
+    /* Ids of the first LW_IPC_SWITCHER_MAX views, in the order of views,
+     * rebuilt as that changes so Alt+Tab can send them as they are */
+    uint32_t switcher_ids[LW_IPC_SWITCHER_MAX];
+    int switcher_count;
 };
 
-/* Create a new workspace */
+/* Create a new workspace at the end of the table (NULL when full) */
 struct lw_workspace *lw_workspace_create(struct lw_server *server,
                                           const char *name);
 
-/* Switch to a workspace (show its views, hide others) */
+/* Remove a workspace, moving its views to the neighbouring one.  The
+ * last workspace is never removed. */
+void lw_workspace_destroy(struct lw_workspace *ws);
+
+/* Free all workspaces at shutdown, after the scene is gone */
+void lw_workspace_finish(struct lw_server *server);
+
+/* Switch to a workspace (show its views, hide others) and focus the
+ * window that last had focus there */
 void lw_workspace_switch(struct lw_server *server, struct lw_workspace *ws);
 
+/* Put a newly mapped view on a workspace */
+void lw_workspace_add_view(struct lw_workspace *ws, struct lw_view *view);
+
+/* Take an unmapped view off its workspace */
+void lw_workspace_remove_view(struct lw_view *view);
+
+/* The view got focus: put it first in its workspace's focus order */
+void lw_workspace_raise_view(struct lw_view *view);
+
 /* Move a view to a workspace */
 void lw_workspace_move_view(struct lw_view *view, struct lw_workspace *ws);
 
-/* Get workspace by index */
+/* Most recently focused view on a workspace that is not minimized */
+struct lw_view *lw_workspace_top_view(struct lw_workspace *ws);
+
+/* Get workspace by index (NULL if out of range) */
 struct lw_workspace *lw_workspace_get(struct lw_server *server, int index);
 
 #endif /* LWINDESK_WORKSPACE_H */
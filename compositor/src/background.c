@@ -0,0 +1,227 @@
+/*
+ * lwindesk - compositor/src/background.c - Desktop wallpaper
+ *
+ * The wallpaper is rasterized once per output size into a single
+ * XRGB8888 pixel buffer and shown through one wlr_scene_buffer node per
+ * output.  Being opaque and alone in its tree, it costs the scene graph
+ * one node per output for hit testing and damage tracking, and it is
+ * excluded from input hit tests entirely.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <drm_fourcc.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_output_layout.h>
+#include <wlr/types/wlr_scene.h>
+#include <wlr/util/box.h>
+#include <wlr/util/log.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "background.h"
+#include "buffer.h"
+#include "output.h"
+#include "server.h"
+
+/* Smooth gradient from dark navy -> blue -> dark purple */
+static const struct lw_gradient_stop default_stops[] = {
+    {0.00f, 0.00f, 0.04f, 0.12f},
+    {0.35f, 0.00f, 0.35f, 0.70f},
+    {0.50f, 0.00f, 0.47f, 0.83f},
+    {0.65f, 0.00f, 0.35f, 0.70f},
+    {1.00f, 0.08f, 0.05f, 0.22f},
+};
+
+/* 4x4 Bayer matrix, scaled to [-0.5, 0.5) of one 8-bit step */
+static const float bayer4[4][4] = {
+    {  0 / 16.0f - 0.5f,  8 / 16.0f - 0.5f,  2 / 16.0f - 0.5f, 10 / 16.0f - 0.5f },
+    { 12 / 16.0f - 0.5f,  4 / 16.0f - 0.5f, 14 / 16.0f - 0.5f,  6 / 16.0f - 0.5f },
+    {  3 / 16.0f - 0.5f, 11 / 16.0f - 0.5f,  1 / 16.0f - 0.5f,  9 / 16.0f - 0.5f },
+    { 15 / 16.0f - 0.5f,  7 / 16.0f - 0.5f, 13 / 16.0f - 0.5f,  5 / 16.0f - 0.5f },
+};
+
+/* Interpolate the gradient at t (0-1), result scaled to 0-255 */
+static void gradient_sample(const struct lw_gradient_stop *stops, int nstops,
+                            float t, float rgb[3]) {
+    int s = 0;
+    for (int j = 0; j < nstops - 1; j++) {
+        if (t >= stops[j].pos) s = j;
+    }
+    if (nstops < 2) {
+        rgb[0] = stops[0].r * 255.0f;
+        rgb[1] = stops[0].g * 255.0f;
+        rgb[2] = stops[0].b * 255.0f;
+        return;
+    }
+
+    float span = stops[s + 1].pos - stops[s].pos;
+    float local_t = span > 0.0f ? (t - stops[s].pos) / span : 0.0f;
+    if (local_t < 0.0f) local_t = 0.0f;
+    if (local_t > 1.0f) local_t = 1.0f;
+
+    rgb[0] = (stops[s].r + (stops[s + 1].r - stops[s].r) * local_t) * 255.0f;
+    rgb[1] = (stops[s].g + (stops[s + 1].g - stops[s].g) * local_t) * 255.0f;
+    rgb[2] = (stops[s].b + (stops[s + 1].b - stops[s].b) * local_t) * 255.0f;
+}
+
+/*
+ * Build the four dithered pixels for one row.  The gradient is vertical,
+ * so a row is one color and the Bayer pattern repeats every 4 columns:
+ * computing those 4 pixels is all the per-row arithmetic there is.
+ */
+#if defined(__SSE2__)
+static __m128i row_pattern(const float rgb[3], const float dither[4]) {
+    __m128 d = _mm_loadu_ps(dither);
+    __m128i zero = _mm_setzero_si128();
+
+    /* Round to nearest and saturate to 0..255 through the pack
+     * instructions, then widen back to one channel per 32-bit lane */
+    __m128i ch[3];
+    for (int i = 0; i < 3; i++) {
+        __m128i v = _mm_cvtps_epi32(_mm_add_ps(_mm_set1_ps(rgb[i]), d));
+        v = _mm_packs_epi32(v, v);
+        v = _mm_packus_epi16(v, v);
+        v = _mm_unpacklo_epi8(v, zero);
+        ch[i] = _mm_unpacklo_epi16(v, zero);
+    }
+
+    __m128i px = _mm_set1_epi32((int)0xff000000);
+    px = _mm_or_si128(px, _mm_slli_epi32(ch[0], 16));
+    px = _mm_or_si128(px, _mm_slli_epi32(ch[1], 8));
+    px = _mm_or_si128(px, ch[2]);
+    return px;
+}
+#else
+/* Rounds half to even like _mm_cvtps_epi32, so both paths agree */
+static uint32_t dither_channel(float v, float d) {
+    long x = lrintf(v + d);
+    if (x < 0) return 0;
+    if (x > 255) return 255;
+    return (uint32_t)x;
+}
+#endif
+
+void lw_background_fill_gradient(uint32_t *pixels, int width, int height,
+                                  size_t stride,
+                                  const struct lw_gradient_stop *stops,
+                                  int nstops) {
+    if (width <= 0 || height <= 0 || nstops <= 0) return;
+
+    for (int y = 0; y < height; y++) {
+        float t = height > 1 ? (float)y / (float)(height - 1) : 0.0f;
+        float rgb[3];
+        gradient_sample(stops, nstops, t, rgb);
+
+        const float *dither = bayer4[y & 3];
+        uint32_t *row = (uint32_t *)((uint8_t *)pixels + (size_t)y * stride);
+        int x = 0;
+
+#if defined(__SSE2__)
+        __m128i px = row_pattern(rgb, dither);
+        for (; x + 4 <= width; x += 4) {
+            _mm_storeu_si128((__m128i *)(row + x), px);
+        }
+        uint32_t tail[4];
+        _mm_storeu_si128((__m128i *)tail, px);
+#else
+        uint32_t tail[4];
+        for (int i = 0; i < 4; i++) {
+            tail[i] = 0xff000000u |
+                dither_channel(rgb[0], dither[i]) << 16 |
+                dither_channel(rgb[1], dither[i]) << 8 |
+                dither_channel(rgb[2], dither[i]);
+        }
+        for (; x + 4 <= width; x += 4) {
+            memcpy(row + x, tail, sizeof(tail));
+        }
+#endif
+        for (; x < width; x++) {
+            row[x] = tail[x & 3];
+        }
+    }
+}
+
+/* The wallpaper never takes pointer focus; let hit tests fall through */
+static bool background_accepts_input(struct wlr_scene_buffer *buffer,
+                                     int sx, int sy) {
+    return false;
+}
+
+static struct wlr_buffer *render_background(int width, int height) {
+    struct lw_pixel_buffer *buf =
+        lw_pixel_buffer_create(width, height, DRM_FORMAT_XRGB8888);
+    if (!buf) return NULL;
+
+    lw_background_fill_gradient(buf->data, width, height, buf->stride,
+        default_stops, sizeof(default_stops) / sizeof(default_stops[0]));
+    return &buf->base;
+}
+
+void lw_background_init(struct lw_server *server) {
+    server->background_tree = wlr_scene_tree_create(&server->scene->tree);
+    wlr_scene_node_lower_to_bottom(&server->background_tree->node);
+}
+
+void lw_background_update(struct lw_output *output) {
+    struct lw_server *server = output->server;
+    struct wlr_output *wlr_output = output->wlr_output;
+
+    if (!output->background) {
+        output->background =
+            wlr_scene_buffer_create(server->background_tree, NULL);
+        if (!output->background) {
+            wlr_log(WLR_ERROR, "Failed to create background node");
+            return;
+        }
+        output->background->point_accepts_input = background_accepts_input;
+    }
+
+    struct wlr_box box;
+    wlr_output_layout_get_box(server->output_layout, wlr_output, &box);
+    if (wlr_box_empty(&box)) {
+        wlr_scene_node_set_enabled(&output->background->node, false);
+        return;
+    }
+    wlr_scene_node_set_enabled(&output->background->node, true);
+    wlr_scene_node_set_position(&output->background->node, box.x, box.y);
+    wlr_scene_buffer_set_dest_size(output->background, box.width, box.height);
+
+    /* Rasterize at the output's physical resolution as displayed (width
+     * and height swapped on a 90/270 degree transform), so the buffer
+     * has the layout box's aspect; only when that changed */
+    int width, height;
+    wlr_output_transformed_resolution(wlr_output, &width, &height);
+    if (width == output->background_width &&
+            height == output->background_height) {
+        return;
+    }
+
+    struct wlr_buffer *buf = render_background(width, height);
+    if (!buf) {
+        wlr_log(WLR_ERROR, "Failed to render background (%dx%d)",
+                width, height);
+        return;
+    }
+    wlr_scene_buffer_set_buffer(output->background, buf);
+    /* The scene node holds its own lock; release our reference */
+    wlr_buffer_drop(buf);
+
+    output->background_width = width;
+    output->background_height = height;
+    wlr_log(WLR_DEBUG, "Rendered background for %s (%dx%d)",
+            wlr_output->name, width, height);
+}
+
+void lw_background_destroy(struct lw_output *output) {
+    if (output->background) {
+        wlr_scene_node_destroy(&output->background->node);
+        output->background = NULL;
+    }
+    output->background_width = 0;
+    output->background_height = 0;
+}
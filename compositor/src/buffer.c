@@ -0,0 +1,210 @@
+/*
+ * lwindesk - compositor/src/buffer.c - CPU pixel buffers for the scene graph
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <inttypes.h>
+#include <stdlib.h>
+#include <wlr/interfaces/wlr_buffer.h>
+#include <wlr/util/log.h>
+
+#include "buffer.h"
+
+static void pool_release(struct lw_buffer_pool *pool,
+		struct lw_pixel_buffer *buf);
+
+static void pixel_buffer_free(struct lw_pixel_buffer *buf) {
+	free(buf->data);
+	free(buf);
+}
+
+static void pixel_buffer_destroy(struct wlr_buffer *wlr_buf) {
+	struct lw_pixel_buffer *buf = wl_container_of(wlr_buf, buf, base);
+	if (buf->pool) {
+		pool_release(buf->pool, buf);
+		return;
+	}
+	pixel_buffer_free(buf);
+}
+
+static bool pixel_buffer_begin_data_ptr_access(struct wlr_buffer *wlr_buf,
+		uint32_t flags, void **data, uint32_t *format, size_t *stride) {
+	struct lw_pixel_buffer *buf = wl_container_of(wlr_buf, buf, base);
+	*data = buf->data;
+	*format = buf->format;
+	*stride = buf->stride;
+	return true;
+}
+
+static void pixel_buffer_end_data_ptr_access(struct wlr_buffer *wlr_buf) {
+	/* no-op */
+}
+
+static const struct wlr_buffer_impl pixel_buffer_impl = {
+	.destroy = pixel_buffer_destroy,
+	.begin_data_ptr_access = pixel_buffer_begin_data_ptr_access,
+	.end_data_ptr_access = pixel_buffer_end_data_ptr_access,
+};
+
+struct lw_pixel_buffer *lw_pixel_buffer_create(int width, int height,
+		uint32_t format) {
+	if (width <= 0 || height <= 0)
+		return NULL;
+
+	struct lw_pixel_buffer *buf = calloc(1, sizeof(*buf));
+	if (!buf)
+		return NULL;
+
+	buf->stride = (size_t)width * 4;
+	buf->data = calloc(1, buf->stride * height);
+	if (!buf->data) {
+		free(buf);
+		return NULL;
+	}
+	buf->format = format;
+	buf->capacity = buf->stride * height;
+	wl_list_init(&buf->pool_link);
+	wlr_buffer_init(&buf->base, &pixel_buffer_impl, width, height);
+
+	return buf;
+}
+
+/* --- Buffer pool --- */
+
+struct lw_buffer_pool *lw_buffer_pool_create(size_t max_bytes) {
+	struct lw_buffer_pool *pool = calloc(1, sizeof(*pool));
+	if (!pool)
+		return NULL;
+	pthread_mutex_init(&pool->lock, NULL);
+	wl_list_init(&pool->idle);
+	pool->max_bytes = max_bytes;
+	return pool;
+}
+
+static void pool_evict(struct lw_buffer_pool *pool,
+		struct lw_pixel_buffer *buf) {
+	wl_list_remove(&buf->pool_link);
+	pool->bytes_held -= buf->capacity;
+	pool->evictions++;
+	pixel_buffer_free(buf);
+}
+
+static void pool_free(struct lw_buffer_pool *pool) {
+	pthread_mutex_destroy(&pool->lock);
+	free(pool);
+}
+
+static void pool_release(struct lw_buffer_pool *pool,
+		struct lw_pixel_buffer *buf) {
+	pthread_mutex_lock(&pool->lock);
+	pool->bytes_in_use -= buf->capacity;
+	pool->outstanding--;
+
+	if (pool->destroyed) {
+		bool last = pool->outstanding == 0;
+		pthread_mutex_unlock(&pool->lock);
+		pixel_buffer_free(buf);
+		if (last)
+			pool_free(pool);
+		return;
+	}
+
+	if (buf->capacity > pool->max_bytes) {
+		pool->evictions++;
+		pthread_mutex_unlock(&pool->lock);
+		pixel_buffer_free(buf);
+		return;
+	}
+
+	/* Trim least recently released buffers to make room */
+	while (pool->bytes_held + buf->capacity > pool->max_bytes &&
+			!wl_list_empty(&pool->idle)) {
+		struct lw_pixel_buffer *oldest =
+			wl_container_of(pool->idle.prev, oldest, pool_link);
+		pool_evict(pool, oldest);
+	}
+
+	wl_list_insert(&pool->idle, &buf->pool_link);
+	pool->bytes_held += buf->capacity;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+struct lw_pixel_buffer *lw_buffer_pool_acquire(struct lw_buffer_pool *pool,
+		int width, int height, uint32_t format) {
+	if (width <= 0 || height <= 0)
+		return NULL;
+
+	int bucket_width = (width + LW_BUFFER_POOL_BUCKET - 1) /
+		LW_BUFFER_POOL_BUCKET * LW_BUFFER_POOL_BUCKET;
+
+	pthread_mutex_lock(&pool->lock);
+	struct lw_pixel_buffer *buf = NULL, *iter;
+	wl_list_for_each(iter, &pool->idle, pool_link) {
+		if (iter->bucket_width == bucket_width &&
+				iter->base.height == height) {
+			buf = iter;
+			break;
+		}
+	}
+
+	if (buf) {
+		pool->hits++;
+		wl_list_remove(&buf->pool_link);
+		wl_list_init(&buf->pool_link);
+		pool->bytes_held -= buf->capacity;
+	} else {
+		pool->misses++;
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	if (!buf) {
+		/* Allocate outside the lock */
+		buf = calloc(1, sizeof(*buf));
+		if (!buf)
+			return NULL;
+		buf->stride = (size_t)bucket_width * 4;
+		buf->capacity = buf->stride * height;
+		buf->data = malloc(buf->capacity);
+		if (!buf->data) {
+			free(buf);
+			return NULL;
+		}
+		buf->pool = pool;
+		buf->bucket_width = bucket_width;
+		wl_list_init(&buf->pool_link);
+	}
+
+	buf->format = format;
+	pthread_mutex_lock(&pool->lock);
+	pool->bytes_in_use += buf->capacity;
+	pool->outstanding++;
+	pthread_mutex_unlock(&pool->lock);
+
+	/* Safe on a recycled buffer: wlroots is done with the old instance
+	 * once it has called our destroy hook. */
+	wlr_buffer_init(&buf->base, &pixel_buffer_impl, width, height);
+	return buf;
+}
+
+void lw_buffer_pool_destroy(struct lw_buffer_pool *pool) {
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	wlr_log(WLR_DEBUG, "Buffer pool: %" PRIu64 " hits, %" PRIu64
+		" misses, %" PRIu64 " evictions, %zu bytes held",
+		pool->hits, pool->misses, pool->evictions, pool->bytes_held);
+
+	struct lw_pixel_buffer *buf, *tmp;
+	wl_list_for_each_safe(buf, tmp, &pool->idle, pool_link) {
+		wl_list_remove(&buf->pool_link);
+		pixel_buffer_free(buf);
+	}
+	pool->bytes_held = 0;
+
+	bool last = pool->outstanding == 0;
+	pool->destroyed = true;
+	pthread_mutex_unlock(&pool->lock);
+	if (last)
+		pool_free(pool);
+}
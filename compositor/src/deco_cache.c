@@ -0,0 +1,275 @@
+/*
+ * lwindesk - compositor/src/deco_cache.c - Title bar text and sprite cache
+ *
+ * Title bars are composed from three parts instead of being redrawn from
+ * scratch with cairo:
+ *   - the title area, a solid fill written directly into the buffer
+ *   - the button strip, rendered once per height and copied row by row
+ *   - the title text, drawn from a cached, already-shaped PangoLayout
+ * Only the text still goes through cairo, clipped to the title area.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdlib.h>
+#include <string.h>
+#include <cairo/cairo.h>
+#include <pango/pangocairo.h>
+#include <drm_fourcc.h>
+#include <wlr/util/log.h>
+
+#include "buffer.h"
+#include "deco_cache.h"
+#include "view.h"
+
+#define DECO_BUTTONS_WIDTH (3 * LW_DECO_BUTTON_WIDTH)
+
+/* Title bar background (#2b2b2b) as a premultiplied ARGB32 pixel */
+#define DECO_BG_PIXEL 0xff2b2b2bu
+
+static uint32_t hash_title(const char *title) {
+	/* FNV-1a */
+	uint32_t h = 2166136261u;
+	for (const unsigned char *p = (const unsigned char *)title; *p; p++) {
+		h ^= *p;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+struct lw_deco_cache *lw_deco_cache_create(struct lw_buffer_pool *pool) {
+	struct lw_deco_cache *cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+
+	cache->pool = pool;
+
+	/* A private font map keeps the cache usable from any one thread */
+	cache->font_map = pango_cairo_font_map_new();
+	cache->context = pango_font_map_create_context(cache->font_map);
+	cache->font = pango_font_description_from_string("Sans 11");
+	return cache;
+}
+
+static void layout_entry_clear(struct lw_deco_layout_entry *entry) {
+	if (entry->layout)
+		g_object_unref(entry->layout);
+	free(entry->title);
+	memset(entry, 0, sizeof(*entry));
+}
+
+void lw_deco_cache_destroy(struct lw_deco_cache *cache) {
+	if (!cache)
+		return;
+
+	for (int i = 0; i < LW_DECO_LAYOUT_CACHE_SIZE; i++)
+		layout_entry_clear(&cache->layouts[i]);
+	free(cache->buttons);
+	pango_font_description_free(cache->font);
+	g_object_unref(cache->context);
+	g_object_unref(cache->font_map);
+	free(cache);
+}
+
+/*
+ * Find (or shape) the layout for a title.  Layouts are keyed by title
+ * only; a width change re-wraps the cached layout rather than shaping a
+ * new one, which keeps drag-resizes on the hit path.
+ */
+static struct lw_deco_layout_entry *layout_lookup(struct lw_deco_cache *cache,
+		const char *title, int max_width) {
+	uint32_t hash = hash_title(title);
+	struct lw_deco_layout_entry *victim = &cache->layouts[0];
+	struct lw_deco_layout_entry *entry = NULL;
+
+	for (int i = 0; i < LW_DECO_LAYOUT_CACHE_SIZE; i++) {
+		struct lw_deco_layout_entry *e = &cache->layouts[i];
+		if (e->layout && e->hash == hash && strcmp(e->title, title) == 0) {
+			entry = e;
+			break;
+		}
+		if (!e->layout || (victim->layout &&
+				e->last_used < victim->last_used))
+			victim = e;
+	}
+
+	if (entry) {
+		cache->layout_hits++;
+	} else {
+		cache->layout_misses++;
+		layout_entry_clear(victim);
+		entry = victim;
+		entry->title = strdup(title);
+		if (!entry->title)
+			return NULL;
+		entry->hash = hash;
+		entry->layout = pango_layout_new(cache->context);
+		pango_layout_set_font_description(entry->layout, cache->font);
+		pango_layout_set_text(entry->layout, title, -1);
+		/* Force the width update below */
+		entry->max_width = -2;
+	}
+
+	if (entry->max_width != max_width) {
+		if (max_width > 0) {
+			pango_layout_set_width(entry->layout,
+				max_width * PANGO_SCALE);
+			pango_layout_set_ellipsize(entry->layout,
+				PANGO_ELLIPSIZE_END);
+		} else {
+			pango_layout_set_width(entry->layout, -1);
+			pango_layout_set_ellipsize(entry->layout,
+				PANGO_ELLIPSIZE_NONE);
+		}
+		pango_layout_get_pixel_size(entry->layout,
+			&entry->text_w, &entry->text_h);
+		entry->max_width = max_width;
+	}
+
+	entry->last_used = ++cache->clock;
+	return entry;
+}
+
+/*
+ * Render the button strip for a given height.
+ *
+ * Layout (left-to-right within the strip):
+ *   [0..46]    minimize button  (#2b2b2b, ─ symbol)
+ *   [46..92]   maximize button  (#2b2b2b, □ symbol)
+ *   [92..138]  close button     (#c42b1c, × symbol)
+ */
+static bool ensure_buttons(struct lw_deco_cache *cache, int height) {
+	if (cache->buttons && cache->buttons_height == height)
+		return true;
+
+	int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32,
+		DECO_BUTTONS_WIDTH);
+	uint32_t *pixels = calloc(1, (size_t)stride * height);
+	if (!pixels)
+		return false;
+
+	cairo_surface_t *surface = cairo_image_surface_create_for_data(
+		(unsigned char *)pixels, CAIRO_FORMAT_ARGB32,
+		DECO_BUTTONS_WIDTH, height, stride);
+	cairo_t *cr = cairo_create(surface);
+
+	cairo_set_source_rgb(cr, 0.169, 0.169, 0.169);
+	cairo_paint(cr);
+
+	/* Close button red background (#c42b1c) */
+	cairo_set_source_rgb(cr, 0.769, 0.169, 0.110);
+	cairo_rectangle(cr, 2 * LW_DECO_BUTTON_WIDTH, 0,
+		LW_DECO_BUTTON_WIDTH, height);
+	cairo_fill(cr);
+
+	/* Button symbols — thin white strokes */
+	cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+	cairo_set_line_width(cr, 1.0);
+
+	int cy = height / 2;
+
+	/* Minimize: ─ */
+	{
+		int nx = LW_DECO_BUTTON_WIDTH / 2;
+		cairo_move_to(cr, nx - 5, cy);
+		cairo_line_to(cr, nx + 5, cy);
+		cairo_stroke(cr);
+	}
+
+	/* Maximize: □ */
+	{
+		int mx = LW_DECO_BUTTON_WIDTH + LW_DECO_BUTTON_WIDTH / 2;
+		cairo_rectangle(cr, mx - 5, cy - 5, 10, 10);
+		cairo_stroke(cr);
+	}
+
+	/* Close: × */
+	{
+		int cx = 2 * LW_DECO_BUTTON_WIDTH + LW_DECO_BUTTON_WIDTH / 2;
+		cairo_move_to(cr, cx - 5, cy - 5);
+		cairo_line_to(cr, cx + 5, cy + 5);
+		cairo_move_to(cr, cx + 5, cy - 5);
+		cairo_line_to(cr, cx - 5, cy + 5);
+		cairo_stroke(cr);
+	}
+
+	cairo_destroy(cr);
+	cairo_surface_destroy(surface);
+
+	free(cache->buttons);
+	cache->buttons = pixels;
+	cache->buttons_height = height;
+	return true;
+}
+
+/* Copy the button strip to the right edge, clipped on narrow windows */
+static void blit_buttons(struct lw_deco_cache *cache,
+		struct lw_pixel_buffer *buf, int width, int height) {
+	int copy_w = width < DECO_BUTTONS_WIDTH ? width : DECO_BUTTONS_WIDTH;
+	int src_x = DECO_BUTTONS_WIDTH - copy_w;
+	int dst_x = width - copy_w;
+
+	for (int y = 0; y < height; y++) {
+		uint32_t *dst = (uint32_t *)((uint8_t *)buf->data +
+			(size_t)y * buf->stride);
+		const uint32_t *src = cache->buttons + (size_t)y * DECO_BUTTONS_WIDTH;
+		memcpy(dst + dst_x, src + src_x, (size_t)copy_w * 4);
+	}
+}
+
+static void fill_title_area(struct lw_pixel_buffer *buf, int title_w,
+		int height) {
+	for (int y = 0; y < height; y++) {
+		uint32_t *row = (uint32_t *)((uint8_t *)buf->data +
+			(size_t)y * buf->stride);
+		for (int x = 0; x < title_w; x++)
+			row[x] = DECO_BG_PIXEL;
+	}
+}
+
+static void draw_title(struct lw_deco_cache *cache,
+		struct lw_pixel_buffer *buf, int width, int height,
+		int title_w, const char *title) {
+	/* Clip text so it never overlaps the three buttons */
+	int max_text_width = width - DECO_BUTTONS_WIDTH - 16;
+	struct lw_deco_layout_entry *entry = layout_lookup(cache, title,
+		max_text_width > 0 ? max_text_width : -1);
+	if (!entry)
+		return;
+
+	cairo_surface_t *surface = cairo_image_surface_create_for_data(
+		buf->data, CAIRO_FORMAT_ARGB32, width, height, buf->stride);
+	cairo_t *cr = cairo_create(surface);
+
+	cairo_rectangle(cr, 0, 0, title_w, height);
+	cairo_clip(cr);
+
+	/* Title text (white, left-aligned, ~12px Sans) */
+	cairo_set_source_rgba(cr, 1.0, 1.0, 1.0, 0.9);
+	cairo_move_to(cr, 12, (height - entry->text_h) / 2);
+	pango_cairo_show_layout(cr, entry->layout);
+
+	cairo_destroy(cr);
+	cairo_surface_destroy(surface);
+}
+
+struct wlr_buffer *lw_deco_cache_render_titlebar(struct lw_deco_cache *cache,
+		int width, int height, const char *title) {
+	if (!ensure_buttons(cache, height))
+		return NULL;
+
+	/* Every pixel is written below, so a recycled buffer needs no clear */
+	struct lw_pixel_buffer *buf = lw_buffer_pool_acquire(cache->pool,
+		width, height, DRM_FORMAT_ARGB8888);
+	if (!buf)
+		return NULL;
+
+	int title_w = width - DECO_BUTTONS_WIDTH;
+	if (title_w > 0)
+		fill_title_area(buf, title_w, height);
+	blit_buttons(cache, buf, width, height);
+
+	if (title && title[0] && title_w > 12)
+		draw_title(cache, buf, width, height, title_w, title);
+
+	return &buf->base;
+}
@@ -0,0 +1,272 @@
+/*
+ * lwindesk - compositor/src/deco_render.c - Title bar rasterization workers
+ *
+ * Cairo/Pango work for title bars runs on a small pool of threads so a
+ * burst of title changes doesn't stall input and frame dispatch.  Each
+ * worker owns an lw_deco_cache; buffers come from the shared pool.
+ *
+ * Finished jobs are moved to the done list and announced through an
+ * eventfd watched by the Wayland event loop.  The main thread then
+ * swaps the buffer onto the view's titlebar node in one step, or drops
+ * it if the view was destroyed, resized since, or already shows a newer
+ * result.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <wlr/types/wlr_buffer.h>
+#include <wlr/util/log.h>
+
+#include "deco_cache.h"
+#include "deco_render.h"
+#include "server.h"
+#include "view.h"
+
+static void job_free(struct lw_deco_job *job) {
+	if (job->result)
+		wlr_buffer_drop(job->result);
+	free(job->title);
+	free(job);
+}
+
+static void *worker_main(void *data) {
+	struct lw_deco_worker *worker = data;
+	struct lw_deco_renderer *renderer = worker->renderer;
+
+	pthread_mutex_lock(&renderer->lock);
+	while (true) {
+		while (!renderer->stopping && wl_list_empty(&renderer->queue))
+			pthread_cond_wait(&renderer->cond, &renderer->lock);
+		if (renderer->stopping)
+			break;
+
+		struct lw_deco_job *job =
+			wl_container_of(renderer->queue.prev, job, link);
+		wl_list_remove(&job->link);
+		wl_list_init(&job->link);
+		job->state = LW_DECO_JOB_RUNNING;
+		pthread_mutex_unlock(&renderer->lock);
+
+		struct wlr_buffer *result = lw_deco_cache_render_titlebar(
+			worker->cache, job->width, job->height, job->title);
+
+		pthread_mutex_lock(&renderer->lock);
+		job->result = result;
+		job->state = LW_DECO_JOB_DONE;
+		wl_list_insert(renderer->done.prev, &job->link);
+
+		uint64_t one = 1;
+		if (write(renderer->event_fd, &one, sizeof(one)) < 0 &&
+				errno != EAGAIN) {
+			wlr_log_errno(WLR_ERROR, "deco worker: eventfd write");
+		}
+	}
+	pthread_mutex_unlock(&renderer->lock);
+	return NULL;
+}
+
+static void job_consume(struct lw_deco_job *job) {
+	struct lw_view *view = job->view;
+	if (view) {
+		wl_list_remove(&job->view_link);
+		wl_list_init(&job->view_link);
+	}
+
+	/*
+	 * Drop results that no longer apply: the view is gone, its size
+	 * changed after this job was queued, or a newer job already won.
+	 */
+	if (!view || !view->deco.has_decorations || !job->result ||
+			job->width != view->deco.pending_width ||
+			job->generation <= view->deco.applied_generation) {
+		job_free(job);
+		return;
+	}
+
+	view->deco.applied_generation = job->generation;
+	lw_view_set_titlebar_buffer(view, job->result, job->width);
+	/* The view now holds the reference */
+	job->result = NULL;
+	job_free(job);
+}
+
+static int handle_jobs_done(int fd, uint32_t mask, void *data) {
+	struct lw_deco_renderer *renderer = data;
+
+	uint64_t count;
+	if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+		wlr_log_errno(WLR_ERROR, "deco renderer: eventfd read");
+	}
+
+	struct wl_list done;
+	wl_list_init(&done);
+	pthread_mutex_lock(&renderer->lock);
+	wl_list_insert_list(&done, &renderer->done);
+	wl_list_init(&renderer->done);
+	pthread_mutex_unlock(&renderer->lock);
+
+	struct lw_deco_job *job, *tmp;
+	wl_list_for_each_safe(job, tmp, &done, link) {
+		wl_list_remove(&job->link);
+		job_consume(job);
+	}
+	return 0;
+}
+
+struct lw_deco_renderer *lw_deco_renderer_create(struct lw_server *server) {
+	struct lw_deco_renderer *renderer = calloc(1, sizeof(*renderer));
+	if (!renderer)
+		return NULL;
+
+	renderer->server = server;
+	wl_list_init(&renderer->queue);
+	wl_list_init(&renderer->done);
+	pthread_mutex_init(&renderer->lock, NULL);
+	pthread_cond_init(&renderer->cond, NULL);
+
+	renderer->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (renderer->event_fd < 0) {
+		wlr_log_errno(WLR_ERROR, "deco renderer: eventfd");
+		goto error;
+	}
+
+	struct wl_event_loop *loop =
+		wl_display_get_event_loop(server->wl_display);
+	renderer->event_source = wl_event_loop_add_fd(loop, renderer->event_fd,
+		WL_EVENT_READABLE, handle_jobs_done, renderer);
+	if (!renderer->event_source)
+		goto error;
+
+	for (int i = 0; i < LW_DECO_WORKERS; i++) {
+		struct lw_deco_worker *worker =
+			&renderer->workers[renderer->worker_count];
+		worker->renderer = renderer;
+		worker->cache = lw_deco_cache_create(server->buffer_pool);
+		if (!worker->cache)
+			break;
+		if (pthread_create(&worker->thread, NULL, worker_main,
+				worker) != 0) {
+			lw_deco_cache_destroy(worker->cache);
+			worker->cache = NULL;
+			break;
+		}
+		renderer->worker_count++;
+	}
+	if (renderer->worker_count == 0) {
+		wlr_log(WLR_ERROR, "deco renderer: no worker threads");
+		goto error;
+	}
+
+	wlr_log(WLR_INFO, "Title bar rendering on %d worker thread(s)",
+		renderer->worker_count);
+	return renderer;
+
+error:
+	if (renderer->event_source)
+		wl_event_source_remove(renderer->event_source);
+	if (renderer->event_fd >= 0)
+		close(renderer->event_fd);
+	pthread_cond_destroy(&renderer->cond);
+	pthread_mutex_destroy(&renderer->lock);
+	free(renderer);
+	return NULL;
+}
+
+void lw_deco_renderer_destroy(struct lw_deco_renderer *renderer) {
+	if (!renderer)
+		return;
+
+	pthread_mutex_lock(&renderer->lock);
+	renderer->stopping = true;
+	pthread_cond_broadcast(&renderer->cond);
+	pthread_mutex_unlock(&renderer->lock);
+
+	for (int i = 0; i < renderer->worker_count; i++) {
+		pthread_join(renderer->workers[i].thread, NULL);
+		lw_deco_cache_destroy(renderer->workers[i].cache);
+	}
+
+	/* Workers are stopped: no locking needed from here on */
+	struct lw_deco_job *job, *tmp;
+	wl_list_for_each_safe(job, tmp, &renderer->queue, link) {
+		wl_list_remove(&job->link);
+		job_free(job);
+	}
+	wl_list_for_each_safe(job, tmp, &renderer->done, link) {
+		wl_list_remove(&job->link);
+		job_free(job);
+	}
+
+	wl_event_source_remove(renderer->event_source);
+	close(renderer->event_fd);
+	pthread_cond_destroy(&renderer->cond);
+	pthread_mutex_destroy(&renderer->lock);
+	free(renderer);
+}
+
+void lw_deco_renderer_submit(struct lw_deco_renderer *renderer,
+		struct lw_view *view, int width, int height, const char *title) {
+	char *title_copy = title ? strdup(title) : NULL;
+	uint32_t generation = ++view->deco.generation;
+
+	pthread_mutex_lock(&renderer->lock);
+
+	/* Coalesce with this view's newest job if no worker picked it up */
+	if (!wl_list_empty(&view->deco.jobs)) {
+		struct lw_deco_job *last =
+			wl_container_of(view->deco.jobs.prev, last, view_link);
+		if (last->state == LW_DECO_JOB_QUEUED) {
+			free(last->title);
+			last->title = title_copy;
+			last->width = width;
+			last->height = height;
+			last->generation = generation;
+			pthread_mutex_unlock(&renderer->lock);
+			return;
+		}
+	}
+
+	struct lw_deco_job *job = calloc(1, sizeof(*job));
+	if (!job) {
+		pthread_mutex_unlock(&renderer->lock);
+		free(title_copy);
+		return;
+	}
+	job->state = LW_DECO_JOB_QUEUED;
+	job->width = width;
+	job->height = height;
+	job->title = title_copy;
+	job->generation = generation;
+	job->view = view;
+	wl_list_insert(view->deco.jobs.prev, &job->view_link);
+
+	/* Queue is consumed from the tail: insert at the head (FIFO) */
+	wl_list_insert(&renderer->queue, &job->link);
+	pthread_cond_signal(&renderer->cond);
+	pthread_mutex_unlock(&renderer->lock);
+}
+
+void lw_deco_renderer_cancel(struct lw_deco_renderer *renderer,
+		struct lw_view *view) {
+	if (!renderer)
+		return;
+
+	pthread_mutex_lock(&renderer->lock);
+	struct lw_deco_job *job, *tmp;
+	wl_list_for_each_safe(job, tmp, &view->deco.jobs, view_link) {
+		wl_list_remove(&job->view_link);
+		wl_list_init(&job->view_link);
+		job->view = NULL;
+
+		/* Not started yet: don't bother rendering it */
+		if (job->state == LW_DECO_JOB_QUEUED) {
+			wl_list_remove(&job->link);
+			job_free(job);
+		}
+	}
+	pthread_mutex_unlock(&renderer->lock);
+}
@@ -0,0 +1,83 @@
+/*
+ * lwindesk - compositor/src/histogram.c - Lock-free latency histograms
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "histogram.h"
+
+static int bucket_index(uint64_t us) {
+    if (us < LW_HISTOGRAM_SUB_BUCKETS) return (int)us;
+
+    /* Position of the highest set bit picks the octave, the next two
+     * bits pick the sub-bucket within it */
+    int msb = 63 - __builtin_clzll(us);
+    int sub = (int)(us >> (msb - 2)) & (LW_HISTOGRAM_SUB_BUCKETS - 1);
+    int idx = (msb - 1) * LW_HISTOGRAM_SUB_BUCKETS + sub;
+    return idx < LW_HISTOGRAM_BUCKETS ? idx : LW_HISTOGRAM_BUCKETS - 1;
+}
+
+static uint64_t bucket_upper_bound(int idx) {
+    if (idx < LW_HISTOGRAM_SUB_BUCKETS) return (uint64_t)idx + 1;
+
+    int msb = idx / LW_HISTOGRAM_SUB_BUCKETS + 1;
+    int sub = idx % LW_HISTOGRAM_SUB_BUCKETS;
+    return (uint64_t)(LW_HISTOGRAM_SUB_BUCKETS + sub + 1) << (msb - 2);
+}
+
+void lw_histogram_record(struct lw_histogram *hist, uint64_t us) {
+    atomic_fetch_add_explicit(&hist->buckets[bucket_index(us)], 1,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->sum_us, us, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->count, 1, memory_order_relaxed);
+
+    uint64_t max = atomic_load_explicit(&hist->max_us, memory_order_relaxed);
+    while (us > max &&
+           !atomic_compare_exchange_weak_explicit(&hist->max_us, &max, us,
+               memory_order_relaxed, memory_order_relaxed)) {
+        /* max reloaded by the failed exchange */
+    }
+}
+
+void lw_histogram_record_interval(struct lw_histogram *hist,
+                                  const struct timespec *start,
+                                  const struct timespec *end) {
+    int64_t ns = (int64_t)(end->tv_sec - start->tv_sec) * 1000000000 +
+                 (end->tv_nsec - start->tv_nsec);
+    lw_histogram_record(hist, ns > 0 ? (uint64_t)ns / 1000 : 0);
+}
+
+uint64_t lw_histogram_percentile(const struct lw_histogram *hist,
+                                 double percentile) {
+    uint64_t counts[LW_HISTOGRAM_BUCKETS];
+    uint64_t total = 0;
+    for (int i = 0; i < LW_HISTOGRAM_BUCKETS; i++) {
+        counts[i] = atomic_load_explicit(&hist->buckets[i],
+                                         memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) return 0;
+
+    /* Rank of the sample we're after, 1-based */
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LW_HISTOGRAM_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank) return bucket_upper_bound(i);
+    }
+    return bucket_upper_bound(LW_HISTOGRAM_BUCKETS - 1);
+}
+
+uint64_t lw_histogram_count(const struct lw_histogram *hist) {
+    return atomic_load_explicit(&hist->count, memory_order_relaxed);
+}
+
+uint64_t lw_histogram_max(const struct lw_histogram *hist) {
+    return atomic_load_explicit(&hist->max_us, memory_order_relaxed);
+}
@@ -0,0 +1,181 @@
+/*
+ * lwindesk - compositor/src/hit_index.c - Cursor hit testing over mapped views
+ *
+ * wlr_scene_node_at() visits every node in the scene, wallpaper
+ * included, and the motion path used to run it twice per event.  Here we
+ * keep the mapped views in stacking order and test the point against each
+ * view's title bar and surface extents, descending into the view's
+ * surfaces only for the view actually under the cursor.  Layer surfaces
+ * are looked up per output by layer_shell.c around that.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <inttypes.h>
+#include <stdlib.h>
+#include <wlr/types/wlr_compositor.h>
+#include <wlr/types/wlr_scene.h>
+#include <wlr/types/wlr_xdg_shell.h>
+#include <wlr/util/box.h>
+#include <wlr/util/log.h>
+
+#include "hit_index.h"
+#include "layer_shell.h"
+#include "server.h"
+#include "view.h"
+
+struct lw_hit_index *lw_hit_index_create(void) {
+    struct lw_hit_index *index = calloc(1, sizeof(*index));
+    if (!index) return NULL;
+    index->dirty = true;
+    return index;
+}
+
+void lw_hit_index_destroy(struct lw_hit_index *index) {
+    if (!index) return;
+    wlr_log(WLR_DEBUG, "Hit index: %" PRIu64 " queries, %" PRIu64
+            " rebuilds", index->queries, index->rebuilds);
+    free(index->entries);
+    free(index);
+}
+
+void lw_hit_index_invalidate(struct lw_server *server) {
+    if (server->hit_index) {
+        server->hit_index->dirty = true;
+    }
+}
+
+static void index_append(struct lw_hit_index *index, struct lw_view *view,
+                         int x, int y) {
+    if (index->count == index->capacity) {
+        int capacity = index->capacity ? index->capacity * 2 : 32;
+        struct lw_hit_entry *entries =
+            realloc(index->entries, capacity * sizeof(*entries));
+        if (!entries) return;
+        index->entries = entries;
+        index->capacity = capacity;
+    }
+    index->entries[index->count++] = (struct lw_hit_entry){
+        .view = view, .x = x, .y = y,
+    };
+}
+
+static bool is_layer_tree(struct lw_server *server,
+                          struct wlr_scene_node *node) {
+    for (int layer = 0; layer < LW_LAYER_COUNT; layer++) {
+        if (node == &server->layer_trees[layer]->node) return true;
+    }
+    return false;
+}
+
+/* Topmost first: scene children are listed bottom to top */
+static void collect_views(struct lw_server *server, struct lw_hit_index *index,
+                          struct wlr_scene_tree *tree, int x, int y) {
+    struct wlr_scene_node *node;
+    wl_list_for_each_reverse(node, &tree->children, link) {
+        if (!node->enabled || node->type != WLR_SCENE_NODE_TREE) continue;
+        if (node == &server->background_tree->node) continue;
+        if (is_layer_tree(server, node)) continue;
+
+        struct lw_view *view = node->data;
+        if (view) {
+            if (view->mapped) {
+                index_append(index, view, x + node->x, y + node->y);
+            }
+        } else {
+            /* Workspace trees and other plain containers */
+            collect_views(server, index, wlr_scene_tree_from_node(node),
+                          x + node->x, y + node->y);
+        }
+    }
+}
+
+static void index_rebuild(struct lw_server *server, struct lw_hit_index *index) {
+    index->count = 0;
+    collect_views(server, index, &server->scene->tree, 0, 0);
+    index->dirty = false;
+    index->rebuilds++;
+}
+
+static enum lw_deco_button titlebar_button(struct lw_view *view, int x) {
+    /* Buttons are laid out from the right edge:
+     *   Close:    [width-46 .. width]
+     *   Maximize: [width-92 .. width-46]
+     *   Minimize: [width-138 .. width-92] */
+    int w = view->deco.width;
+    if (x >= w - LW_DECO_BUTTON_WIDTH) return LW_DECO_CLOSE;
+    if (x >= w - 2 * LW_DECO_BUTTON_WIDTH) return LW_DECO_MAXIMIZE;
+    if (x >= w - 3 * LW_DECO_BUTTON_WIDTH) return LW_DECO_MINIMIZE;
+    return LW_DECO_TITLEBAR;
+}
+
+static bool hit_view(struct lw_hit_entry *entry, double lx, double ly,
+                     struct lw_hit *hit) {
+    struct lw_view *view = entry->view;
+    double vx = lx - entry->x;
+    double vy = ly - entry->y;
+
+    /* The title bar sits above the surface tree in the wrapper */
+    struct lw_decoration *deco = &view->deco;
+    if (deco->has_decorations && deco->titlebar_buffer->node.enabled &&
+            vx >= 0 && vx < deco->width &&
+            vy >= 0 && vy < LW_TITLEBAR_HEIGHT) {
+        hit->view = view;
+        hit->button = titlebar_button(view, (int)vx);
+        return true;
+    }
+
+    /* The surface tree is offset inside the decoration wrapper, and the
+     * scene shifts the surface itself by the window geometry origin */
+    struct wlr_xdg_surface *xdg_surface = view->xdg_toplevel->base;
+    struct wlr_scene_tree *xdg_tree = xdg_surface->data;
+    if (xdg_tree != view->scene_tree) {
+        vx -= xdg_tree->node.x;
+        vy -= xdg_tree->node.y;
+    }
+    struct wlr_box geo;
+    wlr_xdg_surface_get_geometry(xdg_surface, &geo);
+    vx += geo.x;
+    vy += geo.y;
+
+    /* Cheap reject on the surface and its subsurfaces; popups may stick
+     * out anywhere, so views with popups always take the precise path */
+    if (wl_list_empty(&xdg_surface->popups)) {
+        struct wlr_box extents;
+        wlr_surface_get_extends(xdg_surface->surface, &extents);
+        if (!wlr_box_contains_point(&extents, vx, vy)) return false;
+    }
+
+    double sx, sy;
+    struct wlr_surface *surface =
+        wlr_xdg_surface_surface_at(xdg_surface, vx, vy, &sx, &sy);
+    if (!surface) return false;     /* outside the input region */
+
+    hit->view = view;
+    hit->surface = surface;
+    hit->sx = sx;
+    hit->sy = sy;
+    return true;
+}
+
+bool lw_hit_test(struct lw_server *server, double lx, double ly,
+                 struct lw_hit *hit) {
+    struct lw_hit_index *index = server->hit_index;
+    *hit = (struct lw_hit){ .button = LW_DECO_NONE };
+
+    if (index->dirty) {
+        index_rebuild(server, index);
+    }
+    index->queries++;
+
+    hit->surface = lw_layer_surface_at(server, lx, ly, true,
+                                       &hit->sx, &hit->sy, &hit->layer);
+    if (hit->surface) return true;
+
+    for (int i = 0; i < index->count; i++) {
+        if (hit_view(&index->entries[i], lx, ly, hit)) return true;
+    }
+
+    hit->surface = lw_layer_surface_at(server, lx, ly, false,
+                                       &hit->sx, &hit->sy, &hit->layer);
+    return hit->surface != NULL;
+}
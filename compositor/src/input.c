@@ -3,74 +3,47 @@
  */
 
 #define _POSIX_C_SOURCE 200112L
+#include <inttypes.h>
 #include <stdlib.h>
 #include <wlr/types/wlr_cursor.h>
 #include <wlr/types/wlr_input_device.h>
 #include <wlr/types/wlr_keyboard.h>
+#include <wlr/types/wlr_output_layout.h>
 #include <wlr/types/wlr_pointer.h>
+#include <wlr/types/wlr_relative_pointer_v1.h>
 #include <wlr/types/wlr_seat.h>
 #include <wlr/types/wlr_xcursor_manager.h>
+#include <wlr/types/wlr_xdg_shell.h>
+#include <wlr/util/edges.h>
 #include <wlr/util/log.h>
 #include <xkbcommon/xkbcommon.h>
 
+#include "hit_index.h"
+#include "snapshot.h"
 #include "input.h"
 #include "ipc.h"
+#include "layer_shell.h"
+#include "overview.h"
 #include "server.h"
 #include "view.h"
 #include "snap.h"
+#include "switcher.h"
 #include "workspace.h"
 
 #include <linux/input-event-codes.h>
 #include <string.h>
 
-/* Check if a view is a shell window (title starting with "lwindesk-") */
-static bool is_shell_view(struct lw_view *view) {
-    const char *title = view->xdg_toplevel->title;
-    return title && strncmp(title, "lwindesk-", 9) == 0;
+/* The window Super/Alt shortcuts act on: the most recently focused one
+ * on the active workspace */
+static struct lw_view *shortcut_view(struct lw_server *server) {
+    return lw_workspace_top_view(server->active_workspace);
 }
 
-/* Alt+Tab: cycle to next non-shell window.
- * Move the current focused view to the back of the list, then
- * focus the next mapped, non-shell, non-minimized view. */
-static void cycle_window(struct lw_server *server) {
-    if (wl_list_empty(&server->views)) return;
-
-    /* Find the next suitable view to focus. We start from the
-     * second entry in the list (the one behind the current top). */
-    struct lw_view *current = wl_container_of(
-        server->views.next, current, link);
-
-    struct lw_view *next = NULL;
-    struct lw_view *view;
-    bool past_current = false;
-
-    wl_list_for_each(view, &server->views, link) {
-        if (view == current) {
-            past_current = true;
-            continue;
-        }
-        if (past_current && view->mapped && !view->is_minimized &&
-            !is_shell_view(view)) {
-            next = view;
-            break;
-        }
-    }
-
-    /* If we didn't find one after current, wrap around */
-    if (!next) {
-        wl_list_for_each(view, &server->views, link) {
-            if (view == current) break;
-            if (view->mapped && !view->is_minimized &&
-                !is_shell_view(view)) {
-                next = view;
-                break;
-            }
-        }
-    }
-
-    if (next && next != current) {
-        lw_view_focus(next);
-    }
+/* Switch to the workspace delta places away from the active one */
+static void switch_workspace_by(struct lw_server *server, int delta) {
+    struct lw_workspace *ws = lw_workspace_get(server,
+        server->active_workspace->index + delta);
+    if (ws) lw_workspace_switch(server, ws);
 }
 
 /* Handle compositor keybindings (Super+key shortcuts) */
@@ -78,6 +51,40 @@ static bool handle_keybinding(struct lw_server *server, xkb_keysym_t sym,
                                uint32_t modifiers) {
     bool super = modifiers & WLR_MODIFIER_LOGO;
     bool alt = modifiers & WLR_MODIFIER_ALT;
+    bool ctrl = modifiers & WLR_MODIFIER_CTRL;
+
+    if (super && ctrl) {
+        server->super_used_in_combo = true;
+
+        switch (sym) {
+        case XKB_KEY_d:
+        case XKB_KEY_D:
+            /* Super+Ctrl+D: New desktop */
+            {
+                struct lw_workspace *ws = lw_workspace_create(server, NULL);
+                if (ws) lw_workspace_switch(server, ws);
+            }
+            return true;
+
+        case XKB_KEY_Left:
+            /* Super+Ctrl+Left: Previous desktop */
+            switch_workspace_by(server, -1);
+            return true;
+
+        case XKB_KEY_Right:
+            /* Super+Ctrl+Right: Next desktop */
+            switch_workspace_by(server, 1);
+            return true;
+
+        case XKB_KEY_F4:
+            /* Super+Ctrl+F4: Close desktop, its windows move next door */
+            lw_workspace_destroy(server->active_workspace);
+            return true;
+
+        default:
+            break;
+        }
+    }
 
     if (super) {
         /* Any key pressed with Super means Super is used in a combo,
@@ -88,50 +95,44 @@ static bool handle_keybinding(struct lw_server *server, xkb_keysym_t sym,
         case XKB_KEY_d:
         case XKB_KEY_D:
             /* Super+D: Show desktop (minimize all) + notify shell */
-            {
-                struct lw_view *view;
-                wl_list_for_each(view, &server->views, link) {
-                    if (view->mapped && !view->is_minimized) {
-                        lw_view_minimize(view);
-                    }
-                }
-                lw_ipc_send(server, "show-desktop");
-            }
+            lw_view_minimize_all(server);
+            lw_ipc_send(server, LW_IPC_EVENT_SHOW_DESKTOP, NULL, 0);
+            return true;
+
+        case XKB_KEY_Tab:
+            /* Super+Tab: Task View */
+            lw_overview_toggle(server);
             return true;
 
         case XKB_KEY_Left:
             /* Super+Left: Snap left */
-            if (!wl_list_empty(&server->views)) {
-                struct lw_view *top =
-                    wl_container_of(server->views.next, top, link);
-                lw_view_snap(top, LW_SNAP_LEFT);
+            {
+                struct lw_view *top = shortcut_view(server);
+                if (top) lw_view_snap(top, LW_SNAP_LEFT);
             }
             return true;
 
         case XKB_KEY_Right:
             /* Super+Right: Snap right */
-            if (!wl_list_empty(&server->views)) {
-                struct lw_view *top =
-                    wl_container_of(server->views.next, top, link);
-                lw_view_snap(top, LW_SNAP_RIGHT);
+            {
+                struct lw_view *top = shortcut_view(server);
+                if (top) lw_view_snap(top, LW_SNAP_RIGHT);
             }
             return true;
 
         case XKB_KEY_Up:
             /* Super+Up: Maximize */
-            if (!wl_list_empty(&server->views)) {
-                struct lw_view *top =
-                    wl_container_of(server->views.next, top, link);
-                lw_view_snap(top, LW_SNAP_MAXIMIZE);
+            {
+                struct lw_view *top = shortcut_view(server);
+                if (top) lw_view_snap(top, LW_SNAP_MAXIMIZE);
             }
             return true;
 
         case XKB_KEY_Down:
             /* Super+Down: Restore */
-            if (!wl_list_empty(&server->views)) {
-                struct lw_view *top =
-                    wl_container_of(server->views.next, top, link);
-                lw_view_restore(top);
+            {
+                struct lw_view *top = shortcut_view(server);
+                if (top) lw_view_restore(top);
             }
             return true;
 
@@ -150,10 +151,9 @@ static bool handle_keybinding(struct lw_server *server, xkb_keysym_t sym,
         case XKB_KEY_q:
         case XKB_KEY_Q:
             /* Super+Q: Close focused window */
-            if (!wl_list_empty(&server->views)) {
-                struct lw_view *top =
-                    wl_container_of(server->views.next, top, link);
-                lw_view_close(top);
+            {
+                struct lw_view *top = shortcut_view(server);
+                if (top) lw_view_close(top);
             }
             return true;
 
@@ -163,19 +163,17 @@ static bool handle_keybinding(struct lw_server *server, xkb_keysym_t sym,
     }
 
     if (alt) {
-        if (sym == XKB_KEY_Tab) {
-            /* Alt+Tab: Cycle windows */
-            cycle_window(server);
-            lw_ipc_send(server, "cycle-window");
+        if (sym == XKB_KEY_Tab || sym == XKB_KEY_ISO_Left_Tab) {
+            /* Alt+Tab: switcher, held open until Alt is released */
+            lw_switcher_step(server, sym == XKB_KEY_ISO_Left_Tab);
             return true;
         }
 
         if (sym == XKB_KEY_F4) {
             /* Alt+F4: Close focused window */
-            if (!wl_list_empty(&server->views)) {
-                struct lw_view *top =
-                    wl_container_of(server->views.next, top, link);
-                lw_view_close(top);
+            {
+                struct lw_view *top = shortcut_view(server);
+                if (top) lw_view_close(top);
             }
             return true;
         }
@@ -191,6 +189,13 @@ static void keyboard_handle_modifiers(struct wl_listener *listener,
     wlr_seat_set_keyboard(keyboard->server->seat, keyboard->wlr_keyboard);
     wlr_seat_keyboard_notify_modifiers(keyboard->server->seat,
         &keyboard->wlr_keyboard->modifiers);
+
+    /* Letting go of Alt ends Alt+Tab on the selected window */
+    if (keyboard->server->switcher &&
+        !(wlr_keyboard_get_modifiers(keyboard->wlr_keyboard) &
+          WLR_MODIFIER_ALT)) {
+        lw_switcher_commit(keyboard->server);
+    }
 }
 
 static bool is_super_key(uint32_t keycode) {
@@ -224,7 +229,8 @@ static void keyboard_handle_key(struct wl_listener *listener, void *data) {
         } else if (event->state == WL_KEYBOARD_KEY_STATE_RELEASED) {
             if (server->super_pressed && !server->super_used_in_combo) {
                 /* Super was tapped alone: toggle start menu */
-                lw_ipc_send(server, "toggle-start-menu");
+                lw_ipc_send(server, LW_IPC_EVENT_TOGGLE_START_MENU,
+                            NULL, 0);
             }
             server->super_pressed = false;
             server->super_used_in_combo = false;
@@ -241,6 +247,15 @@ static void keyboard_handle_key(struct wl_listener *listener, void *data) {
 
     if (!handled && event->state == WL_KEYBOARD_KEY_STATE_PRESSED) {
         for (int i = 0; i < nsyms; i++) {
+            /* Task View and the switcher take keys first while open */
+            if (server->overview) {
+                handled = lw_overview_handle_key(server, syms[i], modifiers);
+                if (handled) break;
+            }
+            if (server->switcher) {
+                handled = lw_switcher_handle_key(server, syms[i], modifiers);
+                if (handled) break;
+            }
             handled = handle_keybinding(server, syms[i], modifiers);
             if (handled) break;
         }
@@ -317,6 +332,45 @@ void lw_input_new(struct wl_listener *listener, void *data) {
     wlr_seat_set_capabilities(server->seat, caps);
 }
 
+/*
+ * Resize the grabbed view by the dragged edges, within the client's
+ * size limits.  The box is handed to lw_view_resize, which keeps one
+ * configure in flight and coalesces the rest, so a slow client gets the
+ * latest size once it is ready rather than a configure per motion.
+ */
+static void process_cursor_resize(struct lw_server *server) {
+    struct lw_view *view = server->grabbed_view;
+    const struct wlr_xdg_toplevel_state *state = &view->xdg_toplevel->current;
+    uint32_t edges = server->resize_edges;
+    int dx = (int)(server->cursor->x - server->grab_x);
+    int dy = (int)(server->cursor->y - server->grab_y);
+
+    /* Room for the title bar buttons at least */
+    int min_w = view->deco.has_decorations ? 3 * LW_DECO_BUTTON_WIDTH : 1;
+    int min_h = 1;
+    if (state->min_width > min_w) min_w = state->min_width;
+    if (state->min_height > min_h) min_h = state->min_height;
+    int max_w = state->max_width > 0 ? state->max_width : INT32_MAX;
+    int max_h = state->max_height > 0 ? state->max_height : INT32_MAX;
+
+    struct wlr_box box = server->grab_geobox;
+    if (edges & (WLR_EDGE_LEFT | WLR_EDGE_RIGHT)) {
+        int width = box.width + ((edges & WLR_EDGE_LEFT) ? -dx : dx);
+        if (width < min_w) width = min_w;
+        if (width > max_w) width = max_w;
+        if (edges & WLR_EDGE_LEFT) box.x += box.width - width;
+        box.width = width;
+    }
+    if (edges & (WLR_EDGE_TOP | WLR_EDGE_BOTTOM)) {
+        int height = box.height + ((edges & WLR_EDGE_TOP) ? -dy : dy);
+        if (height < min_h) height = min_h;
+        if (height > max_h) height = max_h;
+        if (edges & WLR_EDGE_TOP) box.y += box.height - height;
+        box.height = height;
+    }
+    lw_view_resize(view, box, edges);
+}
+
 void lw_process_cursor_motion(struct lw_server *server, uint32_t time) {
     if (server->cursor_mode == LW_CURSOR_MOVE) {
         struct lw_view *view = server->grabbed_view;
@@ -324,54 +378,169 @@ void lw_process_cursor_motion(struct lw_server *server, uint32_t time) {
         view->y = server->cursor->y - server->grab_y;
         wlr_scene_node_set_position(&view->scene_tree->node,
                                      view->x, view->y);
-
-        /* Detect snap zones while dragging */
-        server->pending_snap = lw_snap_zone_at(server,
-            server->cursor->x, server->cursor->y);
+        lw_hit_index_invalidate(server);
+        /* The snapshot gets the new position once, on the drop */
+        lw_view_damage(view);
+
+        /* Detect snap zones while dragging; the preview goes into the
+         * frame that shows the pointer entering the zone */
+        struct lw_output *output;
+        enum lw_snap_zone zone = lw_snap_zone_at(server,
+            server->cursor->x, server->cursor->y, &output);
+        if (zone != server->snap_preview_zone ||
+            (zone != LW_SNAP_NONE && output != server->snap_preview_output)) {
+            lw_snap_preview_show(server, output, zone);
+        }
+        if (zone != server->pending_snap) {
+            server->pending_snap = zone;
+            lw_ipc_send_snap_preview(server, zone);
+        }
         return;
     }
 
     if (server->cursor_mode == LW_CURSOR_RESIZE) {
-        /* TODO: interactive resize */
+        process_cursor_resize(server);
         return;
     }
 
-    /* Check if cursor is over a decoration element */
-    struct lw_view *deco_view = NULL;
-    enum lw_deco_button btn = lw_deco_button_at(server,
-        server->cursor->x, server->cursor->y, &deco_view);
-    if (btn != LW_DECO_NONE) {
+    if (lw_overview_handle_motion(server, server->cursor->x,
+                                  server->cursor->y)) {
+        return;
+    }
+
+    /* One lookup resolves decoration button, view and surface */
+    struct lw_hit hit;
+    lw_hit_test(server, server->cursor->x, server->cursor->y, &hit);
+
+    if (hit.button != LW_DECO_NONE) {
         /* Over a decoration: set appropriate cursor and clear surface focus */
         wlr_cursor_set_xcursor(server->cursor, server->cursor_mgr, "default");
         wlr_seat_pointer_clear_focus(server->seat);
         return;
     }
 
-    /* Passthrough: find view under cursor */
-    double sx, sy;
-    struct wlr_surface *surface = NULL;
-    struct lw_view *view = lw_view_at(server,
-        server->cursor->x, server->cursor->y, &surface, &sx, &sy);
-
-    if (!view) {
+    if (!hit.view && !hit.layer) {
         wlr_cursor_set_xcursor(server->cursor, server->cursor_mgr, "default");
     }
 
-    if (surface) {
-        wlr_seat_pointer_notify_enter(server->seat, surface, sx, sy);
-        wlr_seat_pointer_notify_motion(server->seat, time, sx, sy);
+    if (hit.surface) {
+        wlr_seat_pointer_notify_enter(server->seat, hit.surface,
+                                      hit.sx, hit.sy);
+        wlr_seat_pointer_notify_motion(server->seat, time, hit.sx, hit.sy);
     } else {
         wlr_seat_pointer_clear_focus(server->seat);
     }
 }
 
+/* --- Motion coalescing --- */
+
+void lw_cursor_flush_motion(struct lw_server *server) {
+    if (!server->motion_pending) return;
+    server->motion_pending = false;
+    server->motion_passes++;
+    lw_process_cursor_motion(server, server->motion_time);
+    /* The frame event we held back in lw_cursor_frame() */
+    wlr_seat_pointer_notify_frame(server->seat);
+}
+
+static int motion_timer_fired(void *data) {
+    lw_cursor_flush_motion(data);
+    return 0;
+}
+
+static void queue_motion(struct lw_server *server, uint32_t time) {
+    server->motion_events++;
+
+    if (server->motion_mode == LW_MOTION_IMMEDIATE) {
+        server->motion_passes++;
+        lw_process_cursor_motion(server, time);
+        return;
+    }
+
+    server->motion_time = time;
+    if (server->motion_pending) return;
+    server->motion_pending = true;
+
+    if (server->motion_mode == LW_MOTION_TIMER) {
+        wl_event_source_timer_update(server->motion_timer,
+                                     server->motion_interval_ms);
+        return;
+    }
+
+    /* Ask for a frame event without marking the output dirty: if the
+     * motion pass changes nothing on screen, the frame commits nothing */
+    struct wlr_output *output = wlr_output_layout_output_at(
+        server->output_layout, server->cursor->x, server->cursor->y);
+    if (output) {
+        wlr_output_schedule_frame(output);
+    } else {
+        lw_cursor_flush_motion(server);
+    }
+}
+
+void lw_input_init_motion(struct lw_server *server) {
+    server->motion_mode = LW_MOTION_IMMEDIATE;
+
+    const char *mode = getenv("LWINDESK_MOTION_COALESCE");
+    if (!mode || !*mode || strcmp(mode, "off") == 0 ||
+            strcmp(mode, "0") == 0) {
+        return;
+    }
+
+    if (strcmp(mode, "frame") == 0) {
+        server->motion_mode = LW_MOTION_PER_FRAME;
+        wlr_log(WLR_INFO, "Pointer motion coalesced per output frame");
+        return;
+    }
+
+    char *end;
+    long ms = strtol(mode, &end, 10);
+    if (*end || ms <= 0 || ms > 1000) {
+        wlr_log(WLR_ERROR, "Invalid LWINDESK_MOTION_COALESCE '%s', "
+                "expected off, frame or 1-1000 (ms)", mode);
+        return;
+    }
+
+    struct wl_event_loop *loop =
+        wl_display_get_event_loop(server->wl_display);
+    server->motion_timer =
+        wl_event_loop_add_timer(loop, motion_timer_fired, server);
+    if (!server->motion_timer) return;
+
+    server->motion_mode = LW_MOTION_TIMER;
+    server->motion_interval_ms = ms;
+    wlr_log(WLR_INFO, "Pointer motion coalesced every %ld ms", ms);
+}
+
+void lw_input_finish_motion(struct lw_server *server) {
+    wlr_log(WLR_INFO, "Pointer motion: %" PRIu64 " events, %" PRIu64
+            " passes", server->motion_events, server->motion_passes);
+    wlr_log(WLR_INFO, "Interactive resize: %" PRIu64 " sizes, %" PRIu64
+            " configures", server->resize_requests,
+            server->resize_configures);
+    if (server->motion_timer) {
+        wl_event_source_remove(server->motion_timer);
+        server->motion_timer = NULL;
+    }
+    server->motion_pending = false;
+}
+
 void lw_cursor_motion(struct wl_listener *listener, void *data) {
     struct lw_server *server =
         wl_container_of(listener, server, cursor_motion);
     struct wlr_pointer_motion_event *event = data;
     wlr_cursor_move(server->cursor, &event->pointer->base,
                      event->delta_x, event->delta_y);
-    lw_process_cursor_motion(server, event->time_msec);
+
+    /* Relative motion goes out unmerged: games and 3D apps want every
+     * delta at full device resolution */
+    wlr_relative_pointer_manager_v1_send_relative_motion(
+        server->relative_pointer_mgr, server->seat,
+        (uint64_t)event->time_msec * 1000,
+        event->delta_x, event->delta_y,
+        event->unaccel_dx, event->unaccel_dy);
+
+    queue_motion(server, event->time_msec);
 }
 
 void lw_cursor_motion_absolute(struct wl_listener *listener, void *data) {
@@ -380,7 +549,7 @@ void lw_cursor_motion_absolute(struct wl_listener *listener, void *data) {
     struct wlr_pointer_motion_absolute_event *event = data;
     wlr_cursor_warp_absolute(server->cursor, &event->pointer->base,
                               event->x, event->y);
-    lw_process_cursor_motion(server, event->time_msec);
+    queue_motion(server, event->time_msec);
 }
 
 void lw_cursor_button(struct wl_listener *listener, void *data) {
@@ -388,12 +557,27 @@ void lw_cursor_button(struct wl_listener *listener, void *data) {
         wl_container_of(listener, server, cursor_button);
     struct wlr_pointer_button_event *event = data;
 
+    /* Clicks act on where the pointer is now */
+    lw_cursor_flush_motion(server);
+
     if (event->state == WL_POINTER_BUTTON_STATE_RELEASED) {
         /* On release during move, apply snap if pending */
         if (server->cursor_mode == LW_CURSOR_MOVE &&
             server->pending_snap != LW_SNAP_NONE) {
-            lw_view_snap(server->grabbed_view, server->pending_snap);
+            /* Onto the output the preview was shown on */
+            lw_view_snap_on(server->grabbed_view,
+                            server->snap_preview_output, server->pending_snap);
             server->pending_snap = LW_SNAP_NONE;
+            lw_ipc_send_snap_preview(server, LW_SNAP_NONE);
+        }
+        if (server->cursor_mode == LW_CURSOR_MOVE) {
+            lw_snapshot_mark_dirty(server);
+        }
+        lw_snap_preview_show(server, NULL, LW_SNAP_NONE);
+        if (server->cursor_mode == LW_CURSOR_RESIZE) {
+            /* A size still waiting goes out once the client acks */
+            wlr_xdg_toplevel_set_resizing(
+                server->grabbed_view->xdg_toplevel, false);
         }
         server->cursor_mode = LW_CURSOR_PASSTHROUGH;
         server->grabbed_view = NULL;
@@ -403,10 +587,16 @@ void lw_cursor_button(struct wl_listener *listener, void *data) {
         return;
     }
 
+    if (lw_overview_handle_button(server, server->cursor->x,
+                                  server->cursor->y)) {
+        return;
+    }
+
     /* Check if the click is on a decoration button */
-    struct lw_view *deco_view = NULL;
-    enum lw_deco_button btn = lw_deco_button_at(server,
-        server->cursor->x, server->cursor->y, &deco_view);
+    struct lw_hit hit;
+    lw_hit_test(server, server->cursor->x, server->cursor->y, &hit);
+    struct lw_view *deco_view = hit.view;
+    enum lw_deco_button btn = hit.button;
 
     if (btn != LW_DECO_NONE && deco_view) {
         /* Focus the view that owns the decoration */
@@ -438,13 +628,13 @@ void lw_cursor_button(struct wl_listener *listener, void *data) {
     wlr_seat_pointer_notify_button(server->seat,
         event->time_msec, event->button, event->state);
 
-    /* Focus the clicked view */
-    double sx, sy;
-    struct wlr_surface *surface = NULL;
-    struct lw_view *view = lw_view_at(server,
-        server->cursor->x, server->cursor->y, &surface, &sx, &sy);
-    if (view) {
-        lw_view_focus(view);
+    /* Focus the clicked view, or the panel if it takes keys */
+    if (hit.view) {
+        lw_view_focus(hit.view);
+    } else if (hit.layer &&
+               hit.layer->layer_surface->current.keyboard_interactive !=
+               ZWLR_LAYER_SURFACE_V1_KEYBOARD_INTERACTIVITY_NONE) {
+        lw_layer_focus(hit.layer);
     }
 }
 
@@ -452,6 +642,7 @@ void lw_cursor_axis(struct wl_listener *listener, void *data) {
     struct lw_server *server =
         wl_container_of(listener, server, cursor_axis);
     struct wlr_pointer_axis_event *event = data;
+    lw_cursor_flush_motion(server);
     wlr_seat_pointer_notify_axis(server->seat, event->time_msec,
         event->orientation, event->delta, event->delta_discrete,
         event->source);
@@ -460,6 +651,8 @@ void lw_cursor_axis(struct wl_listener *listener, void *data) {
 void lw_cursor_frame(struct wl_listener *listener, void *data) {
     struct lw_server *server =
         wl_container_of(listener, server, cursor_frame);
+    /* Deferred motion sends its own frame when it is flushed */
+    if (server->motion_pending) return;
     wlr_seat_pointer_notify_frame(server->seat);
 }
 
@@ -484,6 +677,7 @@ void lw_seat_request_set_selection(struct wl_listener *listener, void *data) {
 
 void lw_view_begin_move(struct lw_view *view) {
     struct lw_server *server = view->server;
+    if (view->is_fullscreen) return;
     if (server->seat->pointer_state.focused_surface !=
         view->xdg_toplevel->base->surface) {
         return;
@@ -505,6 +699,7 @@ void lw_view_begin_move_from_titlebar(struct lw_view *view) {
 
 void lw_view_begin_resize(struct lw_view *view, uint32_t edges) {
     struct lw_server *server = view->server;
+    if (view->is_fullscreen) return;
     if (server->seat->pointer_state.focused_surface !=
         view->xdg_toplevel->base->surface) {
         return;
@@ -513,6 +708,15 @@ void lw_view_begin_resize(struct lw_view *view, uint32_t edges) {
     server->cursor_mode = LW_CURSOR_RESIZE;
     server->resize_edges = edges;
 
+    /* Resizing takes a window out of its snap zone where it stands */
+    if (view->is_snapped || view->is_maximized) {
+        view->is_snapped = false;
+        view->is_maximized = false;
+        view->snap_zone = LW_SNAP_NONE;
+        lw_ipc_send_view_state(server, view);
+    }
+    wlr_xdg_toplevel_set_resizing(view->xdg_toplevel, true);
+
     struct wlr_box geo;
     wlr_xdg_surface_get_geometry(view->xdg_toplevel->base, &geo);
     server->grab_geobox = geo;
@@ -2,26 +2,68 @@
  * lwindesk - compositor/src/ipc.c - IPC socket for shell communication
  *
  * Simple Unix domain socket server. The compositor listens, the shell
- * connects. Protocol is newline-delimited text commands:
- *   "toggle-start-menu\n"
- *   "show-desktop\n"
- *   "cycle-window\n"
+ * and any other observers connect. Messages are length-prefixed binary
+ * frames defined in protocol/ipc_protocol.h: events such as
+ * TOGGLE_START_MENU and WORKSPACE go to every client, requests
+ * (activate/close/minimize a view, switch workspace, show desktop,
+ * Task View, state and stats queries) are answered only to the asking
+ * client.
+ *
+ * Clients are allocated per connection and kept on a list, so there is
+ * no limit beyond file descriptors and adding or dropping one is O(1).
+ *
+ * Requests are decoded in place from the per-client receive buffer.
+ * An event is serialized once into a refcounted lw_ipc_buffer, and a
+ * reference is queued for each client subscribed to its class; with no
+ * subscribers it is not serialized at all.  Queues are flushed once per
+ * event loop iteration, many messages per sendmsg().  When the socket is
+ * full the queue keeps them and WL_EVENT_WRITABLE finishes the job.  For
+ * a client that stops reading, state events (see lw_ipc_send_state)
+ * still waiting in its queue are replaced by newer ones; when the queue
+ * is full anyway the client is disconnected.  Nothing is dropped
+ * silently.  A buffer may carry an fd of its own (a dup of the snapshot
+ * or a thumbnail memfd, see snapshot.c and thumbnail.c); it goes out
+ * with SCM_RIGHTS on its message's first byte.
+ *
+ * With LWINDESK_IPC_TRACE set, every broadcast event is also appended to
+ * that file with a timestamp (format in ipc_protocol.h), whether or not
+ * anyone is subscribed, for offline replay against the shell.
  */
 
 #define _POSIX_C_SOURCE 200112L
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
+#include <time.h>
 #include <unistd.h>
 #include <wayland-server-core.h>
 #include <wlr/util/log.h>
 
+#include "histogram.h"
 #include "ipc.h"
+#include "output.h"
+#include "overview.h"
 #include "server.h"
+#include "snap.h"
+#include "snapshot.h"
+#include "thumbnail.h"
+#include "view.h"
+#include "workspace.h"
+
+/* Messages handed to one sendmsg() */
+#define IPC_FLUSH_IOV 64
+
+/* An outgoing message under construction */
+struct ipc_message {
+	_Alignas(8) unsigned char data[LW_IPC_MAX_MESSAGE];
+	size_t len;
+};
 
 static int set_nonblocking(int fd) {
 	int flags = fcntl(fd, F_GETFL, 0);
@@ -29,10 +71,54 @@ static int set_nonblocking(int fd) {
 	return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
 }
 
+static void ipc_buffer_unref(struct lw_ipc_buffer *buffer) {
+	if (--buffer->refcount == 0) {
+		if (buffer->fd >= 0) close(buffer->fd);
+		free(buffer);
+	}
+}
+
+/* A copy of fd for a buffer to own, so whoever owns the original may
+ * close it before the message goes out; -1 for -1 or on failure */
+static int ipc_dup_fd(int fd) {
+	if (fd < 0) return -1;
+	int copy = dup(fd);
+	if (copy < 0) {
+		wlr_log_errno(WLR_ERROR, "IPC dup");
+		return -1;
+	}
+	fcntl(copy, F_SETFD, FD_CLOEXEC);
+	return copy;
+}
+
+/* Change what a client is subscribed to, keeping the per-class counts
+ * (and so the union over all clients) current without a rescan */
+static void ipc_set_subscriptions(struct lw_ipc_client *client,
+		uint32_t classes) {
+	struct lw_ipc *ipc = &client->server->ipc;
+	uint32_t changed = client->subscriptions ^ classes;
+	for (int bit = 0; changed; bit++, changed >>= 1) {
+		if (!(changed & 1)) continue;
+		if (classes & (1u << bit)) {
+			if (ipc->class_clients[bit]++ == 0)
+				ipc->subscriptions |= 1u << bit;
+		} else {
+			if (--ipc->class_clients[bit] == 0)
+				ipc->subscriptions &= ~(1u << bit);
+		}
+	}
+	client->subscriptions = classes;
+}
+
+static void ipc_schedule_flush(struct lw_server *server);
+
+/* Close the connection; the struct itself is freed from the idle flush
+ * (ipc_reap_closed), after whatever called us has unwound */
 static void ipc_client_disconnect(struct lw_ipc_client *client) {
 	if (client->fd < 0) return;
 
-	wlr_log(WLR_INFO, "IPC client disconnected (fd=%d)", client->fd);
+	wlr_log(WLR_INFO, "IPC client %u disconnected (fd=%d)",
+		client->id, client->fd);
 
 	if (client->event_source) {
 		wl_event_source_remove(client->event_source);
@@ -40,62 +126,692 @@ static void ipc_client_disconnect(struct lw_ipc_client *client) {
 	}
 	close(client->fd);
 	client->fd = -1;
+	client->inlen = 0;
+
+	for (uint32_t i = client->out_tail; i != client->out_head; i++)
+		ipc_buffer_unref(client->outq[i & (LW_IPC_OUTQ_LEN - 1)]);
+	free(client->outq);
+	client->outq = NULL;
+	client->out_head = client->out_tail = 0;
+	client->out_offset = client->out_bytes = 0;
+	client->want_writable = false;
+	ipc_set_subscriptions(client, 0);
 
-	/* Compact the clients array */
 	struct lw_ipc *ipc = &client->server->ipc;
-	int idx = client - ipc->clients;
-	if (idx < ipc->client_count - 1) {
-		memmove(&ipc->clients[idx], &ipc->clients[idx + 1],
-			(ipc->client_count - 1 - idx) *
-			sizeof(struct lw_ipc_client));
-	}
+	wl_list_remove(&client->link);
+	wl_list_insert(&ipc->closed, &client->link);
 	ipc->client_count--;
+	ipc_schedule_flush(client->server);
 }
 
-static int ipc_client_readable(int fd, uint32_t mask, void *data) {
-	struct lw_ipc_client *client = data;
+static void ipc_reap_closed(struct lw_ipc *ipc) {
+	struct lw_ipc_client *client, *tmp;
+	wl_list_for_each_safe(client, tmp, &ipc->closed, link) {
+		wl_list_remove(&client->link);
+		free(client);
+	}
+}
 
-	if (mask & (WL_EVENT_HANGUP | WL_EVENT_ERROR)) {
-		ipc_client_disconnect(client);
+/* strnlen() is POSIX 2008; we build against 2001 */
+static size_t ipc_strlen(const char *str, size_t max) {
+	const char *end = memchr(str, '\0', max);
+	return end ? (size_t)(end - str) : max;
+}
+
+static void ipc_message_init(struct ipc_message *msg, uint16_t type) {
+	struct lw_ipc_header *header = (struct lw_ipc_header *)msg->data;
+	header->size = 0;
+	header->type = type;
+	header->version = LW_IPC_VERSION;
+	header->flags = 0;
+	msg->len = sizeof(*header);
+}
+
+/* Append to the body, truncating at LW_IPC_MAX_MESSAGE; returns the
+ * number of bytes that fit */
+static size_t ipc_message_append(struct ipc_message *msg,
+		const void *data, size_t len) {
+	size_t space = LW_IPC_MAX_MESSAGE - LW_IPC_ALIGN - msg->len;
+	if (len > space) len = space;
+	if (len) memcpy(msg->data + msg->len, data, len);
+	msg->len += len;
+	return len;
+}
+
+/* Pad to LW_IPC_ALIGN and fill in the size */
+static void ipc_message_finish(struct ipc_message *msg) {
+	struct lw_ipc_header *header = (struct lw_ipc_header *)msg->data;
+	uint32_t size = lw_ipc_message_size(msg->len - sizeof(*header));
+	memset(msg->data + msg->len, 0, size - msg->len);
+	msg->len = size;
+	header->size = size;
+}
+
+/* Which subscription an event is delivered under; 0 for replies */
+static uint32_t ipc_event_class(uint16_t type) {
+	switch (type) {
+	case LW_IPC_EVENT_TOGGLE_START_MENU:
+	case LW_IPC_EVENT_SHOW_DESKTOP:
+		return LW_IPC_CLASS_SHORTCUTS;
+	case LW_IPC_EVENT_WORKSPACE:
+		return LW_IPC_CLASS_WORKSPACE;
+	case LW_IPC_EVENT_FOCUS:
+		return LW_IPC_CLASS_FOCUS;
+	case LW_IPC_EVENT_SNAP_PREVIEW:
+		return LW_IPC_CLASS_SNAP;
+	case LW_IPC_EVENT_SNAPSHOT_CHANGED:
+		return LW_IPC_CLASS_SNAPSHOT;
+	case LW_IPC_EVENT_VIEW_CREATED:
+	case LW_IPC_EVENT_VIEW_DESTROYED:
+	case LW_IPC_EVENT_VIEW_TITLE:
+	case LW_IPC_EVENT_VIEW_APP_ID:
+	case LW_IPC_EVENT_VIEW_STATE:
+		return LW_IPC_CLASS_WINDOWS;
+	case LW_IPC_EVENT_OVERVIEW:
+		return LW_IPC_CLASS_OVERVIEW;
+	case LW_IPC_EVENT_THUMBNAIL_CHANGED:
+		return LW_IPC_CLASS_THUMBNAILS;
+	case LW_IPC_EVENT_SWITCHER:
+	case LW_IPC_EVENT_SWITCHER_SELECT:
+		return LW_IPC_CLASS_SWITCHER;
+	default:
 		return 0;
 	}
+}
 
-	/* Read and discard data from client (we don't expect commands
-	 * from the shell to the compositor via this channel yet) */
-	char buf[512];
-	ssize_t n = read(fd, buf, sizeof(buf));
-	if (n <= 0) {
-		ipc_client_disconnect(client);
-		return 0;
+static struct lw_ipc_buffer *ipc_buffer_create(struct lw_ipc *ipc,
+		const struct ipc_message *msg, bool state, uint32_t key) {
+	const struct lw_ipc_header *header = (const void *)msg->data;
+	struct lw_ipc_buffer *buffer = malloc(sizeof(*buffer) + msg->len);
+	if (!buffer) {
+		wlr_log(WLR_ERROR, "IPC out of memory for message 0x%04x",
+			header->type);
+		return NULL;
 	}
+	buffer->refcount = 1;
+	buffer->len = msg->len;
+	buffer->type = header->type;
+	buffer->state = state;
+	buffer->key = key;
+	buffer->fd = -1;
+	memcpy(buffer->data, msg->data, msg->len);
+	ipc->messages_serialized++;
+	return buffer;
+}
 
-	return 0;
+static struct lw_ipc_buffer **ipc_outq_at(struct lw_ipc_client *client,
+		uint32_t index) {
+	return &client->outq[index & (LW_IPC_OUTQ_LEN - 1)];
 }
 
-static int ipc_accept_client(int fd, uint32_t mask, void *data) {
+/* Poll for writability only while there is something queued */
+static void ipc_client_update_mask(struct lw_ipc_client *client) {
+	bool want = client->out_head != client->out_tail;
+	if (want == client->want_writable) return;
+	client->want_writable = want;
+	wl_event_source_fd_update(client->event_source,
+		WL_EVENT_READABLE | WL_EVENT_HANGUP |
+		(want ? WL_EVENT_WRITABLE : 0));
+}
+
+/* Drop sent bytes from the front of the queue */
+static void ipc_client_consume(struct lw_ipc_client *client, size_t sent) {
+	client->out_bytes -= sent;
+	while (sent > 0) {
+		struct lw_ipc_buffer *buffer =
+			*ipc_outq_at(client, client->out_tail);
+		size_t left = buffer->len - client->out_offset;
+		if (sent < left) {
+			client->out_offset += sent;
+			return;
+		}
+		sent -= left;
+		client->out_offset = 0;
+		ipc_buffer_unref(buffer);
+		client->out_tail++;
+	}
+}
+
+/* Write out as much of the queue as the socket takes, up to
+ * IPC_FLUSH_IOV messages per call.  Returns false if the client was
+ * disconnected. */
+static bool ipc_client_flush(struct lw_ipc_client *client) {
+	struct lw_ipc *ipc = &client->server->ipc;
+
+	while (client->out_head != client->out_tail) {
+		struct iovec iov[IPC_FLUSH_IOV];
+		union {
+			char buf[CMSG_SPACE(sizeof(int))];
+			struct cmsghdr align;
+		} control;
+		int send_fd = -1;
+		int count = 0;
+		for (uint32_t i = client->out_tail;
+				i != client->out_head && count < IPC_FLUSH_IOV; i++) {
+			struct lw_ipc_buffer *buffer = *ipc_outq_at(client, i);
+			/* An fd rides on the first byte of its message: send that
+			 * message at the start of its own sendmsg() */
+			if (buffer->fd >= 0 && count > 0) break;
+			size_t skip = count == 0 ? client->out_offset : 0;
+			iov[count].iov_base = buffer->data + skip;
+			iov[count].iov_len = buffer->len - skip;
+			count++;
+			if (buffer->fd >= 0) {
+				if (skip == 0) send_fd = buffer->fd;
+				break;
+			}
+		}
+		/* sendmsg() is writev() plus MSG_NOSIGNAL */
+		struct msghdr mh = { .msg_iov = iov, .msg_iovlen = count };
+		if (send_fd >= 0) {
+			mh.msg_control = control.buf;
+			mh.msg_controllen = sizeof(control.buf);
+			struct cmsghdr *cmsg = CMSG_FIRSTHDR(&mh);
+			cmsg->cmsg_level = SOL_SOCKET;
+			cmsg->cmsg_type = SCM_RIGHTS;
+			cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+			memcpy(CMSG_DATA(cmsg), &send_fd, sizeof(int));
+		}
+
+		ssize_t n = sendmsg(client->fd, &mh, MSG_NOSIGNAL);
+		ipc->sendmsg_calls++;
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+			wlr_log(WLR_ERROR, "IPC write to fd=%d failed: %s",
+				client->fd, strerror(errno));
+			ipc_client_disconnect(client);
+			return false;
+		}
+		ipc->bytes_sent += n;
+		ipc_client_consume(client, n);
+	}
+
+	ipc_client_update_mask(client);
+	return true;
+}
+
+static void ipc_flush_idle(void *data) {
 	struct lw_server *server = data;
 	struct lw_ipc *ipc = &server->ipc;
+	ipc->flush_idle = NULL;
 
-	int client_fd = accept(fd, NULL, NULL);
-	if (client_fd < 0) {
-		wlr_log(WLR_ERROR, "IPC accept failed: %s",
-			strerror(errno));
+	struct lw_ipc_client *client, *tmp;
+	wl_list_for_each_safe(client, tmp, &ipc->clients, link) {
+		if (client->out_head != client->out_tail)
+			ipc_client_flush(client);
+	}
+	ipc_reap_closed(ipc);
+}
+
+static void ipc_schedule_flush(struct lw_server *server) {
+	struct lw_ipc *ipc = &server->ipc;
+	if (ipc->flush_idle) return;
+	struct wl_event_loop *loop =
+		wl_display_get_event_loop(server->wl_display);
+	ipc->flush_idle = wl_event_loop_add_idle(loop, ipc_flush_idle, server);
+}
+
+/* Replace a queued, not yet started state event with the same type and
+ * key, so a stalled client only ever holds the latest value.  Only the
+ * newest entry is replaced in place: an older one is dropped and the new
+ * state queued at the end, so it never overtakes events queued after the
+ * old one (a FOCUS ahead of the VIEW_CREATED it refers to).  Returns true
+ * if the buffer was queued. */
+static bool ipc_coalesce(struct lw_ipc_client *client,
+		struct lw_ipc_buffer *buffer) {
+	uint32_t first = client->out_tail + (client->out_offset ? 1 : 0);
+	for (uint32_t i = client->out_head; i != first; ) {
+		struct lw_ipc_buffer **slot = ipc_outq_at(client, --i);
+		if (!(*slot)->state || (*slot)->type != buffer->type ||
+				(*slot)->key != buffer->key)
+			continue;
+		client->out_bytes -= (*slot)->len;
+		ipc_buffer_unref(*slot);
+		client->server->ipc.messages_coalesced++;
+		if (i + 1 == client->out_head) {
+			client->out_bytes += buffer->len;
+			buffer->refcount++;
+			*slot = buffer;
+			return true;
+		}
+		for (uint32_t j = i; j + 1 != client->out_head; j++)
+			*ipc_outq_at(client, j) = *ipc_outq_at(client, j + 1);
+		client->out_head--;
+		return false;
+	}
+	return false;
+}
+
+static bool ipc_queue_full(const struct lw_ipc_client *client,
+		const struct lw_ipc_buffer *buffer) {
+	return client->out_head - client->out_tail == LW_IPC_OUTQ_LEN ||
+		client->out_bytes + buffer->len > LW_IPC_OUTBUF_SIZE;
+}
+
+/* Queue a reference to a message.  If the queue is full, first push out
+ * what the socket takes right now; a client whose queue is still full
+ * is not reading and gets disconnected.  Returns false if the client is
+ * gone. */
+static bool ipc_queue(struct lw_ipc_client *client,
+		struct lw_ipc_buffer *buffer) {
+	struct lw_ipc *ipc = &client->server->ipc;
+
+	if (buffer->state && ipc_coalesce(client, buffer))
+		return true;
+
+	if (ipc_queue_full(client, buffer)) {
+		if (!ipc_client_flush(client)) return false;
+	}
+	if (ipc_queue_full(client, buffer)) {
+		wlr_log(WLR_ERROR, "IPC client fd=%d is not reading "
+			"(%zu bytes queued), disconnecting",
+			client->fd, client->out_bytes);
+		ipc->slow_disconnects++;
+		ipc->bytes_dropped += client->out_bytes + buffer->len;
+		ipc_client_disconnect(client);
+		return false;
+	}
+
+	buffer->refcount++;
+	*ipc_outq_at(client, client->out_head++) = buffer;
+	client->out_bytes += buffer->len;
+	ipc->messages_queued++;
+	if (client->out_bytes > ipc->queue_high_water)
+		ipc->queue_high_water = client->out_bytes;
+
+	ipc_schedule_flush(client->server);
+	return true;
+}
+
+static void ipc_reply_message(struct lw_ipc_client *client,
+		const struct ipc_message *msg) {
+	struct lw_ipc_buffer *buffer =
+		ipc_buffer_create(&client->server->ipc, msg, false, 0);
+	if (!buffer) return;
+	ipc_queue(client, buffer);
+	ipc_buffer_unref(buffer);
+}
+
+static void ipc_reply(struct lw_ipc_client *client, uint16_t type,
+		const void *payload, size_t size) {
+	struct ipc_message msg;
+	ipc_message_init(&msg, type);
+	ipc_message_append(&msg, payload, size);
+	ipc_message_finish(&msg);
+	ipc_reply_message(client, &msg);
+}
+
+static void ipc_reply_hello(struct lw_ipc_client *client) {
+	struct lw_ipc_hello hello = {
+		.version = LW_IPC_VERSION,
+		.max_message = LW_IPC_MAX_REQUEST,
+	};
+	ipc_reply(client, LW_IPC_EVENT_HELLO, &hello, sizeof(hello));
+}
+
+static struct lw_ipc_workspace ipc_workspace_state(
+		struct lw_server *server) {
+	struct lw_ipc_workspace ws = {
+		.index = server->active_workspace ?
+			server->active_workspace->index : -1,
+		.count = server->workspace_count,
+	};
+	return ws;
+}
+
+static void ipc_reply_workspace(struct lw_ipc_client *client) {
+	struct lw_ipc_workspace ws = ipc_workspace_state(client->server);
+	ipc_reply(client, LW_IPC_EVENT_WORKSPACE, &ws, sizeof(ws));
+}
+
+/* View flags other than LW_IPC_VIEW_FOCUSED */
+static uint32_t ipc_view_flags(const struct lw_view *view) {
+	uint32_t flags = 0;
+	if (view->is_minimized)
+		flags |= LW_IPC_VIEW_MINIMIZED;
+	if (view->is_maximized)
+		flags |= LW_IPC_VIEW_MAXIMIZED;
+	if (view->is_fullscreen)
+		flags |= LW_IPC_VIEW_FULLSCREEN;
+	return flags;
+}
+
+/* A VIEW (or VIEW_CREATED) message: lw_ipc_view, app_id, title */
+static void ipc_view_message(struct ipc_message *msg, uint16_t type,
+		struct lw_view *view) {
+	struct wlr_xdg_toplevel *toplevel = view->xdg_toplevel;
+	struct wlr_surface *focused =
+		view->server->seat->keyboard_state.focused_surface;
+	const char *app_id = toplevel->app_id ? toplevel->app_id : "";
+	const char *title = toplevel->title ? toplevel->title : "";
+
+	struct lw_ipc_view info = {
+		.id = view->id,
+		.flags = ipc_view_flags(view),
+		.workspace = view->workspace ? view->workspace->index : -1,
+	};
+	if (focused == toplevel->base->surface)
+		info.flags |= LW_IPC_VIEW_FOCUSED;
+
+	/* app_id is short; the title gets whatever room is left */
+	size_t app_id_len = ipc_strlen(app_id, 255);
+	size_t title_len = ipc_strlen(title, LW_IPC_MAX_MESSAGE);
+	size_t room = LW_IPC_MAX_MESSAGE - LW_IPC_ALIGN -
+		sizeof(struct lw_ipc_header) - sizeof(info) - app_id_len;
+	if (title_len > room) title_len = room;
+	info.app_id_len = app_id_len;
+	info.title_len = title_len;
+
+	ipc_message_init(msg, type);
+	ipc_message_append(msg, &info, sizeof(info));
+	ipc_message_append(msg, app_id, app_id_len);
+	ipc_message_append(msg, title, title_len);
+	ipc_message_finish(msg);
+}
+
+static void ipc_reply_view(struct lw_ipc_client *client,
+		struct lw_view *view) {
+	struct ipc_message msg;
+	ipc_view_message(&msg, LW_IPC_EVENT_VIEW, view);
+	ipc_reply_message(client, &msg);
+}
+
+static void ipc_reply_state(struct lw_ipc_client *client) {
+	ipc_reply_workspace(client);
+
+	struct lw_view *view;
+	wl_list_for_each(view, &client->server->views, link) {
+		if (client->fd < 0) return;
+		ipc_reply_view(client, view);
+	}
+	if (client->fd >= 0)
+		ipc_reply(client, LW_IPC_EVENT_STATE_DONE, NULL, 0);
+}
+
+static void ipc_reply_frame_stats(struct lw_ipc_client *client) {
+	struct lw_output *output;
+
+	wl_list_for_each(output, &client->server->outputs, link) {
+		if (client->fd < 0) return;
+		const char *name = output->wlr_output->name;
+		struct lw_ipc_frame_stats stats = {
+			.committed = output->frames_committed,
+			.skipped = output->frames_skipped,
+			.commit_p50 =
+				lw_histogram_percentile(&output->hist_commit, 50),
+			.commit_p99 =
+				lw_histogram_percentile(&output->hist_commit, 99),
+			.commit_max = lw_histogram_max(&output->hist_commit),
+			.latency_p50 =
+				lw_histogram_percentile(&output->hist_latency, 50),
+			.latency_p99 =
+				lw_histogram_percentile(&output->hist_latency, 99),
+			.latency_max = lw_histogram_max(&output->hist_latency),
+			.present_p50 =
+				lw_histogram_percentile(&output->hist_present, 50),
+			.present_p99 =
+				lw_histogram_percentile(&output->hist_present, 99),
+			.present_max = lw_histogram_max(&output->hist_present),
+			.present_count = lw_histogram_count(&output->hist_present),
+			.frames_scanout = output->frames_scanout,
+			.frames_composited = output->frames_composited,
+			.scanning_out = output->scanning_out,
+			.name_len = ipc_strlen(name, 255),
+		};
+
+		struct ipc_message msg;
+		ipc_message_init(&msg, LW_IPC_EVENT_FRAME_STATS);
+		ipc_message_append(&msg, &stats, sizeof(stats));
+		ipc_message_append(&msg, name, stats.name_len);
+		ipc_message_finish(&msg);
+		ipc_reply_message(client, &msg);
+	}
+	if (client->fd >= 0)
+		ipc_reply(client, LW_IPC_EVENT_FRAME_STATS_DONE, NULL, 0);
+}
+
+static void ipc_reply_input_stats(struct lw_ipc_client *client) {
+	struct lw_server *server = client->server;
+	struct lw_ipc_input_stats stats = {
+		.motion_events = server->motion_events,
+		.motion_passes = server->motion_passes,
+	};
+	ipc_reply(client, LW_IPC_EVENT_INPUT_STATS, &stats, sizeof(stats));
+}
+
+/* The snapshot fd stays owned by the snapshot; the buffer only borrows
+ * it until it has been sent (the snapshot outlives all clients). */
+static void ipc_reply_snapshot(struct lw_ipc_client *client) {
+	struct lw_snapshot *snapshot = client->server->snapshot;
+	struct lw_ipc_snapshot_info info = { 0 };
+	if (snapshot) {
+		info.size = sizeof(struct lw_ipc_snapshot);
+		info.seq = lw_snapshot_seq(snapshot);
+	}
+
+	struct ipc_message msg;
+	ipc_message_init(&msg, LW_IPC_EVENT_SNAPSHOT);
+	ipc_message_append(&msg, &info, sizeof(info));
+	ipc_message_finish(&msg);
+	struct lw_ipc_buffer *buffer =
+		ipc_buffer_create(&client->server->ipc, &msg, false, 0);
+	if (!buffer) return;
+	buffer->fd = ipc_dup_fd(lw_snapshot_fd(snapshot));
+	ipc_queue(client, buffer);
+	ipc_buffer_unref(buffer);
+}
+
+/* Answered even for a view that is gone, with size 0 and no fd */
+static void ipc_reply_thumbnail(struct lw_ipc_client *client,
+		const struct lw_ipc_header *header) {
+	const struct lw_ipc_view_ref *ref =
+		lw_ipc_payload(header, sizeof(*ref));
+	if (!ref) return;
+	struct lw_view *view = lw_view_from_id(client->server, ref->id);
+	struct lw_thumbnail *thumb = view ? lw_thumbnail_request(view) : NULL;
+	struct lw_ipc_thumbnail_info info = { .view_id = ref->id };
+	if (thumb)
+		info = lw_thumbnail_info(view);
+
+	struct ipc_message msg;
+	ipc_message_init(&msg, LW_IPC_EVENT_THUMBNAIL);
+	ipc_message_append(&msg, &info, sizeof(info));
+	ipc_message_finish(&msg);
+	struct lw_ipc_buffer *buffer =
+		ipc_buffer_create(&client->server->ipc, &msg, false, 0);
+	if (!buffer) return;
+	buffer->fd = ipc_dup_fd(lw_thumbnail_fd(thumb));
+	ipc_queue(client, buffer);
+	ipc_buffer_unref(buffer);
+}
+
+static void ipc_reply_queue_stats(struct lw_ipc_client *client) {
+	struct lw_ipc *ipc = &client->server->ipc;
+	struct lw_ipc_queue_stats stats = {
+		.clients = ipc->client_count,
+		.queue_high_water = ipc->queue_high_water,
+		.messages_serialized = ipc->messages_serialized,
+		.messages_queued = ipc->messages_queued,
+		.messages_coalesced = ipc->messages_coalesced,
+		.sendmsg_calls = ipc->sendmsg_calls,
+		.bytes_sent = ipc->bytes_sent,
+		.slow_disconnects = ipc->slow_disconnects,
+		.bytes_dropped = ipc->bytes_dropped,
+	};
+	struct lw_ipc_client *other;
+	wl_list_for_each(other, &ipc->clients, link)
+		stats.queued_bytes += other->out_bytes;
+	ipc_reply(client, LW_IPC_EVENT_QUEUE_STATS, &stats, sizeof(stats));
+}
+
+/* Resolve the view a request refers to; stale ids are not an error,
+ * the window may have closed while the request was in flight */
+static struct lw_view *ipc_request_view(struct lw_ipc_client *client,
+		const struct lw_ipc_header *header) {
+	const struct lw_ipc_view_ref *ref =
+		lw_ipc_payload(header, sizeof(*ref));
+	if (!ref) return NULL;
+	struct lw_view *view = lw_view_from_id(client->server, ref->id);
+	if (!view)
+		wlr_log(WLR_DEBUG, "IPC request for unknown view %u", ref->id);
+	return view;
+}
+
+static void ipc_handle_request(struct lw_ipc_client *client,
+		const struct lw_ipc_header *header) {
+	struct lw_server *server = client->server;
+	struct lw_view *view;
+
+	switch (header->type) {
+	case LW_IPC_REQUEST_ACTIVATE_VIEW:
+		if ((view = ipc_request_view(client, header)))
+			lw_view_activate(view);
+		break;
+	case LW_IPC_REQUEST_CLOSE_VIEW:
+		if ((view = ipc_request_view(client, header)))
+			lw_view_close(view);
+		break;
+	case LW_IPC_REQUEST_MINIMIZE_VIEW:
+		if ((view = ipc_request_view(client, header)))
+			lw_view_minimize(view);
+		break;
+	case LW_IPC_REQUEST_SWITCH_WORKSPACE: {
+		const struct lw_ipc_workspace *req =
+			lw_ipc_payload(header, sizeof(*req));
+		struct lw_workspace *ws =
+			req ? lw_workspace_get(server, req->index) : NULL;
+		/* One past the last one asks for a new desktop */
+		if (req && !ws && req->index == server->workspace_count)
+			ws = lw_workspace_create(server, NULL);
+		if (ws)
+			lw_workspace_switch(server, ws);
+		break;
+	}
+	case LW_IPC_REQUEST_SHOW_DESKTOP:
+		lw_view_minimize_all(server);
+		break;
+	case LW_IPC_REQUEST_OVERVIEW: {
+		const struct lw_ipc_overview_request *req =
+			lw_ipc_payload(header, sizeof(*req));
+		if (!req) break;
+		if (req->action == LW_IPC_OVERVIEW_SHOW)
+			lw_overview_show(server);
+		else if (req->action == LW_IPC_OVERVIEW_TOGGLE)
+			lw_overview_toggle(server);
+		else
+			lw_overview_hide(server);
+		break;
+	}
+	case LW_IPC_REQUEST_QUERY_STATE:
+		ipc_reply_state(client);
+		break;
+	case LW_IPC_REQUEST_FRAME_STATS:
+		ipc_reply_frame_stats(client);
+		break;
+	case LW_IPC_REQUEST_INPUT_STATS:
+		ipc_reply_input_stats(client);
+		break;
+	case LW_IPC_REQUEST_SUBSCRIBE: {
+		const struct lw_ipc_subscribe *sub =
+			lw_ipc_payload(header, sizeof(*sub));
+		if (sub)
+			ipc_set_subscriptions(client, sub->classes & LW_IPC_CLASS_ALL);
+		break;
+	}
+	case LW_IPC_REQUEST_QUEUE_STATS:
+		ipc_reply_queue_stats(client);
+		break;
+	case LW_IPC_REQUEST_SNAPSHOT:
+		ipc_reply_snapshot(client);
+		break;
+	case LW_IPC_REQUEST_THUMBNAIL:
+		ipc_reply_thumbnail(client, header);
+		break;
+	case LW_IPC_REQUEST_THUMBNAIL_RELEASE:
+		if ((view = ipc_request_view(client, header)))
+			lw_thumbnail_release(view);
+		break;
+	case LW_IPC_REQUEST_PING: {
+		const struct lw_ipc_ping *ping =
+			lw_ipc_payload(header, sizeof(*ping));
+		if (ping)
+			ipc_reply(client, LW_IPC_EVENT_PONG, ping, sizeof(*ping));
+		break;
+	}
+	default:
+		wlr_log(WLR_DEBUG, "IPC unknown request type 0x%04x",
+			header->type);
+		break;
+	}
+}
+
+static int ipc_client_event(int fd, uint32_t mask, void *data) {
+	struct lw_ipc_client *client = data;
+
+	if (mask & WL_EVENT_WRITABLE) {
+		if (!ipc_client_flush(client)) return 0;
+	}
+	if (mask & (WL_EVENT_HANGUP | WL_EVENT_ERROR)) {
+		ipc_client_disconnect(client);
 		return 0;
 	}
+	if (!(mask & WL_EVENT_READABLE)) return 0;
 
-	if (ipc->client_count >= LW_IPC_MAX_CLIENTS) {
-		wlr_log(WLR_ERROR, "IPC max clients reached, rejecting");
-		close(client_fd);
+	size_t space = sizeof(client->inbuf) - client->inlen;
+	ssize_t n = read(fd, client->inbuf + client->inlen, space);
+	if (n <= 0) {
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return 0;
+		ipc_client_disconnect(client);
 		return 0;
 	}
+	client->inlen += n;
+
+	/* Dispatch every complete message where it lies, keep the partial
+	 * tail.  Sizes are multiples of LW_IPC_ALIGN, so each header stays
+	 * aligned. */
+	size_t start = 0;
+	while (client->inlen - start >= sizeof(struct lw_ipc_header)) {
+		const struct lw_ipc_header *header =
+			(const void *)(client->inbuf + start);
+		if (!lw_ipc_header_valid(header, LW_IPC_MAX_REQUEST)) {
+			wlr_log(WLR_ERROR, "IPC bad message (version %u, "
+				"size %u), disconnecting",
+				header->version, header->size);
+			ipc_client_disconnect(client);
+			return 0;
+		}
+		if (header->size > client->inlen - start) break;
+
+		ipc_handle_request(client, header);
+		if (client->fd < 0) return 0;
+		start += header->size;
+	}
+	memmove(client->inbuf, client->inbuf + start, client->inlen - start);
+	client->inlen -= start;
+
+	return 0;
+}
+
+/* Set up one accepted connection; false if it had to be refused */
+static bool ipc_add_client(struct lw_server *server, int client_fd) {
+	struct lw_ipc *ipc = &server->ipc;
 
 	if (set_nonblocking(client_fd) < 0) {
 		wlr_log(WLR_ERROR, "IPC set_nonblocking failed");
-		close(client_fd);
-		return 0;
+		return false;
 	}
 
-	struct lw_ipc_client *client = &ipc->clients[ipc->client_count];
+	struct lw_ipc_client *client = calloc(1, sizeof(*client));
+	if (client)
+		client->outq = calloc(LW_IPC_OUTQ_LEN, sizeof(*client->outq));
+	if (!client || !client->outq) {
+		wlr_log(WLR_ERROR, "IPC out of memory, rejecting client");
+		free(client);
+		return false;
+	}
+	client->id = ++ipc->next_client_id;
 	client->fd = client_fd;
 	client->server = server;
 
@@ -103,26 +819,110 @@ static int ipc_accept_client(int fd, uint32_t mask, void *data) {
 		wl_display_get_event_loop(server->wl_display);
 	client->event_source = wl_event_loop_add_fd(loop, client_fd,
 		WL_EVENT_READABLE | WL_EVENT_HANGUP,
-		ipc_client_readable, client);
+		ipc_client_event, client);
+	if (!client->event_source) {
+		wlr_log(WLR_ERROR, "IPC failed to watch client fd=%d",
+			client_fd);
+		free(client->outq);
+		free(client);
+		return false;
+	}
 
-	ipc->client_count++;
-	wlr_log(WLR_INFO, "IPC client connected (fd=%d, total=%d)",
-		client_fd, ipc->client_count);
+	wl_list_insert(&ipc->clients, &client->link);
+	ipc->clients_accepted++;
+	if (++ipc->client_count > ipc->clients_peak)
+		ipc->clients_peak = ipc->client_count;
+	wlr_log(WLR_INFO, "IPC client %u connected (fd=%d, total=%d)",
+		client->id, client_fd, ipc->client_count);
 
-	return 0;
+	ipc_reply_hello(client);
+	return true;
+}
+
+/* Drain the whole backlog, so a burst of connections costs one wakeup */
+static int ipc_accept_client(int fd, uint32_t mask, void *data) {
+	struct lw_server *server = data;
+
+	while (true) {
+		int client_fd = accept(fd, NULL, NULL);
+		if (client_fd < 0) {
+			if (errno == EINTR) continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				wlr_log(WLR_ERROR, "IPC accept failed: %s",
+					strerror(errno));
+			return 0;
+		}
+		if (!ipc_add_client(server, client_fd))
+			close(client_fd);
+	}
+}
+
+static uint64_t ipc_now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void ipc_trace_close(struct lw_ipc *ipc) {
+	if (!ipc->trace) return;
+	if (fclose(ipc->trace) != 0)
+		wlr_log_errno(WLR_ERROR, "IPC trace close failed");
+	else
+		wlr_log(WLR_INFO, "IPC trace: %" PRIu64 " events recorded",
+			ipc->trace_records);
+	ipc->trace = NULL;
+}
+
+static void ipc_trace_open(struct lw_ipc *ipc) {
+	const char *path = getenv("LWINDESK_IPC_TRACE");
+	if (!path || !*path) return;
+
+	ipc->trace = fopen(path, "we");
+	if (!ipc->trace) {
+		wlr_log_errno(WLR_ERROR, "IPC trace %s", path);
+		return;
+	}
+	/* Records are small; let stdio batch them */
+	setvbuf(ipc->trace, NULL, _IOFBF, 64 * 1024);
+
+	struct lw_ipc_trace_header header = {
+		.magic = LW_IPC_TRACE_MAGIC,
+		.version = LW_IPC_VERSION,
+	};
+	ipc->trace_start_ns = ipc_now_ns();
+	if (fwrite(&header, sizeof(header), 1, ipc->trace) != 1) {
+		wlr_log_errno(WLR_ERROR, "IPC trace %s", path);
+		ipc_trace_close(ipc);
+		return;
+	}
+	wlr_log(WLR_INFO, "IPC trace recording to %s", path);
 }
 
+static void ipc_trace_write(struct lw_ipc *ipc,
+		const struct ipc_message *msg) {
+	struct lw_ipc_trace_record record = {
+		.time_ns = ipc_now_ns() - ipc->trace_start_ns,
+		.size = msg->len,
+	};
+	if (fwrite(&record, sizeof(record), 1, ipc->trace) != 1 ||
+			fwrite(msg->data, msg->len, 1, ipc->trace) != 1) {
+		wlr_log_errno(WLR_ERROR, "IPC trace write failed, stopping");
+		ipc_trace_close(ipc);
+		return;
+	}
+	ipc->trace_records++;
+}
+
+static int ipc_title_timer(void *data);
+
 int lw_ipc_init(struct lw_server *server) {
 	struct lw_ipc *ipc = &server->ipc;
 	memset(ipc, 0, sizeof(*ipc));
 	ipc->listen_fd = -1;
-	ipc->client_count = 0;
-
-	/* Initialize all client slots */
-	for (int i = 0; i < LW_IPC_MAX_CLIENTS; i++) {
-		ipc->clients[i].fd = -1;
-		ipc->clients[i].server = server;
-	}
+	wl_list_init(&ipc->clients);
+	wl_list_init(&ipc->closed);
+	wl_list_init(&ipc->title_pending);
+	ipc_trace_open(ipc);
 
 	/* Build socket path */
 	const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
@@ -165,7 +965,7 @@ int lw_ipc_init(struct lw_server *server) {
 		return -1;
 	}
 
-	if (listen(ipc->listen_fd, 4) < 0) {
+	if (listen(ipc->listen_fd, LW_IPC_LISTEN_BACKLOG) < 0) {
 		wlr_log(WLR_ERROR, "IPC listen() failed: %s",
 			strerror(errno));
 		close(ipc->listen_fd);
@@ -179,53 +979,221 @@ int lw_ipc_init(struct lw_server *server) {
 		wl_display_get_event_loop(server->wl_display);
 	ipc->listen_source = wl_event_loop_add_fd(loop, ipc->listen_fd,
 		WL_EVENT_READABLE, ipc_accept_client, server);
+	ipc->title_timer = wl_event_loop_add_timer(loop, ipc_title_timer,
+		server);
 
 	wlr_log(WLR_INFO, "IPC listening on %s", ipc->socket_path);
 	return 0;
 }
 
-void lw_ipc_send(struct lw_server *server, const char *message) {
+/* Queue a reference to a finished message for every subscribed client */
+static void ipc_broadcast_message(struct lw_server *server,
+		const struct ipc_message *msg, bool state, uint32_t key) {
 	struct lw_ipc *ipc = &server->ipc;
-	if (ipc->client_count == 0) {
-		wlr_log(WLR_DEBUG, "IPC send '%s' - no clients connected",
-			message);
-		return;
+	const struct lw_ipc_header *header = (const void *)msg->data;
+	uint32_t event_class = ipc_event_class(header->type);
+
+	if (ipc->trace) ipc_trace_write(ipc, msg);
+	if (!(ipc->subscriptions & event_class)) return;
+
+	struct lw_ipc_buffer *buffer = ipc_buffer_create(ipc, msg, state, key);
+	if (!buffer) return;
+
+	/* Safe iteration: a client that is not reading drops out here */
+	struct lw_ipc_client *client, *tmp;
+	wl_list_for_each_safe(client, tmp, &ipc->clients, link) {
+		if (client->subscriptions & event_class)
+			ipc_queue(client, buffer);
 	}
+	ipc_buffer_unref(buffer);
+}
 
-	/* Build the newline-delimited message */
-	char buf[256];
-	int len = snprintf(buf, sizeof(buf), "%s\n", message);
-	if (len < 0 || len >= (int)sizeof(buf)) return;
-
-	wlr_log(WLR_DEBUG, "IPC sending '%s' to %d client(s)",
-		message, ipc->client_count);
-
-	/* Send to all connected clients. Iterate in reverse so
-	 * disconnects during send don't skip entries. */
-	for (int i = ipc->client_count - 1; i >= 0; i--) {
-		struct lw_ipc_client *client = &ipc->clients[i];
-		if (client->fd < 0) continue;
-
-		ssize_t written = write(client->fd, buf, len);
-		if (written < 0) {
-			if (errno == EAGAIN || errno == EWOULDBLOCK) {
-				/* Client buffer full, skip this message */
-				wlr_log(WLR_DEBUG,
-					"IPC client %d buffer full", i);
-			} else {
-				/* Write error, disconnect client */
-				ipc_client_disconnect(client);
-			}
-		}
+/* Serialize once and queue a reference for every subscribed client */
+static void ipc_broadcast(struct lw_server *server, uint16_t type,
+		const void *payload, size_t size, bool state, uint32_t key) {
+	if (!lw_ipc_wants(server, type)) return;
+
+	struct ipc_message msg;
+	ipc_message_init(&msg, type);
+	if (ipc_message_append(&msg, payload, size) != size) return;
+	ipc_message_finish(&msg);
+	ipc_broadcast_message(server, &msg, state, key);
+}
+
+bool lw_ipc_wants(struct lw_server *server, uint16_t type) {
+	return server->ipc.trace ||
+		(server->ipc.subscriptions & ipc_event_class(type));
+}
+
+void lw_ipc_send(struct lw_server *server, uint16_t type,
+		const void *payload, size_t size) {
+	ipc_broadcast(server, type, payload, size, false, 0);
+}
+
+void lw_ipc_send_state(struct lw_server *server, uint16_t type,
+		uint32_t key, const void *payload, size_t size) {
+	ipc_broadcast(server, type, payload, size, true, key);
+}
+
+void lw_ipc_send_workspace(struct lw_server *server) {
+	struct lw_ipc_workspace ws = ipc_workspace_state(server);
+	lw_ipc_send_state(server, LW_IPC_EVENT_WORKSPACE, 0, &ws, sizeof(ws));
+}
+
+void lw_ipc_send_focus(struct lw_server *server, struct lw_view *view) {
+	struct lw_ipc_view_ref ref = { .id = view ? view->id : 0 };
+	lw_ipc_send_state(server, LW_IPC_EVENT_FOCUS, 0, &ref, sizeof(ref));
+}
+
+void lw_ipc_send_overview(struct lw_server *server, bool visible,
+		uint32_t view_id) {
+	struct lw_ipc_overview overview = {
+		.visible = visible,
+		.view_id = view_id,
+		.workspace = server->active_workspace ?
+			server->active_workspace->index : -1,
+	};
+	lw_ipc_send_state(server, LW_IPC_EVENT_OVERVIEW, 0,
+		&overview, sizeof(overview));
+}
+
+void lw_ipc_send_snap_preview(struct lw_server *server,
+		enum lw_snap_zone zone) {
+	if (!lw_ipc_wants(server, LW_IPC_EVENT_SNAP_PREVIEW)) return;
+
+	const char *name = lw_snap_zone_name(zone);
+	struct lw_ipc_snap_preview preview = {
+		.zone = zone,
+		.name_len = strlen(name),
+	};
+	char body[sizeof(preview) + 32];
+	size_t len = sizeof(preview) + preview.name_len;
+	if (len > sizeof(body)) return;
+	memcpy(body, &preview, sizeof(preview));
+	memcpy(body + sizeof(preview), name, preview.name_len);
+	lw_ipc_send_state(server, LW_IPC_EVENT_SNAP_PREVIEW, 0, body, len);
+}
+
+/* Views the window list shows */
+static bool ipc_view_listed(const struct lw_view *view) {
+	return view->mapped;
+}
+
+static void ipc_send_view_string(struct lw_server *server, uint16_t type,
+		struct lw_view *view, const char *str) {
+	if (!lw_ipc_wants(server, type)) return;
+
+	struct lw_ipc_view_string info = { .id = view->id };
+	size_t room = LW_IPC_MAX_MESSAGE - LW_IPC_ALIGN -
+		sizeof(struct lw_ipc_header) - sizeof(info);
+	info.len = ipc_strlen(str ? str : "", room);
+
+	struct ipc_message msg;
+	ipc_message_init(&msg, type);
+	ipc_message_append(&msg, &info, sizeof(info));
+	ipc_message_append(&msg, str, info.len);
+	ipc_message_finish(&msg);
+	ipc_broadcast_message(server, &msg, true, view->id);
+}
+
+static int ipc_title_timer(void *data) {
+	struct lw_server *server = data;
+	struct lw_view *view, *tmp;
+	wl_list_for_each_safe(view, tmp, &server->ipc.title_pending,
+			ipc_title_link) {
+		wl_list_remove(&view->ipc_title_link);
+		wl_list_init(&view->ipc_title_link);
+		ipc_send_view_string(server, LW_IPC_EVENT_VIEW_TITLE, view,
+			view->xdg_toplevel->title);
 	}
+	return 0;
+}
+
+/* Drop a held-back title update, e.g. because the view went away */
+static void ipc_cancel_title(struct lw_view *view) {
+	wl_list_remove(&view->ipc_title_link);
+	wl_list_init(&view->ipc_title_link);
+}
+
+void lw_ipc_send_view_created(struct lw_server *server,
+		struct lw_view *view) {
+	if (!ipc_view_listed(view) ||
+			!lw_ipc_wants(server, LW_IPC_EVENT_VIEW_CREATED))
+		return;
+	/* Carries the current title already */
+	ipc_cancel_title(view);
+
+	struct ipc_message msg;
+	ipc_view_message(&msg, LW_IPC_EVENT_VIEW_CREATED, view);
+	ipc_broadcast_message(server, &msg, false, 0);
+}
+
+void lw_ipc_send_view_destroyed(struct lw_server *server,
+		struct lw_view *view) {
+	ipc_cancel_title(view);
+	if (!ipc_view_listed(view)) return;
+
+	struct lw_ipc_view_ref ref = { .id = view->id };
+	lw_ipc_send(server, LW_IPC_EVENT_VIEW_DESTROYED, &ref, sizeof(ref));
+}
+
+void lw_ipc_send_view_title(struct lw_server *server, struct lw_view *view) {
+	struct lw_ipc *ipc = &server->ipc;
+	if (!ipc_view_listed(view) ||
+			!lw_ipc_wants(server, LW_IPC_EVENT_VIEW_TITLE))
+		return;
+
+	if (!ipc->title_timer) {
+		ipc_send_view_string(server, LW_IPC_EVENT_VIEW_TITLE, view,
+			view->xdg_toplevel->title);
+		return;
+	}
+	if (!wl_list_empty(&view->ipc_title_link)) {
+		ipc->titles_coalesced++;
+		return;
+	}
+	if (wl_list_empty(&ipc->title_pending))
+		wl_event_source_timer_update(ipc->title_timer,
+			LW_IPC_TITLE_DELAY_MS);
+	wl_list_insert(ipc->title_pending.prev, &view->ipc_title_link);
+}
+
+void lw_ipc_send_view_app_id(struct lw_server *server,
+		struct lw_view *view) {
+	if (!ipc_view_listed(view)) return;
+	ipc_send_view_string(server, LW_IPC_EVENT_VIEW_APP_ID, view,
+		view->xdg_toplevel->app_id);
+}
+
+void lw_ipc_send_view_state(struct lw_server *server, struct lw_view *view) {
+	if (!ipc_view_listed(view)) return;
+
+	struct lw_ipc_view_state state = {
+		.id = view->id,
+		.flags = ipc_view_flags(view),
+		.workspace = view->workspace ? view->workspace->index : -1,
+	};
+	lw_ipc_send_state(server, LW_IPC_EVENT_VIEW_STATE, view->id,
+		&state, sizeof(state));
 }
 
 void lw_ipc_destroy(struct lw_server *server) {
 	struct lw_ipc *ipc = &server->ipc;
 
 	/* Disconnect all clients */
-	for (int i = ipc->client_count - 1; i >= 0; i--) {
-		ipc_client_disconnect(&ipc->clients[i]);
+	struct lw_ipc_client *client, *tmp;
+	wl_list_for_each_safe(client, tmp, &ipc->clients, link) {
+		ipc_client_disconnect(client);
+	}
+	ipc_reap_closed(ipc);
+
+	if (ipc->flush_idle) {
+		wl_event_source_remove(ipc->flush_idle);
+		ipc->flush_idle = NULL;
+	}
+	if (ipc->title_timer) {
+		wl_event_source_remove(ipc->title_timer);
+		ipc->title_timer = NULL;
 	}
 
 	/* Close listener */
@@ -238,6 +1206,8 @@ void lw_ipc_destroy(struct lw_server *server) {
 		ipc->listen_fd = -1;
 	}
 
+	ipc_trace_close(ipc);
+
 	/* Remove socket file */
 	if (ipc->socket_path[0]) {
 		unlink(ipc->socket_path);
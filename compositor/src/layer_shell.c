@@ -1,13 +1,401 @@
 /*
  * lwindesk - compositor/src/layer_shell.c - Layer shell protocol (for shell panels)
  *
- * TODO: Implement wlr-layer-shell-unstable-v1 for taskbar and overlays.
- * The shell (Qt/QML) will use layer shell to anchor the taskbar to the bottom
- * of the screen and render overlays (start menu, notifications) above windows.
+ * The taskbar, start menu, notification center and other shell panels
+ * are zwlr_layer_shell_v1 surfaces.  Each layer has one tree in the
+ * scene (background and bottom below the workspaces, top and overlay
+ * above them) holding one tree per output, positioned at the output's
+ * layout origin, so a layer surface is placed in output coordinates and
+ * stays clear of window stacking.
+ *
+ * Arranging an output configures its surfaces top layer first, those
+ * with an exclusive zone before the rest, and whatever area they leave
+ * is cached as lw_output.usable_area for snapping and placement.  It is
+ * only recomputed when a layer surface maps, unmaps or commits a new
+ * size or anchor, or the output layout changes.
  */
 
 #define _POSIX_C_SOURCE 200112L
+#include <stdlib.h>
+#include <wlr/types/wlr_compositor.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_output_layout.h>
+#include <wlr/types/wlr_scene.h>
+#include <wlr/types/wlr_seat.h>
+#include <wlr/types/wlr_xdg_shell.h>
+#include <wlr/util/log.h>
+
+#include "layer_shell.h"
+#include "hit_index.h"
+#include "output.h"
 #include "server.h"
+#include "snap.h"
+#include "view.h"
+#include "workspace.h"
+
+#define LAYER_SHELL_VERSION 4
+
+static struct lw_output *output_from_wlr(struct lw_server *server,
+                                         struct wlr_output *wlr_output) {
+    struct lw_output *output;
+    wl_list_for_each(output, &server->outputs, link) {
+        if (output->wlr_output == wlr_output) return output;
+    }
+    return NULL;
+}
+
+/* --- Arranging --- */
+
+/* Fit windows that fill a zone to the output's new usable area */
+static void arrange_views(struct lw_output *output) {
+    struct lw_server *server = output->server;
+    struct lw_view *view;
+    wl_list_for_each(view, &server->views, link) {
+        if (!view->is_snapped || view->is_fullscreen) continue;
+        if (wlr_output_layout_output_at(server->output_layout,
+                view->x + 1, view->y + 1) != output->wlr_output) continue;
+        lw_view_snap(view, view->snap_zone);
+    }
+}
+
+static void arrange_layer(struct lw_output *output, int layer,
+                          const struct wlr_box *full, struct wlr_box *usable,
+                          bool exclusive) {
+    struct lw_layer_surface *surface;
+    wl_list_for_each(surface, &output->layers[layer], link) {
+        struct wlr_layer_surface_v1 *layer_surface = surface->layer_surface;
+        if (!layer_surface->initialized) continue;
+        if ((layer_surface->current.exclusive_zone > 0) != exclusive) continue;
+
+        wlr_scene_layer_surface_v1_configure(surface->scene, full, usable);
+        struct wlr_scene_node *node = &surface->scene->tree->node;
+        surface->box = (struct wlr_box){
+            .x = output->layer_trees[layer]->node.x + node->x,
+            .y = output->layer_trees[layer]->node.y + node->y,
+            .width = layer_surface->current.actual_width,
+            .height = layer_surface->current.actual_height,
+        };
+    }
+}
+
+void lw_layer_arrange(struct lw_output *output) {
+    struct lw_server *server = output->server;
+    struct wlr_box layout_box;
+    wlr_output_layout_get_box(server->output_layout, output->wlr_output,
+                               &layout_box);
+    for (int layer = 0; layer < LW_LAYER_COUNT; layer++) {
+        wlr_scene_node_set_position(&output->layer_trees[layer]->node,
+                                    layout_box.x, layout_box.y);
+    }
+
+    /* Surfaces are configured in output coordinates */
+    struct wlr_box full = {
+        .width = layout_box.width,
+        .height = layout_box.height,
+    };
+    struct wlr_box usable = full;
+    for (int layer = LW_LAYER_COUNT - 1; layer >= 0; layer--) {
+        arrange_layer(output, layer, &full, &usable, true);
+    }
+    for (int layer = LW_LAYER_COUNT - 1; layer >= 0; layer--) {
+        arrange_layer(output, layer, &full, &usable, false);
+    }
+
+    usable.x += layout_box.x;
+    usable.y += layout_box.y;
+    lw_hit_index_invalidate(server);
+    lw_output_schedule_frame(output);
+    bool changed = !wlr_box_equal(&usable, &output->usable_area);
+    output->usable_area = usable;
+    /* Zones follow the usable area, the pointer bands the output box */
+    lw_snap_output_update(output);
+    if (!changed) return;
+
+    wlr_log(WLR_DEBUG, "Output %s usable area %d,%d %dx%d",
+            output->wlr_output->name, usable.x, usable.y,
+            usable.width, usable.height);
+    arrange_views(output);
+}
+
+bool lw_layer_usable_area_at(struct lw_server *server, double lx, double ly,
+                             struct wlr_box *area) {
+    struct wlr_output *wlr_output =
+        wlr_output_layout_output_at(server->output_layout, lx, ly);
+    struct lw_output *output = wlr_output ?
+        output_from_wlr(server, wlr_output) : NULL;
+    if (!output && !wl_list_empty(&server->outputs)) {
+        output = wl_container_of(server->outputs.prev, output, link);
+    }
+    if (!output) return false;
+    *area = output->usable_area;
+    return true;
+}
+
+void lw_layer_output_cover(struct lw_output *output, bool cover) {
+    for (int layer = 0; layer < ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY; layer++) {
+        wlr_scene_node_set_enabled(&output->layer_trees[layer]->node, !cover);
+    }
+    lw_hit_index_invalidate(output->server);
+}
+
+/* --- Focus and hit testing --- */
+
+void lw_layer_focus(struct lw_layer_surface *layer) {
+    struct lw_server *server = layer->server;
+    struct wlr_seat *seat = server->seat;
+    struct wlr_surface *surface = layer->layer_surface->surface;
+    struct wlr_surface *prev = seat->keyboard_state.focused_surface;
+    if (prev == surface) return;
+
+    if (prev) {
+        struct wlr_xdg_toplevel *toplevel =
+            wlr_xdg_toplevel_try_from_wlr_surface(prev);
+        if (toplevel) {
+            wlr_xdg_toplevel_set_activated(toplevel, false);
+        }
+    }
+    struct wlr_keyboard *keyboard = wlr_seat_get_keyboard(seat);
+    if (keyboard) {
+        wlr_seat_keyboard_notify_enter(seat, surface,
+            keyboard->keycodes, keyboard->num_keycodes,
+            &keyboard->modifiers);
+    }
+}
+
+/* Back to the active workspace's window after a layer surface had focus */
+static void layer_restore_focus(struct lw_layer_surface *layer) {
+    struct lw_server *server = layer->server;
+    if (server->seat->keyboard_state.focused_surface !=
+        layer->layer_surface->surface) return;
+
+    struct lw_view *top = lw_workspace_top_view(server->active_workspace);
+    if (top) {
+        lw_view_focus(top);
+    } else {
+        wlr_seat_keyboard_notify_clear_focus(server->seat);
+    }
+}
+
+static bool layer_wants_focus(struct lw_layer_surface *layer) {
+    const struct wlr_layer_surface_v1_state *state =
+        &layer->layer_surface->current;
+    return state->keyboard_interactive !=
+        ZWLR_LAYER_SURFACE_V1_KEYBOARD_INTERACTIVITY_NONE;
+}
+
+static struct wlr_surface *layer_at(struct lw_output *output, int layer,
+                                    double lx, double ly,
+                                    double *sx, double *sy,
+                                    struct lw_layer_surface **out) {
+    if (!output->layer_trees[layer]->node.enabled) return NULL;
+
+    /* Later surfaces are stacked above earlier ones */
+    struct lw_layer_surface *surface;
+    wl_list_for_each_reverse(surface, &output->layers[layer], link) {
+        if (!surface->mapped) continue;
+        struct wlr_surface *found = wlr_layer_surface_v1_surface_at(
+            surface->layer_surface, lx - surface->box.x, ly - surface->box.y,
+            sx, sy);
+        if (found) {
+            *out = surface;
+            return found;
+        }
+    }
+    return NULL;
+}
+
+struct wlr_surface *lw_layer_surface_at(struct lw_server *server,
+                                        double lx, double ly, bool above,
+                                        double *sx, double *sy,
+                                        struct lw_layer_surface **out) {
+    struct wlr_output *wlr_output =
+        wlr_output_layout_output_at(server->output_layout, lx, ly);
+    struct lw_output *output = wlr_output ?
+        output_from_wlr(server, wlr_output) : NULL;
+    if (!output) return NULL;
+
+    int from = above ? ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY :
+                       ZWLR_LAYER_SHELL_V1_LAYER_BOTTOM;
+    int to = above ? ZWLR_LAYER_SHELL_V1_LAYER_TOP :
+                     ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND;
+    for (int layer = from; layer >= to; layer--) {
+        struct wlr_surface *surface =
+            layer_at(output, layer, lx, ly, sx, sy, out);
+        if (surface) return surface;
+    }
+    return NULL;
+}
+
+/* --- Surface lifecycle --- */
+
+static void layer_surface_map(struct wl_listener *listener, void *data) {
+    struct lw_layer_surface *layer = wl_container_of(listener, layer, map);
+    layer->mapped = true;
+    if (!layer->output) return;
+
+    lw_layer_arrange(layer->output);
+    /* Menus and panels that take keys get them as they open */
+    if (layer_wants_focus(layer) &&
+        layer->layer_surface->current.layer >= ZWLR_LAYER_SHELL_V1_LAYER_TOP) {
+        lw_layer_focus(layer);
+    }
+}
+
+static void layer_surface_unmap(struct wl_listener *listener, void *data) {
+    struct lw_layer_surface *layer = wl_container_of(listener, layer, unmap);
+    layer->mapped = false;
+    layer_restore_focus(layer);
+    if (layer->output) {
+        lw_layer_arrange(layer->output);
+    }
+}
+
+static void layer_surface_commit(struct wl_listener *listener, void *data) {
+    struct lw_layer_surface *layer = wl_container_of(listener, layer, commit);
+    struct wlr_layer_surface_v1 *layer_surface = layer->layer_surface;
+    struct lw_output *output = layer->output;
+    if (!output) return;
+
+    /* A changed layer moves the surface to that layer's tree */
+    int wanted = layer_surface->current.layer;
+    if (layer->scene->tree->node.parent != output->layer_trees[wanted]) {
+        wlr_scene_node_reparent(&layer->scene->tree->node,
+                                output->layer_trees[wanted]);
+        wl_list_remove(&layer->link);
+        wl_list_insert(output->layers[wanted].prev, &layer->link);
+    }
+
+    /* The initial commit needs a configure; later ones only matter when
+     * they change what the arrangement depends on */
+    uint32_t committed = layer_surface->current.committed;
+    if (layer_surface->initial_commit || committed) {
+        lw_layer_arrange(output);
+    } else if (layer->mapped) {
+        lw_output_schedule_frame(output);
+    }
+}
+
+static void layer_surface_new_popup(struct wl_listener *listener, void *data) {
+    struct lw_layer_surface *layer =
+        wl_container_of(listener, layer, new_popup);
+    struct wlr_xdg_popup *popup = data;
+    /* Nested popups find their parent's tree through base->data */
+    popup->base->data =
+        wlr_scene_xdg_surface_create(layer->scene->tree, popup->base);
+}
+
+static void layer_surface_destroy(struct wl_listener *listener, void *data) {
+    struct lw_layer_surface *layer =
+        wl_container_of(listener, layer, destroy);
+    wl_list_remove(&layer->link);
+    wl_list_remove(&layer->map.link);
+    wl_list_remove(&layer->unmap.link);
+    wl_list_remove(&layer->commit.link);
+    wl_list_remove(&layer->new_popup.link);
+    wl_list_remove(&layer->destroy.link);
+    if (layer->output) {
+        lw_layer_arrange(layer->output);
+    }
+    free(layer);
+}
+
+static void handle_new_layer_surface(struct wl_listener *listener,
+                                     void *data) {
+    struct lw_server *server =
+        wl_container_of(listener, server, new_layer_surface);
+    struct wlr_layer_surface_v1 *layer_surface = data;
+
+    /* No output asked for: the one under the cursor */
+    if (!layer_surface->output) {
+        layer_surface->output = wlr_output_layout_output_at(
+            server->output_layout, server->cursor->x, server->cursor->y);
+    }
+    struct lw_output *output = layer_surface->output ?
+        output_from_wlr(server, layer_surface->output) : NULL;
+    if (!output) {
+        wlr_layer_surface_v1_destroy(layer_surface);
+        return;
+    }
+
+    struct lw_layer_surface *layer = calloc(1, sizeof(*layer));
+    if (!layer) {
+        wlr_layer_surface_v1_destroy(layer_surface);
+        return;
+    }
+    int index = layer_surface->pending.layer;
+    layer->scene = wlr_scene_layer_surface_v1_create(
+        output->layer_trees[index], layer_surface);
+    if (!layer->scene) {
+        free(layer);
+        wlr_layer_surface_v1_destroy(layer_surface);
+        return;
+    }
+    layer->server = server;
+    layer->output = output;
+    layer->layer_surface = layer_surface;
+    layer_surface->data = layer;
+    wl_list_insert(output->layers[index].prev, &layer->link);
+
+    layer->map.notify = layer_surface_map;
+    wl_signal_add(&layer_surface->surface->events.map, &layer->map);
+    layer->unmap.notify = layer_surface_unmap;
+    wl_signal_add(&layer_surface->surface->events.unmap, &layer->unmap);
+    layer->commit.notify = layer_surface_commit;
+    wl_signal_add(&layer_surface->surface->events.commit, &layer->commit);
+    layer->new_popup.notify = layer_surface_new_popup;
+    wl_signal_add(&layer_surface->events.new_popup, &layer->new_popup);
+    layer->destroy.notify = layer_surface_destroy;
+    wl_signal_add(&layer_surface->events.destroy, &layer->destroy);
+
+    wlr_log(WLR_DEBUG, "New layer surface %s on %s (layer %d)",
+            layer_surface->namespace, output->wlr_output->name, index);
+}
+
+/* --- Setup --- */
+
+void lw_layer_shell_init(struct lw_server *server) {
+    /* Background and bottom under the workspaces, top and overlay above */
+    for (int layer = 0; layer < LW_LAYER_COUNT; layer++) {
+        server->layer_trees[layer] =
+            wlr_scene_tree_create(&server->scene->tree);
+    }
+    wlr_scene_node_place_above(
+        &server->layer_trees[ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND]->node,
+        &server->background_tree->node);
+    wlr_scene_node_place_above(
+        &server->layer_trees[ZWLR_LAYER_SHELL_V1_LAYER_BOTTOM]->node,
+        &server->layer_trees[ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND]->node);
+    wlr_scene_node_place_above(
+        &server->workspace_tree->node,
+        &server->layer_trees[ZWLR_LAYER_SHELL_V1_LAYER_BOTTOM]->node);
+
+    server->layer_shell = wlr_layer_shell_v1_create(server->wl_display,
+                                                    LAYER_SHELL_VERSION);
+    server->new_layer_surface.notify = handle_new_layer_surface;
+    wl_signal_add(&server->layer_shell->events.new_surface,
+                  &server->new_layer_surface);
+}
+
+void lw_layer_output_init(struct lw_output *output) {
+    struct lw_server *server = output->server;
+    for (int layer = 0; layer < LW_LAYER_COUNT; layer++) {
+        wl_list_init(&output->layers[layer]);
+        output->layer_trees[layer] =
+            wlr_scene_tree_create(server->layer_trees[layer]);
+    }
+    lw_layer_arrange(output);
+}
 
-/* Placeholder - layer shell implementation will be added when the
- * shell components need to register as layer surfaces */
+void lw_layer_output_finish(struct lw_output *output) {
+    for (int layer = 0; layer < LW_LAYER_COUNT; layer++) {
+        struct lw_layer_surface *surface, *tmp;
+        wl_list_for_each_safe(surface, tmp, &output->layers[layer], link) {
+            /* Tells the client it was closed and destroys it now */
+            surface->output = NULL;
+            wl_list_remove(&surface->link);
+            wl_list_init(&surface->link);
+            wlr_layer_surface_v1_destroy(surface->layer_surface);
+        }
+        wlr_scene_node_destroy(&output->layer_trees[layer]->node);
+    }
+}
@@ -3,29 +3,220 @@
  */
 
 #define _POSIX_C_SOURCE 200112L
+#include <inttypes.h>
+#include <pixman.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <wlr/backend/x11.h>
 #include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_output_layout.h>
+#include <wlr/types/wlr_compositor.h>
 #include <wlr/types/wlr_scene.h>
+#include <wlr/types/wlr_xdg_shell.h>
+#include <wlr/util/box.h>
 #include <wlr/util/log.h>
 
+#include "background.h"
+#include "input.h"
+#include "layer_shell.h"
 #include "output.h"
 #include "server.h"
+#include "view.h"
+
+/*
+ * Decide whether this frame needs a commit.  The scene graph already
+ * accumulates damage for node changes (moves, buffer swaps, surface
+ * commits) in the output's damage ring; output->dirty covers changes we
+ * signal ourselves, and wlr_output->needs_frame covers backend requests
+ * such as a mode change or a cursor plane fallback.
+ */
+static bool output_needs_commit(struct lw_output *output) {
+    return output->dirty || output->wlr_output->needs_frame ||
+        pixman_region32_not_empty(&output->scene_output->damage_ring.current);
+}
+
+/* Frame events fire at vblank; when the backend reports presentation
+ * the last present timestamp is that vblank.  Fall back to our own clock
+ * if it's missing or stale (e.g. after an idle period). */
+static struct timespec frame_start_time(struct lw_output *output,
+                                        const struct timespec *now) {
+    const struct timespec *last = &output->last_present;
+    if (last->tv_sec == 0 && last->tv_nsec == 0) return *now;
+
+    int64_t since_ns = (int64_t)(now->tv_sec - last->tv_sec) * 1000000000 +
+                       (now->tv_nsec - last->tv_nsec);
+    if (since_ns < 0 || since_ns > 100000000) return *now;
+    return *last;
+}
 
 static void output_frame(struct wl_listener *listener, void *data) {
     struct lw_output *output = wl_container_of(listener, output, frame);
-    struct wlr_scene *scene = output->server->scene;
+    struct wlr_scene_output *scene_output = output->scene_output;
 
-    struct wlr_scene_output *scene_output =
-        wlr_scene_get_scene_output(scene, output->wlr_output);
-    wlr_scene_output_commit(scene_output, NULL);
+    /* Coalesced pointer motion runs first so a window being dragged
+     * lands in this frame */
+    lw_cursor_flush_motion(output->server);
+
+    /* Nothing changed since the last commit: don't render, but still
+     * release frame callbacks, or a client that asked for one without
+     * new content (or whose content is hidden) would wait forever */
+    if (!output_needs_commit(output)) {
+        output->frames_skipped++;
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        wlr_scene_output_send_frame_done(scene_output, &now);
+        return;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct timespec frame_start = frame_start_time(output, &start);
+
+    output->dirty = false;
+    bool committed = wlr_scene_output_commit(scene_output, NULL);
 
     struct timespec now;
     clock_gettime(CLOCK_MONOTONIC, &now);
+    lw_histogram_record_interval(&output->hist_commit, &start, &now);
+
+    if (committed) {
+        output->frames_committed++;
+        lw_histogram_record_interval(&output->hist_latency,
+                                     &frame_start, &now);
+        output->last_commit_end = now;
+        output->awaiting_present = true;
+    }
+
     wlr_scene_output_send_frame_done(scene_output, &now);
 }
 
+static void output_present(struct wl_listener *listener, void *data) {
+    struct lw_output *output = wl_container_of(listener, output, present);
+    struct wlr_output_event_present *event = data;
+
+    if (!event->presented || !event->when) return;
+    output->last_present = *event->when;
+
+    /* Only our own frame commits are timed; the first presentation after
+     * one is that frame (cursor-only commits don't set awaiting_present). */
+    if (output->awaiting_present) {
+        lw_histogram_record_interval(&output->hist_present,
+                                     &output->last_commit_end, event->when);
+        output->awaiting_present = false;
+    }
+}
+
+void lw_output_layout_change(struct wl_listener *listener, void *data) {
+    struct lw_server *server =
+        wl_container_of(listener, server, layout_change);
+    struct lw_output *output;
+    wl_list_for_each(output, &server->outputs, link) {
+        lw_background_update(output);
+        lw_layer_arrange(output);
+    }
+}
+
+/*
+ * Toplevels re-arm their outputs from their own commit handler; popups
+ * and subsurfaces (desynchronized ones commit on their own) have
+ * nothing else watching them.  A commit that only asks for a frame
+ * callback needs no render, just a frame event to release it, so the
+ * outputs are not marked dirty.
+ */
+struct lw_surface_frame {
+    struct wl_listener commit;
+    struct wl_listener destroy;
+};
+
+static void surface_frame_commit(struct wl_listener *listener, void *data) {
+    struct wlr_surface *surface = data;
+    if (wl_list_empty(&surface->current.frame_callback_list)) return;
+
+    struct wlr_surface_output *surface_output;
+    wl_list_for_each(surface_output, &surface->current_outputs, link) {
+        wlr_output_schedule_frame(surface_output->output);
+    }
+}
+
+static void surface_frame_destroy(struct wl_listener *listener, void *data) {
+    struct lw_surface_frame *frame =
+        wl_container_of(listener, frame, destroy);
+    wl_list_remove(&frame->commit.link);
+    wl_list_remove(&frame->destroy.link);
+    free(frame);
+}
+
+void lw_output_new_surface(struct wl_listener *listener, void *data) {
+    struct wlr_surface *surface = data;
+    struct lw_surface_frame *frame = calloc(1, sizeof(*frame));
+    if (!frame) return;
+
+    frame->commit.notify = surface_frame_commit;
+    wl_signal_add(&surface->events.commit, &frame->commit);
+    frame->destroy.notify = surface_frame_destroy;
+    wl_signal_add(&surface->events.destroy, &frame->destroy);
+}
+
+void lw_output_schedule_frame(struct lw_output *output) {
+    output->dirty = true;
+    wlr_output_schedule_frame(output->wlr_output);
+}
+
+void lw_output_damage_box(struct lw_server *server, const struct wlr_box *box) {
+    struct lw_output *output;
+    wl_list_for_each(output, &server->outputs, link) {
+        struct wlr_box output_box, intersection;
+        wlr_output_layout_get_box(server->output_layout,
+                                   output->wlr_output, &output_box);
+        if (wlr_box_intersection(&intersection, &output_box, box)) {
+            lw_output_schedule_frame(output);
+        }
+    }
+}
+
+void lw_output_damage_all(struct lw_server *server) {
+    struct lw_output *output;
+    wl_list_for_each(output, &server->outputs, link) {
+        lw_output_schedule_frame(output);
+    }
+}
+
+static void output_commit(struct wl_listener *listener, void *data) {
+    struct lw_output *output = wl_container_of(listener, output, commit);
+    struct wlr_output_event_commit *event = data;
+
+    /* Only a new mode, scale or transform can change the wallpaper's
+     * pixel size; it re-rasterizes only if that size really changed */
+    if (event->committed & (WLR_OUTPUT_STATE_MODE | WLR_OUTPUT_STATE_SCALE |
+                            WLR_OUTPUT_STATE_TRANSFORM)) {
+        lw_background_update(output);
+    }
+
+    if (!(event->committed & WLR_OUTPUT_STATE_BUFFER)) return;
+
+    /* Direct scanout commits the client's own buffer instead of one
+     * rendered by the scene into our swapchain. */
+    bool scanout = false;
+    if (output->fullscreen_view && event->buffer) {
+        struct wlr_surface *surface =
+            output->fullscreen_view->xdg_toplevel->base->surface;
+        scanout = surface->buffer && event->buffer == &surface->buffer->base;
+    }
+
+    if (scanout) {
+        output->frames_scanout++;
+    } else {
+        output->frames_composited++;
+    }
+    if (scanout != output->scanning_out) {
+        wlr_log(WLR_DEBUG, "Output %s: %s", output->wlr_output->name,
+                scanout ? "direct scanout" : "compositing");
+        output->scanning_out = scanout;
+    }
+}
+
 static void output_request_state(struct wl_listener *listener, void *data) {
     struct lw_output *output =
         wl_container_of(listener, output, request_state);
@@ -36,7 +227,20 @@ static void output_request_state(struct wl_listener *listener, void *data) {
 static void output_destroy(struct wl_listener *listener, void *data) {
     struct lw_output *output = wl_container_of(listener, output, destroy);
 
+    wlr_log(WLR_INFO, "Output %s removed (%" PRIu64 " frames committed, "
+            "%" PRIu64 " skipped)", output->wlr_output->name,
+            output->frames_committed, output->frames_skipped);
+
+    if (output->fullscreen_view) {
+        lw_view_set_fullscreen(output->fullscreen_view, false);
+    }
+    lw_background_destroy(output);
+    lw_snap_output_finish(output);
+    lw_layer_output_finish(output);
+
     wl_list_remove(&output->frame.link);
+    wl_list_remove(&output->commit.link);
+    wl_list_remove(&output->present.link);
     wl_list_remove(&output->request_state.link);
     wl_list_remove(&output->destroy.link);
     wl_list_remove(&output->link);
@@ -84,6 +288,10 @@ void lw_output_new(struct wl_listener *listener, void *data) {
 
     output->frame.notify = output_frame;
     wl_signal_add(&wlr_output->events.frame, &output->frame);
+    output->commit.notify = output_commit;
+    wl_signal_add(&wlr_output->events.commit, &output->commit);
+    output->present.notify = output_present;
+    wl_signal_add(&wlr_output->events.present, &output->present);
     output->request_state.notify = output_request_state;
     wl_signal_add(&wlr_output->events.request_state, &output->request_state);
     output->destroy.notify = output_destroy;
@@ -97,6 +305,11 @@ void lw_output_new(struct wl_listener *listener, void *data) {
         wlr_scene_output_create(server->scene, wlr_output);
     wlr_scene_output_layout_add_output(server->scene_layout, l_output,
                                         output->scene_output);
+    lw_background_update(output);
+    lw_layer_output_init(output);
+
+    /* First frame must always be rendered */
+    lw_output_schedule_frame(output);
 
     wlr_log(WLR_INFO, "New output: %s (%dx%d)",
              wlr_output->name,
@@ -0,0 +1,615 @@
+/*
+ * lwindesk - compositor/src/overview.c - Task View overview
+ *
+ * Thumbnails are extra wlr_scene_buffer nodes showing the buffers the
+ * windows already have: the client's current buffer, cropped to its
+ * window geometry, and the rendered title bar, each with a destination
+ * size.  The renderer scales them while compositing, so opening Task
+ * View costs one frame whatever the number of windows, and thumbnails
+ * stay live because a commit only repoints them at the new buffer.
+ *
+ * Everything sits in one tree on top of the scene that is destroyed on
+ * close.  While it is open, keys (except Super shortcuts) and pointer
+ * input go to the overview instead of clients.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdlib.h>
+#include <wlr/types/wlr_compositor.h>
+#include <wlr/types/wlr_cursor.h>
+#include <wlr/types/wlr_keyboard.h>
+#include <wlr/types/wlr_output_layout.h>
+#include <wlr/types/wlr_scene.h>
+#include <wlr/types/wlr_seat.h>
+#include <wlr/types/wlr_xcursor_manager.h>
+#include <wlr/types/wlr_xdg_shell.h>
+#include <wlr/util/log.h>
+
+#include "overview.h"
+#include "ipc.h"
+#include "layer_shell.h"
+#include "server.h"
+#include "view.h"
+#include "workspace.h"
+
+/* Around the grid and between thumbnails */
+#define OVERVIEW_MARGIN 48
+#define OVERVIEW_GAP 24
+/* Desk strip along the bottom of the usable area, above the taskbar */
+#define OVERVIEW_DESK_WIDTH 192
+#define OVERVIEW_DESK_GAP 16
+/* Accent frame around the selected window and the shown desk */
+#define OVERVIEW_BORDER 3
+
+static const float overview_backdrop[4] = {0.04f, 0.04f, 0.04f, 0.85f};
+static const float overview_desk[4] = {0.17f, 0.17f, 0.17f, 1.0f};
+static const float overview_accent[4] = {0.0f, 0.47f, 0.83f, 1.0f};
+
+/* --- Thumbnails --- */
+
+/*
+ * What a thumbnail of the view shows: its current client buffer and the
+ * part of it inside the window geometry, in buffer pixels.  False when
+ * there is nothing to show yet.  Buffer transforms are not applied;
+ * toplevels practically never use them.
+ */
+static bool view_content(struct lw_view *view, struct wlr_buffer **buffer,
+                         struct wlr_fbox *src, struct wlr_box *geo) {
+    struct wlr_surface *surface = view->xdg_toplevel->base->surface;
+    if (!surface->buffer) return false;
+
+    wlr_xdg_surface_get_geometry(view->xdg_toplevel->base, geo);
+    if (geo->width <= 0 || geo->height <= 0) return false;
+
+    int scale = surface->current.scale > 0 ? surface->current.scale : 1;
+    *src = (struct wlr_fbox){
+        .x = geo->x * scale,
+        .y = geo->y * scale,
+        .width = geo->width * scale,
+        .height = geo->height * scale,
+    };
+    if (src->x + src->width > surface->current.buffer_width) {
+        src->width = surface->current.buffer_width - src->x;
+    }
+    if (src->y + src->height > surface->current.buffer_height) {
+        src->height = surface->current.buffer_height - src->y;
+    }
+    if (src->width <= 0 || src->height <= 0) return false;
+
+    *buffer = &surface->buffer->base;
+    return true;
+}
+
+/* Window size on screen, title bar included */
+static int view_full_height(struct lw_view *view, const struct wlr_box *geo) {
+    return geo->height +
+        (view->deco.has_decorations ? LW_TITLEBAR_HEIGHT : 0);
+}
+
+static int thumb_title_height(struct lw_overview_thumb *thumb) {
+    struct lw_view *view = thumb->view;
+    if (!view->deco.has_decorations || !view->deco.titlebar_wlr_buffer) {
+        return 0;
+    }
+    struct wlr_box geo;
+    wlr_xdg_surface_get_geometry(view->xdg_toplevel->base, &geo);
+    int full = view_full_height(view, &geo);
+    return full > 0 ? thumb->box.height * LW_TITLEBAR_HEIGHT / full : 0;
+}
+
+/* Size and place the thumbnail's nodes in thumb->box */
+static void thumb_place(struct lw_overview_thumb *thumb) {
+    struct wlr_box box = thumb->box;
+    int title_h = thumb->title ? thumb_title_height(thumb) : 0;
+    if (thumb->title) {
+        wlr_scene_node_set_enabled(&thumb->title->node, title_h > 0);
+        wlr_scene_node_set_position(&thumb->title->node, box.x, box.y);
+        if (title_h > 0) {
+            wlr_scene_buffer_set_dest_size(thumb->title, box.width, title_h);
+        }
+    }
+    wlr_scene_buffer_set_dest_size(thumb->content, box.width,
+        box.height - title_h > 0 ? box.height - title_h : 1);
+    wlr_scene_node_set_position(&thumb->content->node, box.x, box.y + title_h);
+}
+
+/* Show the view scaled into box (layout coordinates), fitted to cell */
+static bool thumb_create(struct lw_overview_thumb *thumb,
+                         struct wlr_scene_tree *parent, struct lw_view *view,
+                         struct wlr_box box, struct wlr_box cell) {
+    struct wlr_buffer *buffer;
+    struct wlr_fbox src;
+    struct wlr_box geo;
+    if (!view_content(view, &buffer, &src, &geo)) return false;
+
+    *thumb = (struct lw_overview_thumb){
+        .view = view, .box = box, .cell = cell,
+    };
+    if (thumb_title_height(thumb) > 0) {
+        thumb->title = wlr_scene_buffer_create(parent,
+            view->deco.titlebar_wlr_buffer);
+    }
+
+    thumb->content = wlr_scene_buffer_create(parent, buffer);
+    if (!thumb->content) {
+        if (thumb->title) wlr_scene_node_destroy(&thumb->title->node);
+        return false;
+    }
+    wlr_scene_buffer_set_source_box(thumb->content, &src);
+    thumb_place(thumb);
+    return true;
+}
+
+/* The largest box with the view's aspect ratio that fits in cell, never
+ * larger than the window itself, centered */
+static struct wlr_box fit_box(struct lw_view *view, const struct wlr_box *geo,
+                              struct wlr_box cell) {
+    int width = geo->width;
+    int height = view_full_height(view, geo);
+    double scale = 1.0;
+    if (width > cell.width) scale = (double)cell.width / width;
+    if (height * scale > cell.height) scale = (double)cell.height / height;
+
+    struct wlr_box box = {
+        .width = width * scale > 1 ? (int)(width * scale) : 1,
+        .height = height * scale > 1 ? (int)(height * scale) : 1,
+    };
+    box.x = cell.x + (cell.width - box.width) / 2;
+    box.y = cell.y + (cell.height - box.height) / 2;
+    return box;
+}
+
+/* Where the view is on the output, shrunk into desk; empty when it would
+ * be less than a pixel */
+static struct wlr_box mini_box(struct lw_overview *overview,
+                               struct lw_view *view, const struct wlr_box *geo,
+                               struct wlr_box desk) {
+    double scale = (double)desk.width / overview->area.width;
+    return (struct wlr_box){
+        .x = desk.x + (int)((view->x - overview->area.x) * scale),
+        .y = desk.y + (int)((view->y - overview->area.y) * scale),
+        .width = (int)(geo->width * scale),
+        .height = (int)(view_full_height(view, geo) * scale),
+    };
+}
+
+/*
+ * Point the thumbnail's nodes at the view's current buffers and refit
+ * them, since the window may have been resized or changed its aspect.
+ * Minis sit where the window is on their desk, grid thumbnails are
+ * centered in their cell.
+ */
+static void thumb_update(struct lw_overview *overview,
+                         struct lw_overview_thumb *thumb, bool mini) {
+    struct lw_view *view = thumb->view;
+    struct wlr_buffer *buffer;
+    struct wlr_fbox src;
+    struct wlr_box geo;
+    if (!view_content(view, &buffer, &src, &geo)) return;
+
+    struct wlr_box box = mini ? mini_box(overview, view, &geo, thumb->cell) :
+        fit_box(view, &geo, thumb->cell);
+    if (box.width < 1 || box.height < 1) return;
+
+    wlr_scene_buffer_set_buffer(thumb->content, buffer);
+    wlr_scene_buffer_set_source_box(thumb->content, &src);
+    if (thumb->title && view->deco.titlebar_wlr_buffer) {
+        wlr_scene_buffer_set_buffer(thumb->title,
+            view->deco.titlebar_wlr_buffer);
+    }
+    thumb->box = box;
+    thumb_place(thumb);
+}
+
+/* --- Layout --- */
+
+static void overview_clear(struct lw_overview *overview) {
+    struct wlr_scene_node *node, *tmp;
+    wl_list_for_each_safe(node, tmp, &overview->tree->children, link) {
+        wlr_scene_node_destroy(node);
+    }
+    free(overview->windows);
+    free(overview->minis);
+    free(overview->desks);
+    overview->windows = overview->minis = NULL;
+    overview->desks = NULL;
+    overview->window_count = overview->mini_count = overview->desk_count = 0;
+    overview->highlight = NULL;
+}
+
+static struct wlr_scene_rect *add_rect(struct wlr_scene_tree *parent,
+                                       struct wlr_box box,
+                                       const float color[static 4]) {
+    struct wlr_scene_rect *rect =
+        wlr_scene_rect_create(parent, box.width, box.height, color);
+    if (rect) wlr_scene_node_set_position(&rect->node, box.x, box.y);
+    return rect;
+}
+
+static struct wlr_box grow_box(struct wlr_box box, int by) {
+    return (struct wlr_box){
+        box.x - by, box.y - by, box.width + 2 * by, box.height + 2 * by,
+    };
+}
+
+static void overview_update_highlight(struct lw_overview *overview) {
+    if (!overview->highlight) return;
+    if (overview->selected < 0) {
+        wlr_scene_node_set_enabled(&overview->highlight->node, false);
+        return;
+    }
+    struct wlr_box box = grow_box(overview->windows[overview->selected].box,
+                                  OVERVIEW_BORDER);
+    wlr_scene_rect_set_size(overview->highlight, box.width, box.height);
+    wlr_scene_node_set_position(&overview->highlight->node, box.x, box.y);
+    wlr_scene_node_set_enabled(&overview->highlight->node, true);
+}
+
+/* The workspace's windows in a grid, most recently focused first */
+static void layout_windows(struct lw_overview *overview,
+                           struct wlr_box grid) {
+    struct lw_view *view;
+    struct wlr_buffer *buffer;
+    struct wlr_fbox src;
+    struct wlr_box geo;
+
+    int count = 0;
+    wl_list_for_each(view, &overview->workspace->views, workspace_link) {
+        if (view_content(view, &buffer, &src, &geo)) count++;
+    }
+    if (count == 0) return;
+    overview->windows = calloc(count, sizeof(*overview->windows));
+    if (!overview->windows) return;
+
+    int columns = 1;
+    while (columns * columns < count) columns++;
+    int rows = (count + columns - 1) / columns;
+    overview->columns = columns;
+
+    int cell_w = (grid.width - (columns - 1) * OVERVIEW_GAP) / columns;
+    int cell_h = (grid.height - (rows - 1) * OVERVIEW_GAP) / rows;
+    if (cell_w < 1 || cell_h < 1) return;
+
+    wl_list_for_each(view, &overview->workspace->views, workspace_link) {
+        int i = overview->window_count;
+        if (i == count) break;
+        if (!view_content(view, &buffer, &src, &geo)) continue;
+
+        struct wlr_box cell = {
+            .x = grid.x + (i % columns) * (cell_w + OVERVIEW_GAP),
+            .y = grid.y + (i / columns) * (cell_h + OVERVIEW_GAP),
+            .width = cell_w,
+            .height = cell_h,
+        };
+        if (thumb_create(&overview->windows[i], overview->tree, view,
+                         fit_box(view, &geo, cell), cell)) {
+            overview->window_count++;
+        }
+    }
+}
+
+/* One desk per workspace, each with its windows where they are on the
+ * output, shrunk */
+static void layout_desks(struct lw_overview *overview, struct wlr_box strip) {
+    struct lw_server *server = overview->server;
+    int count = server->workspace_count;
+    overview->desks = calloc(count, sizeof(*overview->desks));
+    if (!overview->desks) return;
+
+    int views = 0;
+    for (int i = 0; i < count; i++) {
+        views += wl_list_length(&server->workspaces[i]->views);
+    }
+    overview->minis = views ? calloc(views, sizeof(*overview->minis)) : NULL;
+
+    int desk_w = OVERVIEW_DESK_WIDTH;
+    if (count * (desk_w + OVERVIEW_DESK_GAP) - OVERVIEW_DESK_GAP >
+            strip.width) {
+        desk_w = (strip.width + OVERVIEW_DESK_GAP) / count - OVERVIEW_DESK_GAP;
+    }
+    if (desk_w < 8) return;
+    int desk_h = desk_w * overview->area.height / overview->area.width;
+    int total = count * (desk_w + OVERVIEW_DESK_GAP) - OVERVIEW_DESK_GAP;
+
+    for (int i = 0; i < count; i++) {
+        struct lw_workspace *ws = server->workspaces[i];
+        struct lw_overview_desk *desk = &overview->desks[i];
+        desk->workspace = ws;
+        desk->box = (struct wlr_box){
+            .x = strip.x + (strip.width - total) / 2 +
+                i * (desk_w + OVERVIEW_DESK_GAP),
+            .y = strip.y + strip.height - desk_h,
+            .width = desk_w,
+            .height = desk_h,
+        };
+        overview->desk_count++;
+
+        if (ws == overview->workspace) {
+            add_rect(overview->tree, grow_box(desk->box, OVERVIEW_BORDER),
+                     overview_accent);
+        }
+        add_rect(overview->tree, desk->box, overview_desk);
+        if (!overview->minis) continue;
+
+        /* Oldest first, so the focused window ends up on top */
+        struct lw_view *view;
+        wl_list_for_each_reverse(view, &ws->views, workspace_link) {
+            struct wlr_buffer *buffer;
+            struct wlr_fbox src;
+            struct wlr_box geo;
+            if (view->is_minimized ||
+                !view_content(view, &buffer, &src, &geo)) continue;
+
+            struct wlr_box box = mini_box(overview, view, &geo, desk->box);
+            if (box.width < 1 || box.height < 1) continue;
+            if (thumb_create(&overview->minis[overview->mini_count],
+                             overview->tree, view, box, desk->box)) {
+                overview->mini_count++;
+            }
+        }
+    }
+}
+
+static void overview_layout(struct lw_overview *overview) {
+    overview_clear(overview);
+
+    struct wlr_box area = overview->area;
+    add_rect(overview->tree, area, overview_backdrop);
+    /* Created before the thumbnails so it stays behind them */
+    overview->highlight = add_rect(overview->tree, area, overview_accent);
+
+    /* Thumbnails stay clear of the panels, which are drawn above */
+    struct wlr_box usable;
+    if (!lw_layer_usable_area_at(overview->server, area.x + 1, area.y + 1,
+                                 &usable)) {
+        usable = area;
+    }
+
+    int desk_h = OVERVIEW_DESK_WIDTH * area.height / area.width;
+    struct wlr_box strip = {
+        .x = usable.x + OVERVIEW_MARGIN,
+        .y = usable.y + usable.height - OVERVIEW_GAP - desk_h,
+        .width = usable.width - 2 * OVERVIEW_MARGIN,
+        .height = desk_h,
+    };
+    struct wlr_box grid = {
+        .x = usable.x + OVERVIEW_MARGIN,
+        .y = usable.y + OVERVIEW_MARGIN,
+        .width = usable.width - 2 * OVERVIEW_MARGIN,
+        .height = strip.y - OVERVIEW_GAP - usable.y - OVERVIEW_MARGIN,
+    };
+    if (grid.width > 0 && grid.height > 0) {
+        layout_windows(overview, grid);
+    }
+    if (strip.width > 0) {
+        layout_desks(overview, strip);
+    }
+
+    if (overview->selected >= overview->window_count) {
+        overview->selected = overview->window_count - 1;
+    }
+    overview_update_highlight(overview);
+}
+
+/* --- Open and close --- */
+
+static uint32_t overview_selected_id(struct lw_overview *overview) {
+    return overview->selected >= 0 ?
+        overview->windows[overview->selected].view->id : 0;
+}
+
+void lw_overview_show(struct lw_server *server) {
+    if (server->overview) return;
+
+    /* The output the pointer is on */
+    struct wlr_output *output = wlr_output_layout_output_at(
+        server->output_layout, server->cursor->x, server->cursor->y);
+    if (!output) {
+        output = wlr_output_layout_get_center_output(server->output_layout);
+    }
+    if (!output || !server->active_workspace) return;
+
+    struct lw_overview *overview = calloc(1, sizeof(*overview));
+    if (!overview) return;
+    overview->server = server;
+    wlr_output_layout_get_box(server->output_layout, output, &overview->area);
+    if (overview->area.width <= 0 || overview->area.height <= 0) {
+        free(overview);
+        return;
+    }
+    /* Over the workspaces, under the taskbar and other top panels */
+    overview->tree = wlr_scene_tree_create(&server->scene->tree);
+    if (!overview->tree) {
+        free(overview);
+        return;
+    }
+    wlr_scene_node_place_below(&overview->tree->node,
+        &server->layer_trees[ZWLR_LAYER_SHELL_V1_LAYER_TOP]->node);
+    overview->workspace = server->active_workspace;
+    overview->selected = 0;
+    server->overview = overview;
+    overview_layout(overview);
+
+    /* Nothing under the pointer belongs to a client now */
+    wlr_seat_pointer_clear_focus(server->seat);
+    wlr_cursor_set_xcursor(server->cursor, server->cursor_mgr, "default");
+
+    wlr_log(WLR_DEBUG, "Task View open: %d windows, %d desks",
+            overview->window_count, overview->desk_count);
+    lw_ipc_send_overview(server, true, overview_selected_id(overview));
+}
+
+/* Close, then bring up the picked window if any */
+static void overview_close(struct lw_server *server, struct lw_view *picked) {
+    struct lw_overview *overview = server->overview;
+    if (!overview) return;
+
+    overview_clear(overview);
+    wlr_scene_node_destroy(&overview->tree->node);
+    free(overview);
+    server->overview = NULL;
+
+    if (picked) {
+        lw_view_activate(picked);
+    }
+    lw_ipc_send_overview(server, false, picked ? picked->id : 0);
+}
+
+void lw_overview_hide(struct lw_server *server) {
+    overview_close(server, NULL);
+}
+
+void lw_overview_toggle(struct lw_server *server) {
+    if (server->overview) {
+        lw_overview_hide(server);
+    } else {
+        lw_overview_show(server);
+    }
+}
+
+void lw_overview_refresh(struct lw_server *server) {
+    struct lw_overview *overview = server->overview;
+    if (!overview) return;
+
+    /* Keep the same window selected if it is still there */
+    struct lw_view *selected = overview->selected >= 0 ?
+        overview->windows[overview->selected].view : NULL;
+    overview->workspace = server->active_workspace;
+    overview_layout(overview);
+    for (int i = 0; selected && i < overview->window_count; i++) {
+        if (overview->windows[i].view == selected) {
+            overview->selected = i;
+            overview_update_highlight(overview);
+            break;
+        }
+    }
+    if (overview->selected < 0 && overview->window_count > 0) {
+        overview->selected = 0;
+        overview_update_highlight(overview);
+    }
+    lw_ipc_send_overview(server, true, overview_selected_id(overview));
+}
+
+void lw_overview_view_changed(struct lw_view *view) {
+    struct lw_overview *overview = view->server->overview;
+    if (!overview) return;
+
+    for (int i = 0; i < overview->window_count; i++) {
+        if (overview->windows[i].view == view) {
+            thumb_update(overview, &overview->windows[i], false);
+            /* The frame follows the thumbnail's new size */
+            if (i == overview->selected) overview_update_highlight(overview);
+        }
+    }
+    for (int i = 0; i < overview->mini_count; i++) {
+        if (overview->minis[i].view == view) {
+            thumb_update(overview, &overview->minis[i], true);
+        }
+    }
+}
+
+/* --- Input --- */
+
+static void overview_select(struct lw_overview *overview, int index) {
+    if (index == overview->selected || index < 0 ||
+        index >= overview->window_count) return;
+    overview->selected = index;
+    overview_update_highlight(overview);
+    lw_ipc_send_overview(overview->server, true,
+                         overview_selected_id(overview));
+}
+
+/* Step through the grid, wrapping around */
+static void overview_step(struct lw_overview *overview, int delta) {
+    int count = overview->window_count;
+    if (count == 0) return;
+    int from = overview->selected < 0 ? 0 : overview->selected;
+    overview_select(overview, ((from + delta) % count + count) % count);
+}
+
+bool lw_overview_handle_key(struct lw_server *server, xkb_keysym_t sym,
+                            uint32_t modifiers) {
+    struct lw_overview *overview = server->overview;
+    if (!overview) return false;
+    /* Super shortcuts keep working, Super+Tab closes again */
+    if (modifiers & WLR_MODIFIER_LOGO) return false;
+
+    int selected = overview->selected;
+    switch (sym) {
+    case XKB_KEY_Escape:
+        lw_overview_hide(server);
+        break;
+    case XKB_KEY_Return:
+    case XKB_KEY_KP_Enter:
+    case XKB_KEY_space:
+        overview_close(server, selected >= 0 ?
+            overview->windows[selected].view : NULL);
+        break;
+    case XKB_KEY_Left:
+    case XKB_KEY_ISO_Left_Tab:
+        overview_step(overview, -1);
+        break;
+    case XKB_KEY_Right:
+    case XKB_KEY_Tab:
+        overview_step(overview, 1);
+        break;
+    case XKB_KEY_Up:
+        overview_select(overview, selected - overview->columns);
+        break;
+    case XKB_KEY_Down:
+        overview_select(overview, selected + overview->columns);
+        break;
+    default:
+        /* Clients do not get keys while Task View is up */
+        break;
+    }
+    return true;
+}
+
+static int overview_window_at(struct lw_overview *overview,
+                              double lx, double ly) {
+    for (int i = 0; i < overview->window_count; i++) {
+        if (wlr_box_contains_point(&overview->windows[i].box, lx, ly)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Panels stay usable while Task View is open */
+static bool over_panel(struct lw_server *server, double lx, double ly) {
+    double sx, sy;
+    struct lw_layer_surface *layer;
+    return lw_layer_surface_at(server, lx, ly, true, &sx, &sy, &layer);
+}
+
+bool lw_overview_handle_motion(struct lw_server *server, double lx,
+                               double ly) {
+    struct lw_overview *overview = server->overview;
+    if (!overview || over_panel(server, lx, ly)) return false;
+
+    int index = overview_window_at(overview, lx, ly);
+    if (index >= 0) overview_select(overview, index);
+    return true;
+}
+
+bool lw_overview_handle_button(struct lw_server *server, double lx,
+                               double ly) {
+    struct lw_overview *overview = server->overview;
+    if (!overview || over_panel(server, lx, ly)) return false;
+
+    int index = overview_window_at(overview, lx, ly);
+    if (index >= 0) {
+        overview_close(server, overview->windows[index].view);
+        return true;
+    }
+    for (int i = 0; i < overview->desk_count; i++) {
+        if (wlr_box_contains_point(&overview->desks[i].box, lx, ly)) {
+            /* Stays open, showing that desk's windows */
+            lw_workspace_switch(server, overview->desks[i].workspace);
+            return true;
+        }
+    }
+    lw_overview_hide(server);
+    return true;
+}
@@ -14,6 +14,7 @@
 #include <wlr/types/wlr_cursor.h>
 #include <wlr/types/wlr_data_device.h>
 #include <wlr/types/wlr_output_layout.h>
+#include <wlr/types/wlr_relative_pointer_v1.h>
 #include <wlr/types/wlr_scene.h>
 #include <wlr/types/wlr_seat.h>
 #include <wlr/types/wlr_subcompositor.h>
@@ -22,8 +23,17 @@
 #include <wlr/util/log.h>
 
 #include "server.h"
+#include "background.h"
+#include "buffer.h"
+#include "deco_cache.h"
+#include "deco_render.h"
+#include "hit_index.h"
+#include "snapshot.h"
+#include "switcher.h"
+#include "thumbnail.h"
 #include "output.h"
 #include "input.h"
+#include "layer_shell.h"
 #include "ipc.h"
 #include "view.h"
 #include "workspace.h"
@@ -63,45 +73,14 @@ int lw_server_init(struct lw_server *server) {
     server->scene_layout = wlr_scene_attach_output_layout(server->scene,
                                                             server->output_layout);
 
-    /* Desktop background — smooth gradient from dark navy → blue → dark purple */
-    {
-        /* Gradient color stops: position (0-1), R, G, B */
-        struct { float pos, r, g, b; } stops[] = {
-            {0.00f, 0.00f, 0.04f, 0.12f},
-            {0.35f, 0.00f, 0.35f, 0.70f},
-            {0.50f, 0.00f, 0.47f, 0.83f},
-            {0.65f, 0.00f, 0.35f, 0.70f},
-            {1.00f, 0.08f, 0.05f, 0.22f},
-        };
-        int nstops = sizeof(stops) / sizeof(stops[0]);
-        int nstrips = 128;
-        int total_h = 4096;
-        int strip_h = total_h / nstrips;
-        for (int i = 0; i < nstrips; i++) {
-            float t = (float)i / (float)(nstrips - 1);
-            /* Find the two stops to interpolate between */
-            int s = 0;
-            for (int j = 0; j < nstops - 1; j++) {
-                if (t >= stops[j].pos) s = j;
-            }
-            float local_t = (t - stops[s].pos) /
-                            (stops[s + 1].pos - stops[s].pos);
-            if (local_t < 0.0f) local_t = 0.0f;
-            if (local_t > 1.0f) local_t = 1.0f;
-            float color[4] = {
-                stops[s].r + (stops[s+1].r - stops[s].r) * local_t,
-                stops[s].g + (stops[s+1].g - stops[s].g) * local_t,
-                stops[s].b + (stops[s+1].b - stops[s].b) * local_t,
-                1.0f
-            };
-            struct wlr_scene_rect *rect =
-                wlr_scene_rect_create(&server->scene->tree, 8192, strip_h + 1, color);
-            wlr_scene_node_set_position(&rect->node, 0, i * strip_h);
-        }
-    }
+    /* Desktop background — rasterized per output in lw_background_update() */
+    lw_background_init(server);
 
     /* Create Wayland globals */
-    wlr_compositor_create(server->wl_display, 5, server->renderer);
+    struct wlr_compositor *compositor =
+        wlr_compositor_create(server->wl_display, 5, server->renderer);
+    server->new_surface.notify = lw_output_new_surface;
+    wl_signal_add(&compositor->events.new_surface, &server->new_surface);
     wlr_subcompositor_create(server->wl_display);
     wlr_data_device_manager_create(server->wl_display);
 
@@ -120,11 +99,36 @@ int lw_server_init(struct lw_server *server) {
 
     /* Initialize view list */
     wl_list_init(&server->views);
+    server->hit_index = lw_hit_index_create();
+    if (!server->hit_index) {
+        wlr_log(WLR_ERROR, "Failed to create hit index");
+        return -1;
+    }
+
+    /* Title bar rendering cache and its buffer pool */
+    server->buffer_pool = lw_buffer_pool_create(LW_BUFFER_POOL_DEFAULT_CAP);
+    if (!server->buffer_pool) {
+        wlr_log(WLR_ERROR, "Failed to create buffer pool");
+        return -1;
+    }
+    server->deco_cache = lw_deco_cache_create(server->buffer_pool);
+    if (!server->deco_cache) {
+        wlr_log(WLR_ERROR, "Failed to create decoration cache");
+        return -1;
+    }
+    server->deco_renderer = lw_deco_renderer_create(server);
+    if (!server->deco_renderer) {
+        wlr_log(WLR_ERROR, "Title bar workers unavailable, "
+                "rendering on the main thread");
+    }
 
     /* Output handling */
     wl_list_init(&server->outputs);
     server->new_output.notify = lw_output_new;
     wl_signal_add(&server->backend->events.new_output, &server->new_output);
+    server->layout_change.notify = lw_output_layout_change;
+    wl_signal_add(&server->output_layout->events.change,
+                  &server->layout_change);
 
     /* Cursor */
     server->cursor = wlr_cursor_create();
@@ -142,6 +146,9 @@ int lw_server_init(struct lw_server *server) {
     wl_signal_add(&server->cursor->events.axis, &server->cursor_axis);
     server->cursor_frame.notify = lw_cursor_frame;
     wl_signal_add(&server->cursor->events.frame, &server->cursor_frame);
+    server->relative_pointer_mgr =
+        wlr_relative_pointer_manager_v1_create(server->wl_display);
+    lw_input_init_motion(server);
 
     /* Seat (input) */
     wl_list_init(&server->keyboards);
@@ -155,10 +162,16 @@ int lw_server_init(struct lw_server *server) {
     wl_signal_add(&server->seat->events.request_set_selection,
                   &server->request_set_selection);
 
-    /* Initialize workspaces - create first desktop */
-    wl_list_init(&server->workspaces);
-    server->workspace_count = 0;
+    /* Initialize workspaces - create first desktop.  Their trees share
+     * one parent so desktops added later still stack below the top and
+     * overlay layers (taskbar, menus) */
+    server->workspace_tree = wlr_scene_tree_create(&server->scene->tree);
+    lw_layer_shell_init(server);
     struct lw_workspace *ws = lw_workspace_create(server, "Desktop 1");
+    if (!ws) {
+        wlr_log(WLR_ERROR, "Failed to create workspace");
+        return -1;
+    }
     server->active_workspace = ws;
 
     /* Add Wayland socket */
@@ -176,6 +189,14 @@ int lw_server_init(struct lw_server *server) {
         wlr_log(WLR_ERROR, "Failed to initialize IPC (non-fatal)");
         /* IPC failure is non-fatal; shell just won't get shortcut events */
     }
+    server->snapshot = lw_snapshot_create(server);
+    if (!server->snapshot) {
+        wlr_log(WLR_ERROR, "Failed to create state snapshot (non-fatal)");
+    }
+    server->thumbnailer = lw_thumbnailer_create(server);
+    if (!server->thumbnailer) {
+        wlr_log(WLR_ERROR, "Failed to create thumbnailer (non-fatal)");
+    }
 
     /* Initialize keyboard shortcut state */
     server->super_pressed = false;
@@ -199,13 +220,27 @@ int lw_server_run(struct lw_server *server) {
 
 void lw_server_destroy(struct lw_server *server) {
     wlr_log(WLR_INFO, "Shutting down compositor");
+    /* First: closing the switcher and dropping thumbnails still tells
+     * IPC clients */
+    lw_switcher_cancel(server);
+    lw_thumbnailer_destroy(server->thumbnailer);
+    server->thumbnailer = NULL;
     lw_ipc_destroy(server);
+    lw_snapshot_destroy(server->snapshot);
+    server->snapshot = NULL;
+    lw_input_finish_motion(server);
     wl_display_destroy_clients(server->wl_display);
+    /* After the views are gone, so no job still points at one */
+    lw_deco_renderer_destroy(server->deco_renderer);
     wlr_scene_node_destroy(&server->scene->tree.node);
+    lw_workspace_finish(server);
     wlr_xcursor_manager_destroy(server->cursor_mgr);
     wlr_cursor_destroy(server->cursor);
     wlr_allocator_destroy(server->allocator);
     wlr_renderer_destroy(server->renderer);
     wlr_backend_destroy(server->backend);
     wl_display_destroy(server->wl_display);
+    lw_deco_cache_destroy(server->deco_cache);
+    lw_buffer_pool_destroy(server->buffer_pool);
+    lw_hit_index_destroy(server->hit_index);
 }
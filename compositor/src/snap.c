@@ -1,66 +1,190 @@
 /*
  * lwindesk - compositor/src/snap.c - Windows 11-style snap zone detection
+ *
+ * Every output keeps a table of its snap zones (struct lw_snap_table),
+ * rebuilt from lw_layer_arrange() when its usable area or position
+ * changes.  Dragging a window then classifies the pointer with a few
+ * compares against the table, and the drop target is drawn right away
+ * as a scene node, in the same frame the pointer enters the zone.
  */
 
 #define _POSIX_C_SOURCE 200112L
-#include <wlr/types/wlr_output.h>
 #include <wlr/types/wlr_output_layout.h>
+#include <wlr/types/wlr_scene.h>
 
 #include "snap.h"
+#include "output.h"
 #include "server.h"
 
 /* Edge threshold in pixels for snap zone detection */
 #define SNAP_EDGE_THRESHOLD 16
 #define SNAP_CORNER_THRESHOLD 48
+/* Outline of the drop preview */
+#define SNAP_PREVIEW_BORDER 2
 
-enum lw_snap_zone lw_snap_zone_at(struct lw_server *server,
-                                    double cursor_x, double cursor_y) {
-    struct wlr_output *output =
-        wlr_output_layout_output_at(server->output_layout,
-                                     cursor_x, cursor_y);
-    if (!output) return LW_SNAP_NONE;
-
-    struct wlr_box box;
-    wlr_output_layout_get_box(server->output_layout, output, &box);
-
-    double rx = cursor_x - box.x;
-    double ry = cursor_y - box.y;
-
-    bool at_left = rx < SNAP_EDGE_THRESHOLD;
-    bool at_right = rx > box.width - SNAP_EDGE_THRESHOLD;
-    bool at_top = ry < SNAP_EDGE_THRESHOLD;
-    bool near_top_corner = ry < SNAP_CORNER_THRESHOLD;
-    bool near_bottom_corner = ry > box.height - SNAP_CORNER_THRESHOLD;
-
-    /* Top edge = maximize */
-    if (at_top && !at_left && !at_right) {
-        return LW_SNAP_MAXIMIZE;
+/* Accent colour, premultiplied */
+static const float snap_fill[4] = {0.0f, 0.094f, 0.166f, 0.2f};
+static const float snap_border[4] = {0.0f, 0.376f, 0.664f, 0.8f};
+
+/*
+ * Zone by pointer band: rows are the top edge, the rest of the top
+ * corner, the middle and the bottom corner; columns the left band, the
+ * middle and the right band.
+ */
+static const enum lw_snap_zone snap_zones[4][3] = {
+    { LW_SNAP_TOP_LEFT,    LW_SNAP_MAXIMIZE, LW_SNAP_TOP_RIGHT },
+    { LW_SNAP_TOP_LEFT,    LW_SNAP_NONE,     LW_SNAP_TOP_RIGHT },
+    { LW_SNAP_LEFT,        LW_SNAP_NONE,     LW_SNAP_RIGHT },
+    { LW_SNAP_BOTTOM_LEFT, LW_SNAP_NONE,     LW_SNAP_BOTTOM_RIGHT },
+};
+
+/* --- Tables --- */
+
+void lw_snap_output_update(struct lw_output *output) {
+    struct lw_snap_table *table = &output->snap;
+    wlr_output_layout_get_box(output->server->output_layout,
+                               output->wlr_output, &table->box);
+
+    const struct wlr_box *box = &table->box;
+    table->left = box->x + SNAP_EDGE_THRESHOLD;
+    table->right = box->x + box->width - SNAP_EDGE_THRESHOLD;
+    table->top = box->y + SNAP_EDGE_THRESHOLD;
+    table->top_corner = box->y + SNAP_CORNER_THRESHOLD;
+    table->bottom_corner = box->y + box->height - SNAP_CORNER_THRESHOLD;
+
+    /* Halves and quarters of what the panels leave */
+    const struct wlr_box *area = &output->usable_area;
+    int half_w = area->width / 2;
+    int half_h = area->height / 2;
+    struct wlr_box *zones = table->zones;
+    zones[LW_SNAP_NONE] = (struct wlr_box){0};
+    zones[LW_SNAP_LEFT] = (struct wlr_box){
+        area->x, area->y, half_w, area->height };
+    zones[LW_SNAP_RIGHT] = (struct wlr_box){
+        area->x + half_w, area->y, half_w, area->height };
+    zones[LW_SNAP_TOP_LEFT] = (struct wlr_box){
+        area->x, area->y, half_w, half_h };
+    zones[LW_SNAP_TOP_RIGHT] = (struct wlr_box){
+        area->x + half_w, area->y, half_w, half_h };
+    zones[LW_SNAP_BOTTOM_LEFT] = (struct wlr_box){
+        area->x, area->y + half_h, half_w, half_h };
+    zones[LW_SNAP_BOTTOM_RIGHT] = (struct wlr_box){
+        area->x + half_w, area->y + half_h, half_w, half_h };
+    zones[LW_SNAP_MAXIMIZE] = *area;
+
+    /* A preview on this output follows the new geometry */
+    struct lw_server *server = output->server;
+    if (server->snap_preview_output == output) {
+        lw_snap_preview_show(server, output, server->snap_preview_zone);
     }
+}
 
-    /* Left edge with corners */
-    if (at_left) {
-        if (near_top_corner) return LW_SNAP_TOP_LEFT;
-        if (near_bottom_corner) return LW_SNAP_BOTTOM_LEFT;
-        return LW_SNAP_LEFT;
+void lw_snap_output_finish(struct lw_output *output) {
+    struct lw_server *server = output->server;
+    if (server->snap_preview_output == output) {
+        lw_snap_preview_show(server, NULL, LW_SNAP_NONE);
     }
+}
 
-    /* Right edge with corners */
-    if (at_right) {
-        if (near_top_corner) return LW_SNAP_TOP_RIGHT;
-        if (near_bottom_corner) return LW_SNAP_BOTTOM_RIGHT;
-        return LW_SNAP_RIGHT;
+static struct lw_output *table_output_at(struct lw_server *server,
+                                         double lx, double ly) {
+    struct lw_output *output;
+    wl_list_for_each(output, &server->outputs, link) {
+        if (wlr_box_contains_point(&output->snap.box, lx, ly)) return output;
     }
+    return NULL;
+}
+
+struct lw_output *lw_snap_output_at(struct lw_server *server,
+                                    double lx, double ly) {
+    struct lw_output *output = table_output_at(server, lx, ly);
+    if (!output && !wl_list_empty(&server->outputs)) {
+        output = wl_container_of(server->outputs.prev, output, link);
+    }
+    return output;
+}
 
-    return LW_SNAP_NONE;
+enum lw_snap_zone lw_snap_zone_at(struct lw_server *server,
+                                    double cursor_x, double cursor_y,
+                                    struct lw_output **output) {
+    struct lw_output *found = table_output_at(server, cursor_x, cursor_y);
+    *output = found;
+    if (!found) return LW_SNAP_NONE;
+
+    const struct lw_snap_table *table = &found->snap;
+    int col = cursor_x < table->left ? 0 :
+              cursor_x > table->right ? 2 : 1;
+    int row = cursor_y < table->top ? 0 :
+              cursor_y < table->top_corner ? 1 :
+              cursor_y > table->bottom_corner ? 3 : 2;
+    return snap_zones[row][col];
 }
 
-struct wlr_box lw_snap_zone_geometry(struct wlr_output *output,
+struct wlr_box lw_snap_zone_geometry(const struct lw_output *output,
                                       enum lw_snap_zone zone) {
-    struct wlr_box box = {0};
-    /* This would be filled using output layout - used by shell overlay */
-    (void)output;
-    (void)zone;
-    return box;
+    if (!output || zone <= LW_SNAP_NONE || zone >= LW_SNAP_ZONE_COUNT) {
+        return (struct wlr_box){0};
+    }
+    return output->snap.zones[zone];
+}
+
+/* --- Preview --- */
+
+/* Above the windows, under the taskbar; created on first use */
+static bool preview_create(struct lw_server *server) {
+    struct wlr_scene_tree *tree = wlr_scene_tree_create(&server->scene->tree);
+    if (!tree) return false;
+    wlr_scene_node_place_below(&tree->node,
+        &server->layer_trees[ZWLR_LAYER_SHELL_V1_LAYER_TOP]->node);
+    wlr_scene_node_set_enabled(&tree->node, false);
+
+    server->snap_preview_rects[0] = wlr_scene_rect_create(tree, 0, 0,
+                                                           snap_fill);
+    for (int i = 1; i < 5; i++) {
+        server->snap_preview_rects[i] = wlr_scene_rect_create(tree, 0, 0,
+                                                               snap_border);
+    }
+    server->snap_preview = tree;
+    return true;
+}
+
+void lw_snap_preview_show(struct lw_server *server, struct lw_output *output,
+                          enum lw_snap_zone zone) {
+    struct lw_output *previous = server->snap_preview_output;
+    struct wlr_box box = lw_snap_zone_geometry(output, zone);
+    if (wlr_box_empty(&box)) {
+        output = NULL;
+        zone = LW_SNAP_NONE;
+    }
+    server->snap_preview_output = output;
+    server->snap_preview_zone = zone;
+
+    if (!output) {
+        if (server->snap_preview) {
+            wlr_scene_node_set_enabled(&server->snap_preview->node, false);
+        }
+        if (previous) lw_output_schedule_frame(previous);
+        return;
+    }
+    if (!server->snap_preview && !preview_create(server)) return;
+
+    /* Fill, then the outline: top, bottom, left, right */
+    struct wlr_scene_rect **rects = server->snap_preview_rects;
+    int b = SNAP_PREVIEW_BORDER;
+    int inner_h = box.height > 2 * b ? box.height - 2 * b : 0;
+    wlr_scene_rect_set_size(rects[0], box.width, box.height);
+    wlr_scene_rect_set_size(rects[1], box.width, b);
+    wlr_scene_rect_set_size(rects[2], box.width, b);
+    wlr_scene_node_set_position(&rects[2]->node, 0, box.height - b);
+    wlr_scene_rect_set_size(rects[3], b, inner_h);
+    wlr_scene_node_set_position(&rects[3]->node, 0, b);
+    wlr_scene_rect_set_size(rects[4], b, inner_h);
+    wlr_scene_node_set_position(&rects[4]->node, box.width - b, b);
+
+    wlr_scene_node_set_position(&server->snap_preview->node, box.x, box.y);
+    wlr_scene_node_set_enabled(&server->snap_preview->node, true);
+    if (previous && previous != output) lw_output_schedule_frame(previous);
+    lw_output_schedule_frame(output);
 }
 
 const char *lw_snap_zone_name(enum lw_snap_zone zone) {
@@ -0,0 +1,215 @@
+/*
+ * lwindesk - compositor/src/snapshot.c - Shared-memory state snapshot
+ *
+ * The shell used to learn about windows and workspaces only from what
+ * IPC pushed at it.  This publishes the same state as a struct
+ * lw_ipc_snapshot in a memfd: clients map a read-only fd (sent over IPC
+ * with SCM_RIGHTS) and copy out a consistent view under the seqlock
+ * whenever they like, with no request, reply or parsing.
+ *
+ * Call sites only mark the snapshot dirty.  The rebuild runs from an idle
+ * callback, so a burst of changes costs one rebuild, and the shared copy
+ * is rewritten (and SNAPSHOT_CHANGED sent) only if the contents differ;
+ * commits that don't change the size don't wake anybody up.
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wlr/types/wlr_seat.h>
+#include <wlr/types/wlr_xdg_shell.h>
+#include <wlr/util/log.h>
+
+#include "ipc.h"
+#include "snapshot.h"
+#include "view.h"
+#include "workspace.h"
+
+static void copy_string(char *dst, uint16_t *len, const char *src,
+                        size_t max) {
+    size_t n = src ? strlen(src) : 0;
+    if (n > max) n = max;
+    if (n) memcpy(dst, src, n);
+    *len = n;
+}
+
+/* Fill scratch from the live state; unused tail entries stay zeroed */
+static void snapshot_build(struct lw_snapshot *snapshot) {
+    struct lw_server *server = snapshot->server;
+    struct lw_ipc_snapshot *snap = snapshot->scratch;
+    struct wlr_surface *focused = server->seat->keyboard_state.focused_surface;
+
+    uint32_t old_count = snap->view_count;
+    snap->view_count = 0;
+    snap->active_workspace = server->active_workspace ?
+        server->active_workspace->index : -1;
+    snap->workspace_count = server->workspace_count;
+    snap->focused_view = 0;
+
+    struct lw_view *view;
+    wl_list_for_each(view, &server->views, link) {
+        if (snap->view_count == LW_IPC_SNAPSHOT_MAX_VIEWS) break;
+
+        struct wlr_xdg_toplevel *toplevel = view->xdg_toplevel;
+        struct lw_ipc_snapshot_view *entry =
+            &snap->views[snap->view_count++];
+        memset(entry, 0, sizeof(*entry));
+
+        struct wlr_box geo;
+        wlr_xdg_surface_get_geometry(toplevel->base, &geo);
+        entry->id = view->id;
+        entry->workspace = view->workspace ? view->workspace->index : -1;
+        entry->x = view->x;
+        entry->y = view->y +
+            (view->deco.has_decorations ? LW_TITLEBAR_HEIGHT : 0);
+        entry->width = geo.width;
+        entry->height = geo.height;
+
+        if (focused == toplevel->base->surface) {
+            entry->flags |= LW_IPC_VIEW_FOCUSED;
+            snap->focused_view = view->id;
+        }
+        if (view->is_minimized) entry->flags |= LW_IPC_VIEW_MINIMIZED;
+        if (view->is_maximized) entry->flags |= LW_IPC_VIEW_MAXIMIZED;
+        if (view->is_fullscreen) entry->flags |= LW_IPC_VIEW_FULLSCREEN;
+
+        copy_string(entry->app_id, &entry->app_id_len, toplevel->app_id,
+                    LW_IPC_SNAPSHOT_APP_ID_MAX);
+        copy_string(entry->title, &entry->title_len, toplevel->title,
+                    LW_IPC_SNAPSHOT_TITLE_MAX);
+    }
+
+    /* Keep the tail zeroed so the memcmp below stays meaningful */
+    if (old_count > snap->view_count) {
+        memset(&snap->views[snap->view_count], 0,
+               (old_count - snap->view_count) * sizeof(snap->views[0]));
+    }
+}
+
+/* Everything after the seq word that a reader may look at */
+static size_t snapshot_payload_size(const struct lw_ipc_snapshot *snap) {
+    uint32_t count = snap->view_count > LW_IPC_SNAPSHOT_MAX_VIEWS ?
+        LW_IPC_SNAPSHOT_MAX_VIEWS : snap->view_count;
+    return offsetof(struct lw_ipc_snapshot, views) -
+        offsetof(struct lw_ipc_snapshot, view_count) +
+        count * sizeof(snap->views[0]);
+}
+
+static void snapshot_publish(struct lw_snapshot *snapshot) {
+    struct lw_ipc_snapshot *shared = snapshot->shared;
+    struct lw_ipc_snapshot *scratch = snapshot->scratch;
+
+    snapshot->rebuilds++;
+    snapshot_build(snapshot);
+
+    /* Compare the larger of the two view ranges */
+    size_t size = snapshot_payload_size(scratch);
+    size_t old_size = snapshot_payload_size(shared);
+    if (old_size > size) size = old_size;
+    if (memcmp(&shared->view_count, &scratch->view_count, size) == 0) {
+        return;
+    }
+
+    uint32_t seq = shared->seq;
+    __atomic_store_n(&shared->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&shared->view_count, &scratch->view_count, size);
+    __atomic_store_n(&shared->seq, seq + 2, __ATOMIC_RELEASE);
+    snapshot->publishes++;
+
+    struct lw_ipc_snapshot_info info = {
+        .size = sizeof(*shared),
+        .seq = seq + 2,
+    };
+    lw_ipc_send_state(snapshot->server, LW_IPC_EVENT_SNAPSHOT_CHANGED, 0,
+                      &info, sizeof(info));
+}
+
+static void snapshot_idle(void *data) {
+    struct lw_snapshot *snapshot = data;
+    snapshot->idle = NULL;
+    snapshot_publish(snapshot);
+}
+
+struct lw_snapshot *lw_snapshot_create(struct lw_server *server) {
+    struct lw_snapshot *snapshot = calloc(1, sizeof(*snapshot));
+    if (!snapshot) return NULL;
+    snapshot->server = server;
+    snapshot->fd = snapshot->ro_fd = -1;
+
+    const size_t size = sizeof(struct lw_ipc_snapshot);
+    snapshot->scratch = calloc(1, size);
+    if (!snapshot->scratch) goto fail;
+
+    snapshot->fd = memfd_create("lwindesk-snapshot",
+                                MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (snapshot->fd < 0 || ftruncate(snapshot->fd, size) < 0) {
+        wlr_log_errno(WLR_ERROR, "Snapshot memfd");
+        goto fail;
+    }
+    /* Clients can't resize it under us (SIGBUS) */
+    fcntl(snapshot->fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW |
+          F_SEAL_SEAL);
+
+    snapshot->shared = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                            snapshot->fd, 0);
+    if (snapshot->shared == MAP_FAILED) {
+        snapshot->shared = NULL;
+        wlr_log_errno(WLR_ERROR, "Snapshot mmap");
+        goto fail;
+    }
+
+    /* What we hand out must not be writable */
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", snapshot->fd);
+    snapshot->ro_fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (snapshot->ro_fd < 0) {
+        wlr_log_errno(WLR_ERROR, "Snapshot read-only fd");
+        goto fail;
+    }
+
+    snapshot->shared->magic = snapshot->scratch->magic =
+        LW_IPC_SNAPSHOT_MAGIC;
+    snapshot->shared->version = snapshot->scratch->version = LW_IPC_VERSION;
+    snapshot->shared->active_workspace = -1;
+    return snapshot;
+
+fail:
+    lw_snapshot_destroy(snapshot);
+    return NULL;
+}
+
+void lw_snapshot_destroy(struct lw_snapshot *snapshot) {
+    if (!snapshot) return;
+    wlr_log(WLR_DEBUG, "Snapshot: %" PRIu64 " rebuilds, %" PRIu64
+            " publishes", snapshot->rebuilds, snapshot->publishes);
+    if (snapshot->idle) wl_event_source_remove(snapshot->idle);
+    if (snapshot->shared) {
+        munmap(snapshot->shared, sizeof(struct lw_ipc_snapshot));
+    }
+    if (snapshot->ro_fd >= 0) close(snapshot->ro_fd);
+    if (snapshot->fd >= 0) close(snapshot->fd);
+    free(snapshot->scratch);
+    free(snapshot);
+}
+
+void lw_snapshot_mark_dirty(struct lw_server *server) {
+    struct lw_snapshot *snapshot = server->snapshot;
+    if (!snapshot || snapshot->idle) return;
+    struct wl_event_loop *loop =
+        wl_display_get_event_loop(server->wl_display);
+    snapshot->idle = wl_event_loop_add_idle(loop, snapshot_idle, snapshot);
+}
+
+uint32_t lw_snapshot_seq(struct lw_snapshot *snapshot) {
+    return snapshot ? snapshot->shared->seq : 0;
+}
+
+int lw_snapshot_fd(struct lw_snapshot *snapshot) {
+    return snapshot ? snapshot->ro_fd : -1;
+}
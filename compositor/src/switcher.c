@@ -0,0 +1,178 @@
+/*
+ * lwindesk - compositor/src/switcher.c - Alt+Tab window switcher
+ *
+ * The compositor owns the session: which windows are listed, in what
+ * order, which one is selected and when it ends.  The list comes ready
+ * made from the active workspace (lw_workspace.switcher_ids), so the
+ * first Tab copies it and sends it to the shell once, later Tabs send
+ * only the new index, and releasing Alt activates the window without
+ * the shell having to answer.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#include <stdlib.h>
+#include <string.h>
+#include <wlr/types/wlr_keyboard.h>
+#include <wlr/types/wlr_seat.h>
+#include <wlr/util/log.h>
+
+#include "switcher.h"
+#include "ipc.h"
+#include "overview.h"
+#include "server.h"
+#include "view.h"
+#include "workspace.h"
+
+static void switcher_send(struct lw_server *server,
+                          struct lw_switcher *switcher, bool visible,
+                          uint32_t view_id) {
+    if (!lw_ipc_wants(server, LW_IPC_EVENT_SWITCHER)) return;
+
+    struct lw_ipc_switcher info = {
+        .visible = visible,
+        .serial = switcher->serial,
+        .count = visible ? switcher->count : 0,
+        .selected = visible ? switcher->selected : -1,
+        .view_id = view_id,
+    };
+    char body[sizeof(info) + sizeof(switcher->ids)];
+    size_t ids_len = info.count * sizeof(uint32_t);
+    memcpy(body, &info, sizeof(info));
+    memcpy(body + sizeof(info), switcher->ids, ids_len);
+    lw_ipc_send_state(server, LW_IPC_EVENT_SWITCHER, 0, body,
+                      sizeof(info) + ids_len);
+}
+
+static void switcher_send_select(struct lw_switcher *switcher) {
+    struct lw_ipc_switcher_select select = {
+        .serial = switcher->serial,
+        .index = switcher->selected,
+        .view_id = switcher->ids[switcher->selected],
+    };
+    /* Keyed by session, so a fast Tab run folds into its last index but
+     * never overtakes the SWITCHER that opened it */
+    lw_ipc_send_state(switcher->server, LW_IPC_EVENT_SWITCHER_SELECT,
+                      switcher->serial, &select, sizeof(select));
+}
+
+static void switcher_open(struct lw_server *server, bool backward) {
+    struct lw_workspace *ws = server->active_workspace;
+    if (!ws || ws->switcher_count == 0) return;
+
+    struct lw_switcher *switcher = calloc(1, sizeof(*switcher));
+    if (!switcher) return;
+    switcher->server = server;
+    switcher->serial = ++server->switcher_serial;
+    switcher->count = ws->switcher_count;
+    memcpy(switcher->ids, ws->switcher_ids,
+           switcher->count * sizeof(uint32_t));
+
+    /* The first entry is normally the focused window, so the first Tab
+     * goes to the one before it; it is not when focus sits on the shell
+     * or the desktop */
+    struct lw_view *top = wl_container_of(ws->views.next, top, workspace_link);
+    struct wlr_surface *focused = server->seat->keyboard_state.focused_surface;
+    int start = focused == top->xdg_toplevel->base->surface ? 1 : 0;
+    if (backward) {
+        switcher->selected = switcher->count - 1;
+    } else {
+        switcher->selected = start < switcher->count ? start : 0;
+    }
+
+    /* Task View and the switcher never show together */
+    lw_overview_hide(server);
+    server->switcher = switcher;
+    switcher_send(server, switcher, true, 0);
+}
+
+void lw_switcher_step(struct lw_server *server, bool backward) {
+    struct lw_switcher *switcher = server->switcher;
+    if (!switcher) {
+        switcher_open(server, backward);
+        return;
+    }
+
+    int count = switcher->count;
+    switcher->selected =
+        (switcher->selected + (backward ? count - 1 : 1)) % count;
+    switcher_send_select(switcher);
+}
+
+static void switcher_close(struct lw_server *server, struct lw_view *picked) {
+    struct lw_switcher *switcher = server->switcher;
+    if (!switcher) return;
+    server->switcher = NULL;
+
+    if (picked) {
+        lw_view_activate(picked);
+    }
+    switcher_send(server, switcher, false, picked ? picked->id : 0);
+    free(switcher);
+}
+
+void lw_switcher_commit(struct lw_server *server) {
+    struct lw_switcher *switcher = server->switcher;
+    if (!switcher) return;
+    switcher_close(server, lw_view_from_id(server,
+        switcher->ids[switcher->selected]));
+}
+
+void lw_switcher_cancel(struct lw_server *server) {
+    switcher_close(server, NULL);
+}
+
+bool lw_switcher_handle_key(struct lw_server *server, xkb_keysym_t sym,
+                            uint32_t modifiers) {
+    if (!server->switcher) return false;
+    /* Super shortcuts keep working */
+    if (modifiers & WLR_MODIFIER_LOGO) return false;
+
+    switch (sym) {
+    case XKB_KEY_Escape:
+        lw_switcher_cancel(server);
+        break;
+    case XKB_KEY_Return:
+    case XKB_KEY_KP_Enter:
+    case XKB_KEY_space:
+        lw_switcher_commit(server);
+        break;
+    case XKB_KEY_Tab:
+    case XKB_KEY_Right:
+        lw_switcher_step(server, false);
+        break;
+    case XKB_KEY_ISO_Left_Tab:
+    case XKB_KEY_Left:
+        lw_switcher_step(server, true);
+        break;
+    default:
+        /* Clients do not get keys while the switcher is up */
+        break;
+    }
+    return true;
+}
+
+void lw_switcher_view_removed(struct lw_view *view) {
+    struct lw_server *server = view->server;
+    struct lw_switcher *switcher = server->switcher;
+    if (!switcher) return;
+
+    int index = 0;
+    while (index < switcher->count && switcher->ids[index] != view->id) {
+        index++;
+    }
+    if (index == switcher->count) return;
+
+    switcher->count--;
+    memmove(&switcher->ids[index], &switcher->ids[index + 1],
+            (switcher->count - index) * sizeof(uint32_t));
+    if (switcher->count == 0) {
+        lw_switcher_cancel(server);
+        return;
+    }
+    if (index < switcher->selected) {
+        switcher->selected--;
+    } else if (switcher->selected == switcher->count) {
+        switcher->selected = 0;
+    }
+    switcher_send(server, switcher, true, 0);
+}
@@ -0,0 +1,514 @@
+/*
+ * lwindesk - compositor/src/thumbnail.c - Shared-memory window thumbnails
+ *
+ * Taskbar previews and the Alt+Tab strip want small pictures of windows.
+ * Shipping full-size frames to the shell would cost a window's worth of
+ * memory bandwidth per hover, so the compositor shrinks them itself into
+ * a memfd per window that clients map read-only (the fd goes out with
+ * the THUMBNAIL reply, like the state snapshot).
+ *
+ * Nothing happens until a client asks for a window's thumbnail.  From
+ * then on it is redrawn from the buffer the window commits, only when
+ * the commit carries damage and at most LWINDESK_THUMBNAIL_RATE times a
+ * second; a commit that comes too early is held (its buffer stays
+ * locked) and drawn when the interval is over.  The box filter reads
+ * every source pixel once, four channels per SSE2 lane group.  All
+ * thumbnails together stay under LWINDESK_THUMBNAIL_BUDGET; the least
+ * recently requested go first, released ones before those still shown.
+ *
+ * Only buffers with CPU access (wl_shm, ARGB/XRGB8888) can be read;
+ * dmabuf clients get no thumbnail.
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <drm_fourcc.h>
+#include <wlr/interfaces/wlr_buffer.h>
+#include <wlr/types/wlr_compositor.h>
+#include <wlr/types/wlr_xdg_shell.h>
+#include <wlr/util/log.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "ipc.h"
+#include "thumbnail.h"
+#include "view.h"
+
+/* --- Box filter --- */
+
+/* Add one source row to the per-column channel sums */
+static void sum_row(uint32_t *sums, const uint32_t *row, int width) {
+    int x = 0;
+#if defined(__SSE2__)
+    __m128i zero = _mm_setzero_si128();
+    for (; x + 4 <= width; x += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i *)(row + x));
+        __m128i lo = _mm_unpacklo_epi8(px, zero);
+        __m128i hi = _mm_unpackhi_epi8(px, zero);
+        __m128i *s = (__m128i *)(sums + 4 * x);
+        _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s),
+            _mm_unpacklo_epi16(lo, zero)));
+        _mm_storeu_si128(s + 1, _mm_add_epi32(_mm_loadu_si128(s + 1),
+            _mm_unpackhi_epi16(lo, zero)));
+        _mm_storeu_si128(s + 2, _mm_add_epi32(_mm_loadu_si128(s + 2),
+            _mm_unpacklo_epi16(hi, zero)));
+        _mm_storeu_si128(s + 3, _mm_add_epi32(_mm_loadu_si128(s + 3),
+            _mm_unpackhi_epi16(hi, zero)));
+    }
+#endif
+    for (; x < width; x++) {
+        uint32_t px = row[x];
+        uint32_t *s = sums + 4 * x;
+        s[0] += px & 0xff;
+        s[1] += (px >> 8) & 0xff;
+        s[2] += (px >> 16) & 0xff;
+        s[3] += px >> 24;
+    }
+}
+
+/* Average columns [x0, x1) of the sums over count source pixels */
+static uint32_t average(const uint32_t *sums, int x0, int x1, int count) {
+#if defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    for (int x = x0; x < x1; x++) {
+        acc = _mm_add_epi32(acc,
+            _mm_loadu_si128((const __m128i *)(sums + 4 * x)));
+    }
+    /* Round to nearest, then narrow through the saturating packs */
+    __m128i v = _mm_cvtps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(acc),
+        _mm_set1_ps(1.0f / count)));
+    v = _mm_packs_epi32(v, v);
+    v = _mm_packus_epi16(v, v);
+    return (uint32_t)_mm_cvtsi128_si32(v);
+#else
+    uint32_t acc[4] = {0};
+    for (int x = x0; x < x1; x++) {
+        for (int i = 0; i < 4; i++) acc[i] += sums[4 * x + i];
+    }
+    uint32_t px = 0;
+    for (int i = 0; i < 4; i++) {
+        px |= ((acc[i] + count / 2) / count) << (8 * i);
+    }
+    return px;
+#endif
+}
+
+void lw_thumbnail_downscale(uint32_t *dst, int dst_width, int dst_height,
+                            size_t dst_stride, const uint32_t *src,
+                            int src_width, int src_height, size_t src_stride,
+                            bool opaque, uint32_t *scratch, int *columns) {
+    if (dst_width <= 0 || dst_height <= 0 ||
+        dst_width > src_width || dst_height > src_height) return;
+
+    /* Destination column x covers source columns [columns[x],
+     * columns[x + 1]); never empty since we only shrink */
+    for (int x = 0; x <= dst_width; x++) {
+        columns[x] = (int)((int64_t)x * src_width / dst_width);
+    }
+    const uint32_t alpha = opaque ? 0xff000000u : 0;
+
+    int y1 = 0;
+    for (int y = 0; y < dst_height; y++) {
+        int y0 = y1;
+        y1 = (int)((int64_t)(y + 1) * src_height / dst_height);
+
+        memset(scratch, 0, 4 * (size_t)src_width * sizeof(*scratch));
+        for (int sy = y0; sy < y1; sy++) {
+            sum_row(scratch, (const uint32_t *)((const uint8_t *)src +
+                (size_t)sy * src_stride), src_width);
+        }
+
+        uint32_t *out = (uint32_t *)((uint8_t *)dst + (size_t)y * dst_stride);
+        for (int x = 0; x < dst_width; x++) {
+            int x0 = columns[x], x1 = columns[x + 1];
+            out[x] = average(scratch, x0, x1, (x1 - x0) * (y1 - y0)) | alpha;
+        }
+    }
+}
+
+/* --- Thumbnails --- */
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static size_t thumbnail_size(void) {
+    return sizeof(struct lw_ipc_thumbnail) +
+        (size_t)LW_THUMBNAIL_MAX_WIDTH * LW_THUMBNAIL_MAX_HEIGHT * 4;
+}
+
+static void thumbnail_announce(struct lw_view *view) {
+    struct lw_ipc_thumbnail_info info = lw_thumbnail_info(view);
+    lw_ipc_send_state(view->server, LW_IPC_EVENT_THUMBNAIL_CHANGED,
+                      view->id, &info, sizeof(info));
+}
+
+/* Free it and tell clients to unmap */
+static void thumbnail_destroy(struct lw_thumbnail *thumb) {
+    struct lw_thumbnailer *thumbnailer = thumb->thumbnailer;
+    struct lw_view *view = thumb->view;
+
+    wl_list_remove(&thumb->link);
+    thumbnailer->bytes -= thumb->size;
+    if (thumb->pending) wlr_buffer_unlock(thumb->pending);
+    if (thumb->shared) munmap(thumb->shared, thumb->size);
+    if (thumb->ro_fd >= 0) close(thumb->ro_fd);
+    if (thumb->fd >= 0) close(thumb->fd);
+    free(thumb);
+
+    view->thumbnail = NULL;
+    thumbnail_announce(view);
+}
+
+/* Evict until size more bytes fit: released thumbnails first, then the
+ * least recently requested */
+static bool thumbnailer_make_room(struct lw_thumbnailer *thumbnailer,
+                                  size_t size) {
+    struct lw_thumbnail *thumb, *tmp;
+    for (int pass = 0; pass < 2; pass++) {
+        wl_list_for_each_reverse_safe(thumb, tmp, &thumbnailer->lru, link) {
+            if (thumbnailer->bytes + size <= thumbnailer->budget) return true;
+            if (pass == 0 && thumb->active) continue;
+            thumbnailer->evictions++;
+            thumbnail_destroy(thumb);
+        }
+    }
+    return thumbnailer->bytes + size <= thumbnailer->budget;
+}
+
+static struct lw_thumbnail *thumbnail_create(struct lw_view *view) {
+    struct lw_thumbnailer *thumbnailer = view->server->thumbnailer;
+    const size_t size = thumbnail_size();
+    if (!thumbnailer_make_room(thumbnailer, size)) return NULL;
+
+    struct lw_thumbnail *thumb = calloc(1, sizeof(*thumb));
+    if (!thumb) return NULL;
+    thumb->thumbnailer = thumbnailer;
+    thumb->view = view;
+    thumb->size = size;
+    thumb->fd = thumb->ro_fd = -1;
+    wl_list_init(&thumb->link);
+
+    thumb->fd = memfd_create("lwindesk-thumbnail",
+                             MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (thumb->fd < 0 || ftruncate(thumb->fd, size) < 0) {
+        wlr_log_errno(WLR_ERROR, "Thumbnail memfd");
+        goto fail;
+    }
+    /* Clients can't resize it under us (SIGBUS) */
+    fcntl(thumb->fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+
+    thumb->shared = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         thumb->fd, 0);
+    if (thumb->shared == MAP_FAILED) {
+        thumb->shared = NULL;
+        wlr_log_errno(WLR_ERROR, "Thumbnail mmap");
+        goto fail;
+    }
+
+    /* What we hand out must not be writable */
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", thumb->fd);
+    thumb->ro_fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (thumb->ro_fd < 0) {
+        wlr_log_errno(WLR_ERROR, "Thumbnail read-only fd");
+        goto fail;
+    }
+
+    struct lw_ipc_thumbnail *shared = thumb->shared;
+    shared->magic = LW_IPC_THUMBNAIL_MAGIC;
+    shared->version = LW_IPC_VERSION;
+    shared->view_id = view->id;
+    shared->stride = LW_THUMBNAIL_MAX_WIDTH * 4;
+    shared->format = DRM_FORMAT_ARGB8888;
+    shared->max_width = LW_THUMBNAIL_MAX_WIDTH;
+    shared->max_height = LW_THUMBNAIL_MAX_HEIGHT;
+
+    wl_list_insert(&thumbnailer->lru, &thumb->link);
+    thumbnailer->bytes += size;
+    view->thumbnail = thumb;
+    return thumb;
+
+fail:
+    if (thumb->shared) munmap(thumb->shared, size);
+    if (thumb->ro_fd >= 0) close(thumb->ro_fd);
+    if (thumb->fd >= 0) close(thumb->fd);
+    free(thumb);
+    return NULL;
+}
+
+/* Redraw from a buffer of the view, cropped to its window geometry */
+static bool thumbnail_draw(struct lw_thumbnail *thumb,
+                           struct wlr_buffer *buffer) {
+    struct lw_thumbnailer *thumbnailer = thumb->thumbnailer;
+    struct lw_view *view = thumb->view;
+
+    void *data;
+    uint32_t format;
+    size_t stride;
+    if (!wlr_buffer_begin_data_ptr_access(buffer,
+            WLR_BUFFER_DATA_PTR_ACCESS_READ, &data, &format, &stride)) {
+        thumbnailer->unreadable++;
+        return false;
+    }
+    if (format != DRM_FORMAT_ARGB8888 && format != DRM_FORMAT_XRGB8888) {
+        wlr_buffer_end_data_ptr_access(buffer);
+        thumbnailer->unreadable++;
+        return false;
+    }
+
+    /* Leave out client-side shadows, as the window is shown */
+    struct wlr_surface *surface = view->xdg_toplevel->base->surface;
+    int scale = surface->current.scale > 0 ? surface->current.scale : 1;
+    struct wlr_box geo;
+    wlr_xdg_surface_get_geometry(view->xdg_toplevel->base, &geo);
+    struct wlr_box src = {0, 0, buffer->width, buffer->height};
+    if (geo.width > 0 && geo.height > 0) {
+        src.x = geo.x * scale > 0 ? geo.x * scale : 0;
+        src.y = geo.y * scale > 0 ? geo.y * scale : 0;
+        src.width = geo.width * scale;
+        src.height = geo.height * scale;
+        if (src.x + src.width > buffer->width) {
+            src.width = buffer->width - src.x;
+        }
+        if (src.y + src.height > buffer->height) {
+            src.height = buffer->height - src.y;
+        }
+    }
+    if (src.width <= 0 || src.height <= 0) {
+        wlr_buffer_end_data_ptr_access(buffer);
+        return false;
+    }
+
+    int width = src.width, height = src.height;
+    if (width > LW_THUMBNAIL_MAX_WIDTH) {
+        height = (int)((int64_t)height * LW_THUMBNAIL_MAX_WIDTH / width);
+        width = LW_THUMBNAIL_MAX_WIDTH;
+    }
+    if (height > LW_THUMBNAIL_MAX_HEIGHT) {
+        width = (int)((int64_t)width * LW_THUMBNAIL_MAX_HEIGHT / height);
+        height = LW_THUMBNAIL_MAX_HEIGHT;
+    }
+    if (width < 1) width = 1;
+    if (height < 1) height = 1;
+
+    if (thumbnailer->sums_width < src.width) {
+        uint32_t *sums = realloc(thumbnailer->sums,
+            4 * (size_t)src.width * sizeof(*sums));
+        if (!sums) {
+            wlr_buffer_end_data_ptr_access(buffer);
+            return false;
+        }
+        thumbnailer->sums = sums;
+        thumbnailer->sums_width = src.width;
+    }
+
+    struct lw_ipc_thumbnail *shared = thumb->shared;
+    uint32_t seq = shared->seq;
+    __atomic_store_n(&shared->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    lw_thumbnail_downscale((uint32_t *)(shared + 1), width, height,
+        shared->stride,
+        (const uint32_t *)((const uint8_t *)data +
+            (size_t)src.y * stride + (size_t)src.x * 4),
+        src.width, src.height, stride, format == DRM_FORMAT_XRGB8888,
+        thumbnailer->sums, thumbnailer->columns);
+    shared->width = width;
+    shared->height = height;
+    __atomic_store_n(&shared->seq, seq + 2, __ATOMIC_RELEASE);
+
+    wlr_buffer_end_data_ptr_access(buffer);
+
+    thumbnailer->redraws++;
+    thumb->stale = false;
+    thumb->next_ns = now_ns() + thumbnailer->interval_ns;
+    thumbnail_announce(view);
+    return true;
+}
+
+/* Make sure the timer fires by when (CLOCK_MONOTONIC ns) */
+static void thumbnailer_schedule(struct lw_thumbnailer *thumbnailer,
+                                 uint64_t when, uint64_t now) {
+    if (thumbnailer->timer_ns && thumbnailer->timer_ns <= when) return;
+    thumbnailer->timer_ns = when;
+    /* Round up: firing early would only find nothing due */
+    int ms = when > now ? (int)((when - now + 999999) / 1000000) : 1;
+    wl_event_source_timer_update(thumbnailer->timer, ms);
+}
+
+/* Draw held commits whose interval is over; re-arm for the rest */
+static int thumbnailer_timer(void *data) {
+    struct lw_thumbnailer *thumbnailer = data;
+    uint64_t now = now_ns();
+    uint64_t next = 0;
+    thumbnailer->timer_ns = 0;
+
+    struct lw_thumbnail *thumb;
+    wl_list_for_each(thumb, &thumbnailer->lru, link) {
+        if (!thumb->pending) continue;
+        if (thumb->next_ns <= now) {
+            struct wlr_buffer *buffer = thumb->pending;
+            thumb->pending = NULL;
+            thumbnail_draw(thumb, buffer);
+            wlr_buffer_unlock(buffer);
+        } else if (!next || thumb->next_ns < next) {
+            next = thumb->next_ns;
+        }
+    }
+
+    if (next) thumbnailer_schedule(thumbnailer, next, now);
+    return 0;
+}
+
+static long env_long(const char *name, long fallback, long min, long max) {
+    const char *value = getenv(name);
+    if (!value || !*value) return fallback;
+
+    char *end;
+    long n = strtol(value, &end, 10);
+    if (*end || n < min || n > max) {
+        wlr_log(WLR_ERROR, "Invalid %s '%s', expected %ld-%ld",
+                name, value, min, max);
+        return fallback;
+    }
+    return n;
+}
+
+struct lw_thumbnailer *lw_thumbnailer_create(struct lw_server *server) {
+    struct lw_thumbnailer *thumbnailer = calloc(1, sizeof(*thumbnailer));
+    if (!thumbnailer) return NULL;
+    thumbnailer->server = server;
+    wl_list_init(&thumbnailer->lru);
+
+    long rate = env_long("LWINDESK_THUMBNAIL_RATE",
+                         LW_THUMBNAIL_DEFAULT_RATE, 1, 120);
+    long budget = env_long("LWINDESK_THUMBNAIL_BUDGET",
+                           LW_THUMBNAIL_DEFAULT_BUDGET >> 20, 1, 1024);
+    thumbnailer->interval_ns = 1000000000u / rate;
+    thumbnailer->budget = (size_t)budget << 20;
+
+    struct wl_event_loop *loop =
+        wl_display_get_event_loop(server->wl_display);
+    thumbnailer->timer = wl_event_loop_add_timer(loop, thumbnailer_timer,
+                                                 thumbnailer);
+    if (!thumbnailer->timer) {
+        free(thumbnailer);
+        return NULL;
+    }
+
+    wlr_log(WLR_DEBUG, "Thumbnails: %ld/s per window, %ld MiB budget",
+            rate, budget);
+    return thumbnailer;
+}
+
+void lw_thumbnailer_destroy(struct lw_thumbnailer *thumbnailer) {
+    if (!thumbnailer) return;
+    wlr_log(WLR_DEBUG, "Thumbnails: %" PRIu64 " redraws, %" PRIu64
+            " deferred, %" PRIu64 " evictions, %" PRIu64 " unreadable",
+            thumbnailer->redraws, thumbnailer->deferred,
+            thumbnailer->evictions, thumbnailer->unreadable);
+
+    struct lw_thumbnail *thumb, *tmp;
+    wl_list_for_each_safe(thumb, tmp, &thumbnailer->lru, link) {
+        thumbnail_destroy(thumb);
+    }
+    wl_event_source_remove(thumbnailer->timer);
+    free(thumbnailer->sums);
+    free(thumbnailer);
+}
+
+struct lw_thumbnail *lw_thumbnail_request(struct lw_view *view) {
+    struct lw_thumbnailer *thumbnailer = view->server->thumbnailer;
+    if (!thumbnailer || !view->mapped) return NULL;
+
+    struct lw_thumbnail *thumb = view->thumbnail;
+    if (!thumb) {
+        thumb = thumbnail_create(view);
+        if (!thumb) return NULL;
+        thumb->stale = true;
+    }
+    wl_list_remove(&thumb->link);
+    wl_list_insert(&thumbnailer->lru, &thumb->link);
+    thumb->active = true;
+
+    /* Between commits only the client's own buffer is left to read; it
+     * may already hold the next frame in progress, which the next
+     * commit corrects */
+    struct wlr_client_buffer *client =
+        view->xdg_toplevel->base->surface->buffer;
+    if (thumb->stale && client && client->source) {
+        thumbnail_draw(thumb, client->source);
+    }
+    return thumb;
+}
+
+void lw_thumbnail_release(struct lw_view *view) {
+    struct lw_thumbnail *thumb = view->thumbnail;
+    if (!thumb) return;
+    thumb->active = false;
+    if (thumb->pending) {
+        wlr_buffer_unlock(thumb->pending);
+        thumb->pending = NULL;
+    }
+}
+
+void lw_thumbnail_view_commit(struct lw_view *view) {
+    struct lw_thumbnail *thumb = view->thumbnail;
+    if (!thumb) return;
+
+    /* The buffer is only there during the commit event (0.17) */
+    struct wlr_surface *surface = view->xdg_toplevel->base->surface;
+    if (!surface->current.buffer ||
+        !pixman_region32_not_empty(&surface->buffer_damage)) return;
+
+    thumb->stale = true;
+    if (!thumb->active) return;
+
+    struct lw_thumbnailer *thumbnailer = thumb->thumbnailer;
+    uint64_t now = now_ns();
+    if (now >= thumb->next_ns) {
+        if (thumb->pending) {
+            wlr_buffer_unlock(thumb->pending);
+            thumb->pending = NULL;
+        }
+        thumbnail_draw(thumb, surface->current.buffer);
+        return;
+    }
+
+    /* Too early: hold this frame for when the interval is over */
+    thumbnailer->deferred++;
+    if (thumb->pending) wlr_buffer_unlock(thumb->pending);
+    thumb->pending = wlr_buffer_lock(surface->current.buffer);
+    thumbnailer_schedule(thumbnailer, thumb->next_ns, now);
+}
+
+void lw_thumbnail_view_destroy(struct lw_view *view) {
+    if (view->thumbnail) {
+        thumbnail_destroy(view->thumbnail);
+    }
+}
+
+struct lw_ipc_thumbnail_info lw_thumbnail_info(struct lw_view *view) {
+    struct lw_thumbnail *thumb = view->thumbnail;
+    struct lw_ipc_thumbnail_info info = {.view_id = view->id};
+    if (thumb) {
+        info.size = thumb->size;
+        info.seq = thumb->shared->seq;
+    }
+    return info;
+}
+
+int lw_thumbnail_fd(struct lw_thumbnail *thumb) {
+    return thumb ? thumb->ro_fd : -1;
+}
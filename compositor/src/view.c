@@ -2,67 +2,40 @@
  * lwindesk - compositor/src/view.c - Window (view) management
  *
  * Server-side decorations are rendered using cairo onto a pixel buffer
- * that is displayed via a wlr_scene_buffer node.  This gives us proper
- * Windows 11-style dark title bars with text and button symbols instead
- * of plain colored rectangles.
+ * (see deco_cache.c) that is displayed via a wlr_scene_buffer node.
+ * This gives us proper Windows 11-style dark title bars with text and
+ * button symbols instead of plain colored rectangles.
  */
 
 #define _POSIX_C_SOURCE 200112L
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
-#include <cairo/cairo.h>
-#include <pango/pangocairo.h>
-#include <drm_fourcc.h>
-#include <wlr/interfaces/wlr_buffer.h>
+#include <pixman.h>
+#include <wlr/types/wlr_output_layout.h>
 #include <wlr/types/wlr_scene.h>
 #include <wlr/types/wlr_xdg_shell.h>
+#include <wlr/util/box.h>
+#include <wlr/util/edges.h>
 #include <wlr/util/log.h>
 
 #include "view.h"
+#include "deco_cache.h"
+#include "deco_render.h"
+#include "hit_index.h"
+#include "layer_shell.h"
+#include "snapshot.h"
+#include "ipc.h"
+#include "output.h"
+#include "overview.h"
 #include "server.h"
+#include "snap.h"
+#include "workspace.h"
 
-/* Tag stored in the titlebar scene_buffer node->data so lw_view_at
- * and lw_deco_button_at can recognise it as a decoration. */
-#define DECO_TAG_TITLEBAR  ((void *)(uintptr_t)1)
-
-/* --- Custom pixel buffer implementation for wlr_buffer --- */
-
-struct lw_pixel_buffer {
-	struct wlr_buffer base;
-	void *data;
-	size_t stride;
-};
-
-static void pixel_buffer_destroy(struct wlr_buffer *wlr_buf) {
-	struct lw_pixel_buffer *buf = wl_container_of(wlr_buf, buf, base);
-	free(buf->data);
-	free(buf);
-}
-
-static bool pixel_buffer_begin_data_ptr_access(struct wlr_buffer *wlr_buf,
-		uint32_t flags, void **data, uint32_t *format, size_t *stride) {
-	struct lw_pixel_buffer *buf = wl_container_of(wlr_buf, buf, base);
-	*data = buf->data;
-	*format = DRM_FORMAT_ARGB8888;
-	*stride = buf->stride;
-	return true;
-}
-
-static void pixel_buffer_end_data_ptr_access(struct wlr_buffer *wlr_buf) {
-	/* no-op */
-}
-
-static const struct wlr_buffer_impl pixel_buffer_impl = {
-	.destroy = pixel_buffer_destroy,
-	.begin_data_ptr_access = pixel_buffer_begin_data_ptr_access,
-	.end_data_ptr_access = pixel_buffer_end_data_ptr_access,
-};
-
-/* --- Cairo title bar rendering --- */
+/* --- Title bar rendering --- */
 
 /*
- * Render a Windows 11 dark-theme title bar into a new wlr_buffer.
+ * Render a Windows 11 dark-theme title bar into a new pixel buffer.
  *
  * Layout (right-to-left from the right edge):
  *   [0..width-138]  title text area  (#2b2b2b background)
@@ -71,105 +44,13 @@ static const struct wlr_buffer_impl pixel_buffer_impl = {
  *   [width-46]      close button     (#c42b1c, × symbol)
  *
  * Each button is 46px wide, the full titlebar is 32px tall.
- * Symbols and text are white.
+ * Symbols and text are white.  The font, shaped title layouts and the
+ * button sprites come from the server's lw_deco_cache.
  */
-static struct wlr_buffer *render_titlebar(int width, int height,
-		const char *title) {
-	if (width <= 0 || height <= 0)
-		return NULL;
-
-	size_t stride = (size_t)width * 4;
-	void *data = calloc(1, stride * height);
-	if (!data)
-		return NULL;
-
-	cairo_surface_t *surface = cairo_image_surface_create_for_data(
-		data, CAIRO_FORMAT_ARGB32, width, height, stride);
-	cairo_t *cr = cairo_create(surface);
-
-	/* Background (#2b2b2b) */
-	cairo_set_source_rgb(cr, 0.169, 0.169, 0.169);
-	cairo_paint(cr);
-
-	/* Close button red background (#c42b1c) */
-	cairo_set_source_rgb(cr, 0.769, 0.169, 0.110);
-	cairo_rectangle(cr, width - LW_DECO_BUTTON_WIDTH, 0,
-		LW_DECO_BUTTON_WIDTH, height);
-	cairo_fill(cr);
-
-	/* Button symbols — thin white strokes */
-	cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
-	cairo_set_line_width(cr, 1.0);
-
-	int cy = height / 2;
-
-	/* Close button: × centered in rightmost 46px */
-	{
-		int cx = width - LW_DECO_BUTTON_WIDTH / 2;
-		cairo_move_to(cr, cx - 5, cy - 5);
-		cairo_line_to(cr, cx + 5, cy + 5);
-		cairo_move_to(cr, cx + 5, cy - 5);
-		cairo_line_to(cr, cx - 5, cy + 5);
-		cairo_stroke(cr);
-	}
-
-	/* Maximize button: □ centered in second-from-right 46px */
-	{
-		int mx = width - LW_DECO_BUTTON_WIDTH - LW_DECO_BUTTON_WIDTH / 2;
-		cairo_rectangle(cr, mx - 5, cy - 5, 10, 10);
-		cairo_stroke(cr);
-	}
-
-	/* Minimize button: ─ centered in third-from-right 46px */
-	{
-		int nx = width - 2 * LW_DECO_BUTTON_WIDTH - LW_DECO_BUTTON_WIDTH / 2;
-		cairo_move_to(cr, nx - 5, cy);
-		cairo_line_to(cr, nx + 5, cy);
-		cairo_stroke(cr);
-	}
-
-	/* Title text (white, left-aligned, ~12px Sans) */
-	if (title && title[0]) {
-		PangoLayout *layout = pango_cairo_create_layout(cr);
-		PangoFontDescription *font =
-			pango_font_description_from_string("Sans 11");
-		pango_layout_set_font_description(layout, font);
-		pango_layout_set_text(layout, title, -1);
-
-		/* Clip text so it never overlaps the three buttons */
-		int max_text_width = width - 3 * LW_DECO_BUTTON_WIDTH - 16;
-		if (max_text_width > 0) {
-			pango_layout_set_width(layout,
-				max_text_width * PANGO_SCALE);
-			pango_layout_set_ellipsize(layout,
-				PANGO_ELLIPSIZE_END);
-		}
-
-		cairo_set_source_rgba(cr, 1.0, 1.0, 1.0, 0.9);
-
-		int text_w, text_h;
-		pango_layout_get_pixel_size(layout, &text_w, &text_h);
-		cairo_move_to(cr, 12, (height - text_h) / 2);
-		pango_cairo_show_layout(cr, layout);
-
-		pango_font_description_free(font);
-		g_object_unref(layout);
-	}
-
-	cairo_destroy(cr);
-	cairo_surface_destroy(surface);
-
-	/* Wrap the pixel data in a wlr_buffer */
-	struct lw_pixel_buffer *buf = calloc(1, sizeof(*buf));
-	if (!buf) {
-		free(data);
-		return NULL;
-	}
-	buf->data = data;
-	buf->stride = stride;
-	wlr_buffer_init(&buf->base, &pixel_buffer_impl, width, height);
-
-	return &buf->base;
+static struct wlr_buffer *render_titlebar(struct lw_server *server,
+		int width, int height, const char *title) {
+	return lw_deco_cache_render_titlebar(server->deco_cache,
+		width, height, title);
 }
 
 /* --- Server-side decoration (SSD) implementation --- */
@@ -191,11 +72,12 @@ void lw_view_create_decorations(struct lw_view *view) {
 	struct lw_server *server = view->server;
 
 	/*
-	 * Create a wrapper scene tree. The current scene_tree (from
-	 * wlr_scene_xdg_surface_create) will be reparented into it.
+	 * Create a wrapper scene tree where the current scene_tree (from
+	 * wlr_scene_xdg_surface_create) lives, e.g. its workspace's tree,
+	 * and reparent the surface tree into it.
 	 */
 	struct wlr_scene_tree *wrapper =
-		wlr_scene_tree_create(&server->scene->tree);
+		wlr_scene_tree_create(view->scene_tree->node.parent);
 	if (!wrapper) {
 		wlr_log(WLR_ERROR, "Failed to create decoration wrapper tree");
 		return;
@@ -214,6 +96,8 @@ void lw_view_create_decorations(struct lw_view *view) {
 	xdg_tree->node.data = NULL;
 	wrapper->node.data = view;
 	view->scene_tree = wrapper;
+	lw_hit_index_invalidate(server);
+	lw_snapshot_mark_dirty(server);
 
 	/* Get the current surface width for sizing decorations */
 	struct wlr_box geo;
@@ -223,9 +107,10 @@ void lw_view_create_decorations(struct lw_view *view) {
 	/* Get the window title */
 	const char *title = view->xdg_toplevel->title;
 
-	/* Render the title bar */
+	/* Render the first title bar synchronously so the window never maps
+	 * without one; later updates go through the worker pool. */
 	struct wlr_buffer *wlr_buf =
-		render_titlebar(width, LW_TITLEBAR_HEIGHT, title);
+		render_titlebar(server, width, LW_TITLEBAR_HEIGHT, title);
 	if (!wlr_buf) {
 		wlr_log(WLR_ERROR, "Failed to render titlebar");
 		return;
@@ -241,15 +126,16 @@ void lw_view_create_decorations(struct lw_view *view) {
 	wlr_scene_buffer_set_buffer(scene_buf, wlr_buf);
 	wlr_scene_node_set_position(&scene_buf->node, 0, 0);
 
-	/* Tag the node so hit-testing knows it is a decoration */
-	scene_buf->node.data = DECO_TAG_TITLEBAR;
-
 	/* Store references for later update/destroy */
 	view->deco.titlebar_buffer = scene_buf;
 	view->deco.titlebar_wlr_buffer = wlr_buf;
 	view->deco.width = width;
+	view->deco.pending_width = width;
 	view->deco.cached_title = title ? strdup(title) : NULL;
 	view->deco.has_decorations = true;
+	wl_list_init(&view->deco.jobs);
+	view->deco.generation = 0;
+	view->deco.applied_generation = 0;
 
 	/* The scene now holds a reference to the buffer.  We keep our own
 	 * reference (from wlr_buffer_init) so we can drop it in destroy. */
@@ -266,6 +152,9 @@ void lw_view_create_decorations(struct lw_view *view) {
 void lw_view_destroy_decorations(struct lw_view *view) {
 	if (!view->deco.has_decorations) return;
 
+	/* Results still in flight must not find this view */
+	lw_deco_renderer_cancel(view->server->deco_renderer, view);
+
 	/* Destroy the scene buffer node (removes from scene graph) */
 	if (view->deco.titlebar_buffer) {
 		wlr_scene_node_destroy(&view->deco.titlebar_buffer->node);
@@ -281,6 +170,7 @@ void lw_view_destroy_decorations(struct lw_view *view) {
 	free(view->deco.cached_title);
 	view->deco.cached_title = NULL;
 	view->deco.width = 0;
+	view->deco.pending_width = 0;
 	view->deco.has_decorations = false;
 
 	/* Clear wrapper data so it won't be found by view_at / deco_button_at */
@@ -291,7 +181,8 @@ void lw_view_destroy_decorations(struct lw_view *view) {
 /*
  * Update decoration to match the current window width and title.
  * Called on every surface commit and when the title changes.
- * If the width (or title) changed, we re-render the entire titlebar.
+ * If the width (or title) changed, we queue a re-render; the new buffer
+ * replaces the old one when the worker pool hands it back.
  */
 void lw_view_update_decorations(struct lw_view *view) {
 	if (!view->deco.has_decorations) return;
@@ -303,32 +194,68 @@ void lw_view_update_decorations(struct lw_view *view) {
 
 	const char *title = view->xdg_toplevel->title;
 
-	/* Skip re-render if nothing changed */
+	/* Skip re-render if nothing changed since the last request */
 	const char *cached = view->deco.cached_title;
 	bool title_changed = (title && cached && strcmp(title, cached) != 0) ||
 	                      (title && !cached) || (!title && cached);
-	if (width == view->deco.width && !title_changed) {
+	if (width == view->deco.pending_width && !title_changed) {
+		return;
+	}
+
+	/* Cache the title for change detection */
+	if (title_changed) {
+		free(view->deco.cached_title);
+		view->deco.cached_title = title ? strdup(title) : NULL;
+	}
+	view->deco.pending_width = width;
+
+	struct lw_deco_renderer *renderer = view->server->deco_renderer;
+	if (renderer) {
+		lw_deco_renderer_submit(renderer, view, width,
+			LW_TITLEBAR_HEIGHT, title);
 		return;
 	}
 
-	/* Render a new titlebar buffer */
+	/* No worker pool: render inline */
 	struct wlr_buffer *new_buf =
-		render_titlebar(width, LW_TITLEBAR_HEIGHT, title);
+		render_titlebar(view->server, width, LW_TITLEBAR_HEIGHT, title);
 	if (!new_buf) return;
+	lw_view_set_titlebar_buffer(view, new_buf, width);
+}
 
-	/* Swap the buffer on the existing scene node */
-	wlr_scene_buffer_set_buffer(view->deco.titlebar_buffer, new_buf);
+/*
+ * Swap a freshly rendered buffer onto the titlebar node.  This runs on
+ * the main thread, so the scene never sees a half-updated decoration:
+ * node buffer, our reference and the hit-test width change together.
+ */
+void lw_view_set_titlebar_buffer(struct lw_view *view,
+		struct wlr_buffer *buffer, int width) {
+	if (!view->deco.has_decorations) {
+		wlr_buffer_drop(buffer);
+		return;
+	}
+
+	/* A title-only change leaves the buttons untouched, so only the
+	 * title area is damaged. */
+	if (width == view->deco.width) {
+		pixman_region32_t damage;
+		int title_w = width - 3 * LW_DECO_BUTTON_WIDTH;
+		pixman_region32_init_rect(&damage, 0, 0,
+			title_w > 0 ? title_w : width, LW_TITLEBAR_HEIGHT);
+		wlr_scene_buffer_set_buffer_with_damage(
+			view->deco.titlebar_buffer, buffer, &damage);
+		pixman_region32_fini(&damage);
+	} else {
+		wlr_scene_buffer_set_buffer(view->deco.titlebar_buffer, buffer);
+	}
 
 	/* Drop the old buffer */
 	if (view->deco.titlebar_wlr_buffer) {
 		wlr_buffer_drop(view->deco.titlebar_wlr_buffer);
 	}
-	view->deco.titlebar_wlr_buffer = new_buf;
+	view->deco.titlebar_wlr_buffer = buffer;
 	view->deco.width = width;
-
-	/* Cache the title for change detection */
-	free(view->deco.cached_title);
-	view->deco.cached_title = title ? strdup(title) : NULL;
+	lw_overview_view_changed(view);
 }
 
 /*
@@ -342,53 +269,14 @@ void lw_view_update_decorations(struct lw_view *view) {
 enum lw_deco_button lw_deco_button_at(struct lw_server *server,
                                         double lx, double ly,
                                         struct lw_view **out_view) {
-	double sx, sy;
-	struct wlr_scene_node *node =
-		wlr_scene_node_at(&server->scene->tree.node, lx, ly, &sx, &sy);
-
-	if (!node) return LW_DECO_NONE;
-
-	/* Check if this node is our tagged titlebar buffer */
-	if (node->type == WLR_SCENE_NODE_BUFFER &&
-			node->data == DECO_TAG_TITLEBAR) {
-		/* Walk up to find the view */
-		struct wlr_scene_tree *tree = node->parent;
-		while (tree && !tree->node.data) {
-			tree = tree->node.parent;
-		}
-		struct lw_view *view = tree ? tree->node.data : NULL;
-		if (!view || !view->deco.has_decorations) {
-			return LW_DECO_NONE;
-		}
-
-		if (out_view) {
-			*out_view = view;
-		}
-
-		/*
-		 * sx is the local X coordinate within the buffer.
-		 * The titlebar is view->deco.width pixels wide.
-		 * Buttons are laid out from the right edge:
-		 *   Close:    [width-46 .. width]
-		 *   Maximize: [width-92 .. width-46]
-		 *   Minimize: [width-138 .. width-92]
-		 */
-		int w = view->deco.width;
-		int ix = (int)sx;
-
-		if (ix >= w - LW_DECO_BUTTON_WIDTH) {
-			return LW_DECO_CLOSE;
-		} else if (ix >= w - 2 * LW_DECO_BUTTON_WIDTH) {
-			return LW_DECO_MAXIMIZE;
-		} else if (ix >= w - 3 * LW_DECO_BUTTON_WIDTH) {
-			return LW_DECO_MINIMIZE;
-		}
-
-		/* Anywhere else on the titlebar */
-		return LW_DECO_TITLEBAR;
+	struct lw_hit hit;
+	if (!lw_hit_test(server, lx, ly, &hit) || hit.button == LW_DECO_NONE) {
+		return LW_DECO_NONE;
 	}
-
-	return LW_DECO_NONE;
+	if (out_view) {
+		*out_view = hit.view;
+	}
+	return hit.button;
 }
 
 void lw_view_focus(struct lw_view *view) {
@@ -411,10 +299,21 @@ void lw_view_focus(struct lw_view *view) {
         }
     }
 
+    /* Focusing a window hidden behind a fullscreen view (e.g. Alt+Tab
+     * away from a game) shows it again; the output then composites. */
+    if (view->hidden_by_fullscreen) {
+        view->hidden_by_fullscreen = false;
+        wlr_scene_node_set_enabled(&view->scene_tree->node, true);
+    }
+
     /* Raise to top */
     wlr_scene_node_raise_to_top(&view->scene_tree->node);
+    lw_hit_index_invalidate(server);
+    lw_snapshot_mark_dirty(server);
     wl_list_remove(&view->link);
     wl_list_insert(&server->views, &view->link);
+    lw_workspace_raise_view(view);
+    lw_view_damage(view);
 
     /* Activate */
     wlr_xdg_toplevel_set_activated(view->xdg_toplevel, true);
@@ -426,10 +325,26 @@ void lw_view_focus(struct lw_view *view) {
             keyboard->keycodes, keyboard->num_keycodes,
             &keyboard->modifiers);
     }
+
+    lw_ipc_send_focus(server, view);
 }
 
 void lw_view_snap(struct lw_view *view, enum lw_snap_zone zone) {
+    if (!view) return;
+    lw_view_snap_on(view,
+        lw_snap_output_at(view->server, view->x + 1, view->y + 1), zone);
+}
+
+void lw_view_snap_on(struct lw_view *view, struct lw_output *output,
+                     enum lw_snap_zone zone) {
     if (!view || zone == LW_SNAP_NONE) return;
+    /* The zone on that output, less what panels reserve */
+    struct wlr_box target = lw_snap_zone_geometry(output, zone);
+    if (wlr_box_empty(&target)) return;
+
+    if (view->is_fullscreen) {
+        lw_view_set_fullscreen(view, false);
+    }
 
     /* Save current geometry for restore */
     if (!view->is_snapped && !view->is_maximized) {
@@ -440,69 +355,8 @@ void lw_view_snap(struct lw_view *view, enum lw_snap_zone zone) {
         view->saved_geometry.width = geo.width;
         view->saved_geometry.height = geo.height;
     }
-
-    /* Get the output this view is on */
-    struct wlr_output *output =
-        wlr_output_layout_output_at(view->server->output_layout,
-                                     view->x + 1, view->y + 1);
-    if (!output) return;
-
-    struct wlr_box output_box;
-    wlr_output_layout_get_box(view->server->output_layout, output,
-                               &output_box);
-
-    /* Reserve 48px at bottom for taskbar */
-    int taskbar_height = 48;
-    int usable_h = output_box.height - taskbar_height;
-
-    struct wlr_box target = {0};
-
-    switch (zone) {
-    case LW_SNAP_LEFT:
-        target.x = output_box.x;
-        target.y = output_box.y;
-        target.width = output_box.width / 2;
-        target.height = usable_h;
-        break;
-    case LW_SNAP_RIGHT:
-        target.x = output_box.x + output_box.width / 2;
-        target.y = output_box.y;
-        target.width = output_box.width / 2;
-        target.height = usable_h;
-        break;
-    case LW_SNAP_TOP_LEFT:
-        target.x = output_box.x;
-        target.y = output_box.y;
-        target.width = output_box.width / 2;
-        target.height = usable_h / 2;
-        break;
-    case LW_SNAP_TOP_RIGHT:
-        target.x = output_box.x + output_box.width / 2;
-        target.y = output_box.y;
-        target.width = output_box.width / 2;
-        target.height = usable_h / 2;
-        break;
-    case LW_SNAP_BOTTOM_LEFT:
-        target.x = output_box.x;
-        target.y = output_box.y + usable_h / 2;
-        target.width = output_box.width / 2;
-        target.height = usable_h / 2;
-        break;
-    case LW_SNAP_BOTTOM_RIGHT:
-        target.x = output_box.x + output_box.width / 2;
-        target.y = output_box.y + usable_h / 2;
-        target.width = output_box.width / 2;
-        target.height = usable_h / 2;
-        break;
-    case LW_SNAP_MAXIMIZE:
-        target.x = output_box.x;
-        target.y = output_box.y;
-        target.width = output_box.width;
-        target.height = usable_h;
+    if (zone == LW_SNAP_MAXIMIZE) {
         view->is_maximized = true;
-        break;
-    default:
-        return;
     }
 
     /* If the view has decorations, the title bar consumes space from the
@@ -517,96 +371,342 @@ void lw_view_snap(struct lw_view *view, enum lw_snap_zone zone) {
     wlr_xdg_toplevel_set_size(view->xdg_toplevel,
         target.width, surface_height);
     wlr_scene_node_set_position(&view->scene_tree->node, target.x, target.y);
+    lw_hit_index_invalidate(view->server);
+    lw_snapshot_mark_dirty(view->server);
     view->x = target.x;
     view->y = target.y;
     view->is_snapped = true;
     view->snap_zone = zone;
+    lw_ipc_send_view_state(view->server, view);
+    lw_view_damage(view);
+}
+
+static void resize_send(struct lw_view *view, struct wlr_box box) {
+    view->resize_sent = box;
+    view->resize_serial =
+        wlr_xdg_toplevel_set_size(view->xdg_toplevel, box.width, box.height);
+    view->server->resize_configures++;
+}
+
+void lw_view_resize(struct lw_view *view, struct wlr_box box,
+                    uint32_t edges) {
+    view->server->resize_requests++;
+    view->resize_edges = edges;
+
+    if (view->resize_serial) {
+        /* Back to what is in flight: nothing more to send */
+        view->resize_queued = box.width != view->resize_sent.width ||
+            box.height != view->resize_sent.height;
+        view->resize_next = box;
+        return;
+    }
+
+    struct wlr_box geo;
+    wlr_xdg_surface_get_geometry(view->xdg_toplevel->base, &geo);
+    if (box.width == geo.width && box.height == geo.height) return;
+    resize_send(view, box);
+}
+
+bool lw_view_resize_commit(struct lw_view *view) {
+    if (!view->resize_serial) return false;
+    uint32_t acked = view->xdg_toplevel->base->current.configure_serial;
+    if ((int32_t)(acked - view->resize_serial) < 0) return false;
+    view->resize_serial = 0;
+
+    /* Clients may settle on another size (minimums, size increments):
+     * keep the edges that are not being dragged in place */
+    struct wlr_box geo;
+    wlr_xdg_surface_get_geometry(view->xdg_toplevel->base, &geo);
+    const struct wlr_box *sent = &view->resize_sent;
+    int x = sent->x;
+    int y = sent->y;
+    if (view->resize_edges & WLR_EDGE_LEFT) {
+        x = sent->x + sent->width - geo.width;
+    }
+    if (view->resize_edges & WLR_EDGE_TOP) {
+        y = sent->y + sent->height - geo.height;
+    }
+    if (x != view->x || y != view->y) {
+        view->x = x;
+        view->y = y;
+        wlr_scene_node_set_position(&view->scene_tree->node, x, y);
+        lw_hit_index_invalidate(view->server);
+    }
+    lw_snapshot_mark_dirty(view->server);
+
+    if (view->resize_queued) {
+        view->resize_queued = false;
+        resize_send(view, view->resize_next);
+    }
+    return true;
 }
 
 void lw_view_restore(struct lw_view *view) {
-    if (!view || (!view->is_snapped && !view->is_maximized)) return;
+    if (!view) return;
+    if (view->is_fullscreen) {
+        lw_view_set_fullscreen(view, false);
+        return;
+    }
+    if (!view->is_snapped && !view->is_maximized) return;
 
     wlr_xdg_toplevel_set_size(view->xdg_toplevel,
         view->saved_geometry.width, view->saved_geometry.height);
     wlr_scene_node_set_position(&view->scene_tree->node,
         view->saved_geometry.x, view->saved_geometry.y);
+    lw_hit_index_invalidate(view->server);
+    lw_snapshot_mark_dirty(view->server);
 
     view->x = view->saved_geometry.x;
     view->y = view->saved_geometry.y;
     view->is_snapped = false;
     view->is_maximized = false;
     view->snap_zone = LW_SNAP_NONE;
+    lw_ipc_send_view_state(view->server, view);
+    lw_view_damage(view);
+}
+
+/*
+ * Disable (or re-enable) everything sharing an output with a fullscreen
+ * view: other views, the wallpaper and the panels below the overlay
+ * layer.  With the fullscreen surface as
+ * the only enabled node on the output, wlr_scene can hand its buffer
+ * straight to the display instead of compositing.
+ */
+static void fullscreen_hide_others(struct lw_view *view,
+                                   struct lw_output *output, bool hide) {
+    struct lw_server *server = view->server;
+    struct wlr_box output_box;
+    wlr_output_layout_get_box(server->output_layout, output->wlr_output,
+                               &output_box);
+
+    struct lw_view *other;
+    wl_list_for_each(other, &server->views, link) {
+        if (other == view) continue;
+        /* Other workspaces are hidden already */
+        if (hide && other->workspace != view->workspace) continue;
+
+        if (!hide) {
+            if (other->hidden_by_fullscreen) {
+                other->hidden_by_fullscreen = false;
+                if (!other->is_minimized) {
+                    wlr_scene_node_set_enabled(&other->scene_tree->node, true);
+                }
+            }
+            continue;
+        }
+
+        if (other->is_minimized || !other->scene_tree->node.enabled) continue;
+
+        struct wlr_box geo, box, intersection;
+        wlr_xdg_surface_get_geometry(other->xdg_toplevel->base, &geo);
+        box.x = other->x;
+        box.y = other->y;
+        box.width = geo.width;
+        box.height = geo.height +
+            (other->deco.has_decorations ? LW_TITLEBAR_HEIGHT : 0);
+        if (wlr_box_intersection(&intersection, &box, &output_box)) {
+            wlr_scene_node_set_enabled(&other->scene_tree->node, false);
+            other->hidden_by_fullscreen = true;
+        }
+    }
+
+    if (output->background) {
+        wlr_scene_node_set_enabled(&output->background->node, !hide);
+    }
+    lw_layer_output_cover(output, hide);
+}
+
+void lw_view_fullscreen_cover(struct lw_view *view, bool cover) {
+    if (!view->is_fullscreen || !view->fullscreen_output) return;
+    /* A minimized fullscreen view covers nothing until it is restored */
+    if (cover && view->is_minimized) return;
+    fullscreen_hide_others(view, view->fullscreen_output, cover);
+    lw_hit_index_invalidate(view->server);
+}
+
+static void set_decorations_visible(struct lw_view *view, bool visible) {
+    if (!view->deco.has_decorations) return;
+
+    struct wlr_scene_tree *xdg_tree = view->xdg_toplevel->base->data;
+    wlr_scene_node_set_enabled(&view->deco.titlebar_buffer->node, visible);
+    wlr_scene_node_set_position(&xdg_tree->node, 0,
+        visible ? LW_TITLEBAR_HEIGHT : 0);
+}
+
+void lw_view_set_fullscreen(struct lw_view *view, bool fullscreen) {
+    if (!view || view->is_fullscreen == fullscreen) return;
+
+    struct lw_server *server = view->server;
+
+    if (!fullscreen) {
+        struct lw_output *output = view->fullscreen_output;
+        if (output) {
+            fullscreen_hide_others(view, output, false);
+            output->fullscreen_view = NULL;
+            output->scanning_out = false;
+        }
+        view->fullscreen_output = NULL;
+        view->is_fullscreen = false;
+
+        set_decorations_visible(view, true);
+        wlr_xdg_toplevel_set_fullscreen(view->xdg_toplevel, false);
+        wlr_xdg_toplevel_set_size(view->xdg_toplevel,
+            view->fullscreen_saved.width, view->fullscreen_saved.height);
+        wlr_scene_node_set_position(&view->scene_tree->node,
+            view->fullscreen_saved.x, view->fullscreen_saved.y);
+        view->x = view->fullscreen_saved.x;
+        view->y = view->fullscreen_saved.y;
+        lw_hit_index_invalidate(server);
+        lw_snapshot_mark_dirty(server);
+        lw_ipc_send_view_state(server, view);
+        lw_output_damage_all(server);
+        return;
+    }
+
+    struct wlr_output *wlr_output =
+        wlr_output_layout_output_at(server->output_layout,
+                                     view->x + 1, view->y + 1);
+    if (!wlr_output) {
+        wlr_output = wlr_output_layout_get_center_output(server->output_layout);
+    }
+    if (!wlr_output) return;
+
+    struct lw_output *output = NULL, *iter;
+    wl_list_for_each(iter, &server->outputs, link) {
+        if (iter->wlr_output == wlr_output) {
+            output = iter;
+            break;
+        }
+    }
+    if (!output) return;
+
+    /* One fullscreen view per output */
+    if (output->fullscreen_view) {
+        lw_view_set_fullscreen(output->fullscreen_view, false);
+    }
+
+    struct wlr_box geo;
+    wlr_xdg_surface_get_geometry(view->xdg_toplevel->base, &geo);
+    view->fullscreen_saved.x = view->x;
+    view->fullscreen_saved.y = view->y;
+    view->fullscreen_saved.width = geo.width;
+    view->fullscreen_saved.height = geo.height;
+
+    /* The whole output, including the area reserved for the taskbar */
+    struct wlr_box output_box;
+    wlr_output_layout_get_box(server->output_layout, wlr_output, &output_box);
+
+    view->is_fullscreen = true;
+    view->fullscreen_output = output;
+    output->fullscreen_view = view;
+
+    set_decorations_visible(view, false);
+    wlr_xdg_toplevel_set_fullscreen(view->xdg_toplevel, true);
+    wlr_xdg_toplevel_set_size(view->xdg_toplevel,
+        output_box.width, output_box.height);
+    wlr_scene_node_set_position(&view->scene_tree->node,
+        output_box.x, output_box.y);
+    view->x = output_box.x;
+    view->y = output_box.y;
+
+    lw_view_focus(view);
+    wlr_scene_node_raise_to_top(&view->scene_tree->node);
+    fullscreen_hide_others(view, output, true);
+    lw_hit_index_invalidate(server);
+    lw_snapshot_mark_dirty(server);
+    lw_ipc_send_view_state(server, view);
+    lw_output_schedule_frame(output);
 }
 
 void lw_view_minimize(struct lw_view *view) {
     if (!view || view->is_minimized) return;
+    /* Bring back the wallpaper, panels and windows it was covering; it
+     * stays fullscreen and covers them again when restored */
+    if (view->is_fullscreen) {
+        lw_view_fullscreen_cover(view, false);
+    }
     wlr_scene_node_set_enabled(&view->scene_tree->node, false);
     view->is_minimized = true;
+    lw_hit_index_invalidate(view->server);
+    lw_snapshot_mark_dirty(view->server);
+    lw_ipc_send_view_state(view->server, view);
+    lw_view_damage(view);
 }
 
 void lw_view_unminimize(struct lw_view *view) {
     if (!view || !view->is_minimized) return;
     wlr_scene_node_set_enabled(&view->scene_tree->node, true);
     view->is_minimized = false;
+    /* Only on the workspace shown; switching to it covers otherwise */
+    if (view->is_fullscreen && (!view->workspace ||
+            view->workspace == view->server->active_workspace)) {
+        wlr_scene_node_raise_to_top(&view->scene_tree->node);
+        lw_view_fullscreen_cover(view, true);
+    }
+    lw_hit_index_invalidate(view->server);
+    lw_snapshot_mark_dirty(view->server);
+    lw_ipc_send_view_state(view->server, view);
     lw_view_focus(view);
 }
 
-void lw_view_close(struct lw_view *view) {
+void lw_view_activate(struct lw_view *view) {
     if (!view) return;
-    wlr_xdg_toplevel_send_close(view->xdg_toplevel);
+    struct lw_server *server = view->server;
+    if (view->workspace && view->workspace != server->active_workspace) {
+        lw_workspace_switch(server, view->workspace);
+    }
+    if (view->is_minimized) {
+        lw_view_unminimize(view);
+    } else {
+        lw_view_focus(view);
+    }
 }
 
-struct lw_view *lw_view_at(struct lw_server *server, double lx, double ly,
-                            struct wlr_surface **surface,
-                            double *sx, double *sy) {
-    struct wlr_scene_node *node =
-        wlr_scene_node_at(&server->scene->tree.node, lx, ly, sx, sy);
-    if (!node) return NULL;
-
-    /*
-     * If we hit a RECT node (e.g. desktop background gradient strips),
-     * walk up to find a view.  The surface pointer is NULL since these
-     * are not Wayland surfaces.
-     */
-    if (node->type == WLR_SCENE_NODE_RECT) {
-        *surface = NULL;
-        struct wlr_scene_tree *tree = node->parent;
-        while (tree && !tree->node.data) {
-            tree = tree->node.parent;
-        }
-        return tree ? tree->node.data : NULL;
-    }
+void lw_view_damage(struct lw_view *view) {
+    if (!view) return;
 
-    if (node->type != WLR_SCENE_NODE_BUFFER) {
-        return NULL;
-    }
+    struct wlr_box geo;
+    wlr_xdg_surface_get_geometry(view->xdg_toplevel->base, &geo);
+    struct wlr_box box = {
+        .x = view->x,
+        .y = view->y,
+        .width = geo.width > 0 ? geo.width : 1,
+        .height = (geo.height > 0 ? geo.height : 1) +
+            (view->deco.has_decorations ? LW_TITLEBAR_HEIGHT : 0),
+    };
+    lw_output_damage_box(view->server, &box);
+}
+
+void lw_view_close(struct lw_view *view) {
+    if (!view) return;
+    wlr_xdg_toplevel_send_close(view->xdg_toplevel);
+}
 
-    /*
-     * If this buffer node is our titlebar decoration (tagged with
-     * DECO_TAG_TITLEBAR), treat it like a decoration hit: return
-     * the view but set surface to NULL.
-     */
-    if (node->data == DECO_TAG_TITLEBAR) {
-        *surface = NULL;
-        struct wlr_scene_tree *tree = node->parent;
-        while (tree && !tree->node.data) {
-            tree = tree->node.parent;
+void lw_view_minimize_all(struct lw_server *server) {
+    if (!server->active_workspace) return;
+    struct lw_view *view;
+    wl_list_for_each(view, &server->active_workspace->views, workspace_link) {
+        if (view->mapped && !view->is_minimized) {
+            lw_view_minimize(view);
         }
-        return tree ? tree->node.data : NULL;
     }
+}
 
-    struct wlr_scene_buffer *scene_buffer = wlr_scene_buffer_from_node(node);
-    struct wlr_scene_surface *scene_surface =
-        wlr_scene_surface_try_from_buffer(scene_buffer);
-    if (!scene_surface) return NULL;
-
-    *surface = scene_surface->surface;
-
-    /* Walk up the scene tree to find the view */
-    struct wlr_scene_tree *tree = node->parent;
-    while (tree && !tree->node.data) {
-        tree = tree->node.parent;
+struct lw_view *lw_view_from_id(struct lw_server *server, uint32_t id) {
+    struct lw_view *view;
+    wl_list_for_each(view, &server->views, link) {
+        if (view->id == id) return view;
     }
+    return NULL;
+}
 
-    return tree ? tree->node.data : NULL;
+struct lw_view *lw_view_at(struct lw_server *server, double lx, double ly,
+                            struct wlr_surface **surface,
+                            double *sx, double *sy) {
+    struct lw_hit hit;
+    lw_hit_test(server, lx, ly, &hit);
+    *surface = hit.surface;
+    *sx = hit.sx;
+    *sy = hit.sy;
+    return hit.view;
 }
@@ -1,57 +1,273 @@
 /*
  * lwindesk - compositor/src/workspace.c - Virtual desktop management
+ *
+ * Workspaces sit in a table indexed by position, each with its own scene
+ * tree under server->workspace_tree and a focus stack of its views.  A
+ * switch disables one tree, enables another and refocuses the window
+ * that was last focused there; views never have to be walked.  The
+ * focus order is also kept as a plain array of view ids for Alt+Tab.
  */
 
 #define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <wlr/types/wlr_scene.h>
+#include <wlr/types/wlr_seat.h>
+#include <wlr/types/wlr_xdg_shell.h>
 #include <wlr/util/log.h>
 
 #include "workspace.h"
+#include "hit_index.h"
+#include "snapshot.h"
+#include "ipc.h"
+#include "output.h"
+#include "overview.h"
 #include "server.h"
+#include "switcher.h"
 #include "view.h"
 
+/* Copy the focus order into the Alt+Tab list; called whenever it
+ * changes, which is far rarer than Tab is pressed */
+static void workspace_update_switcher(struct lw_workspace *ws) {
+    int count = 0;
+    struct lw_view *view;
+    wl_list_for_each(view, &ws->views, workspace_link) {
+        if (count == LW_IPC_SWITCHER_MAX) break;
+        ws->switcher_ids[count++] = view->id;
+    }
+    ws->switcher_count = count;
+}
+
 struct lw_workspace *lw_workspace_create(struct lw_server *server,
                                           const char *name) {
+    if (server->workspace_count >= LW_WORKSPACE_MAX) {
+        wlr_log(WLR_ERROR, "Workspace limit (%d) reached", LW_WORKSPACE_MAX);
+        return NULL;
+    }
+    if (server->workspace_count == server->workspace_capacity) {
+        int capacity = server->workspace_capacity ?
+            server->workspace_capacity * 2 : 4;
+        struct lw_workspace **table = realloc(server->workspaces,
+            capacity * sizeof(*table));
+        if (!table) return NULL;
+        server->workspaces = table;
+        server->workspace_capacity = capacity;
+    }
+
     struct lw_workspace *ws = calloc(1, sizeof(*ws));
+    if (!ws) return NULL;
     ws->server = server;
-    ws->index = server->workspace_count++;
-    strncpy(ws->name, name, sizeof(ws->name) - 1);
+    ws->index = server->workspace_count;
+    if (name) {
+        strncpy(ws->name, name, sizeof(ws->name) - 1);
+    } else {
+        snprintf(ws->name, sizeof(ws->name), "Desktop %d", ws->index + 1);
+    }
     wl_list_init(&ws->views);
-    ws->scene_tree = wlr_scene_tree_create(&server->scene->tree);
+    ws->scene_tree = wlr_scene_tree_create(server->workspace_tree);
+    /* Only the active workspace is shown */
+    if (server->active_workspace) {
+        wlr_scene_node_set_enabled(&ws->scene_tree->node, false);
+    }
 
-    wl_list_insert(&server->workspaces, &ws->link);
+    server->workspaces[server->workspace_count++] = ws;
+    lw_snapshot_mark_dirty(server);
+    lw_ipc_send_workspace(server);
+    lw_overview_refresh(server);
 
     wlr_log(WLR_INFO, "Created workspace %d: %s", ws->index, ws->name);
     return ws;
 }
 
+void lw_workspace_destroy(struct lw_workspace *ws) {
+    struct lw_server *server = ws->server;
+    if (server->workspace_count <= 1) return;
+
+    struct lw_workspace *target =
+        server->workspaces[ws->index > 0 ? ws->index - 1 : 1];
+    if (server->active_workspace == ws) {
+        lw_workspace_switch(server, target);
+    }
+
+    /* Under the target's own windows, most recent first, so its top
+     * window (the one with focus) stays on top of the stack */
+    struct lw_view *view, *tmp;
+    wl_list_for_each_safe(view, tmp, &ws->views, workspace_link) {
+        lw_workspace_move_view(view, target);
+        wl_list_remove(&view->workspace_link);
+        wl_list_insert(target->views.prev, &view->workspace_link);
+        wlr_scene_node_lower_to_bottom(&view->scene_tree->node);
+    }
+    workspace_update_switcher(target);
+
+    wlr_log(WLR_INFO, "Removed workspace %d: %s", ws->index, ws->name);
+
+    int index = ws->index;
+    wlr_scene_node_destroy(&ws->scene_tree->node);
+    free(ws);
+
+    server->workspace_count--;
+    for (int i = index; i < server->workspace_count; i++) {
+        struct lw_workspace *moved = server->workspaces[i + 1];
+        server->workspaces[i] = moved;
+        moved->index = i;
+        wl_list_for_each(view, &moved->views, workspace_link) {
+            lw_ipc_send_view_state(server, view);
+        }
+    }
+
+    lw_snapshot_mark_dirty(server);
+    lw_ipc_send_workspace(server);
+    lw_overview_refresh(server);
+}
+
+void lw_workspace_finish(struct lw_server *server) {
+    for (int i = 0; i < server->workspace_count; i++) {
+        free(server->workspaces[i]);
+    }
+    free(server->workspaces);
+    server->workspaces = NULL;
+    server->workspace_count = server->workspace_capacity = 0;
+    server->active_workspace = NULL;
+}
+
+struct lw_view *lw_workspace_top_view(struct lw_workspace *ws) {
+    if (!ws) return NULL;
+    struct lw_view *view;
+    wl_list_for_each(view, &ws->views, workspace_link) {
+        if (!view->is_minimized) return view;
+    }
+    return NULL;
+}
+
+/* Give keyboard focus to the top window of the active workspace, or to
+ * nothing when it has none */
+static void workspace_restore_focus(struct lw_server *server) {
+    struct lw_view *top = lw_workspace_top_view(server->active_workspace);
+    if (top) {
+        lw_view_focus(top);
+        return;
+    }
+
+    struct wlr_surface *prev = server->seat->keyboard_state.focused_surface;
+    if (!prev) return;
+    struct wlr_xdg_toplevel *toplevel =
+        wlr_xdg_toplevel_try_from_wlr_surface(prev);
+    if (toplevel) {
+        wlr_xdg_toplevel_set_activated(toplevel, false);
+    }
+    wlr_seat_keyboard_notify_clear_focus(server->seat);
+    lw_ipc_send_focus(server, NULL);
+}
+
+/* A fullscreen view hides what shares its output; that only holds while
+ * its workspace is the one shown */
+static void workspace_cover_outputs(struct lw_server *server,
+                                    struct lw_workspace *ws, bool cover) {
+    struct lw_output *output;
+    wl_list_for_each(output, &server->outputs, link) {
+        if (output->fullscreen_view &&
+            output->fullscreen_view->workspace == ws) {
+            lw_view_fullscreen_cover(output->fullscreen_view, cover);
+        }
+    }
+}
+
 void lw_workspace_switch(struct lw_server *server, struct lw_workspace *ws) {
-    if (server->active_workspace == ws) return;
+    struct lw_workspace *old = server->active_workspace;
+    if (old == ws) return;
 
     /* Hide current workspace */
-    if (server->active_workspace) {
-        wlr_scene_node_set_enabled(
-            &server->active_workspace->scene_tree->node, false);
+    if (old) {
+        workspace_cover_outputs(server, old, false);
+        wlr_scene_node_set_enabled(&old->scene_tree->node, false);
     }
 
     /* Show new workspace */
     wlr_scene_node_set_enabled(&ws->scene_tree->node, true);
+    workspace_cover_outputs(server, ws, true);
     server->active_workspace = ws;
+    lw_hit_index_invalidate(server);
+    lw_snapshot_mark_dirty(server);
+    lw_output_damage_all(server);
+    lw_ipc_send_workspace(server);
+    workspace_restore_focus(server);
+    lw_overview_refresh(server);
 
     wlr_log(WLR_INFO, "Switched to workspace %d: %s", ws->index, ws->name);
 }
 
+void lw_workspace_add_view(struct lw_workspace *ws, struct lw_view *view) {
+    view->workspace = ws;
+    wl_list_insert(&ws->views, &view->workspace_link);
+    wlr_scene_node_reparent(&view->scene_tree->node, ws->scene_tree);
+    wlr_scene_node_set_enabled(&view->scene_tree->node, !view->is_minimized);
+    workspace_update_switcher(ws);
+    lw_overview_refresh(view->server);
+}
+
+void lw_workspace_remove_view(struct lw_view *view) {
+    if (!view->workspace) return;
+
+    struct lw_server *server = view->server;
+    struct wlr_surface *surface = view->xdg_toplevel->base->surface;
+    bool focused = server->seat->keyboard_state.focused_surface == surface;
+
+    struct lw_workspace *ws = view->workspace;
+    wl_list_remove(&view->workspace_link);
+    wl_list_init(&view->workspace_link);
+    view->workspace = NULL;
+    workspace_update_switcher(ws);
+    lw_switcher_view_removed(view);
+    /* Out of the workspace tree, which may go away before the view, and
+     * hidden there: the title bar would otherwise stay drawn */
+    wlr_scene_node_reparent(&view->scene_tree->node, &server->scene->tree);
+    wlr_scene_node_set_enabled(&view->scene_tree->node, false);
+
+    if (focused) {
+        workspace_restore_focus(server);
+    }
+    lw_overview_refresh(server);
+}
+
+void lw_workspace_raise_view(struct lw_view *view) {
+    struct lw_workspace *ws = view->workspace;
+    if (!ws || ws->views.next == &view->workspace_link) return;
+    wl_list_remove(&view->workspace_link);
+    wl_list_insert(&ws->views, &view->workspace_link);
+    workspace_update_switcher(ws);
+}
+
 void lw_workspace_move_view(struct lw_view *view, struct lw_workspace *ws) {
+    struct lw_server *server = view->server;
+    if (!view->workspace || view->workspace == ws) return;
+
+    struct wlr_surface *surface = view->xdg_toplevel->base->surface;
+    bool focused = server->seat->keyboard_state.focused_surface == surface;
+
+    if (view->is_fullscreen) {
+        lw_view_set_fullscreen(view, false);
+    }
+    struct lw_workspace *old = view->workspace;
+    wl_list_remove(&view->workspace_link);
+    wl_list_insert(&ws->views, &view->workspace_link);
     view->workspace = ws;
+    workspace_update_switcher(old);
+    workspace_update_switcher(ws);
     wlr_scene_node_reparent(&view->scene_tree->node, ws->scene_tree);
+    lw_hit_index_invalidate(server);
+    lw_snapshot_mark_dirty(server);
+    lw_output_damage_all(server);
+    lw_ipc_send_view_state(server, view);
+
+    if (focused && ws != server->active_workspace) {
+        workspace_restore_focus(server);
+    }
+    lw_overview_refresh(server);
 }
 
 struct lw_workspace *lw_workspace_get(struct lw_server *server, int index) {
-    struct lw_workspace *ws;
-    wl_list_for_each(ws, &server->workspaces, link) {
-        if (ws->index == index) return ws;
-    }
-    return NULL;
+    if (index < 0 || index >= server->workspace_count) return NULL;
+    return server->workspaces[index];
 }
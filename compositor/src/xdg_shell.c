@@ -4,8 +4,6 @@
 
 #define _POSIX_C_SOURCE 200112L
 #include <stdlib.h>
-#include <string.h>
-#include <wlr/types/wlr_output_layout.h>
 #include <wlr/types/wlr_scene.h>
 #include <wlr/types/wlr_xdg_shell.h>
 #include <wlr/types/wlr_xdg_decoration_v1.h>
@@ -13,99 +11,81 @@
 
 #include "server.h"
 #include "view.h"
+#include "hit_index.h"
+#include "snapshot.h"
+#include "ipc.h"
 #include "input.h"
+#include "layer_shell.h"
+#include "overview.h"
+#include "snap.h"
+#include "thumbnail.h"
+#include "workspace.h"
 
 static void xdg_toplevel_map(struct wl_listener *listener, void *data) {
     struct lw_view *view = wl_container_of(listener, view, map);
     wl_list_insert(&view->server->views, &view->link);
     view->mapped = true;
-
-    /* Position shell components based on window title.
-     * All shell windows share app_id "lwindesk-shell", so use title
-     * to distinguish them. */
-    const char *title = view->xdg_toplevel->title;
-
-    if (title && strncmp(title, "lwindesk-", 9) == 0) {
-        view->is_shell_window = true;
-
-        struct wlr_box output_box;
-        wlr_output_layout_get_box(view->server->output_layout, NULL,
-                                   &output_box);
-
-        if (strcmp(title, "lwindesk-startmenu") == 0) {
-            /* Start menu: centered, above taskbar */
-            int x = (output_box.width - 640) / 2;
-            int y = output_box.height - 48 - 720 - 12;
-            wlr_scene_node_set_position(&view->scene_tree->node, x, y);
-            view->x = x;
-            view->y = y;
-            wlr_log(WLR_INFO, "Start menu at %d,%d", x, y);
-        } else if (strcmp(title, "lwindesk-notifications") == 0) {
-            /* Notification center: right side, above taskbar */
-            int x = output_box.width - 380 - 12;
-            int y = output_box.height - 48 - 600 - 12;
-            wlr_scene_node_set_position(&view->scene_tree->node, x, y);
-            view->x = x;
-            view->y = y;
-            wlr_log(WLR_INFO, "Notifications at %d,%d", x, y);
-        } else if (strcmp(title, "lwindesk-quicksettings") == 0) {
-            /* Quick settings: right side, above taskbar */
-            int x = output_box.width - 360 - 12;
-            int y = output_box.height - 48 - 400 - 12;
-            wlr_scene_node_set_position(&view->scene_tree->node, x, y);
-            view->x = x;
-            view->y = y;
-            wlr_log(WLR_INFO, "Quick settings at %d,%d", x, y);
-        } else if (strcmp(title, "lwindesk-desktop") == 0) {
-            /* Desktop click surface: fullscreen at origin, behind
-             * all other windows */
-            wlr_scene_node_set_position(&view->scene_tree->node, 0, 0);
-            view->x = 0;
-            view->y = 0;
-            wlr_scene_node_lower_to_bottom(&view->scene_tree->node);
-            wlr_log(WLR_INFO, "Desktop surface at 0,0 (lowered)");
-        } else {
-            /* Default: taskbar at bottom */
-            int y = output_box.height - 48;
-            wlr_scene_node_set_position(&view->scene_tree->node, 0, y);
-            view->x = 0;
-            view->y = y;
-            wlr_log(WLR_INFO, "Shell taskbar at y=%d", y);
-        }
-    } else {
-        /* Non-shell window: create server-side decorations and center */
-        view->is_shell_window = false;
-        lw_view_create_decorations(view);
-
-        /* Center the window on the output */
-        struct wlr_box output_box;
-        wlr_output_layout_get_box(view->server->output_layout, NULL,
-                                   &output_box);
-        struct wlr_box geo;
-        wlr_xdg_surface_get_geometry(view->xdg_toplevel->base, &geo);
-        int win_w = geo.width > 0 ? geo.width : 640;
-        int win_h = geo.height > 0 ? geo.height : 480;
-        int total_h = win_h + (view->deco.has_decorations ? LW_TITLEBAR_HEIGHT : 0);
-        int x = (output_box.width - win_w) / 2;
-        int y = (output_box.height - 48 - total_h) / 2;
-        if (x < 0) x = 0;
-        if (y < 0) y = 0;
-        wlr_scene_node_set_position(&view->scene_tree->node, x, y);
-        view->x = x;
-        view->y = y;
+    lw_hit_index_invalidate(view->server);
+    lw_snapshot_mark_dirty(view->server);
+
+    /* Panels and menus are layer surfaces; every toplevel is a window */
+    lw_view_create_decorations(view);
+
+    /* Center the window in the usable area of the output under the
+     * pointer */
+    struct lw_server *server = view->server;
+    struct wlr_box area;
+    if (!lw_layer_usable_area_at(server, server->cursor->x, server->cursor->y,
+                                 &area)) {
+        area = (struct wlr_box){ .width = 640, .height = 480 };
     }
-
+    struct wlr_box geo;
+    wlr_xdg_surface_get_geometry(view->xdg_toplevel->base, &geo);
+    int win_w = geo.width > 0 ? geo.width : 640;
+    int win_h = geo.height > 0 ? geo.height : 480;
+    int total_h = win_h + (view->deco.has_decorations ? LW_TITLEBAR_HEIGHT : 0);
+    int x = area.x + (area.width - win_w) / 2;
+    int y = area.y + (area.height - total_h) / 2;
+    if (x < area.x) x = area.x;
+    if (y < area.y) y = area.y;
+    wlr_scene_node_set_position(&view->scene_tree->node, x, y);
+    view->x = x;
+    view->y = y;
+
+    lw_workspace_add_view(server->active_workspace, view);
+
+    lw_ipc_send_view_created(server, view);
     lw_view_focus(view);
+
+    if (view->fullscreen_on_map) {
+        view->fullscreen_on_map = false;
+        lw_view_set_fullscreen(view, true);
+    }
 }
 
 static void xdg_toplevel_unmap(struct wl_listener *listener, void *data) {
     struct lw_view *view = wl_container_of(listener, view, unmap);
+    /* Bring back whatever the fullscreen view was hiding */
+    if (view->is_fullscreen) {
+        lw_view_set_fullscreen(view, false);
+    }
     if (view->server->grabbed_view == view) {
         view->server->cursor_mode = LW_CURSOR_PASSTHROUGH;
         view->server->grabbed_view = NULL;
+        if (view->server->pending_snap != LW_SNAP_NONE) {
+            view->server->pending_snap = LW_SNAP_NONE;
+            lw_ipc_send_snap_preview(view->server, LW_SNAP_NONE);
+        }
+        lw_snap_preview_show(view->server, NULL, LW_SNAP_NONE);
     }
+    lw_ipc_send_view_destroyed(view->server, view);
+    lw_thumbnail_view_destroy(view);
     wl_list_remove(&view->link);
     view->mapped = false;
+    lw_workspace_remove_view(view);
+    lw_hit_index_invalidate(view->server);
+    lw_snapshot_mark_dirty(view->server);
+    lw_view_damage(view);
 }
 
 static void xdg_toplevel_commit(struct wl_listener *listener, void *data) {
@@ -114,10 +94,20 @@ static void xdg_toplevel_commit(struct wl_listener *listener, void *data) {
         wlr_xdg_toplevel_set_size(view->xdg_toplevel, 0, 0);
     }
 
-    /* Update decoration size when window geometry changes */
-    if (view->deco.has_decorations) {
+    /* Update decoration size when window geometry changes; while a
+     * resize is in flight only for the size the client acked */
+    bool acked = lw_view_resize_commit(view);
+    if (view->deco.has_decorations && (acked || !view->resize_serial)) {
         lw_view_update_decorations(view);
     }
+
+    /* New content: re-arm frame scheduling on the outputs we cover */
+    if (view->mapped) {
+        lw_view_damage(view);
+        lw_snapshot_mark_dirty(view->server);
+        lw_overview_view_changed(view);
+        lw_thumbnail_view_commit(view);
+    }
 }
 
 static void xdg_toplevel_destroy(struct wl_listener *listener, void *data) {
@@ -128,6 +118,8 @@ static void xdg_toplevel_destroy(struct wl_listener *listener, void *data) {
      * wrapper tree and decoration rects would remain as orphans with
      * dangling data pointers if not cleaned up here. */
     lw_view_destroy_decorations(view);
+    lw_hit_index_invalidate(view->server);
+    lw_snapshot_mark_dirty(view->server);
 
     wl_list_remove(&view->map.link);
     wl_list_remove(&view->unmap.link);
@@ -139,6 +131,9 @@ static void xdg_toplevel_destroy(struct wl_listener *listener, void *data) {
     wl_list_remove(&view->request_minimize.link);
     wl_list_remove(&view->request_fullscreen.link);
     wl_list_remove(&view->set_title.link);
+    wl_list_remove(&view->set_app_id.link);
+    wl_list_remove(&view->ipc_title_link);
+    wl_list_remove(&view->workspace_link);
 
     free(view);
 }
@@ -175,8 +170,15 @@ static void xdg_toplevel_request_minimize(struct wl_listener *listener,
 static void xdg_toplevel_request_fullscreen(struct wl_listener *listener,
                                               void *data) {
     struct lw_view *view = wl_container_of(listener, view, request_fullscreen);
-    /* TODO: implement fullscreen */
-    (void)view;
+    bool fullscreen = view->xdg_toplevel->requested.fullscreen;
+
+    /* Requested before the first map (e.g. games starting fullscreen):
+     * apply once the view has decorations and a position. */
+    if (!view->mapped) {
+        view->fullscreen_on_map = fullscreen;
+        return;
+    }
+    lw_view_set_fullscreen(view, fullscreen);
 }
 
 static void xdg_toplevel_set_title(struct wl_listener *listener, void *data) {
@@ -186,6 +188,18 @@ static void xdg_toplevel_set_title(struct wl_listener *listener, void *data) {
     if (view->deco.has_decorations) {
         lw_view_update_decorations(view);
     }
+    if (view->mapped) {
+        lw_snapshot_mark_dirty(view->server);
+        lw_ipc_send_view_title(view->server, view);
+    }
+}
+
+static void xdg_toplevel_set_app_id(struct wl_listener *listener, void *data) {
+    struct lw_view *view = wl_container_of(listener, view, set_app_id);
+    if (view->mapped) {
+        lw_snapshot_mark_dirty(view->server);
+        lw_ipc_send_view_app_id(view->server, view);
+    }
 }
 
 static void setup_toplevel(struct lw_server *server,
@@ -194,6 +208,7 @@ static void setup_toplevel(struct lw_server *server,
 
     struct lw_view *view = calloc(1, sizeof(*view));
     view->server = server;
+    view->id = ++server->next_view_id;
     view->xdg_toplevel = toplevel;
     view->scene_tree =
         wlr_scene_xdg_surface_create(&server->scene->tree, xdg_surface);
@@ -225,9 +240,11 @@ static void setup_toplevel(struct lw_server *server,
                   &view->request_fullscreen);
     view->set_title.notify = xdg_toplevel_set_title;
     wl_signal_add(&toplevel->events.set_title, &view->set_title);
-
-    /* Assign to active workspace */
-    view->workspace = server->active_workspace;
+    view->set_app_id.notify = xdg_toplevel_set_app_id;
+    wl_signal_add(&toplevel->events.set_app_id, &view->set_app_id);
+    wl_list_init(&view->ipc_title_link);
+    /* Put on the active workspace when it maps */
+    wl_list_init(&view->workspace_link);
 
     wlr_log(WLR_INFO, "New toplevel: %s",
              toplevel->title ? toplevel->title : "(untitled)");
@@ -0,0 +1,424 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * protocol/ipc_protocol.h - Binary IPC protocol between compositor and shell
+ *
+ * Shared by the compositor (C) and the shell (C++).  Every message is an
+ * 8-byte header followed by a fixed payload struct and, for some types,
+ * UTF-8 strings (not NUL-terminated) whose lengths are in the payload.
+ * The size in the header covers everything and is a multiple of
+ * LW_IPC_ALIGN, so a receiver that reads into an aligned buffer can use
+ * each header and payload in place without copying it out.  Integers are
+ * in host byte order: both ends run on the same machine.
+ *
+ * Events flow from the compositor to clients, requests the other way.
+ * Replies to a request are events sent only to the client that asked.
+ * Other events belong to an event class and only reach clients that
+ * SUBSCRIBE to it; a new connection is subscribed to nothing.
+ * On connect the compositor sends HELLO.  Receivers skip messages of an
+ * unknown type (the size says how far) and drop the connection when a
+ * header carries a version they do not speak or an impossible size.
+ */
+
+#ifndef LWINDESK_IPC_PROTOCOL_H
+#define LWINDESK_IPC_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LW_IPC_VERSION 1
+
+/* Message sizes are padded to this; payload fields are at most 8 bytes */
+#define LW_IPC_ALIGN 8
+
+/* Largest message either side sends */
+#define LW_IPC_MAX_MESSAGE 4096
+
+struct lw_ipc_header {
+    uint32_t size;          /* whole message: header, payload, padding */
+    uint16_t type;          /* enum lw_ipc_type */
+    uint8_t version;        /* LW_IPC_VERSION */
+    uint8_t flags;          /* reserved, 0 */
+};
+
+enum lw_ipc_type {
+    /* Compositor -> clients */
+    LW_IPC_EVENT_HELLO = 0x0001,            /* lw_ipc_hello */
+    LW_IPC_EVENT_TOGGLE_START_MENU = 0x0002,
+    LW_IPC_EVENT_SHOW_DESKTOP = 0x0003,
+    LW_IPC_EVENT_CYCLE_WINDOW = 0x0004,     /* no longer sent, see SWITCHER */
+    LW_IPC_EVENT_WORKSPACE = 0x0005,        /* lw_ipc_workspace */
+    LW_IPC_EVENT_VIEW = 0x0006,             /* lw_ipc_view, app_id, title */
+    LW_IPC_EVENT_STATE_DONE = 0x0007,       /* ends a QUERY_STATE reply */
+    LW_IPC_EVENT_FRAME_STATS = 0x0008,      /* lw_ipc_frame_stats, name */
+    LW_IPC_EVENT_FRAME_STATS_DONE = 0x0009,
+    LW_IPC_EVENT_INPUT_STATS = 0x000a,      /* lw_ipc_input_stats */
+    LW_IPC_EVENT_PONG = 0x000b,             /* lw_ipc_ping */
+    LW_IPC_EVENT_QUEUE_STATS = 0x000c,      /* lw_ipc_queue_stats */
+    LW_IPC_EVENT_FOCUS = 0x000d,            /* lw_ipc_view_ref, 0: none */
+    LW_IPC_EVENT_SNAP_PREVIEW = 0x000e,     /* lw_ipc_snap_preview, name */
+    LW_IPC_EVENT_SNAPSHOT = 0x000f,         /* lw_ipc_snapshot_info + fd */
+    LW_IPC_EVENT_SNAPSHOT_CHANGED = 0x0010, /* lw_ipc_snapshot_info */
+    LW_IPC_EVENT_VIEW_CREATED = 0x0011,     /* like VIEW */
+    LW_IPC_EVENT_VIEW_DESTROYED = 0x0012,   /* lw_ipc_view_ref */
+    LW_IPC_EVENT_VIEW_TITLE = 0x0013,       /* lw_ipc_view_string, title */
+    LW_IPC_EVENT_VIEW_APP_ID = 0x0014,      /* lw_ipc_view_string, app_id */
+    LW_IPC_EVENT_VIEW_STATE = 0x0015,       /* lw_ipc_view_state */
+    LW_IPC_EVENT_OVERVIEW = 0x0016,         /* lw_ipc_overview */
+    LW_IPC_EVENT_THUMBNAIL = 0x0017,        /* lw_ipc_thumbnail_info + fd */
+    LW_IPC_EVENT_THUMBNAIL_CHANGED = 0x0018, /* lw_ipc_thumbnail_info */
+    LW_IPC_EVENT_SWITCHER = 0x0019,         /* lw_ipc_switcher, view ids */
+    LW_IPC_EVENT_SWITCHER_SELECT = 0x001a,  /* lw_ipc_switcher_select */
+
+    /* Clients -> compositor */
+    LW_IPC_REQUEST_ACTIVATE_VIEW = 0x0101,  /* lw_ipc_view_ref */
+    LW_IPC_REQUEST_CLOSE_VIEW = 0x0102,     /* lw_ipc_view_ref */
+    LW_IPC_REQUEST_MINIMIZE_VIEW = 0x0103,  /* lw_ipc_view_ref */
+    LW_IPC_REQUEST_SWITCH_WORKSPACE = 0x0104, /* lw_ipc_workspace; index ==
+                                                count creates one */
+    LW_IPC_REQUEST_SHOW_DESKTOP = 0x0105,
+    LW_IPC_REQUEST_QUERY_STATE = 0x0106,    /* -> WORKSPACE, VIEW..., STATE_DONE */
+    LW_IPC_REQUEST_FRAME_STATS = 0x0107,    /* -> FRAME_STATS..., FRAME_STATS_DONE */
+    LW_IPC_REQUEST_INPUT_STATS = 0x0108,    /* -> INPUT_STATS */
+    LW_IPC_REQUEST_PING = 0x0109,           /* lw_ipc_ping -> PONG */
+    LW_IPC_REQUEST_QUEUE_STATS = 0x010a,    /* -> QUEUE_STATS */
+    LW_IPC_REQUEST_SUBSCRIBE = 0x010b,      /* lw_ipc_subscribe */
+    LW_IPC_REQUEST_SNAPSHOT = 0x010c,       /* -> SNAPSHOT */
+    LW_IPC_REQUEST_OVERVIEW = 0x010d,       /* lw_ipc_overview_request */
+    LW_IPC_REQUEST_THUMBNAIL = 0x010e,      /* lw_ipc_view_ref -> THUMBNAIL */
+    LW_IPC_REQUEST_THUMBNAIL_RELEASE = 0x010f, /* lw_ipc_view_ref */
+};
+
+/* Broadcast event classes, for SUBSCRIBE */
+enum lw_ipc_event_class {
+    LW_IPC_CLASS_SHORTCUTS = 1 << 0,    /* TOGGLE_START_MENU, SHOW_DESKTOP */
+    LW_IPC_CLASS_WORKSPACE = 1 << 1,    /* WORKSPACE */
+    LW_IPC_CLASS_FOCUS = 1 << 2,        /* FOCUS */
+    LW_IPC_CLASS_WINDOWS = 1 << 3,      /* VIEW_CREATED, _DESTROYED, _TITLE,
+                                           _APP_ID, _STATE */
+    LW_IPC_CLASS_SNAP = 1 << 4,         /* SNAP_PREVIEW while dragging */
+    LW_IPC_CLASS_SNAPSHOT = 1 << 5,     /* SNAPSHOT_CHANGED */
+    LW_IPC_CLASS_OVERVIEW = 1 << 6,     /* OVERVIEW */
+    LW_IPC_CLASS_THUMBNAILS = 1 << 7,   /* THUMBNAIL_CHANGED */
+    LW_IPC_CLASS_SWITCHER = 1 << 8,     /* SWITCHER, SWITCHER_SELECT */
+    LW_IPC_CLASS_ALL = (1 << 9) - 1,
+};
+
+/* Replaces the client's previous subscription */
+struct lw_ipc_subscribe {
+    uint32_t classes;       /* enum lw_ipc_event_class bits */
+    uint32_t reserved;
+};
+
+struct lw_ipc_hello {
+    uint32_t version;       /* LW_IPC_VERSION of the compositor */
+    uint32_t max_message;   /* largest request the compositor accepts */
+};
+
+/* Active workspace (event) or workspace to switch to (request) */
+struct lw_ipc_workspace {
+    int32_t index;
+    uint32_t count;         /* workspaces that exist; ignored in requests */
+};
+
+struct lw_ipc_view_ref {
+    uint32_t id;
+    uint32_t reserved;
+};
+
+enum lw_ipc_view_flags {
+    LW_IPC_VIEW_FOCUSED = 1 << 0,
+    LW_IPC_VIEW_MINIMIZED = 1 << 1,
+    LW_IPC_VIEW_MAXIMIZED = 1 << 2,
+    LW_IPC_VIEW_FULLSCREEN = 1 << 3,
+};
+
+/* Followed by app_id_len bytes of app_id, then title_len bytes of title */
+struct lw_ipc_view {
+    uint32_t id;            /* stable for the lifetime of the window */
+    uint32_t flags;         /* enum lw_ipc_view_flags */
+    int32_t workspace;      /* index, -1 if none */
+    uint16_t app_id_len;
+    uint16_t title_len;
+};
+
+/*
+ * Window list deltas.  VIEW_CREATED and VIEW_DESTROYED bracket the time
+ * a window is mapped.  Title updates are coalesced to at most one per
+ * view per frame interval; a client that falls behind only ever gets
+ * the latest title, app_id and state of each view.  Focus changes come
+ * as FOCUS, so VIEW_STATE flags never include LW_IPC_VIEW_FOCUSED.
+ */
+struct lw_ipc_view_string {
+    uint32_t id;
+    uint16_t len;           /* bytes that follow */
+    uint16_t reserved;
+};
+
+struct lw_ipc_view_state {
+    uint32_t id;
+    uint32_t flags;         /* enum lw_ipc_view_flags */
+    int32_t workspace;      /* index, -1 if none */
+    uint32_t reserved;
+};
+
+/* Microsecond percentiles from the output's histograms; followed by
+ * name_len bytes of output name */
+struct lw_ipc_frame_stats {
+    uint64_t committed;
+    uint64_t skipped;
+    uint64_t commit_p50, commit_p99, commit_max;
+    uint64_t latency_p50, latency_p99, latency_max;
+    uint64_t present_p50, present_p99, present_max;
+    uint64_t present_count;
+    uint64_t frames_scanout;    /* committed client buffers directly */
+    uint64_t frames_composited;
+    uint16_t name_len;
+    uint8_t scanning_out;       /* 1 if the last frame was scanned out */
+    uint8_t reserved[5];
+};
+
+struct lw_ipc_input_stats {
+    uint64_t motion_events;
+    uint64_t motion_passes;
+};
+
+/* Outbound queue health, summed over all clients since startup.  A
+ * client that stops reading has its state events coalesced in place;
+ * once its queue is full it is disconnected and counted here. */
+struct lw_ipc_queue_stats {
+    uint32_t clients;
+    uint32_t reserved;
+    uint64_t queued_bytes;          /* currently waiting, all clients */
+    uint64_t queue_high_water;      /* deepest single queue seen */
+    uint64_t messages_serialized;   /* one per event, shared by clients */
+    uint64_t messages_queued;       /* one per event per recipient */
+    uint64_t messages_coalesced;
+    uint64_t sendmsg_calls;
+    uint64_t bytes_sent;
+    uint64_t slow_disconnects;
+    uint64_t bytes_dropped;
+};
+
+/* Task View drawn by the compositor.  Sent when it opens, as the
+ * highlighted window changes, and when it closes; the closing event
+ * carries the window that was picked (0 when dismissed). */
+struct lw_ipc_overview {
+    uint32_t visible;
+    uint32_t view_id;       /* highlighted or picked window, 0: none */
+    int32_t workspace;      /* whose windows are shown */
+    uint32_t reserved;
+};
+
+enum lw_ipc_overview_action {
+    LW_IPC_OVERVIEW_HIDE = 0,
+    LW_IPC_OVERVIEW_SHOW = 1,
+    LW_IPC_OVERVIEW_TOGGLE = 2,
+};
+
+struct lw_ipc_overview_request {
+    uint32_t action;        /* enum lw_ipc_overview_action */
+    uint32_t reserved;
+};
+
+/*
+ * Alt+Tab switcher, run by the compositor while Alt is held.  SWITCHER
+ * opens it with the windows of the active workspace as count uint32_t
+ * view ids, most recently focused first, and is sent again if one of
+ * them goes away meanwhile.  Every further Tab only moves the selection
+ * (SWITCHER_SELECT, whose serial matches its SWITCHER).  Releasing Alt
+ * activates the selected window and Escape dismisses the list; either
+ * way SWITCHER comes with visible 0, no ids, and the window that was
+ * activated (0 when dismissed).
+ */
+#define LW_IPC_SWITCHER_MAX 256
+
+struct lw_ipc_switcher {
+    uint32_t visible;
+    uint32_t serial;        /* one per Alt+Tab session */
+    uint32_t count;         /* view ids that follow */
+    int32_t selected;       /* index into them */
+    uint32_t view_id;       /* the window activated, on close */
+    uint32_t reserved;
+};
+
+struct lw_ipc_switcher_select {
+    uint32_t serial;
+    int32_t index;
+    uint32_t view_id;
+    uint32_t reserved;
+};
+
+/* Snap zone under the pointer while a window is dragged; followed by
+ * name_len bytes of zone name ("none" when leaving all zones) */
+struct lw_ipc_snap_preview {
+    int32_t zone;
+    uint16_t name_len;
+    uint16_t reserved;
+};
+
+struct lw_ipc_ping {
+    uint64_t token;         /* echoed back in PONG */
+};
+
+/*
+ * Shared state snapshot.  SNAPSHOT replies carry a read-only memfd
+ * (SCM_RIGHTS) holding one struct lw_ipc_snapshot, which the compositor
+ * rewrites in place whenever window or workspace state changes and then
+ * announces with SNAPSHOT_CHANGED.  Readers map it and copy out what they
+ * need under the seqlock (lw_ipc_snapshot_read_begin/retry); they never
+ * have to ask the compositor.  Strings are truncated to fit and are not
+ * NUL-terminated.  A SNAPSHOT reply with size 0 and no fd means the
+ * compositor has no snapshot; fall back to QUERY_STATE.
+ */
+#define LW_IPC_SNAPSHOT_MAGIC 0x4c57534e    /* "LWSN" */
+#define LW_IPC_SNAPSHOT_MAX_VIEWS 256
+#define LW_IPC_SNAPSHOT_APP_ID_MAX 64
+#define LW_IPC_SNAPSHOT_TITLE_MAX 192
+
+struct lw_ipc_snapshot_info {
+    uint32_t size;          /* bytes to map */
+    uint32_t seq;           /* snapshot sequence when sent */
+};
+
+struct lw_ipc_snapshot_view {
+    uint32_t id;
+    uint32_t flags;         /* enum lw_ipc_view_flags */
+    int32_t workspace;
+    int32_t x, y, width, height;        /* layout coordinates, content */
+    uint16_t app_id_len;
+    uint16_t title_len;
+    char app_id[LW_IPC_SNAPSHOT_APP_ID_MAX];
+    char title[LW_IPC_SNAPSHOT_TITLE_MAX];
+};
+
+struct lw_ipc_snapshot {
+    uint32_t magic;         /* LW_IPC_SNAPSHOT_MAGIC */
+    uint32_t version;       /* LW_IPC_VERSION */
+    uint32_t seq;           /* seqlock: odd while being written */
+    uint32_t view_count;
+    int32_t active_workspace;
+    uint32_t workspace_count;
+    uint32_t focused_view;  /* id, 0 if none */
+    uint32_t reserved;
+    struct lw_ipc_snapshot_view views[LW_IPC_SNAPSHOT_MAX_VIEWS];
+};
+
+/* Start a read: returns the sequence to hand to _retry.  Doesn't wait
+ * for a writer; if one is active _retry fails and the caller decides
+ * how often to try again (a crashed compositor never finishes). */
+static inline uint32_t lw_ipc_snapshot_read_begin(
+        const struct lw_ipc_snapshot *snap) {
+    return __atomic_load_n(&snap->seq, __ATOMIC_ACQUIRE);
+}
+
+/* Whether what was read since _begin may be torn and must be reread */
+static inline int lw_ipc_snapshot_read_retry(
+        const struct lw_ipc_snapshot *snap, uint32_t seq) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (seq & 1) || __atomic_load_n(&snap->seq, __ATOMIC_RELAXED) != seq;
+}
+
+/*
+ * Window thumbnails.  THUMBNAIL asks for a small copy of a window; the
+ * reply carries a read-only memfd (SCM_RIGHTS) holding one struct
+ * lw_ipc_thumbnail followed by the pixels, at most max_width x
+ * max_height, premultiplied ARGB8888 rows of stride bytes.  While
+ * requested, the compositor redraws it in place after the window
+ * changes, no more often than its configured rate, and announces each
+ * update with THUMBNAIL_CHANGED; copy out under the seqlock as with the
+ * snapshot.  THUMBNAIL_RELEASE says it is no longer shown: updates stop
+ * and it is the first to go when the compositor's thumbnail memory
+ * budget runs out.  A THUMBNAIL_CHANGED (or reply) with size 0 means
+ * there is none (window gone, evicted, or not readable): unmap it and
+ * ask again if still needed.  seq 0 means no pixels yet.
+ */
+#define LW_IPC_THUMBNAIL_MAGIC 0x4854574c   /* "LWTH" */
+
+struct lw_ipc_thumbnail_info {
+    uint32_t view_id;
+    uint32_t size;          /* bytes to map, 0: no thumbnail */
+    uint32_t seq;           /* thumbnail sequence when sent */
+    uint32_t reserved;
+};
+
+struct lw_ipc_thumbnail {
+    uint32_t magic;         /* LW_IPC_THUMBNAIL_MAGIC */
+    uint32_t version;       /* LW_IPC_VERSION */
+    uint32_t seq;           /* seqlock: odd while being written */
+    uint32_t view_id;
+    uint32_t width, height; /* of the current image */
+    uint32_t stride;        /* bytes per row */
+    uint32_t format;        /* DRM_FORMAT_ARGB8888, premultiplied */
+    uint32_t max_width, max_height;
+    uint32_t reserved[6];
+    /* pixels follow */
+};
+
+/* Seqlock readers for the thumbnail header and pixels */
+static inline uint32_t lw_ipc_thumbnail_read_begin(
+        const struct lw_ipc_thumbnail *thumb) {
+    return __atomic_load_n(&thumb->seq, __ATOMIC_ACQUIRE);
+}
+
+static inline int lw_ipc_thumbnail_read_retry(
+        const struct lw_ipc_thumbnail *thumb, uint32_t seq) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (seq & 1) ||
+        __atomic_load_n(&thumb->seq, __ATOMIC_RELAXED) != seq;
+}
+
+/*
+ * Event traces, written by the compositor when LWINDESK_IPC_TRACE names
+ * a file: one lw_ipc_trace_header, then per broadcast event one
+ * lw_ipc_trace_record followed by the message exactly as sent (size
+ * bytes, a multiple of LW_IPC_ALIGN, so records stay aligned).
+ * lwindesk-ipc-replay plays them back to the shell.
+ */
+#define LW_IPC_TRACE_MAGIC 0x5254574c       /* "LWTR" */
+
+struct lw_ipc_trace_header {
+    uint32_t magic;         /* LW_IPC_TRACE_MAGIC */
+    uint32_t version;       /* LW_IPC_VERSION of the recorded messages */
+    uint64_t reserved;
+};
+
+struct lw_ipc_trace_record {
+    uint64_t time_ns;       /* CLOCK_MONOTONIC, since the trace started */
+    uint32_t size;          /* message bytes that follow */
+    uint32_t reserved;
+};
+
+/* Size on the wire of a message with body_size bytes after the header */
+static inline uint32_t lw_ipc_message_size(size_t body_size) {
+    return (uint32_t)((sizeof(struct lw_ipc_header) + body_size +
+                       LW_IPC_ALIGN - 1) & ~(size_t)(LW_IPC_ALIGN - 1));
+}
+
+/* Whether a header is sane enough to frame the stream by; max_size is
+ * the most the receiver is prepared to buffer */
+static inline int lw_ipc_header_valid(const struct lw_ipc_header *header,
+                                      uint32_t max_size) {
+    return header->version == LW_IPC_VERSION &&
+        header->size >= sizeof(struct lw_ipc_header) &&
+        header->size <= max_size &&
+        header->size % LW_IPC_ALIGN == 0;
+}
+
+/* Payload of a complete message, or NULL if it is shorter than size */
+static inline const void *lw_ipc_payload(const struct lw_ipc_header *header,
+                                         size_t size) {
+    if (header->size - sizeof(struct lw_ipc_header) < size) return NULL;
+    return header + 1;
+}
+
+/* Bytes after the fixed payload struct, where the strings live */
+static inline const char *lw_ipc_tail(const struct lw_ipc_header *header,
+                                      size_t fixed_size, size_t tail_size) {
+    size_t body = header->size - sizeof(struct lw_ipc_header);
+    if (body < fixed_size || body - fixed_size < tail_size) return NULL;
+    return (const char *)(header + 1) + fixed_size;
+}
+
+#endif /* LWINDESK_IPC_PROTOCOL_H */
@@ -4,17 +4,18 @@ import LWinDesk
 
 /*
  * Main shell window - a 48px taskbar anchored to the bottom of the screen.
- * Start menu and panels open as child windows above the taskbar.
+ * Start menu and panels open as child windows above the taskbar.  All of
+ * them are layer surfaces, set up by title in main.cpp, which also shows
+ * the windows marked shownAtStart once that is done.
  */
 Window {
     id: root
-    visible: true
+    property bool shownAtStart: true
+    visible: false
     width: Screen.width > 0 ? Screen.width : 1920
     height: 48
-    x: 0
-    y: (Screen.height > 0 ? Screen.height : 1080) - 48
     color: "transparent"
-    flags: Qt.FramelessWindowHint | Qt.WindowStaysOnTopHint
+    flags: Qt.FramelessWindowHint
     title: "lwindesk-taskbar"
 
     /* Taskbar fills the window */
@@ -76,14 +77,35 @@ Window {
         }
     }
 
-    /* Desktop click surface - fullscreen transparent window behind all other
-     * windows but above the wallpaper.  Catches right-click to show the
-     * desktop context menu. */
+    /* Alt+Tab switcher window; sized before it maps, centered on the
+     * overlay layer without keyboard focus */
+    Window {
+        id: switcherWindow
+        visible: shellManager.switcherVisible
+        width: Math.min(shellManager.switcherEntries.length * 168 + 24,
+                        (Screen.width > 0 ? Screen.width : 1920) - 96)
+        height: 152
+        color: "transparent"
+        flags: Qt.FramelessWindowHint
+        title: "lwindesk-switcher"
+
+        Loader {
+            active: shellManager.switcherVisible
+            source: "switcher/WindowSwitcher.qml"
+            anchors.fill: parent
+        }
+    }
+
+    /* Desktop click surface - transparent window on the bottom layer,
+     * behind all other windows but above the wallpaper, sized by the
+     * compositor to the area the taskbar leaves.  Catches right-click to
+     * show the desktop context menu. */
     Window {
         id: desktopWindow
-        visible: true
+        property bool shownAtStart: true
+        visible: false
         width: Screen.width > 0 ? Screen.width : 1920
-        height: (Screen.height > 0 ? Screen.height : 1080) - 48  // above taskbar
+        height: (Screen.height > 0 ? Screen.height : 1080) - 48
         color: "transparent"
         flags: Qt.FramelessWindowHint
         title: "lwindesk-desktop"
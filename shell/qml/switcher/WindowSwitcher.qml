@@ -0,0 +1,62 @@
+import QtQuick
+import "../common"
+
+/* Windows 11 Alt+Tab switcher.  The compositor holds the session and
+ * sends the list; this only shows it and the selection. */
+LWPanel {
+    id: switcher
+    color: Qt.rgba(0.12, 0.12, 0.12, 0.95)
+
+    readonly property int tileWidth: 160
+    readonly property int tileHeight: 120
+
+    ListView {
+        id: list
+        anchors.fill: parent
+        anchors.margins: 16
+        orientation: ListView.Horizontal
+        spacing: 8
+        interactive: false
+        model: shellManager.switcherEntries
+        currentIndex: shellManager.switcherIndex
+        highlightMoveDuration: 0
+
+        delegate: Rectangle {
+            width: switcher.tileWidth
+            height: switcher.tileHeight
+            radius: 6
+            color: ListView.isCurrentItem ? Qt.rgba(1, 1, 1, 0.12) :
+                                            "transparent"
+            border.color: ListView.isCurrentItem ? "#60CDFF" : "transparent"
+            border.width: 2
+
+            Image {
+                anchors.horizontalCenter: parent.horizontalCenter
+                anchors.top: parent.top
+                anchors.topMargin: 24
+                width: 48
+                height: 48
+                sourceSize: Qt.size(width, height)
+                source: modelData.iconName.length > 0 ?
+                    "image://icon/" + modelData.iconName :
+                    "image://icon/application-x-executable"
+                opacity: modelData.minimized ? 0.6 : 1.0
+                smooth: true
+            }
+
+            Text {
+                anchors.left: parent.left
+                anchors.right: parent.right
+                anchors.bottom: parent.bottom
+                anchors.margins: 10
+                horizontalAlignment: Text.AlignHCenter
+                text: modelData.title.length > 0 ? modelData.title :
+                                                   modelData.appId
+                elide: Text.ElideRight
+                color: "white"
+                font.pixelSize: 12
+                font.family: "Selawik"
+            }
+        }
+    }
+}
@@ -97,6 +97,14 @@ LWPanel {
             }
         }
 
+        /* Task View button */
+        TaskbarButton {
+            iconSource: "image://icon/view-grid-symbolic?color=white"
+            tooltip: "Task View"
+            active: shellManager.overviewVisible
+            onClicked: shellManager.toggleOverview()
+        }
+
         /* Terminal button */
         TaskbarButton {
             iconSource: "image://icon/utilities-terminal-symbolic?color=white"
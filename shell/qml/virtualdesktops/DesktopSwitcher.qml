@@ -20,7 +20,7 @@ LWPanel {
             spacing: 16
 
             Repeater {
-                model: 3
+                model: shellManager.workspaceCount
                 delegate: Rectangle {
                     width: 200
                     height: 120
@@ -32,12 +32,27 @@ LWPanel {
                         "#0078D4" : "transparent"
                     border.width: 2
 
-                    Text {
+                    Column {
                         anchors.centerIn: parent
-                        text: "Desktop " + (index + 1)
-                        color: "white"
-                        font.pixelSize: 13
-                        font.family: "Selawik"
+                        spacing: 4
+
+                        Text {
+                            anchors.horizontalCenter: parent.horizontalCenter
+                            text: "Desktop " + (index + 1)
+                            color: "white"
+                            font.pixelSize: 13
+                            font.family: "Selawik"
+                        }
+
+                        Text {
+                            property int windows:
+                                shellManager.workspaceWindowCounts[index] || 0
+                            anchors.horizontalCenter: parent.horizontalCenter
+                            text: windows === 1 ? "1 window" : windows + " windows"
+                            color: Qt.rgba(1, 1, 1, 0.6)
+                            font.pixelSize: 11
+                            font.family: "Selawik"
+                        }
                     }
 
                     MouseArea {
@@ -64,6 +79,14 @@ LWPanel {
                     font.pixelSize: 13
                     font.family: "Selawik"
                 }
+
+                /* The compositor creates a desktop when asked to switch
+                 * one past the last */
+                MouseArea {
+                    anchors.fill: parent
+                    onClicked: shellManager.switchWorkspace(
+                        shellManager.workspaceCount)
+                }
             }
         }
 
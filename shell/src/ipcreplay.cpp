@@ -0,0 +1,500 @@
+/*
+ * lwindesk - shell/src/ipcreplay.cpp - Replay a compositor IPC trace
+ *
+ * Stands in for the compositor: listens on a private IPC socket, lets a
+ * real ShellManager connect, answers its startup requests (no snapshot,
+ * empty state) and then writes the events of a trace recorded with
+ * LWINDESK_IPC_TRACE, at the recorded pace or faster.  For every event it
+ * measures the time from the write to ShellManager having handled it,
+ * and for events that change what QML binds to (the start menu toggle,
+ * workspace, snap preview, taskbar model), the time to that change.
+ *
+ * Usage: lwindesk-ipc-replay [-s speed] [-r repeat] [-o report.json] trace
+ *   speed 1 replays in real time (default), 10 ten times faster, 0 as
+ *   fast as the shell takes them.  repeat plays the trace that many
+ *   times back to back, e.g. to turn a short trace into a burst of 100k
+ *   events with -s 0.
+ */
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "ipc_protocol.h"
+#include "shellmanager.h"
+
+/* HELLO and the STATE_DONE answering QUERY_STATE come before the trace */
+static constexpr quint64 kStartupMessages = 2;
+
+/* Give up when the shell makes no progress for this long */
+static constexpr int kStallTimeoutMs = 5000;
+
+struct TraceEvent {
+    quint64 timeNs;
+    quint16 type;
+    QByteArray message;
+};
+
+/* Per event type results */
+struct TypeStats {
+    std::vector<quint64> handledUs;
+    std::vector<quint64> reactionUs;
+};
+
+struct Replay {
+    std::vector<TraceEvent> events;
+    double speed = 1.0;
+    int repeat = 1;
+    int listenFd = -1;
+
+    /* Written by the feeder before each event goes out; sent publishes */
+    std::vector<qint64> sentNs;
+    std::atomic<size_t> sent{0};
+    std::atomic<bool> feederDone{false};
+    std::atomic<bool> feederFailed{false};
+    std::atomic<bool> stop{false};
+
+    /* GUI thread only */
+    quint64 handled = 0;             /* messages ShellManager dispatched */
+    qint64 finishedNs = 0;           /* when the last event was handled */
+    std::vector<bool> reacted;
+    std::map<quint16, TypeStats> stats;
+};
+
+static qint64 nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const char *typeName(quint16 type) {
+    switch (type) {
+    case LW_IPC_EVENT_HELLO:             return "hello";
+    case LW_IPC_EVENT_TOGGLE_START_MENU: return "toggle_start_menu";
+    case LW_IPC_EVENT_SHOW_DESKTOP:      return "show_desktop";
+    case LW_IPC_EVENT_CYCLE_WINDOW:      return "cycle_window";
+    case LW_IPC_EVENT_WORKSPACE:         return "workspace";
+    case LW_IPC_EVENT_VIEW:              return "view";
+    case LW_IPC_EVENT_STATE_DONE:        return "state_done";
+    case LW_IPC_EVENT_FOCUS:             return "focus";
+    case LW_IPC_EVENT_SNAP_PREVIEW:      return "snap_preview";
+    case LW_IPC_EVENT_SNAPSHOT_CHANGED:  return "snapshot_changed";
+    case LW_IPC_EVENT_VIEW_CREATED:      return "view_created";
+    case LW_IPC_EVENT_VIEW_DESTROYED:    return "view_destroyed";
+    case LW_IPC_EVENT_VIEW_TITLE:        return "view_title";
+    case LW_IPC_EVENT_VIEW_APP_ID:       return "view_app_id";
+    case LW_IPC_EVENT_VIEW_STATE:        return "view_state";
+    case LW_IPC_EVENT_OVERVIEW:          return "overview";
+    case LW_IPC_EVENT_THUMBNAIL_CHANGED: return "thumbnail_changed";
+    case LW_IPC_EVENT_SWITCHER:          return "switcher";
+    case LW_IPC_EVENT_SWITCHER_SELECT:   return "switcher_select";
+    default:                             return nullptr;
+    }
+}
+
+static bool loadTrace(const QString &path, std::vector<TraceEvent> &events) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "ipc-replay: %s: %s\n", qPrintable(path),
+                qPrintable(file.errorString()));
+        return false;
+    }
+
+    lw_ipc_trace_header header;
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) !=
+            qint64(sizeof(header)) ||
+        header.magic != LW_IPC_TRACE_MAGIC ||
+        header.version != LW_IPC_VERSION) {
+        fprintf(stderr, "ipc-replay: %s is not a version %u IPC trace\n",
+                qPrintable(path), LW_IPC_VERSION);
+        return false;
+    }
+
+    lw_ipc_trace_record record;
+    while (file.read(reinterpret_cast<char *>(&record), sizeof(record)) ==
+           qint64(sizeof(record))) {
+        TraceEvent event;
+        event.timeNs = record.time_ns;
+        event.message = file.read(record.size);
+        lw_ipc_header msg;
+        if (event.message.size() != qsizetype(record.size) ||
+            record.size < sizeof(msg)) {
+            fprintf(stderr, "ipc-replay: truncated trace\n");
+            return false;
+        }
+        memcpy(&msg, event.message.constData(), sizeof(msg));
+        if (!lw_ipc_header_valid(&msg, LW_IPC_MAX_MESSAGE) ||
+            msg.size != record.size) {
+            fprintf(stderr, "ipc-replay: bad message in trace\n");
+            return false;
+        }
+        event.type = msg.type;
+        events.push_back(std::move(event));
+    }
+    return true;
+}
+
+/* Append repeat - 1 more copies of the trace, each starting where the
+ * previous one ended */
+static void repeatTrace(std::vector<TraceEvent> &events, int repeat) {
+    if (events.empty() || repeat <= 1) return;
+    const size_t count = events.size();
+    const quint64 span = events.back().timeNs;
+    events.reserve(count * size_t(repeat));
+    for (int r = 1; r < repeat; r++) {
+        for (size_t i = 0; i < count; i++) {
+            TraceEvent event = events[i];
+            event.timeNs += span * quint64(r);
+            events.push_back(std::move(event));
+        }
+    }
+}
+
+/* --- Feeder thread: the fake compositor end of the socket --- */
+
+static bool writeAll(int fd, const void *data, size_t len) {
+    const char *p = static_cast<const char *>(data);
+    while (len > 0) {
+        const ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= size_t(n);
+    }
+    return true;
+}
+
+static bool writeMessage(int fd, quint16 type, const void *payload = nullptr,
+                         size_t size = 0) {
+    alignas(LW_IPC_ALIGN) char buf[64] = {};
+    const quint32 msgSize = lw_ipc_message_size(size);
+    lw_ipc_header header = {msgSize, type, LW_IPC_VERSION, 0};
+    memcpy(buf, &header, sizeof(header));
+    if (size) memcpy(buf + sizeof(header), payload, size);
+    return writeAll(fd, buf, msgSize);
+}
+
+static bool waitReadable(int fd, int timeoutMs) {
+    pollfd pfd = {fd, POLLIN, 0};
+    return poll(&pfd, 1, timeoutMs) == 1;
+}
+
+/* Read requests from fd and answer what the shell asks at startup.
+ * Returns false on EOF or error; sets stateDone on QUERY_STATE. */
+static bool serveRequests(int fd, bool &stateDone) {
+    alignas(LW_IPC_ALIGN) char buf[LW_IPC_MAX_MESSAGE];
+    const ssize_t n = read(fd, buf, sizeof(buf));
+    if (n <= 0) return false;
+
+    /* Requests are tiny and the shell writes each with one write() */
+    ssize_t start = 0;
+    while (n - start >= ssize_t(sizeof(lw_ipc_header))) {
+        const auto *header = reinterpret_cast<const lw_ipc_header *>(
+            buf + start);
+        if (!lw_ipc_header_valid(header, LW_IPC_MAX_MESSAGE) ||
+            ssize_t(header->size) > n - start)
+            return false;
+        if (header->type == LW_IPC_REQUEST_SNAPSHOT) {
+            lw_ipc_snapshot_info info = {0, 0};
+            writeMessage(fd, LW_IPC_EVENT_SNAPSHOT, &info, sizeof(info));
+        } else if (header->type == LW_IPC_REQUEST_QUERY_STATE) {
+            writeMessage(fd, LW_IPC_EVENT_STATE_DONE);
+            stateDone = true;
+        }
+        start += header->size;
+    }
+    return true;
+}
+
+/* Accept the shell's connection and walk it through HELLO, SUBSCRIBE,
+ * the snapshot attempt and QUERY_STATE */
+static int serveStartup(Replay *replay) {
+    if (!waitReadable(replay->listenFd, kStallTimeoutMs)) return -1;
+    const int fd = accept(replay->listenFd, nullptr, nullptr);
+    if (fd < 0) return -1;
+
+    lw_ipc_hello hello = {LW_IPC_VERSION, LW_IPC_MAX_MESSAGE};
+    writeMessage(fd, LW_IPC_EVENT_HELLO, &hello, sizeof(hello));
+
+    bool stateDone = false;
+    while (!stateDone && !replay->stop.load()) {
+        pollfd pfds[2] = {{replay->listenFd, POLLIN, 0}, {fd, POLLIN, 0}};
+        if (poll(pfds, 2, kStallTimeoutMs) <= 0) break;
+
+        if (pfds[0].revents & POLLIN) {
+            /* StateSnapshot's one-shot handshake connection */
+            const int other = accept(replay->listenFd, nullptr, nullptr);
+            if (other >= 0) {
+                bool ignored = false;
+                writeMessage(other, LW_IPC_EVENT_HELLO, &hello,
+                             sizeof(hello));
+                if (waitReadable(other, kStallTimeoutMs))
+                    serveRequests(other, ignored);
+                close(other);
+            }
+        }
+        if ((pfds[1].revents & (POLLIN | POLLHUP)) &&
+            !serveRequests(fd, stateDone))
+            break;
+    }
+    if (!stateDone) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void feed(Replay *replay) {
+    const int fd = serveStartup(replay);
+    if (fd < 0) {
+        fprintf(stderr, "ipc-replay: shell never finished connecting\n");
+        replay->feederFailed.store(true);
+        replay->feederDone.store(true);
+        return;
+    }
+
+    const qint64 start = nowNs();
+    for (size_t i = 0; i < replay->events.size(); i++) {
+        if (replay->stop.load()) break;
+        const TraceEvent &event = replay->events[i];
+
+        if (replay->speed > 0) {
+            const qint64 due = start + qint64(event.timeNs / replay->speed);
+            const qint64 wait = due - nowNs();
+            if (wait > 0)
+                std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+        }
+        replay->sentNs[i] = nowNs();
+        replay->sent.store(i + 1, std::memory_order_release);
+        if (!writeAll(fd, event.message.constData(), event.message.size())) {
+            fprintf(stderr, "ipc-replay: shell hung up\n");
+            replay->feederFailed.store(true);
+            break;
+        }
+    }
+    replay->feederDone.store(true);
+
+    /* Keep the connection up until the shell has read everything */
+    while (!replay->stop.load())
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    close(fd);
+}
+
+/* --- GUI side: timing ShellManager --- */
+
+/* Event index of the message ShellManager is handling right now, or -1
+ * for the startup messages */
+static qint64 currentEvent(const Replay *replay) {
+    if (replay->handled < kStartupMessages) return -1;
+    const quint64 index = replay->handled - kStartupMessages;
+    if (index >= replay->sent.load(std::memory_order_acquire)) return -1;
+    return qint64(index);
+}
+
+static void onReaction(Replay *replay) {
+    const qint64 index = currentEvent(replay);
+    if (index < 0 || replay->reacted[index]) return;
+    replay->reacted[index] = true;
+    const qint64 elapsed = nowNs() - replay->sentNs[index];
+    replay->stats[replay->events[index].type].reactionUs.push_back(
+        quint64(qMax<qint64>(elapsed, 0) / 1000));
+}
+
+static void onHandled(Replay *replay) {
+    const qint64 index = currentEvent(replay);
+    replay->handled++;
+    if (index < 0) return;
+    if (size_t(index) + 1 == replay->events.size()) replay->finishedNs = nowNs();
+    const qint64 elapsed = nowNs() - replay->sentNs[index];
+    replay->stats[replay->events[index].type].handledUs.push_back(
+        quint64(qMax<qint64>(elapsed, 0) / 1000));
+}
+
+static quint64 percentile(std::vector<quint64> &values, int p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    const size_t rank = (values.size() * p + 99) / 100;
+    return values[rank ? rank - 1 : 0];
+}
+
+static void printLatency(FILE *out, const char *name,
+                         std::vector<quint64> &values) {
+    fprintf(out, "\"%s\": {\"p50\": %llu, \"p90\": %llu, \"p99\": %llu, "
+            "\"max\": %llu}", name,
+            (unsigned long long)percentile(values, 50),
+            (unsigned long long)percentile(values, 90),
+            (unsigned long long)percentile(values, 99),
+            (unsigned long long)percentile(values, 100));
+}
+
+static void printReport(Replay *replay, FILE *out, bool ok) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"ok\": %s,\n", ok ? "true" : "false");
+    fprintf(out, "  \"events\": %zu,\n", replay->events.size());
+    fprintf(out, "  \"handled\": %llu,\n",
+            (unsigned long long)(replay->handled > kStartupMessages ?
+                replay->handled - kStartupMessages : 0));
+    fprintf(out, "  \"speed\": %g,\n", replay->speed);
+    fprintf(out, "  \"repeat\": %d,\n", replay->repeat);
+    fprintf(out, "  \"elapsed_us\": %lld,\n",
+            replay->finishedNs && !replay->sentNs.empty() ?
+                (long long)(replay->finishedNs - replay->sentNs[0]) / 1000 :
+                0LL);
+    fprintf(out, "  \"types\": {\n");
+
+    bool first = true;
+    for (auto &[type, stats] : replay->stats) {
+        if (stats.handledUs.empty()) continue;
+        const char *name = typeName(type);
+        char fallback[16];
+        if (!name) {
+            snprintf(fallback, sizeof(fallback), "0x%04x", type);
+            name = fallback;
+        }
+        fprintf(out, "%s    \"%s\": {\"count\": %zu, \"reactions\": %zu, ",
+                first ? "" : ",\n", name, stats.handledUs.size(),
+                stats.reactionUs.size());
+        printLatency(out, "handled_us", stats.handledUs);
+        fprintf(out, ", ");
+        printLatency(out, "reaction_us", stats.reactionUs);
+        fprintf(out, "}");
+        first = false;
+    }
+    fprintf(out, "\n  }\n}\n");
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-s speed] [-r repeat] [-o report.json] "
+            "trace\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    Replay replay;
+    const char *outPath = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:o:h")) != -1) {
+        switch (opt) {
+        case 's':
+            replay.speed = atof(optarg);
+            break;
+        case 'r':
+            replay.repeat = atoi(optarg);
+            break;
+        case 'o':
+            outPath = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc - 1 || replay.speed < 0 || replay.repeat < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    QCoreApplication app(argc, argv);
+    if (!loadTrace(QString::fromLocal8Bit(argv[optind]), replay.events))
+        return 1;
+    repeatTrace(replay.events, replay.repeat);
+    replay.sentNs.resize(replay.events.size());
+    replay.reacted.resize(replay.events.size());
+
+    /* ShellManager finds the socket through XDG_RUNTIME_DIR */
+    QTemporaryDir runtimeDir;
+    if (!runtimeDir.isValid()) {
+        fprintf(stderr, "ipc-replay: no temporary directory\n");
+        return 1;
+    }
+    qputenv("XDG_RUNTIME_DIR", QFile::encodeName(runtimeDir.path()));
+
+    const QByteArray socketPath =
+        QFile::encodeName(runtimeDir.filePath(QStringLiteral("lwindesk-ipc")));
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (size_t(socketPath.size()) >= sizeof(addr.sun_path)) return 1;
+    memcpy(addr.sun_path, socketPath.constData(), socketPath.size());
+    replay.listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (replay.listenFd < 0 ||
+        bind(replay.listenFd, reinterpret_cast<sockaddr *>(&addr),
+             sizeof(addr)) < 0 ||
+        listen(replay.listenFd, 4) < 0) {
+        fprintf(stderr, "ipc-replay: %s: %s\n", socketPath.constData(),
+                strerror(errno));
+        return 1;
+    }
+    std::thread feeder(feed, &replay);
+
+    ShellManager shell;
+    const auto react = [&replay] { onReaction(&replay); };
+    QObject::connect(&shell, &ShellManager::ipcMessageHandled,
+                     [&replay] { onHandled(&replay); });
+    QObject::connect(&shell, &ShellManager::startMenuVisibleChanged, react);
+    QObject::connect(&shell, &ShellManager::activeWorkspaceChanged, react);
+    QObject::connect(&shell, &ShellManager::snapZoneChanged, react);
+    QObject::connect(shell.taskbarModel(), &QAbstractItemModel::modelReset,
+                     react);
+    QObject::connect(shell.taskbarModel(), &QAbstractItemModel::dataChanged,
+                     react);
+    QObject::connect(shell.taskbarModel(), &QAbstractItemModel::rowsInserted,
+                     react);
+    QObject::connect(shell.taskbarModel(), &QAbstractItemModel::rowsRemoved,
+                     react);
+
+    /* Done when every event has been handled; fail if progress stops */
+    bool ok = false;
+    quint64 lastHandled = 0;
+    qint64 lastProgress = nowNs();
+    QTimer watchdog;
+    QObject::connect(&watchdog, &QTimer::timeout, [&] {
+        if (replay.feederDone.load() &&
+            replay.handled >= kStartupMessages + replay.events.size()) {
+            ok = !replay.feederFailed.load();
+            app.quit();
+            return;
+        }
+        if (replay.handled != lastHandled) {
+            lastHandled = replay.handled;
+            lastProgress = nowNs();
+        } else if (replay.feederFailed.load() ||
+                   nowNs() - lastProgress > kStallTimeoutMs * 1000000LL) {
+            fprintf(stderr, "ipc-replay: shell stalled after %llu messages\n",
+                    (unsigned long long)replay.handled);
+            app.quit();
+        }
+    });
+    watchdog.start(10);
+    app.exec();
+
+    replay.stop.store(true);
+    feeder.join();
+    close(replay.listenFd);
+
+    FILE *out = outPath ? fopen(outPath, "w") : stdout;
+    if (!out) {
+        perror(outPath);
+        out = stdout;
+    }
+    printReport(&replay, out, ok);
+    if (out != stdout) fclose(out);
+    return ok ? 0 : 1;
+}
@@ -7,6 +7,9 @@
 #include <QQmlContext>
 #include <QQuickStyle>
 #include <QIcon>
+#include <QMargins>
+#include <QWindow>
+#include <LayerShellQt/Window>
 
 #include "shellmanager.h"
 #include "taskbarmodel.h"
@@ -15,6 +18,54 @@
 #include "systemtraymanager.h"
 #include "iconprovider.h"
 
+/*
+ * Every shell window is a wlr-layer-shell surface: the compositor places
+ * it from its anchors and layer and keeps windows out of the taskbar's
+ * exclusive zone.  This has to happen before a window is first shown.
+ */
+static void setupLayerSurface(QWindow *window) {
+    using LayerShellQt::Window;
+    Window *layer = Window::get(window);
+    if (!layer) return;
+
+    const QString title = window->title();
+    layer->setScope(title);
+    layer->setExclusiveZone(0);
+    layer->setKeyboardInteractivity(Window::KeyboardInteractivityOnDemand);
+
+    if (title == QLatin1String("lwindesk-taskbar")) {
+        layer->setLayer(Window::LayerTop);
+        layer->setAnchors(Window::Anchors(Window::AnchorBottom) |
+                          Window::AnchorLeft | Window::AnchorRight);
+        layer->setExclusiveZone(window->height());
+        /* Clicking a task button must not take focus from its window */
+        layer->setKeyboardInteractivity(Window::KeyboardInteractivityNone);
+    } else if (title == QLatin1String("lwindesk-startmenu")) {
+        /* Centered above the taskbar */
+        layer->setLayer(Window::LayerTop);
+        layer->setAnchors(Window::Anchors(Window::AnchorBottom));
+        layer->setMargins(QMargins(0, 0, 0, 12));
+    } else if (title == QLatin1String("lwindesk-notifications") ||
+               title == QLatin1String("lwindesk-quicksettings")) {
+        /* Bottom right, above the taskbar */
+        layer->setLayer(Window::LayerTop);
+        layer->setAnchors(Window::Anchors(Window::AnchorBottom) |
+                          Window::AnchorRight);
+        layer->setMargins(QMargins(0, 0, 12, 12));
+    } else if (title == QLatin1String("lwindesk-switcher")) {
+        /* Centered over everything; the compositor keeps the keyboard */
+        layer->setLayer(Window::LayerOverlay);
+        layer->setAnchors(Window::Anchors(Window::AnchorNone));
+        layer->setKeyboardInteractivity(Window::KeyboardInteractivityNone);
+    } else if (title == QLatin1String("lwindesk-desktop")) {
+        /* Behind the windows, filling what the taskbar leaves */
+        layer->setLayer(Window::LayerBottom);
+        layer->setAnchors(Window::Anchors(Window::AnchorTop) |
+                          Window::AnchorBottom | Window::AnchorLeft |
+                          Window::AnchorRight);
+    }
+}
+
 int main(int argc, char *argv[]) {
     QGuiApplication app(argc, argv);
     app.setApplicationName("lwindesk-shell");
@@ -42,6 +93,8 @@ int main(int argc, char *argv[]) {
     /* Create shell manager (handles IPC with compositor) */
     ShellManager shellManager;
     engine.rootContext()->setContextProperty("shellManager", &shellManager);
+    engine.rootContext()->setContextProperty("taskbarModel",
+                                             shellManager.taskbarModel());
 
     const QUrl url(QStringLiteral("qrc:/LWinDesk/qml/Main.qml"));
     engine.load(url);
@@ -51,5 +104,19 @@ int main(int argc, char *argv[]) {
         return -1;
     }
 
+    /* Main.qml leaves the always-visible windows hidden until this ran */
+    for (QObject *object : engine.rootObjects()) {
+        auto *root = qobject_cast<QWindow *>(object);
+        if (!root) continue;
+        QList<QWindow *> windows = root->findChildren<QWindow *>();
+        windows.prepend(root);
+        for (QWindow *window : windows) {
+            setupLayerSurface(window);
+        }
+        for (QWindow *window : windows) {
+            if (window->property("shownAtStart").toBool()) window->show();
+        }
+    }
+
     return app.exec();
 }
@@ -4,10 +4,14 @@
 
 #include "shellmanager.h"
 #include <QProcess>
+#include <QSocketNotifier>
 #include <QTimer>
 #include <QDateTime>
 #include <QStandardPaths>
 #include <QDir>
+#include <QVariantMap>
+
+#include <cstring>
 
 ShellManager::ShellManager(QObject *parent)
     : QObject(parent) {
@@ -16,6 +20,14 @@ ShellManager::ShellManager(QObject *parent)
     connect(m_clockTimer, &QTimer::timeout, this, &ShellManager::currentTimeChanged);
     m_clockTimer->start(1000);
 
+    m_taskbarModel = new TaskbarModel(this);
+    connect(m_taskbarModel, &TaskbarModel::activateRequested,
+            this, &ShellManager::activateView);
+    connect(m_taskbarModel, &TaskbarModel::closeRequested,
+            this, &ShellManager::closeView);
+    connect(m_taskbarModel, &TaskbarModel::minimizeRequested,
+            this, &ShellManager::minimizeView);
+
     /* Set up IPC socket to compositor */
     m_ipcSocket = new QLocalSocket(this);
     connect(m_ipcSocket, &QLocalSocket::connected,
@@ -33,6 +45,13 @@ ShellManager::ShellManager(QObject *parent)
     connect(m_reconnectTimer, &QTimer::timeout,
             this, &ShellManager::connectToCompositor);
 
+    /* Snapshot handshakes that take longer fall back to QUERY_STATE */
+    m_snapshotTimer = new QTimer(this);
+    m_snapshotTimer->setSingleShot(true);
+    m_snapshotTimer->setInterval(1000);
+    connect(m_snapshotTimer, &QTimer::timeout,
+            this, &ShellManager::onSnapshotTimeout);
+
     /* Connect to compositor IPC on startup */
     connectToCompositor();
 }
@@ -82,13 +101,36 @@ void ShellManager::setQuickSettingsVisible(bool visible) {
 void ShellManager::switchWorkspace(int index) {
     if (m_activeWorkspace != index) {
         m_activeWorkspace = index;
-        /* TODO: Send IPC to compositor to switch workspace */
+        /* The compositor confirms with a WORKSPACE event */
+        lw_ipc_workspace req = {index, 0};
+        sendIpcRequest(LW_IPC_REQUEST_SWITCH_WORKSPACE, &req, sizeof(req));
         emit activeWorkspaceChanged();
     }
 }
 
+void ShellManager::toggleOverview() {
+    /* The compositor answers with an OVERVIEW event */
+    lw_ipc_overview_request req = {LW_IPC_OVERVIEW_TOGGLE, 0};
+    sendIpcRequest(LW_IPC_REQUEST_OVERVIEW, &req, sizeof(req));
+}
+
 void ShellManager::showDesktop() {
-    /* TODO: Send IPC to compositor to minimize all windows */
+    sendIpcRequest(LW_IPC_REQUEST_SHOW_DESKTOP);
+}
+
+void ShellManager::activateView(quint32 viewId) {
+    lw_ipc_view_ref ref = {viewId, 0};
+    sendIpcRequest(LW_IPC_REQUEST_ACTIVATE_VIEW, &ref, sizeof(ref));
+}
+
+void ShellManager::closeView(quint32 viewId) {
+    lw_ipc_view_ref ref = {viewId, 0};
+    sendIpcRequest(LW_IPC_REQUEST_CLOSE_VIEW, &ref, sizeof(ref));
+}
+
+void ShellManager::minimizeView(quint32 viewId) {
+    lw_ipc_view_ref ref = {viewId, 0};
+    sendIpcRequest(LW_IPC_REQUEST_MINIMIZE_VIEW, &ref, sizeof(ref));
 }
 
 void ShellManager::lockScreen() {
@@ -160,12 +202,79 @@ void ShellManager::connectToCompositor() {
 
 void ShellManager::onIpcConnected() {
     qDebug("ShellManager: IPC connected to compositor");
-    m_ipcBuffer.clear();
+    m_ipcBufferStart = m_ipcBufferLen = 0;
+    lw_ipc_subscribe sub = {LW_IPC_CLASS_SHORTCUTS | LW_IPC_CLASS_WORKSPACE |
+                            LW_IPC_CLASS_FOCUS | LW_IPC_CLASS_WINDOWS |
+                            LW_IPC_CLASS_SNAP | LW_IPC_CLASS_SNAPSHOT |
+                            LW_IPC_CLASS_OVERVIEW | LW_IPC_CLASS_SWITCHER,
+                            0};
+    sendIpcRequest(LW_IPC_REQUEST_SUBSCRIBE, &sub, sizeof(sub));
+
+    /* Subscribed first, so no SNAPSHOT_CHANGED can slip in between.  The
+     * reply is read as it arrives; events keep flowing meanwhile. */
+    const int sock = m_snapshot.startAttach(m_ipcSocket->fullServerName());
+    if (sock < 0) {
+        finishSnapshotAttach(false);
+        return;
+    }
+    m_snapshotNotifier = new QSocketNotifier(sock, QSocketNotifier::Read,
+                                             this);
+    connect(m_snapshotNotifier, &QSocketNotifier::activated,
+            this, &ShellManager::onSnapshotReadable);
+    m_snapshotTimer->start();
+}
+
+void ShellManager::onSnapshotReadable() {
+    /* The handshake closes its socket when done; stop watching first */
+    m_snapshotNotifier->setEnabled(false);
+    switch (m_snapshot.continueAttach()) {
+    case StateSnapshot::AttachState::Pending:
+        m_snapshotNotifier->setEnabled(true);
+        break;
+    case StateSnapshot::AttachState::Attached:
+        finishSnapshotAttach(true);
+        break;
+    case StateSnapshot::AttachState::Failed:
+        finishSnapshotAttach(false);
+        break;
+    }
+}
+
+void ShellManager::onSnapshotTimeout() {
+    if (!m_snapshotNotifier) return;
+    m_snapshotNotifier->setEnabled(false);
+    m_snapshot.cancelAttach();
+    finishSnapshotAttach(false);
+}
+
+/* Handshake over: load the snapshot, or fall back to QUERY_STATE */
+void ShellManager::finishSnapshotAttach(bool attached) {
+    m_snapshotTimer->stop();
+    if (m_snapshotNotifier) {
+        m_snapshotNotifier->deleteLater();
+        m_snapshotNotifier = nullptr;
+    }
+    if (attached) {
+        refreshFromSnapshot(true);
+    } else {
+        qDebug("ShellManager: no state snapshot, querying state instead");
+        sendIpcRequest(LW_IPC_REQUEST_QUERY_STATE);
+    }
 }
 
 void ShellManager::onIpcDisconnected() {
     qDebug("ShellManager: IPC disconnected, will retry in 2s");
-    m_ipcBuffer.clear();
+    m_ipcBufferStart = m_ipcBufferLen = 0;
+    m_stateEntries.clear();
+    if (m_snapshotNotifier) {
+        m_snapshotNotifier->setEnabled(false);
+        m_snapshotNotifier->deleteLater();
+        m_snapshotNotifier = nullptr;
+    }
+    m_snapshotTimer->stop();
+    m_snapshot.cancelAttach();
+    m_snapshot.detach();
+    m_snapshotData = StateSnapshot::Data();
     m_reconnectTimer->start(2000);
 }
 
@@ -179,38 +288,323 @@ void ShellManager::onIpcError(QLocalSocket::LocalSocketError error) {
     }
 }
 
-void ShellManager::onIpcReadyRead() {
-    m_ipcBuffer.append(m_ipcSocket->readAll());
+bool ShellManager::sendIpcRequest(quint16 type, const void *payload,
+                                  size_t size) {
+    if (m_ipcSocket->state() != QLocalSocket::ConnectedState) return false;
 
-    /* Process complete newline-delimited commands */
+    /* Requests are a few bytes; build them on the stack */
+    alignas(LW_IPC_ALIGN) char buf[64] = {};
+    const quint32 msgSize = lw_ipc_message_size(size);
+    Q_ASSERT(msgSize <= sizeof(buf));
+
+    lw_ipc_header header = {msgSize, type, LW_IPC_VERSION, 0};
+    memcpy(buf, &header, sizeof(header));
+    if (size) memcpy(buf + sizeof(header), payload, size);
+    return m_ipcSocket->write(buf, msgSize) == qint64(msgSize);
+}
+
+void ShellManager::onIpcReadyRead() {
+    /* Read straight into the aligned buffer and dispatch each complete
+     * message where it lies.  m_ipcBufferStart is the parse cursor; the
+     * unparsed tail is only moved back to the front when there is no
+     * longer room for a whole message behind it, so a burst costs one
+     * pass over the bytes however it is split across reads. */
+    m_snapshotRefreshPending = false;
     while (true) {
-        int idx = m_ipcBuffer.indexOf('\n');
-        if (idx < 0) break;
+        if (m_ipcBufferStart == m_ipcBufferLen) {
+            m_ipcBufferStart = m_ipcBufferLen = 0;
+        } else if (qsizetype(sizeof(m_ipcBuffer)) - m_ipcBufferLen <
+                   LW_IPC_MAX_MESSAGE) {
+            memmove(m_ipcBuffer, m_ipcBuffer + m_ipcBufferStart,
+                    m_ipcBufferLen - m_ipcBufferStart);
+            m_ipcBufferLen -= m_ipcBufferStart;
+            m_ipcBufferStart = 0;
+        }
 
-        QByteArray line = m_ipcBuffer.left(idx).trimmed();
-        m_ipcBuffer.remove(0, idx + 1);
+        const qint64 n = m_ipcSocket->read(m_ipcBuffer + m_ipcBufferLen,
+            sizeof(m_ipcBuffer) - m_ipcBufferLen);
+        if (n <= 0) break;
+        m_ipcBufferLen += n;
+
+        while (m_ipcBufferLen - m_ipcBufferStart >=
+               qsizetype(sizeof(lw_ipc_header))) {
+            const auto *header = reinterpret_cast<const lw_ipc_header *>(
+                m_ipcBuffer + m_ipcBufferStart);
+            if (!lw_ipc_header_valid(header, LW_IPC_MAX_MESSAGE)) {
+                qWarning("ShellManager: bad IPC message (version %u, "
+                         "size %u), reconnecting",
+                         header->version, header->size);
+                m_ipcBufferStart = m_ipcBufferLen = 0;
+                m_ipcSocket->abort();
+                m_reconnectTimer->start(2000);
+                return;
+            }
+            if (qsizetype(header->size) > m_ipcBufferLen - m_ipcBufferStart)
+                break;
+
+            handleIpcMessage(header);
+            emit ipcMessageHandled(header->type);
+            m_ipcBufferStart += header->size;
+        }
+    }
 
-        if (!line.isEmpty()) {
-            handleIpcCommand(QString::fromUtf8(line));
+    /* Any number of SNAPSHOT_CHANGED in one burst is a single re-read */
+    if (m_snapshotRefreshPending) {
+        m_snapshotRefreshPending = false;
+        refreshFromSnapshot(false);
+    }
+}
+
+void ShellManager::handleIpcMessage(const lw_ipc_header *header) {
+    switch (header->type) {
+    case LW_IPC_EVENT_HELLO: {
+        auto *hello = static_cast<const lw_ipc_hello *>(
+            lw_ipc_payload(header, sizeof(lw_ipc_hello)));
+        if (hello) {
+            qDebug("ShellManager: compositor speaks IPC version %u",
+                   hello->version);
+        }
+        break;
+    }
+    case LW_IPC_EVENT_TOGGLE_START_MENU:
+        toggleStartMenu();
+        break;
+    case LW_IPC_EVENT_SHOW_DESKTOP:
+        /* The compositor already minimized everything (Super+D) */
+        setStartMenuVisible(false);
+        setNotificationCenterVisible(false);
+        setQuickSettingsVisible(false);
+        break;
+    case LW_IPC_EVENT_WORKSPACE: {
+        auto *ws = static_cast<const lw_ipc_workspace *>(
+            lw_ipc_payload(header, sizeof(lw_ipc_workspace)));
+        if (ws && ws->index >= 0 && ws->index != m_activeWorkspace) {
+            m_activeWorkspace = ws->index;
+            emit activeWorkspaceChanged();
+        }
+        /* Desktops come and go; per-desktop window counts follow with
+         * the next snapshot */
+        if (ws && ws->count > 0 && int(ws->count) != m_workspaceCount) {
+            m_workspaceCount = int(ws->count);
+            emit workspacesChanged();
+        }
+        break;
+    }
+    case LW_IPC_EVENT_FOCUS: {
+        auto *ref = static_cast<const lw_ipc_view_ref *>(
+            lw_ipc_payload(header, sizeof(lw_ipc_view_ref)));
+        if (ref) m_taskbarModel->setActiveView(ref->id);
+        break;
+    }
+    case LW_IPC_EVENT_SNAP_PREVIEW: {
+        auto *preview = static_cast<const lw_ipc_snap_preview *>(
+            lw_ipc_payload(header, sizeof(lw_ipc_snap_preview)));
+        const char *name = preview ? lw_ipc_tail(header, sizeof(*preview),
+                                                 preview->name_len)
+                                   : nullptr;
+        if (name)
+            emit snapZoneChanged(QString::fromLatin1(name, preview->name_len));
+        break;
+    }
+    case LW_IPC_EVENT_OVERVIEW: {
+        auto *overview = static_cast<const lw_ipc_overview *>(
+            lw_ipc_payload(header, sizeof(lw_ipc_overview)));
+        if (overview && bool(overview->visible) != m_overviewVisible) {
+            m_overviewVisible = overview->visible;
+            /* Task View and the start menu never show together */
+            if (m_overviewVisible) setStartMenuVisible(false);
+            emit overviewVisibleChanged();
+        }
+        break;
+    }
+    case LW_IPC_EVENT_SWITCHER:
+        handleIpcSwitcher(header);
+        break;
+    case LW_IPC_EVENT_SWITCHER_SELECT: {
+        auto *select = static_cast<const lw_ipc_switcher_select *>(
+            lw_ipc_payload(header, sizeof(lw_ipc_switcher_select)));
+        /* Only the index moves; the list came with SWITCHER */
+        if (select && m_switcherVisible &&
+            select->serial == m_switcherSerial && select->index >= 0 &&
+            select->index < m_switcherEntries.size() &&
+            select->index != m_switcherIndex) {
+            m_switcherIndex = select->index;
+            emit switcherIndexChanged();
         }
+        break;
+    }
+    case LW_IPC_EVENT_VIEW:
+    case LW_IPC_EVENT_VIEW_CREATED:
+        handleIpcView(header);
+        break;
+    case LW_IPC_EVENT_VIEW_DESTROYED: {
+        auto *ref = static_cast<const lw_ipc_view_ref *>(
+            lw_ipc_payload(header, sizeof(lw_ipc_view_ref)));
+        if (ref) m_taskbarModel->removeView(ref->id);
+        break;
+    }
+    case LW_IPC_EVENT_VIEW_TITLE:
+    case LW_IPC_EVENT_VIEW_APP_ID:
+        handleIpcViewString(header);
+        break;
+    case LW_IPC_EVENT_VIEW_STATE: {
+        auto *state = static_cast<const lw_ipc_view_state *>(
+            lw_ipc_payload(header, sizeof(lw_ipc_view_state)));
+        if (state) {
+            m_taskbarModel->setViewState(state->id,
+                state->flags & LW_IPC_VIEW_MINIMIZED,
+                state->flags & LW_IPC_VIEW_MAXIMIZED,
+                state->flags & LW_IPC_VIEW_FULLSCREEN, state->workspace);
+        }
+        break;
+    }
+    case LW_IPC_EVENT_STATE_DONE:
+        m_taskbarModel->setEntries(std::move(m_stateEntries));
+        m_stateEntries.clear();
+        break;
+    case LW_IPC_EVENT_SNAPSHOT_CHANGED: {
+        auto *info = static_cast<const lw_ipc_snapshot_info *>(
+            lw_ipc_payload(header, sizeof(lw_ipc_snapshot_info)));
+        /* Several changes may have been folded into one read already;
+         * the re-read waits for the end of the burst.  The window list
+         * itself follows the VIEW_* deltas. */
+        if (info && m_snapshot.isAttached() && info->seq != m_snapshotData.seq)
+            m_snapshotRefreshPending = true;
+        break;
+    }
+    default:
+        /* Newer compositor, or a reply to someone else's query */
+        break;
     }
 }
 
-void ShellManager::handleIpcCommand(const QString &command) {
-    qDebug("ShellManager: IPC command received: %s",
-           qPrintable(command));
+void ShellManager::handleIpcView(const lw_ipc_header *header) {
+    auto *view = static_cast<const lw_ipc_view *>(
+        lw_ipc_payload(header, sizeof(lw_ipc_view)));
+    if (!view) return;
+    const char *strings = lw_ipc_tail(header, sizeof(*view),
+        size_t(view->app_id_len) + view->title_len);
+    if (!strings) return;
+
+    TaskbarEntry entry;
+    entry.viewId = view->id;
+    entry.appId = QString::fromUtf8(strings, view->app_id_len);
+    entry.title = QString::fromUtf8(strings + view->app_id_len,
+                                    view->title_len);
+    entry.iconName = entry.appId;
+    entry.active = view->flags & LW_IPC_VIEW_FOCUSED;
+    entry.minimized = view->flags & LW_IPC_VIEW_MINIMIZED;
+    entry.maximized = view->flags & LW_IPC_VIEW_MAXIMIZED;
+    entry.fullscreen = view->flags & LW_IPC_VIEW_FULLSCREEN;
+    entry.workspace = view->workspace;
+    entry.pinned = false;
+
+    /* VIEW is part of a QUERY_STATE reply, VIEW_CREATED a live delta */
+    if (header->type == LW_IPC_EVENT_VIEW)
+        m_stateEntries.append(entry);
+    else
+        m_taskbarModel->addView(entry);
+}
 
-    if (command == QStringLiteral("toggle-start-menu")) {
-        toggleStartMenu();
-    } else if (command == QStringLiteral("show-desktop")) {
-        showDesktop();
-    } else if (command == QStringLiteral("cycle-window")) {
-        /* Alt+Tab notification from compositor.
-         * The compositor handles the actual window focus change;
-         * the shell can update any task switcher UI here. */
-        qDebug("ShellManager: window cycle event");
-    } else {
-        qDebug("ShellManager: unknown IPC command: %s",
-               qPrintable(command));
+void ShellManager::handleIpcViewString(const lw_ipc_header *header) {
+    auto *info = static_cast<const lw_ipc_view_string *>(
+        lw_ipc_payload(header, sizeof(lw_ipc_view_string)));
+    const char *str = info ? lw_ipc_tail(header, sizeof(*info), info->len)
+                           : nullptr;
+    if (!str) return;
+
+    const QString value = QString::fromUtf8(str, info->len);
+    if (header->type == LW_IPC_EVENT_VIEW_TITLE)
+        m_taskbarModel->setViewTitle(info->id, value);
+    else
+        m_taskbarModel->setViewAppId(info->id, value);
+}
+
+/* Rebuild the workspace state, and on attach the taskbar, from the shared
+ * snapshot.  The copy is taken under the seqlock; Qt objects are built
+ * after.  Once attached the taskbar is kept current by the VIEW_* deltas,
+ * so later refreshes leave it alone rather than resetting the model. */
+void ShellManager::refreshFromSnapshot(bool withEntries) {
+    StateSnapshot::Data data;
+    if (!m_snapshot.read(data)) {
+        qWarning("ShellManager: state snapshot busy, keeping old state");
+        return;
     }
+    m_snapshotData = data;
+
+    QVector<TaskbarEntry> entries;
+    if (withEntries) entries.reserve(data.views.size());
+    QVariantList counts;
+    for (quint32 i = 0; i < data.workspaceCount; i++) counts.append(0);
+
+    for (const lw_ipc_snapshot_view &view : std::as_const(data.views)) {
+        if (view.workspace >= 0 && view.workspace < counts.size())
+            counts[view.workspace] = counts[view.workspace].toInt() + 1;
+        if (!withEntries) continue;
+
+        TaskbarEntry entry;
+        entry.viewId = view.id;
+        entry.appId = QString::fromUtf8(view.app_id,
+            qMin<int>(view.app_id_len, LW_IPC_SNAPSHOT_APP_ID_MAX));
+        entry.title = QString::fromUtf8(view.title,
+            qMin<int>(view.title_len, LW_IPC_SNAPSHOT_TITLE_MAX));
+        entry.iconName = entry.appId;
+        entry.active = view.flags & LW_IPC_VIEW_FOCUSED;
+        entry.minimized = view.flags & LW_IPC_VIEW_MINIMIZED;
+        entry.maximized = view.flags & LW_IPC_VIEW_MAXIMIZED;
+        entry.fullscreen = view.flags & LW_IPC_VIEW_FULLSCREEN;
+        entry.workspace = view.workspace;
+        entry.pinned = false;
+        entries.append(entry);
+    }
+    if (withEntries) m_taskbarModel->setEntries(std::move(entries));
+
+    if (data.activeWorkspace >= 0 &&
+        data.activeWorkspace != m_activeWorkspace) {
+        m_activeWorkspace = data.activeWorkspace;
+        emit activeWorkspaceChanged();
+    }
+    const int workspaceCount = qMax<int>(1, data.workspaceCount);
+    if (workspaceCount != m_workspaceCount ||
+        counts != m_workspaceWindowCounts) {
+        m_workspaceCount = workspaceCount;
+        m_workspaceWindowCounts = counts;
+        emit workspacesChanged();
+    }
+}
+
+void ShellManager::handleIpcSwitcher(const lw_ipc_header *header) {
+    auto *switcher = static_cast<const lw_ipc_switcher *>(
+        lw_ipc_payload(header, sizeof(lw_ipc_switcher)));
+    if (!switcher || switcher->count > LW_IPC_SWITCHER_MAX) return;
+    const char *ids = lw_ipc_tail(header, sizeof(*switcher),
+                                  size_t(switcher->count) * sizeof(quint32));
+    if (!ids) return;
+
+    /* The compositor sends the list in order; only titles and icons
+     * are looked up here */
+    QVariantList entries;
+    entries.reserve(switcher->count);
+    for (quint32 i = 0; i < switcher->count; i++) {
+        quint32 viewId;
+        memcpy(&viewId, ids + i * sizeof(viewId), sizeof(viewId));
+        const TaskbarEntry *entry = m_taskbarModel->entry(viewId);
+        QVariantMap item;
+        item.insert(QStringLiteral("viewId"), viewId);
+        item.insert(QStringLiteral("title"), entry ? entry->title : QString());
+        item.insert(QStringLiteral("appId"), entry ? entry->appId : QString());
+        item.insert(QStringLiteral("iconName"),
+                    entry ? entry->iconName : QString());
+        item.insert(QStringLiteral("minimized"), entry && entry->minimized);
+        entries.append(item);
+    }
+
+    m_switcherVisible = switcher->visible && !entries.isEmpty();
+    m_switcherSerial = switcher->serial;
+    m_switcherEntries = std::move(entries);
+    m_switcherIndex = m_switcherVisible ? switcher->selected : -1;
+    /* The switcher and the start menu never show together */
+    if (m_switcherVisible) setStartMenuVisible(false);
+    emit switcherChanged();
+    emit switcherIndexChanged();
 }
@@ -8,13 +8,31 @@
 #include <QObject>
 #include <QDateTime>
 #include <QLocalSocket>
+#include <QVariantList>
+#include <QVector>
+
+#include "ipc_protocol.h"
+#include "statesnapshot.h"
+#include "taskbarmodel.h"
 
 class ShellManager : public QObject {
     Q_OBJECT
     Q_PROPERTY(int activeWorkspace READ activeWorkspace
                NOTIFY activeWorkspaceChanged)
+    Q_PROPERTY(int workspaceCount READ workspaceCount
+               NOTIFY workspacesChanged)
+    Q_PROPERTY(QVariantList workspaceWindowCounts
+               READ workspaceWindowCounts NOTIFY workspacesChanged)
     Q_PROPERTY(bool startMenuVisible READ startMenuVisible
                WRITE setStartMenuVisible NOTIFY startMenuVisibleChanged)
+    Q_PROPERTY(bool overviewVisible READ overviewVisible
+               NOTIFY overviewVisibleChanged)
+    Q_PROPERTY(bool switcherVisible READ switcherVisible
+               NOTIFY switcherChanged)
+    Q_PROPERTY(QVariantList switcherEntries READ switcherEntries
+               NOTIFY switcherChanged)
+    Q_PROPERTY(int switcherIndex READ switcherIndex
+               NOTIFY switcherIndexChanged)
     Q_PROPERTY(bool searchFocusRequested READ searchFocusRequested
                NOTIFY searchFocusRequestedChanged)
     Q_PROPERTY(QString searchText READ searchText WRITE setSearchText
@@ -32,10 +50,24 @@ public:
     explicit ShellManager(QObject *parent = nullptr);
 
     int activeWorkspace() const { return m_activeWorkspace; }
+    int workspaceCount() const { return m_workspaceCount; }
+    QVariantList workspaceWindowCounts() const { return m_workspaceWindowCounts; }
+
+    /* Open windows as last reported by the compositor */
+    TaskbarModel *taskbarModel() const { return m_taskbarModel; }
 
     bool startMenuVisible() const { return m_startMenuVisible; }
     void setStartMenuVisible(bool visible);
 
+    /* Task View, drawn by the compositor */
+    bool overviewVisible() const { return m_overviewVisible; }
+
+    /* Alt+Tab switcher, run by the compositor: the windows it lists
+     * (viewId, title, appId, iconName, minimized) and the selected one */
+    bool switcherVisible() const { return m_switcherVisible; }
+    QVariantList switcherEntries() const { return m_switcherEntries; }
+    int switcherIndex() const { return m_switcherIndex; }
+
     bool searchFocusRequested() const { return m_searchFocusRequested; }
 
     QString searchText() const { return m_searchText; }
@@ -56,41 +88,86 @@ public slots:
     void lockScreen();
     void launchApp(const QString &command);
     void toggleStartMenu();
+    void toggleOverview();
     void openSearch();
     void openTerminal();
     void clearSearchFocusRequest();
 
+    /* Window management requests, by compositor view id */
+    void activateView(quint32 viewId);
+    void closeView(quint32 viewId);
+    void minimizeView(quint32 viewId);
+
 signals:
     void activeWorkspaceChanged();
+    void workspacesChanged();
     void startMenuVisibleChanged();
+    void overviewVisibleChanged();
+    void switcherChanged();
+    void switcherIndexChanged();
     void searchFocusRequestedChanged();
     void searchTextChanged();
     void notificationCenterVisibleChanged();
     void quickSettingsVisibleChanged();
     void currentTimeChanged();
     void snapZoneChanged(const QString &zone);
+    /* After each message from the compositor has been dispatched (used
+     * by lwindesk-ipc-replay to time the shell) */
+    void ipcMessageHandled(quint16 type);
 
 private slots:
     void onIpcConnected();
     void onIpcDisconnected();
     void onIpcReadyRead();
     void onIpcError(QLocalSocket::LocalSocketError error);
+    void onSnapshotReadable();
+    void onSnapshotTimeout();
 
 private:
     void connectToCompositor();
-    void handleIpcCommand(const QString &command);
+    void handleIpcMessage(const lw_ipc_header *header);
+    void handleIpcView(const lw_ipc_header *header);
+    void handleIpcViewString(const lw_ipc_header *header);
+    void handleIpcSwitcher(const lw_ipc_header *header);
+    bool sendIpcRequest(quint16 type, const void *payload = nullptr,
+                        size_t size = 0);
+    void refreshFromSnapshot(bool withEntries);
+    void finishSnapshotAttach(bool attached);
 
     int m_activeWorkspace = 0;
+    int m_workspaceCount = 1;
+    QVariantList m_workspaceWindowCounts;
     bool m_startMenuVisible = false;
+    bool m_overviewVisible = false;
+    bool m_switcherVisible = false;
+    quint32 m_switcherSerial = 0;
+    QVariantList m_switcherEntries;
+    int m_switcherIndex = -1;
     bool m_searchFocusRequested = false;
     QString m_searchText;
     bool m_notificationCenterVisible = false;
     bool m_quickSettingsVisible = false;
     class QTimer *m_clockTimer;
 
-    /* IPC connection to compositor */
+    TaskbarModel *m_taskbarModel;
+    QVector<TaskbarEntry> m_stateEntries;   /* QUERY_STATE in progress */
+
+    /* Shared compositor state; QUERY_STATE is only the fallback.  The
+     * fd handshake runs on its own connection, watched by the notifier
+     * and given up on when the timer fires. */
+    StateSnapshot m_snapshot;
+    StateSnapshot::Data m_snapshotData;
+    bool m_snapshotRefreshPending = false;
+    class QSocketNotifier *m_snapshotNotifier = nullptr;
+    class QTimer *m_snapshotTimer = nullptr;
+
+    /* IPC connection to compositor.  Messages are decoded in place from
+     * this buffer, so it must stay aligned like the wire format; bytes
+     * before m_ipcBufferStart have been dispatched already. */
     QLocalSocket *m_ipcSocket = nullptr;
-    QByteArray m_ipcBuffer;
+    alignas(LW_IPC_ALIGN) char m_ipcBuffer[16 * LW_IPC_MAX_MESSAGE];
+    qsizetype m_ipcBufferStart = 0;
+    qsizetype m_ipcBufferLen = 0;
     class QTimer *m_reconnectTimer = nullptr;
 };
 
@@ -0,0 +1,192 @@
+/*
+ * lwindesk - shell/src/statesnapshot.cpp - Compositor state snapshot reader
+ *
+ * The fd arrives with SCM_RIGHTS, which QLocalSocket cannot receive, so
+ * the handshake uses its own short-lived connection to the IPC socket:
+ * send SNAPSHOT, read the reply and its fd with recvmsg(), map, hang up.
+ * The connection is non-blocking and the caller polls it from its event
+ * loop, so a slow compositor never stalls the GUI thread.
+ */
+
+#include "statesnapshot.h"
+
+#include <QtGlobal>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* Attempts before read() gives up on a busy writer */
+static constexpr int kReadAttempts = 16;
+
+StateSnapshot::~StateSnapshot() {
+    cancelAttach();
+    detach();
+}
+
+int StateSnapshot::startAttach(const QString &socketPath) {
+    detach();
+    cancelAttach();
+
+    const QByteArray path = socketPath.toLocal8Bit();
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (size_t(path.size()) >= sizeof(addr.sun_path)) return -1;
+    memcpy(addr.sun_path, path.constData(), path.size());
+
+    const int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC |
+                            SOCK_NONBLOCK, 0);
+    if (sock < 0) return -1;
+
+    /* A local connect either lands in the backlog right away or fails
+     * (EAGAIN when the compositor is swamped); the request fits in the
+     * empty send buffer either way */
+    struct {
+        lw_ipc_header header;
+    } request = {{lw_ipc_message_size(0), LW_IPC_REQUEST_SNAPSHOT,
+                  LW_IPC_VERSION, 0}};
+    if (::connect(sock, reinterpret_cast<sockaddr *>(&addr),
+                  sizeof(addr)) != 0 ||
+        send(sock, &request, sizeof(request), MSG_NOSIGNAL) !=
+            ssize_t(sizeof(request))) {
+        close(sock);
+        return -1;
+    }
+    m_attachSocket = sock;
+    m_attachLen = 0;
+    return sock;
+}
+
+/* Take whatever has arrived; everything before the SNAPSHOT reply (HELLO
+ * first of all) is skipped */
+StateSnapshot::AttachState StateSnapshot::continueAttach() {
+    if (m_attachSocket < 0) return AttachState::Failed;
+
+    while (true) {
+        union {
+            char buf[CMSG_SPACE(sizeof(int))];
+            cmsghdr align;
+        } control;
+        iovec iov = {m_attachBuffer + m_attachLen,
+                     sizeof(m_attachBuffer) - m_attachLen};
+        msghdr mh = {};
+        mh.msg_iov = &iov;
+        mh.msg_iovlen = 1;
+        mh.msg_control = control.buf;
+        mh.msg_controllen = sizeof(control.buf);
+
+        const ssize_t n = recvmsg(m_attachSocket, &mh,
+                                  MSG_CMSG_CLOEXEC | MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return AttachState::Pending;
+        if (n <= 0) break;
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&mh); cmsg;
+             cmsg = CMSG_NXTHDR(&mh, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET &&
+                cmsg->cmsg_type == SCM_RIGHTS && m_attachFd < 0) {
+                memcpy(&m_attachFd, CMSG_DATA(cmsg), sizeof(int));
+            }
+        }
+        m_attachLen += size_t(n);
+
+        size_t start = 0;
+        while (m_attachLen - start >= sizeof(lw_ipc_header)) {
+            const auto *header = reinterpret_cast<const lw_ipc_header *>(
+                m_attachBuffer + start);
+            if (!lw_ipc_header_valid(header, LW_IPC_MAX_MESSAGE)) {
+                cancelAttach();
+                return AttachState::Failed;
+            }
+            if (header->size > m_attachLen - start) break;
+            if (header->type == LW_IPC_EVENT_SNAPSHOT) {
+                auto *reply = static_cast<const lw_ipc_snapshot_info *>(
+                    lw_ipc_payload(header, sizeof(lw_ipc_snapshot_info)));
+                const lw_ipc_snapshot_info info =
+                    reply ? *reply : lw_ipc_snapshot_info{0, 0};
+                const int fd = m_attachFd;
+                m_attachFd = -1;
+                cancelAttach();
+                if (!reply || fd < 0) {
+                    if (fd >= 0) close(fd);
+                    return AttachState::Failed;
+                }
+                return map(fd, info) ? AttachState::Attached
+                                     : AttachState::Failed;
+            }
+            start += header->size;
+        }
+        memmove(m_attachBuffer, m_attachBuffer + start, m_attachLen - start);
+        m_attachLen -= start;
+    }
+
+    cancelAttach();
+    return AttachState::Failed;
+}
+
+void StateSnapshot::cancelAttach() {
+    if (m_attachFd >= 0) close(m_attachFd);
+    if (m_attachSocket >= 0) close(m_attachSocket);
+    m_attachFd = m_attachSocket = -1;
+    m_attachLen = 0;
+}
+
+/* Map the fd (which this takes over) if it is a snapshot we can read */
+bool StateSnapshot::map(int fd, const lw_ipc_snapshot_info &info) {
+    /* A compositor built with a different layout is not ours to read */
+    if (info.size < sizeof(lw_ipc_snapshot)) {
+        close(fd);
+        return false;
+    }
+    void *mapping = mmap(nullptr, info.size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return false;
+
+    const auto *snapshot = static_cast<const lw_ipc_snapshot *>(mapping);
+    if (snapshot->magic != LW_IPC_SNAPSHOT_MAGIC ||
+        snapshot->version != LW_IPC_VERSION) {
+        munmap(mapping, info.size);
+        return false;
+    }
+    m_snapshot = snapshot;
+    m_size = info.size;
+    return true;
+}
+
+void StateSnapshot::detach() {
+    if (!m_snapshot) return;
+    munmap(const_cast<lw_ipc_snapshot *>(m_snapshot), m_size);
+    m_snapshot = nullptr;
+    m_size = 0;
+}
+
+quint32 StateSnapshot::sequence() const {
+    return m_snapshot ? __atomic_load_n(&m_snapshot->seq, __ATOMIC_ACQUIRE)
+                      : 0;
+}
+
+bool StateSnapshot::read(Data &data) const {
+    if (!m_snapshot) return false;
+
+    for (int attempt = 0; attempt < kReadAttempts; attempt++) {
+        const quint32 seq = lw_ipc_snapshot_read_begin(m_snapshot);
+        const quint32 count = qMin<quint32>(m_snapshot->view_count,
+                                            LW_IPC_SNAPSHOT_MAX_VIEWS);
+        data.activeWorkspace = m_snapshot->active_workspace;
+        data.workspaceCount = m_snapshot->workspace_count;
+        data.focusedView = m_snapshot->focused_view;
+        data.views.resize(count);
+        memcpy(data.views.data(), m_snapshot->views,
+               count * sizeof(lw_ipc_snapshot_view));
+        if (!lw_ipc_snapshot_read_retry(m_snapshot, seq)) {
+            data.seq = seq;
+            return true;
+        }
+        if (attempt > 0) usleep(100);
+    }
+    return false;
+}
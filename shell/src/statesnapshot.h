@@ -0,0 +1,67 @@
+/*
+ * lwindesk - shell/src/statesnapshot.h - Compositor state snapshot reader
+ */
+
+#ifndef LWINDESK_STATESNAPSHOT_H
+#define LWINDESK_STATESNAPSHOT_H
+
+#include <QString>
+#include <QVector>
+
+#include "ipc_protocol.h"
+
+/*
+ * Read-only mapping of the compositor's shared state snapshot (see
+ * compositor/src/snapshot.c).  Once attached, the window list and
+ * workspace state can be read at any time without an IPC round trip.
+ */
+class StateSnapshot {
+public:
+    /* A consistent copy of the shared state */
+    struct Data {
+        quint32 seq = 0;
+        qint32 activeWorkspace = -1;
+        quint32 workspaceCount = 0;
+        quint32 focusedView = 0;
+        QVector<lw_ipc_snapshot_view> views;
+    };
+
+    StateSnapshot() = default;
+    ~StateSnapshot();
+    StateSnapshot(const StateSnapshot &) = delete;
+    StateSnapshot &operator=(const StateSnapshot &) = delete;
+
+    enum class AttachState { Pending, Attached, Failed };
+
+    /* Ask the compositor's IPC socket for the snapshot fd without
+     * blocking.  Returns the connection to watch for input, or -1; each
+     * time it is readable, continueAttach() takes what has arrived and
+     * maps the snapshot once the reply is complete. */
+    int startAttach(const QString &socketPath);
+    AttachState continueAttach();
+    void cancelAttach();
+    void detach();
+    bool isAttached() const { return m_snapshot != nullptr; }
+
+    /* Sequence of the current contents (odd while being rewritten) */
+    quint32 sequence() const;
+
+    /* Copy out the current contents; false if the compositor kept
+     * rewriting it (or is stuck mid-write) */
+    bool read(Data &data) const;
+
+private:
+    bool map(int fd, const lw_ipc_snapshot_info &info);
+
+    const lw_ipc_snapshot *m_snapshot = nullptr;
+    size_t m_size = 0;
+
+    /* Handshake in progress: its connection, the fd once it came and
+     * the reply read so far */
+    int m_attachSocket = -1;
+    int m_attachFd = -1;
+    alignas(LW_IPC_ALIGN) char m_attachBuffer[2 * LW_IPC_MAX_MESSAGE];
+    size_t m_attachLen = 0;
+};
+
+#endif /* LWINDESK_STATESNAPSHOT_H */
@@ -25,6 +25,9 @@ QVariant TaskbarModel::data(const QModelIndex &index, int role) const {
     case ActiveRole:    return entry.active;
     case MinimizedRole: return entry.minimized;
     case PinnedRole:    return entry.pinned;
+    case MaximizedRole: return entry.maximized;
+    case FullscreenRole: return entry.fullscreen;
+    case WorkspaceRole: return entry.workspace;
     }
     return QVariant();
 }
@@ -37,20 +40,141 @@ QHash<int, QByteArray> TaskbarModel::roleNames() const {
         {ActiveRole, "active"},
         {MinimizedRole, "minimized"},
         {PinnedRole, "pinned"},
+        {MaximizedRole, "maximized"},
+        {FullscreenRole, "fullscreen"},
+        {WorkspaceRole, "workspace"},
     };
 }
 
 void TaskbarModel::activateWindow(int index) {
     if (index < 0 || index >= m_entries.count()) return;
-    /* TODO: Send activate to compositor via IPC */
+    if (m_entries[index].viewId)
+        emit activateRequested(m_entries[index].viewId);
 }
 
 void TaskbarModel::closeWindow(int index) {
     if (index < 0 || index >= m_entries.count()) return;
-    /* TODO: Send close to compositor via IPC */
+    if (m_entries[index].viewId)
+        emit closeRequested(m_entries[index].viewId);
+}
+
+void TaskbarModel::minimizeWindow(int index) {
+    if (index < 0 || index >= m_entries.count()) return;
+    if (m_entries[index].viewId)
+        emit minimizeRequested(m_entries[index].viewId);
+}
+
+void TaskbarModel::setEntries(QVector<TaskbarEntry> entries) {
+    beginResetModel();
+    m_entries = std::move(entries);
+    endResetModel();
 }
 
 void TaskbarModel::pinApp(const QString &appId) {
     Q_UNUSED(appId)
     /* TODO: Pin app to taskbar */
 }
+
+void TaskbarModel::setActiveView(quint32 viewId) {
+    for (int i = 0; i < m_entries.count(); i++) {
+        bool active = viewId && m_entries[i].viewId == viewId;
+        if (m_entries[i].active == active) continue;
+        m_entries[i].active = active;
+        const QModelIndex idx = index(i);
+        emit dataChanged(idx, idx, {ActiveRole});
+    }
+}
+
+const TaskbarEntry *TaskbarModel::entry(quint32 viewId) const {
+    const int row = rowOf(viewId);
+    return row >= 0 ? &m_entries[row] : nullptr;
+}
+
+int TaskbarModel::rowOf(quint32 viewId) const {
+    if (!viewId) return -1;
+    for (int i = 0; i < m_entries.count(); i++) {
+        if (m_entries[i].viewId == viewId) return i;
+    }
+    return -1;
+}
+
+void TaskbarModel::addView(const TaskbarEntry &entry) {
+    const int row = rowOf(entry.viewId);
+    if (row >= 0) {
+        /* Already known (e.g. from the snapshot); keep focus as is,
+         * FOCUS events own that */
+        TaskbarEntry &existing = m_entries[row];
+        existing.appId = entry.appId;
+        existing.title = entry.title;
+        existing.iconName = entry.iconName;
+        existing.minimized = entry.minimized;
+        existing.maximized = entry.maximized;
+        existing.fullscreen = entry.fullscreen;
+        existing.workspace = entry.workspace;
+        const QModelIndex idx = index(row);
+        emit dataChanged(idx, idx,
+                         {AppIdRole, TitleRole, IconNameRole, MinimizedRole,
+                          MaximizedRole, FullscreenRole, WorkspaceRole});
+        return;
+    }
+
+    const int last = m_entries.count();
+    beginInsertRows(QModelIndex(), last, last);
+    m_entries.append(entry);
+    endInsertRows();
+}
+
+void TaskbarModel::removeView(quint32 viewId) {
+    const int row = rowOf(viewId);
+    if (row < 0) return;
+    beginRemoveRows(QModelIndex(), row, row);
+    m_entries.remove(row);
+    endRemoveRows();
+}
+
+void TaskbarModel::setViewTitle(quint32 viewId, const QString &title) {
+    const int row = rowOf(viewId);
+    if (row < 0 || m_entries[row].title == title) return;
+    m_entries[row].title = title;
+    const QModelIndex idx = index(row);
+    emit dataChanged(idx, idx, {TitleRole});
+}
+
+void TaskbarModel::setViewAppId(quint32 viewId, const QString &appId) {
+    const int row = rowOf(viewId);
+    if (row < 0 || m_entries[row].appId == appId) return;
+    m_entries[row].appId = appId;
+    m_entries[row].iconName = appId;
+    const QModelIndex idx = index(row);
+    emit dataChanged(idx, idx, {AppIdRole, IconNameRole});
+}
+
+void TaskbarModel::setViewState(quint32 viewId, bool minimized,
+                                bool maximized, bool fullscreen,
+                                int workspace) {
+    const int row = rowOf(viewId);
+    if (row < 0) return;
+
+    /* Only the roles that changed */
+    TaskbarEntry &entry = m_entries[row];
+    QList<int> roles;
+    if (entry.minimized != minimized) {
+        entry.minimized = minimized;
+        roles.append(MinimizedRole);
+    }
+    if (entry.maximized != maximized) {
+        entry.maximized = maximized;
+        roles.append(MaximizedRole);
+    }
+    if (entry.fullscreen != fullscreen) {
+        entry.fullscreen = fullscreen;
+        roles.append(FullscreenRole);
+    }
+    if (entry.workspace != workspace) {
+        entry.workspace = workspace;
+        roles.append(WorkspaceRole);
+    }
+    if (roles.isEmpty()) return;
+    const QModelIndex idx = index(row);
+    emit dataChanged(idx, idx, roles);
+}
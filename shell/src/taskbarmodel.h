@@ -9,11 +9,15 @@
 #include <QVector>
 
 struct TaskbarEntry {
+    quint32 viewId;             /* compositor handle, 0 for pinned apps */
     QString appId;
     QString title;
     QString iconName;
     bool active;
     bool minimized;
+    bool maximized;
+    bool fullscreen;
+    int workspace;              /* index, -1 if none */
     bool pinned;
 };
 
@@ -28,6 +32,9 @@ public:
         ActiveRole,
         MinimizedRole,
         PinnedRole,
+        MaximizedRole,
+        FullscreenRole,
+        WorkspaceRole,
     };
 
     explicit TaskbarModel(QObject *parent = nullptr);
@@ -38,9 +45,37 @@ public:
 
     Q_INVOKABLE void activateWindow(int index);
     Q_INVOKABLE void closeWindow(int index);
+    Q_INVOKABLE void minimizeWindow(int index);
     Q_INVOKABLE void pinApp(const QString &appId);
 
+    /* Replace the window list with a fresh compositor snapshot */
+    void setEntries(QVector<TaskbarEntry> entries);
+
+    /* The window with this view id, or nullptr */
+    const TaskbarEntry *entry(quint32 viewId) const;
+
+    /* Mark the window with this view id as the focused one */
+    void setActiveView(quint32 viewId);
+
+    /* Incremental updates from the compositor's window delta stream.
+     * Each touches only the affected row; ids the model does not know
+     * are ignored, and adding a known id updates it in place. */
+    void addView(const TaskbarEntry &entry);
+    void removeView(quint32 viewId);
+    void setViewTitle(quint32 viewId, const QString &title);
+    void setViewAppId(quint32 viewId, const QString &appId);
+    void setViewState(quint32 viewId, bool minimized, bool maximized,
+                      bool fullscreen, int workspace);
+
+signals:
+    /* Forwarded to the compositor by ShellManager */
+    void activateRequested(quint32 viewId);
+    void closeRequested(quint32 viewId);
+    void minimizeRequested(quint32 viewId);
+
 private:
+    int rowOf(quint32 viewId) const;
+
     QVector<TaskbarEntry> m_entries;
 };
 
@@ -0,0 +1,532 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * tests/bench/bench.c - Headless end-to-end compositor benchmark
+ *
+ * Runs the real lw_server in-process on the wlroots headless backend with
+ * the pixman renderer, connects N synthetic xdg-shell clients (one thread
+ * each) and walks them through the phases in bench.h.  Results go out as
+ * JSON: operations, throughput and latency percentiles per phase, plus the
+ * compositor's own frame timing histograms.  The ipc_ping phase measures
+ * request/reply pairs per second over the binary IPC socket; ipc_churn
+ * connects and drops hundreds of subscribed IPC clients while the
+ * compositor keeps changing focus and workspace.  The thumbnail phase
+ * times creating and drawing a window thumbnail from the client's shm
+ * buffer.  Afterwards the title bar microbenchmark renders the same
+ * titles through the decoration cache and from scratch, reporting both.
+ *
+ * Usage: lwindesk-bench [-c clients] [-n iterations] [-k churn_conns]
+ *                       [-o file.json] [-v]
+ */
+
+#define _GNU_SOURCE
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <wlr/backend.h>
+#include <wlr/backend/headless.h>
+#include <wlr/backend/multi.h>
+#include <wlr/types/wlr_xdg_shell.h>
+#include <wlr/util/log.h>
+
+#include "bench.h"
+#include "ipc.h"
+#include "output.h"
+#include "server.h"
+#include "thumbnail.h"
+#include "view.h"
+#include "workspace.h"
+
+/* A phase that takes longer than this has hung */
+#define BENCH_PHASE_TIMEOUT_S 120
+
+/* IPC connections each client holds open at once while churning */
+#define BENCH_CHURN_OPEN 256
+
+/* Descriptors kept free for everything but the churn connections */
+#define BENCH_FD_RESERVE 256
+
+#define BENCH_OUTPUT_WIDTH 1920
+#define BENCH_OUTPUT_HEIGHT 1080
+
+static const char *phase_names[BENCH_PHASE_COUNT] = {
+    [BENCH_PHASE_CONNECT] = "connect",
+    [BENCH_PHASE_MAP_UNMAP] = "map_unmap",
+    [BENCH_PHASE_COMMIT_STORM] = "commit_storm",
+    [BENCH_PHASE_TITLE_CHURN] = "title_churn",
+    [BENCH_PHASE_SNAP] = "snap",
+    [BENCH_PHASE_WORKSPACE] = "workspace_switch",
+    [BENCH_PHASE_THUMBNAIL] = "thumbnail",
+    [BENCH_PHASE_IPC] = "ipc_ping",
+    [BENCH_PHASE_IPC_CHURN] = "ipc_churn",
+    [BENCH_PHASE_DONE] = "done",
+};
+
+struct bench {
+    struct lw_server server;
+    struct bench_shared shared;
+    bool server_ready;           /* lw_server_init() succeeded */
+    int client_count;
+    double seconds[BENCH_PHASE_COUNT];
+    struct bench_titlebar titlebar;
+};
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void dispatch(struct bench *bench, int timeout_ms) {
+    struct wl_display *display = bench->server.wl_display;
+    wl_display_flush_clients(display);
+    wl_event_loop_dispatch(wl_display_get_event_loop(display), timeout_ms);
+    wl_display_flush_clients(display);
+}
+
+static bool timed_out(struct bench *bench, double start) {
+    if (atomic_load(&bench->shared.abort)) return true;
+    if (now_s() - start > BENCH_PHASE_TIMEOUT_S) {
+        fprintf(stderr, "bench: phase timed out\n");
+        atomic_store(&bench->shared.abort, true);
+        return true;
+    }
+    return false;
+}
+
+static struct lw_output *first_output(struct lw_server *server) {
+    if (wl_list_empty(&server->outputs)) return NULL;
+    struct lw_output *output;
+    output = wl_container_of(server->outputs.next, output, link);
+    return output;
+}
+
+/* Keep IPC events flowing while clients come and go: refocus the next
+ * window and re-announce the workspace on every loop iteration */
+static void churn_tick(struct bench *bench) {
+    struct lw_server *server = &bench->server;
+    if (!wl_list_empty(&server->views)) {
+        struct lw_view *view;
+        view = wl_container_of(server->views.prev, view, link);
+        lw_view_focus(view);
+    }
+    lw_ipc_send_workspace(server);
+}
+
+/* Publish a phase and serve the clients until all of them report in,
+ * calling tick (if any) before every dispatch */
+static bool run_client_phase(struct bench *bench, enum bench_phase phase,
+                             void (*tick)(struct bench *bench)) {
+    atomic_store(&bench->shared.clients_done, 0);
+    atomic_store(&bench->shared.phase, phase);
+
+    double start = now_s();
+    while (atomic_load(&bench->shared.clients_done) < bench->client_count) {
+        if (timed_out(bench, start)) return false;
+        if (tick) tick(bench);
+        dispatch(bench, 1);
+    }
+    return true;
+}
+
+static bool view_settled(struct lw_view *view) {
+    struct wlr_xdg_toplevel *toplevel = view->xdg_toplevel;
+    return toplevel->current.width == toplevel->scheduled.width &&
+        toplevel->current.height == toplevel->scheduled.height;
+}
+
+/* Wait until every view has committed the size it was configured with,
+ * recording each view's latency from start */
+static bool wait_views_settled(struct bench *bench, enum bench_phase phase,
+                               double start, bool record) {
+    struct lw_server *server = &bench->server;
+    int count = wl_list_length(&server->views);
+    bool *settled = calloc(count, sizeof(*settled));
+    if (!settled) return false;
+
+    int remaining = count;
+    while (remaining > 0) {
+        if (timed_out(bench, start)) {
+            free(settled);
+            return false;
+        }
+        dispatch(bench, 1);
+
+        int i = 0;
+        struct lw_view *view;
+        wl_list_for_each(view, &server->views, link) {
+            if (i < count && !settled[i] && view_settled(view)) {
+                settled[i] = true;
+                remaining--;
+                if (record) {
+                    lw_histogram_record(&bench->shared.latency[phase],
+                                        (uint64_t)((now_s() - start) * 1e6));
+                    atomic_fetch_add(&bench->shared.ops[phase], 1);
+                }
+            }
+            i++;
+        }
+    }
+    free(settled);
+    return true;
+}
+
+/* Snap every window through all zones; latency runs from the snap to
+ * the client committing a buffer of the new size */
+static bool run_snap(struct bench *bench) {
+    static const enum lw_snap_zone zones[] = {
+        LW_SNAP_LEFT, LW_SNAP_RIGHT, LW_SNAP_TOP_LEFT, LW_SNAP_TOP_RIGHT,
+        LW_SNAP_BOTTOM_LEFT, LW_SNAP_BOTTOM_RIGHT, LW_SNAP_MAXIMIZE,
+    };
+    const int zone_count = sizeof(zones) / sizeof(zones[0]);
+    struct lw_server *server = &bench->server;
+    struct lw_view *view;
+
+    for (int round = 0; round < bench->shared.iterations; round++) {
+        double start = now_s();
+        wl_list_for_each(view, &server->views, link) {
+            lw_view_snap(view, zones[round % zone_count]);
+        }
+        if (!wait_views_settled(bench, BENCH_PHASE_SNAP, start, true)) {
+            return false;
+        }
+    }
+
+    double start = now_s();
+    wl_list_for_each(view, &server->views, link) {
+        lw_view_restore(view);
+    }
+    return wait_views_settled(bench, BENCH_PHASE_SNAP, start, false);
+}
+
+/* Split the windows over two workspaces and flip between them; latency
+ * runs from the switch to the output committing the new frame */
+static bool run_workspace(struct bench *bench) {
+    struct lw_server *server = &bench->server;
+    struct lw_output *output = first_output(server);
+    struct lw_workspace *home = server->active_workspace;
+    struct lw_workspace *other = lw_workspace_create(server, "Bench 2");
+
+    if (!other) return false;
+
+    /* The least recently focused half, so focus stays where it is */
+    int half = wl_list_length(&home->views) / 2;
+    for (int i = 0; i < half; i++) {
+        struct lw_view *view =
+            wl_container_of(home->views.prev, view, workspace_link);
+        lw_workspace_move_view(view, other);
+    }
+
+    for (int n = 0; n < bench->shared.iterations * 4; n++) {
+        uint64_t committed = output->frames_committed;
+        double start = now_s();
+        lw_workspace_switch(server, (n % 2) ? home : other);
+
+        while (output->frames_committed == committed) {
+            if (timed_out(bench, start)) return false;
+            dispatch(bench, 1);
+        }
+        lw_histogram_record(&bench->shared.latency[BENCH_PHASE_WORKSPACE],
+                            (uint64_t)((now_s() - start) * 1e6));
+        atomic_fetch_add(&bench->shared.ops[BENCH_PHASE_WORKSPACE], 1);
+    }
+
+    lw_workspace_switch(server, home);
+    return true;
+}
+
+/* Thumbnail every window from scratch, over and over; latency covers
+ * the memfd setup and the downscale of the window's current buffer */
+static bool run_thumbnail(struct bench *bench) {
+    struct lw_server *server = &bench->server;
+    struct lw_view *view;
+
+    for (int round = 0; round < bench->shared.iterations; round++) {
+        wl_list_for_each(view, &server->views, link) {
+            lw_thumbnail_view_destroy(view);
+            double start = now_s();
+            struct lw_thumbnail *thumb = lw_thumbnail_request(view);
+            if (!thumb) return false;
+            if (thumb->shared->seq == 0) continue;
+            lw_histogram_record(
+                &bench->shared.latency[BENCH_PHASE_THUMBNAIL],
+                (uint64_t)((now_s() - start) * 1e6));
+            atomic_fetch_add(&bench->shared.ops[BENCH_PHASE_THUMBNAIL], 1);
+        }
+        /* Let the THUMBNAIL_CHANGED traffic drain */
+        dispatch(bench, 0);
+    }
+
+    wl_list_for_each(view, &server->views, link) {
+        lw_thumbnail_release(view);
+    }
+    return true;
+}
+
+static void print_histogram(FILE *out, const char *name,
+                            const struct lw_histogram *hist) {
+    fprintf(out, "\"%s\": {\"p50\": %" PRIu64 ", \"p90\": %" PRIu64
+            ", \"p99\": %" PRIu64 ", \"max\": %" PRIu64 "}", name,
+            lw_histogram_percentile(hist, 50),
+            lw_histogram_percentile(hist, 90),
+            lw_histogram_percentile(hist, 99),
+            lw_histogram_max(hist));
+}
+
+static void print_report(struct bench *bench, FILE *out, bool ok) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"ok\": %s,\n", ok ? "true" : "false");
+    fprintf(out, "  \"clients\": %d,\n", bench->client_count);
+    fprintf(out, "  \"iterations\": %d,\n", bench->shared.iterations);
+    fprintf(out, "  \"churn_open\": %d,\n", bench->shared.churn_open);
+    fprintf(out, "  \"output\": \"%dx%d\",\n",
+            BENCH_OUTPUT_WIDTH, BENCH_OUTPUT_HEIGHT);
+
+    fprintf(out, "  \"phases\": {\n");
+    for (int p = BENCH_PHASE_MAP_UNMAP; p < BENCH_PHASE_DONE; p++) {
+        uint64_t ops = atomic_load(&bench->shared.ops[p]);
+        double seconds = bench->seconds[p];
+        fprintf(out, "    \"%s\": {\"ops\": %" PRIu64 ", \"seconds\": %.3f, "
+                "\"ops_per_sec\": %.1f, ", phase_names[p], ops, seconds,
+                seconds > 0 ? ops / seconds : 0.0);
+        print_histogram(out, "latency_us", &bench->shared.latency[p]);
+        fprintf(out, "}%s\n", p + 1 < BENCH_PHASE_DONE ? "," : "");
+    }
+    fprintf(out, "  },\n");
+
+    fprintf(out, "  \"outputs\": {\n");
+    struct lw_output *output;
+    wl_list_for_each(output, &bench->server.outputs, link) {
+        fprintf(out, "    \"%s\": {\"frames_committed\": %" PRIu64
+                ", \"frames_skipped\": %" PRIu64
+                ", \"frames_scanout\": %" PRIu64
+                ", \"frames_composited\": %" PRIu64
+                ", \"scanning_out\": %s, ",
+                output->wlr_output->name, output->frames_committed,
+                output->frames_skipped, output->frames_scanout,
+                output->frames_composited,
+                output->scanning_out ? "true" : "false");
+        print_histogram(out, "commit_us", &output->hist_commit);
+        fprintf(out, ", ");
+        print_histogram(out, "frame_latency_us", &output->hist_latency);
+        fprintf(out, "}%s\n",
+                output->link.next != &bench->server.outputs ? "," : "");
+    }
+    fprintf(out, "  },\n");
+
+    struct lw_ipc *ipc = &bench->server.ipc;
+    fprintf(out, "  \"ipc_queue\": {\"messages_serialized\": %" PRIu64
+            ", \"messages_queued\": %" PRIu64
+            ", \"messages_coalesced\": %" PRIu64
+            ", \"sendmsg_calls\": %" PRIu64 ", \"bytes_sent\": %" PRIu64
+            ", \"queue_high_water\": %" PRIu64
+            ", \"slow_disconnects\": %" PRIu64
+            ", \"clients_accepted\": %" PRIu64
+            ", \"clients_peak\": %d}",
+            ipc->messages_serialized, ipc->messages_queued,
+            ipc->messages_coalesced,
+            ipc->sendmsg_calls, ipc->bytes_sent, ipc->queue_high_water,
+            ipc->slow_disconnects, ipc->clients_accepted,
+            ipc->clients_peak);
+
+    const struct bench_titlebar *titlebar = &bench->titlebar;
+    fprintf(out, ",\n  \"titlebar\": {\"renders\": %" PRIu64
+            ", \"layout_hits\": %" PRIu64 ", \"layout_misses\": %" PRIu64
+            ", \"cached_seconds\": %.4f, \"fresh_seconds\": %.4f, "
+            "\"speedup\": %.2f, ",
+            titlebar->renders, titlebar->layout_hits, titlebar->layout_misses,
+            titlebar->cached_seconds, titlebar->fresh_seconds,
+            titlebar->cached_seconds > 0 ?
+                titlebar->fresh_seconds / titlebar->cached_seconds : 0.0);
+    print_histogram(out, "cached_us", &titlebar->cached);
+    fprintf(out, ", ");
+    print_histogram(out, "fresh_us", &titlebar->fresh);
+    fprintf(out, "}");
+
+    struct lw_thumbnailer *thumbnailer = bench->server.thumbnailer;
+    if (thumbnailer) {
+        fprintf(out, ",\n  \"thumbnails\": {\"redraws\": %" PRIu64
+                ", \"deferred\": %" PRIu64 ", \"evictions\": %" PRIu64
+                ", \"unreadable\": %" PRIu64 ", \"bytes\": %zu}",
+                thumbnailer->redraws, thumbnailer->deferred,
+                thumbnailer->evictions, thumbnailer->unreadable,
+                thumbnailer->bytes);
+    }
+    fprintf(out, "\n}\n");
+}
+
+static void find_headless(struct wlr_backend *backend, void *data) {
+    struct wlr_backend **headless = data;
+    if (wlr_backend_is_headless(backend)) {
+        *headless = backend;
+    }
+}
+
+static bool start_server(struct bench *bench) {
+    struct lw_server *server = &bench->server;
+
+    if (lw_server_init(server) != 0) return false;
+    bench->server_ready = true;
+
+    struct wlr_backend *headless = NULL;
+    wlr_multi_for_each_backend(server->backend, find_headless, &headless);
+    if (!headless) {
+        fprintf(stderr, "bench: headless backend not available\n");
+        return false;
+    }
+    if (!wlr_backend_start(server->backend)) return false;
+    wlr_headless_add_output(headless, BENCH_OUTPUT_WIDTH,
+                            BENCH_OUTPUT_HEIGHT);
+
+    double start = now_s();
+    while (!first_output(server)) {
+        if (timed_out(bench, start)) return false;
+        dispatch(bench, 1);
+    }
+    return true;
+}
+
+/* Every churn connection costs two descriptors in this process, the
+ * client end and the compositor's; raise the limit as far as allowed
+ * and shrink the batches if that is still not enough */
+static int fit_churn_open(int client_count, int churn_open) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return churn_open;
+    if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    rlim_t needed = (rlim_t)client_count * churn_open * 2 + BENCH_FD_RESERVE;
+    if (limit.rlim_cur == RLIM_INFINITY || needed <= limit.rlim_cur) {
+        return churn_open;
+    }
+    int fit = limit.rlim_cur > BENCH_FD_RESERVE ?
+        (int)((limit.rlim_cur - BENCH_FD_RESERVE) / (2 * client_count)) : 0;
+    if (fit < 1) fit = 1;
+    fprintf(stderr, "bench: fd limit %llu, churning %d connections per "
+            "client instead of %d\n", (unsigned long long)limit.rlim_cur,
+            fit, churn_open);
+    return fit;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-c clients] [-n iterations] "
+            "[-k churn_conns] [-o file.json] [-v]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    int client_count = 8;
+    int iterations = 50;
+    int churn_open = BENCH_CHURN_OPEN;
+    const char *out_path = NULL;
+    bool verbose = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:n:k:o:vh")) != -1) {
+        switch (opt) {
+        case 'c':
+            client_count = atoi(optarg);
+            break;
+        case 'n':
+            iterations = atoi(optarg);
+            break;
+        case 'k':
+            churn_open = atoi(optarg);
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (client_count < 1 || iterations < 1 || churn_open < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    /* No GPU, no seat: headless backend, software renderer, and a private
+     * runtime dir so parallel runs don't fight over sockets */
+    setenv("WLR_BACKENDS", "headless", 1);
+    setenv("WLR_RENDERER", "pixman", 0);
+    char runtime_dir[] = "/tmp/lwindesk-bench-XXXXXX";
+    if (!mkdtemp(runtime_dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    setenv("XDG_RUNTIME_DIR", runtime_dir, 1);
+
+    wlr_log_init(verbose ? WLR_DEBUG : WLR_ERROR, NULL);
+
+    struct bench *bench = calloc(1, sizeof(*bench));
+    bench->client_count = client_count;
+    bench->shared.iterations = iterations;
+    bench->shared.churn_open = fit_churn_open(client_count, churn_open);
+
+    bool ok = start_server(bench);
+    bench->shared.socket = bench->server.socket;
+    bench->shared.ipc_path = bench->server.ipc.socket_path;
+
+    struct bench_client **clients = calloc(client_count, sizeof(*clients));
+    int started = 0;
+    for (; ok && started < client_count; started++) {
+        clients[started] = bench_client_start(&bench->shared, started);
+        if (!clients[started]) ok = false;
+    }
+
+    for (int p = BENCH_PHASE_CONNECT; ok && p < BENCH_PHASE_DONE; p++) {
+        double start = now_s();
+        ok = run_client_phase(bench, p,
+                              p == BENCH_PHASE_IPC_CHURN ? churn_tick : NULL);
+        if (ok && p == BENCH_PHASE_SNAP) ok = run_snap(bench);
+        if (ok && p == BENCH_PHASE_WORKSPACE) ok = run_workspace(bench);
+        if (ok && p == BENCH_PHASE_THUMBNAIL) ok = run_thumbnail(bench);
+        bench->seconds[p] = now_s() - start;
+    }
+
+    /* Clients exit on DONE or abort without needing the server */
+    if (!ok) atomic_store(&bench->shared.abort, true);
+    atomic_store(&bench->shared.phase, BENCH_PHASE_DONE);
+    for (int i = 0; i < started; i++) {
+        if (clients[i] && bench_client_join(clients[i]) != 0) ok = false;
+    }
+    free(clients);
+
+    if (ok) {
+        ok = bench_titlebar_run(&bench->titlebar, bench->server.buffer_pool,
+                                iterations);
+    }
+
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        perror(out_path);
+        out = stdout;
+    }
+    if (bench->server_ready) {
+        print_report(bench, out, ok);
+    }
+    if (out != stdout) fclose(out);
+
+    if (bench->server_ready) {
+        lw_server_destroy(&bench->server);
+    }
+    free(bench);
+    rmdir(runtime_dir);
+
+    return ok ? 0 : 1;
+}
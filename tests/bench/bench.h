@@ -0,0 +1,82 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * tests/bench/bench.h - Headless end-to-end benchmark
+ */
+
+#ifndef LWINDESK_BENCH_H
+#define LWINDESK_BENCH_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "histogram.h"
+
+/*
+ * The benchmark runs in lock step: the compositor thread publishes a
+ * phase, every client thread runs its share of it and bumps
+ * clients_done, then idles (still answering configures) until the next
+ * phase is published.  Snap, workspace and thumbnail phases are driven
+ * from the compositor side; clients only have to keep up with the
+ * resizes.
+ */
+enum bench_phase {
+    BENCH_PHASE_CONNECT = 0,     /* bind globals, map one window */
+    BENCH_PHASE_MAP_UNMAP,       /* map and destroy extra windows */
+    BENCH_PHASE_COMMIT_STORM,    /* commit frames as fast as allowed */
+    BENCH_PHASE_TITLE_CHURN,     /* retitle + roundtrip */
+    BENCH_PHASE_SNAP,            /* compositor snaps every view */
+    BENCH_PHASE_WORKSPACE,       /* compositor switches workspaces */
+    BENCH_PHASE_THUMBNAIL,       /* compositor thumbnails every view */
+    BENCH_PHASE_IPC,             /* IPC clients pipeline PING requests */
+    BENCH_PHASE_IPC_CHURN,       /* IPC connect/disconnect under events */
+    BENCH_PHASE_DONE,
+    BENCH_PHASE_COUNT,
+};
+
+struct bench_shared {
+    const char *socket;          /* WAYLAND_DISPLAY of the server */
+    const char *ipc_path;        /* compositor IPC socket */
+    int iterations;
+    int churn_open;              /* IPC connections per client in churn */
+
+    _Atomic int phase;
+    _Atomic int clients_done;    /* clients finished with the phase */
+    _Atomic bool abort;          /* a client failed; stop everything */
+
+    /* Per phase: operation count and latency in microseconds */
+    _Atomic uint64_t ops[BENCH_PHASE_COUNT];
+    struct lw_histogram latency[BENCH_PHASE_COUNT];
+};
+
+/* Cached vs. from-scratch title bar rendering, same titles and widths */
+struct bench_titlebar {
+    uint64_t renders;            /* title bars rendered by each path */
+    double cached_seconds, fresh_seconds;
+    struct lw_histogram cached;  /* microseconds per render */
+    struct lw_histogram fresh;
+    uint64_t layout_hits, layout_misses;
+};
+
+struct bench_client;
+struct lw_buffer_pool;
+
+/* Start a synthetic xdg-shell client on its own thread */
+struct bench_client *bench_client_start(struct bench_shared *shared, int id);
+
+/* Wait for the client thread to exit; returns 0 if it ran every phase */
+int bench_client_join(struct bench_client *client);
+
+/* Run the IPC phase over a fresh connection to the IPC socket */
+bool bench_ipc_run(struct bench_shared *shared, int id);
+
+/* Open and close batches of subscribed IPC connections */
+bool bench_ipc_churn(struct bench_shared *shared, int id);
+
+/* Time both title bar paths; cached buffers come from the given pool */
+bool bench_titlebar_run(struct bench_titlebar *result,
+                        struct lw_buffer_pool *pool, int iterations);
+
+#endif /* LWINDESK_BENCH_H */
@@ -0,0 +1,517 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * tests/bench/bench_client.c - Synthetic xdg-shell client for the benchmark
+ *
+ * Each client is a thread with its own wl_display connection and one
+ * long-lived toplevel backed by shm buffers.  The work per phase is
+ * described in bench.h.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+#include "bench.h"
+#include "xdg-shell-client-protocol.h"
+
+/* Give up on any single wait after this long */
+#define BENCH_WAIT_TIMEOUT_MS 10000
+
+#define BENCH_DEFAULT_WIDTH 640
+#define BENCH_DEFAULT_HEIGHT 480
+
+struct bench_buffer {
+    struct wl_buffer *wl_buffer;
+    void *data;
+    size_t size;
+    int width, height;
+    bool busy;                   /* attached and not yet released */
+};
+
+struct bench_window {
+    struct bench_client *client;
+    struct wl_surface *surface;
+    struct xdg_surface *xdg_surface;
+    struct xdg_toplevel *xdg_toplevel;
+    struct bench_buffer buffers[2];
+
+    int width, height;           /* size to draw at */
+    int configure_width, configure_height;
+    bool configured;
+    bool mapped;
+    bool resize_pending;         /* configured with a new size */
+    bool frame_done;
+    uint32_t frame;
+};
+
+struct bench_client {
+    int id;
+    struct bench_shared *shared;
+    pthread_t thread;
+    int result;
+
+    struct wl_display *display;
+    struct wl_registry *registry;
+    struct wl_compositor *compositor;
+    struct wl_shm *shm;
+    struct xdg_wm_base *wm_base;
+
+    struct bench_window window;
+};
+
+static int64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void record(struct bench_client *client, enum bench_phase phase,
+                   int64_t start_us) {
+    int64_t elapsed = now_us() - start_us;
+    lw_histogram_record(&client->shared->latency[phase],
+                        elapsed > 0 ? (uint64_t)elapsed : 0);
+    atomic_fetch_add_explicit(&client->shared->ops[phase], 1,
+                              memory_order_relaxed);
+}
+
+/* --- Buffers --- */
+
+static void buffer_release(void *data, struct wl_buffer *wl_buffer) {
+    struct bench_buffer *buffer = data;
+    buffer->busy = false;
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+    .release = buffer_release,
+};
+
+static void buffer_finish(struct bench_buffer *buffer) {
+    if (buffer->wl_buffer) {
+        wl_buffer_destroy(buffer->wl_buffer);
+    }
+    if (buffer->data) {
+        munmap(buffer->data, buffer->size);
+    }
+    memset(buffer, 0, sizeof(*buffer));
+}
+
+static bool buffer_init(struct bench_client *client,
+                        struct bench_buffer *buffer, int width, int height) {
+    int stride = width * 4;
+    size_t size = (size_t)stride * height;
+
+    int fd = memfd_create("lwindesk-bench", MFD_CLOEXEC);
+    if (fd < 0) return false;
+    if (ftruncate(fd, size) < 0) {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+
+    struct wl_shm_pool *pool = wl_shm_create_pool(client->shm, fd, size);
+    buffer->wl_buffer = wl_shm_pool_create_buffer(pool, 0, width, height,
+                                                  stride,
+                                                  WL_SHM_FORMAT_XRGB8888);
+    wl_shm_pool_destroy(pool);
+    close(fd);
+
+    buffer->data = data;
+    buffer->size = size;
+    buffer->width = width;
+    buffer->height = height;
+    buffer->busy = false;
+    wl_buffer_add_listener(buffer->wl_buffer, &buffer_listener, buffer);
+    return true;
+}
+
+/* --- Event handling --- */
+
+static int client_dispatch(struct bench_client *client, int timeout_ms) {
+    struct wl_display *display = client->display;
+
+    while (wl_display_prepare_read(display) != 0) {
+        if (wl_display_dispatch_pending(display) < 0) return -1;
+    }
+    if (wl_display_flush(display) < 0 && errno != EAGAIN) {
+        wl_display_cancel_read(display);
+        return -1;
+    }
+
+    struct pollfd pfd = {
+        .fd = wl_display_get_fd(display),
+        .events = POLLIN,
+    };
+    int ret = poll(&pfd, 1, timeout_ms);
+    if (ret <= 0) {
+        wl_display_cancel_read(display);
+        return (ret < 0 && errno != EINTR) ? -1 : 0;
+    }
+
+    if (wl_display_read_events(display) < 0) return -1;
+    return wl_display_dispatch_pending(display) < 0 ? -1 : 0;
+}
+
+static bool window_draw(struct bench_window *window, bool want_frame);
+
+/* Dispatch until *flag is set; false on error, timeout or abort */
+static bool client_wait(struct bench_client *client, const bool *flag) {
+    int64_t deadline = now_us() + BENCH_WAIT_TIMEOUT_MS * 1000LL;
+
+    while (!*flag) {
+        if (atomic_load(&client->shared->abort)) return false;
+        if (now_us() > deadline) {
+            fprintf(stderr, "bench client %d: timed out\n", client->id);
+            return false;
+        }
+        if (client_dispatch(client, 10) < 0) return false;
+    }
+    return true;
+}
+
+static void frame_done(void *data, struct wl_callback *callback,
+                       uint32_t time) {
+    struct bench_window *window = data;
+    window->frame_done = true;
+    wl_callback_destroy(callback);
+}
+
+static const struct wl_callback_listener frame_listener = {
+    .done = frame_done,
+};
+
+static void xdg_surface_configure(void *data,
+                                  struct xdg_surface *xdg_surface,
+                                  uint32_t serial) {
+    struct bench_window *window = data;
+    xdg_surface_ack_configure(xdg_surface, serial);
+
+    int width = window->configure_width > 0 ?
+        window->configure_width : BENCH_DEFAULT_WIDTH;
+    int height = window->configure_height > 0 ?
+        window->configure_height : BENCH_DEFAULT_HEIGHT;
+    if (width != window->width || height != window->height) {
+        window->width = width;
+        window->height = height;
+        window->resize_pending = window->mapped;
+    }
+    window->configured = true;
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+    .configure = xdg_surface_configure,
+};
+
+static void xdg_toplevel_configure(void *data,
+                                   struct xdg_toplevel *xdg_toplevel,
+                                   int32_t width, int32_t height,
+                                   struct wl_array *states) {
+    struct bench_window *window = data;
+    window->configure_width = width;
+    window->configure_height = height;
+}
+
+static void xdg_toplevel_close(void *data,
+                               struct xdg_toplevel *xdg_toplevel) {
+    /* The compositor never closes benchmark windows on its own */
+}
+
+static const struct xdg_toplevel_listener xdg_toplevel_listener = {
+    .configure = xdg_toplevel_configure,
+    .close = xdg_toplevel_close,
+};
+
+static void wm_base_ping(void *data, struct xdg_wm_base *wm_base,
+                         uint32_t serial) {
+    xdg_wm_base_pong(wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener wm_base_listener = {
+    .ping = wm_base_ping,
+};
+
+static void registry_global(void *data, struct wl_registry *registry,
+                            uint32_t name, const char *interface,
+                            uint32_t version) {
+    struct bench_client *client = data;
+
+    if (strcmp(interface, wl_compositor_interface.name) == 0) {
+        client->compositor = wl_registry_bind(registry, name,
+                                              &wl_compositor_interface, 4);
+    } else if (strcmp(interface, wl_shm_interface.name) == 0) {
+        client->shm = wl_registry_bind(registry, name,
+                                       &wl_shm_interface, 1);
+    } else if (strcmp(interface, xdg_wm_base_interface.name) == 0) {
+        client->wm_base = wl_registry_bind(registry, name,
+                                           &xdg_wm_base_interface, 1);
+        xdg_wm_base_add_listener(client->wm_base, &wm_base_listener, client);
+    }
+}
+
+static void registry_global_remove(void *data, struct wl_registry *registry,
+                                   uint32_t name) {
+}
+
+static const struct wl_registry_listener registry_listener = {
+    .global = registry_global,
+    .global_remove = registry_global_remove,
+};
+
+/* --- Windows --- */
+
+static bool window_draw(struct bench_window *window, bool want_frame) {
+    struct bench_client *client = window->client;
+
+    /* Wait for the compositor to let go of one of the two buffers */
+    struct bench_buffer *buffer = NULL;
+    int64_t deadline = now_us() + BENCH_WAIT_TIMEOUT_MS * 1000LL;
+    while (!buffer) {
+        for (int i = 0; i < 2; i++) {
+            if (!window->buffers[i].busy) {
+                buffer = &window->buffers[i];
+                break;
+            }
+        }
+        if (buffer) break;
+        if (atomic_load(&client->shared->abort) || now_us() > deadline ||
+                client_dispatch(client, 10) < 0) {
+            return false;
+        }
+    }
+
+    if (buffer->width != window->width || buffer->height != window->height) {
+        buffer_finish(buffer);
+        if (!buffer_init(client, buffer, window->width, window->height)) {
+            return false;
+        }
+    }
+
+    /* Different content every frame so the damage is real */
+    window->frame++;
+    memset(buffer->data, 0x20 + (window->frame * 7 + client->id * 31) % 0xc0,
+           buffer->size);
+
+    wl_surface_attach(window->surface, buffer->wl_buffer, 0, 0);
+    wl_surface_damage_buffer(window->surface, 0, 0,
+                             window->width, window->height);
+    if (want_frame) {
+        window->frame_done = false;
+        struct wl_callback *callback = wl_surface_frame(window->surface);
+        wl_callback_add_listener(callback, &frame_listener, window);
+    }
+    wl_surface_commit(window->surface);
+    buffer->busy = true;
+    window->resize_pending = false;
+    return true;
+}
+
+static bool window_map(struct bench_client *client,
+                       struct bench_window *window, const char *title) {
+    memset(window, 0, sizeof(*window));
+    window->client = client;
+
+    window->surface = wl_compositor_create_surface(client->compositor);
+    window->xdg_surface = xdg_wm_base_get_xdg_surface(client->wm_base,
+                                                      window->surface);
+    xdg_surface_add_listener(window->xdg_surface, &xdg_surface_listener,
+                             window);
+    window->xdg_toplevel = xdg_surface_get_toplevel(window->xdg_surface);
+    xdg_toplevel_add_listener(window->xdg_toplevel, &xdg_toplevel_listener,
+                              window);
+    xdg_toplevel_set_app_id(window->xdg_toplevel, "lwindesk-bench");
+    xdg_toplevel_set_title(window->xdg_toplevel, title);
+    wl_surface_commit(window->surface);
+
+    if (!client_wait(client, &window->configured)) return false;
+    if (!window_draw(window, true)) return false;
+    if (!client_wait(client, &window->frame_done)) return false;
+    window->mapped = true;
+    return true;
+}
+
+static void window_destroy(struct bench_window *window) {
+    if (window->xdg_toplevel) xdg_toplevel_destroy(window->xdg_toplevel);
+    if (window->xdg_surface) xdg_surface_destroy(window->xdg_surface);
+    if (window->surface) wl_surface_destroy(window->surface);
+    for (int i = 0; i < 2; i++) {
+        buffer_finish(&window->buffers[i]);
+    }
+    memset(window, 0, sizeof(*window));
+}
+
+/* --- Phases --- */
+
+static bool run_map_unmap(struct bench_client *client) {
+    char title[64];
+
+    for (int i = 0; i < client->shared->iterations; i++) {
+        struct bench_window window;
+        snprintf(title, sizeof(title), "bench %d transient %d",
+                 client->id, i);
+
+        int64_t start = now_us();
+        bool ok = window_map(client, &window, title);
+        if (ok) record(client, BENCH_PHASE_MAP_UNMAP, start);
+        window_destroy(&window);
+        if (!ok) return false;
+    }
+    return wl_display_roundtrip(client->display) >= 0;
+}
+
+static bool run_commit_storm(struct bench_client *client) {
+    struct bench_window *window = &client->window;
+
+    for (int i = 0; i < client->shared->iterations * 10; i++) {
+        int64_t start = now_us();
+        if (!window_draw(window, true)) return false;
+        if (!client_wait(client, &window->frame_done)) return false;
+        record(client, BENCH_PHASE_COMMIT_STORM, start);
+    }
+    return true;
+}
+
+static bool run_title_churn(struct bench_client *client) {
+    char title[64];
+
+    for (int i = 0; i < client->shared->iterations * 10; i++) {
+        snprintf(title, sizeof(title), "bench %d: document %d - Editor",
+                 client->id, i);
+
+        int64_t start = now_us();
+        xdg_toplevel_set_title(client->window.xdg_toplevel, title);
+        if (wl_display_roundtrip(client->display) < 0) return false;
+        record(client, BENCH_PHASE_TITLE_CHURN, start);
+    }
+    return true;
+}
+
+/* Idle until the compositor publishes another phase, keeping up with any
+ * configure it sends meanwhile */
+static bool wait_phase(struct bench_client *client, int phase) {
+    struct bench_shared *shared = client->shared;
+
+    while (atomic_load(&shared->phase) < phase) {
+        if (atomic_load(&shared->abort)) return false;
+        if (client_dispatch(client, 10) < 0) return false;
+        if (client->window.resize_pending &&
+                !window_draw(&client->window, false)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool client_connect(struct bench_client *client) {
+    client->display = wl_display_connect(client->shared->socket);
+    if (!client->display) {
+        fprintf(stderr, "bench client %d: cannot connect to %s\n",
+                client->id, client->shared->socket);
+        return false;
+    }
+
+    client->registry = wl_display_get_registry(client->display);
+    wl_registry_add_listener(client->registry, &registry_listener, client);
+    if (wl_display_roundtrip(client->display) < 0) return false;
+
+    if (!client->compositor || !client->shm || !client->wm_base) {
+        fprintf(stderr, "bench client %d: missing globals\n", client->id);
+        return false;
+    }
+
+    char title[64];
+    snprintf(title, sizeof(title), "bench %d", client->id);
+    return window_map(client, &client->window, title);
+}
+
+static void client_disconnect(struct bench_client *client) {
+    if (!client->display) return;
+
+    window_destroy(&client->window);
+    if (client->wm_base) xdg_wm_base_destroy(client->wm_base);
+    if (client->shm) wl_shm_destroy(client->shm);
+    if (client->compositor) wl_compositor_destroy(client->compositor);
+    if (client->registry) wl_registry_destroy(client->registry);
+    wl_display_disconnect(client->display);
+    client->display = NULL;
+}
+
+static void *client_thread(void *data) {
+    struct bench_client *client = data;
+    struct bench_shared *shared = client->shared;
+    bool ok = client_connect(client);
+
+    for (int phase = BENCH_PHASE_CONNECT; ok && phase < BENCH_PHASE_DONE;
+            phase++) {
+        ok = wait_phase(client, phase);
+        if (!ok) break;
+
+        switch (phase) {
+        case BENCH_PHASE_MAP_UNMAP:
+            ok = run_map_unmap(client);
+            break;
+        case BENCH_PHASE_COMMIT_STORM:
+            ok = run_commit_storm(client);
+            break;
+        case BENCH_PHASE_TITLE_CHURN:
+            ok = run_title_churn(client);
+            break;
+        case BENCH_PHASE_IPC:
+            ok = bench_ipc_run(shared, client->id);
+            break;
+        case BENCH_PHASE_IPC_CHURN:
+            ok = bench_ipc_churn(shared, client->id);
+            break;
+        default:
+            /* Connect was done above; snap, workspace and thumbnail
+             * are driven by the compositor while we wait for the next
+             * phase */
+            break;
+        }
+        if (ok) atomic_fetch_add(&shared->clients_done, 1);
+    }
+
+    if (ok) ok = wait_phase(client, BENCH_PHASE_DONE);
+    if (!ok) {
+        fprintf(stderr, "bench client %d failed in phase %d\n",
+                client->id, atomic_load(&shared->phase));
+        atomic_store(&shared->abort, true);
+    }
+
+    client_disconnect(client);
+    client->result = ok ? 0 : -1;
+    return NULL;
+}
+
+struct bench_client *bench_client_start(struct bench_shared *shared, int id) {
+    struct bench_client *client = calloc(1, sizeof(*client));
+    if (!client) return NULL;
+    client->id = id;
+    client->shared = shared;
+
+    if (pthread_create(&client->thread, NULL, client_thread, client) != 0) {
+        free(client);
+        return NULL;
+    }
+    return client;
+}
+
+int bench_client_join(struct bench_client *client) {
+    pthread_join(client->thread, NULL);
+    int result = client->result;
+    free(client);
+    return result;
+}
@@ -0,0 +1,155 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * tests/bench/bench_deco.c - Title bar rendering microbenchmark
+ *
+ * Renders the same set of titles two ways: through lw_deco_cache (shaped
+ * layouts and the button strip reused, buffers from the server's pool)
+ * and from scratch the way view.c used to, with a new cairo context,
+ * PangoLayout and font description per title bar.  Both are timed per
+ * render so the report shows what the cache buys on a redraw.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <time.h>
+#include <cairo/cairo.h>
+#include <pango/pangocairo.h>
+
+#include "bench.h"
+#include "deco_cache.h"
+#include "view.h"
+
+/* Fewer than LW_DECO_LAYOUT_CACHE_SIZE, so the cached path runs warm */
+static const char *bench_titles[] = {
+    "Terminal",
+    "~/src/lwindesk - vim",
+    "Files - Downloads",
+    "Settings",
+    "Inbox (3) - Mail",
+    "lwindesk/compositor/src/view.c at main - Web Browser",
+    "Untitled Document 1 - Text Editor",
+    "Calculator",
+    "Music - Now Playing: A Rather Long Track Name (Extended Mix)",
+    "System Monitor",
+    "Image Viewer - IMG_20260412_183015.jpg",
+    "Chat - #general",
+};
+
+#define BENCH_TITLE_COUNT (sizeof(bench_titles) / sizeof(bench_titles[0]))
+
+/* Window widths the titles are rendered at, narrow enough to ellipsize */
+static const int bench_widths[] = { 320, 800, 1280, 1920 };
+
+#define BENCH_WIDTH_COUNT (sizeof(bench_widths) / sizeof(bench_widths[0]))
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* The uncached render: everything built and torn down per call */
+static bool render_fresh(int width, int height, const char *title) {
+    size_t stride = (size_t)width * 4;
+    void *data = calloc(1, stride * height);
+    if (!data) return false;
+
+    cairo_surface_t *surface = cairo_image_surface_create_for_data(
+        data, CAIRO_FORMAT_ARGB32, width, height, stride);
+    cairo_t *cr = cairo_create(surface);
+
+    cairo_set_source_rgb(cr, 0.169, 0.169, 0.169);
+    cairo_paint(cr);
+
+    cairo_set_source_rgb(cr, 0.769, 0.169, 0.110);
+    cairo_rectangle(cr, width - LW_DECO_BUTTON_WIDTH, 0,
+                    LW_DECO_BUTTON_WIDTH, height);
+    cairo_fill(cr);
+
+    cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+    cairo_set_line_width(cr, 1.0);
+    int cy = height / 2;
+
+    int cx = width - LW_DECO_BUTTON_WIDTH / 2;
+    cairo_move_to(cr, cx - 5, cy - 5);
+    cairo_line_to(cr, cx + 5, cy + 5);
+    cairo_move_to(cr, cx + 5, cy - 5);
+    cairo_line_to(cr, cx - 5, cy + 5);
+    cairo_stroke(cr);
+
+    int mx = width - LW_DECO_BUTTON_WIDTH - LW_DECO_BUTTON_WIDTH / 2;
+    cairo_rectangle(cr, mx - 5, cy - 5, 10, 10);
+    cairo_stroke(cr);
+
+    int nx = width - 2 * LW_DECO_BUTTON_WIDTH - LW_DECO_BUTTON_WIDTH / 2;
+    cairo_move_to(cr, nx - 5, cy);
+    cairo_line_to(cr, nx + 5, cy);
+    cairo_stroke(cr);
+
+    PangoLayout *layout = pango_cairo_create_layout(cr);
+    PangoFontDescription *font =
+        pango_font_description_from_string("Sans 11");
+    pango_layout_set_font_description(layout, font);
+    pango_layout_set_text(layout, title, -1);
+
+    int max_text_width = width - 3 * LW_DECO_BUTTON_WIDTH - 16;
+    if (max_text_width > 0) {
+        pango_layout_set_width(layout, max_text_width * PANGO_SCALE);
+        pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_END);
+    }
+
+    cairo_set_source_rgba(cr, 1.0, 1.0, 1.0, 0.9);
+    int text_w, text_h;
+    pango_layout_get_pixel_size(layout, &text_w, &text_h);
+    cairo_move_to(cr, 12, (height - text_h) / 2);
+    pango_cairo_show_layout(cr, layout);
+
+    pango_font_description_free(font);
+    g_object_unref(layout);
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+    free(data);
+    return true;
+}
+
+bool bench_titlebar_run(struct bench_titlebar *result,
+                        struct lw_buffer_pool *pool, int iterations) {
+    /* A private cache, so the hit/miss counts are only ours */
+    struct lw_deco_cache *cache = lw_deco_cache_create(pool);
+    if (!cache) return false;
+
+    bool ok = true;
+    for (int round = 0; ok && round < iterations; round++) {
+        for (size_t i = 0; ok && i < BENCH_TITLE_COUNT; i++) {
+            int width = bench_widths[(round + i) % BENCH_WIDTH_COUNT];
+            const char *title = bench_titles[i];
+
+            double start = now_s();
+            struct wlr_buffer *buffer = lw_deco_cache_render_titlebar(
+                cache, width, LW_TITLEBAR_HEIGHT, title);
+            double cached = now_s() - start;
+            if (!buffer) {
+                ok = false;
+                break;
+            }
+            wlr_buffer_drop(buffer);
+
+            start = now_s();
+            ok = render_fresh(width, LW_TITLEBAR_HEIGHT, title);
+            double fresh = now_s() - start;
+
+            lw_histogram_record(&result->cached, (uint64_t)(cached * 1e6));
+            lw_histogram_record(&result->fresh, (uint64_t)(fresh * 1e6));
+            result->cached_seconds += cached;
+            result->fresh_seconds += fresh;
+            result->renders++;
+        }
+    }
+
+    result->layout_hits = cache->layout_hits;
+    result->layout_misses = cache->layout_misses;
+    lw_deco_cache_destroy(cache);
+    return ok;
+}
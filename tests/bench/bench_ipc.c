@@ -0,0 +1,259 @@
+/*
+ * lwindesk - A Windows 11-like Wayland Desktop Environment
+ * Copyright (C) 2026 Frank Kahle
+ *
+ * tests/bench/bench_ipc.c - IPC throughput client for the benchmark
+ *
+ * Connects to the compositor's IPC socket and pipelines batches of PING
+ * requests, decoding the PONG replies in place the way the shell does.
+ * One op is one request/reply pair; latency is per batch round trip.
+ *
+ * The churn phase has every client open a batch of connections (-k,
+ * a few hundred by default) that subscribe to all events, which the
+ * compositor keeps generating.  Each must answer a PING and receive at
+ * least one FOCUS or WORKSPACE broadcast before the batch is dropped
+ * again.  One op is one connection; latency is per batch, from the
+ * first connect to the last connection served.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "ipc_protocol.h"
+
+#define BENCH_IPC_TIMEOUT_MS 10000
+
+/* Requests in flight per round trip */
+#define BENCH_IPC_BATCH 64
+
+/* Rounds per iteration */
+#define BENCH_IPC_ROUNDS 20
+
+/* Churn batches per iteration */
+#define BENCH_CHURN_ROUNDS 2
+
+struct bench_ping {
+    struct lw_ipc_header header;
+    struct lw_ipc_ping ping;
+};
+
+struct bench_subscribe_ping {
+    struct lw_ipc_header sub_header;
+    struct lw_ipc_subscribe sub;
+    struct lw_ipc_header ping_header;
+    struct lw_ipc_ping ping;
+};
+
+struct bench_ipc {
+    int fd;
+    int id;
+    _Alignas(LW_IPC_ALIGN) unsigned char buf[4 * LW_IPC_MAX_MESSAGE];
+    size_t len;
+    uint64_t pongs;              /* PONGs seen since the last reset */
+    uint64_t broadcasts;         /* FOCUS and WORKSPACE events seen */
+    bool hello;
+};
+
+static int64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static bool ipc_connect(struct bench_ipc *ipc, const char *path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    ipc->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (ipc->fd < 0) return false;
+    if (connect(ipc->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "bench ipc %d: connect(%s): %s\n", ipc->id, path,
+                strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static bool ipc_write_all(struct bench_ipc *ipc, const void *data,
+                          size_t len) {
+    const unsigned char *p = data;
+    while (len > 0) {
+        ssize_t n = send(ipc->fd, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+/* Read whatever is available and account every complete message */
+static bool ipc_read(struct bench_ipc *ipc) {
+    struct pollfd pfd = {.fd = ipc->fd, .events = POLLIN};
+    int ret = poll(&pfd, 1, BENCH_IPC_TIMEOUT_MS);
+    if (ret <= 0) {
+        fprintf(stderr, "bench ipc %d: %s\n", ipc->id,
+                ret == 0 ? "timed out" : strerror(errno));
+        return false;
+    }
+
+    ssize_t n = read(ipc->fd, ipc->buf + ipc->len,
+                     sizeof(ipc->buf) - ipc->len);
+    if (n <= 0) {
+        fprintf(stderr, "bench ipc %d: connection lost\n", ipc->id);
+        return false;
+    }
+    ipc->len += n;
+
+    size_t start = 0;
+    while (ipc->len - start >= sizeof(struct lw_ipc_header)) {
+        const struct lw_ipc_header *header =
+            (const void *)(ipc->buf + start);
+        if (!lw_ipc_header_valid(header, LW_IPC_MAX_MESSAGE)) {
+            fprintf(stderr, "bench ipc %d: bad message\n", ipc->id);
+            return false;
+        }
+        if (header->size > ipc->len - start) break;
+
+        if (header->type == LW_IPC_EVENT_HELLO) {
+            ipc->hello = true;
+        } else if (header->type == LW_IPC_EVENT_PONG &&
+                   lw_ipc_payload(header, sizeof(struct lw_ipc_ping))) {
+            ipc->pongs++;
+        } else if (header->type == LW_IPC_EVENT_FOCUS ||
+                   header->type == LW_IPC_EVENT_WORKSPACE) {
+            ipc->broadcasts++;
+        }
+        start += header->size;
+    }
+    memmove(ipc->buf, ipc->buf + start, ipc->len - start);
+    ipc->len -= start;
+    return true;
+}
+
+bool bench_ipc_run(struct bench_shared *shared, int id) {
+    struct bench_ipc ipc = {.fd = -1, .id = id};
+    bool ok = ipc_connect(&ipc, shared->ipc_path);
+
+    while (ok && !ipc.hello) {
+        ok = ipc_read(&ipc);
+    }
+
+    struct bench_ping batch[BENCH_IPC_BATCH];
+    for (int i = 0; i < BENCH_IPC_BATCH; i++) {
+        batch[i].header = (struct lw_ipc_header){
+            .size = sizeof(batch[i]),
+            .type = LW_IPC_REQUEST_PING,
+            .version = LW_IPC_VERSION,
+        };
+    }
+
+    uint64_t token = (uint64_t)id << 32;
+    int rounds = shared->iterations * BENCH_IPC_ROUNDS;
+    for (int round = 0; ok && round < rounds; round++) {
+        if (atomic_load(&shared->abort)) {
+            ok = false;
+            break;
+        }
+        for (int i = 0; i < BENCH_IPC_BATCH; i++) {
+            batch[i].ping.token = token++;
+        }
+
+        int64_t start = now_us();
+        ipc.pongs = 0;
+        ok = ipc_write_all(&ipc, batch, sizeof(batch));
+        while (ok && ipc.pongs < BENCH_IPC_BATCH) {
+            ok = ipc_read(&ipc);
+        }
+        if (!ok) break;
+
+        int64_t elapsed = now_us() - start;
+        lw_histogram_record(&shared->latency[BENCH_PHASE_IPC],
+                            elapsed > 0 ? (uint64_t)elapsed : 0);
+        atomic_fetch_add_explicit(&shared->ops[BENCH_PHASE_IPC],
+                                  BENCH_IPC_BATCH, memory_order_relaxed);
+    }
+
+    if (ipc.fd >= 0) close(ipc.fd);
+    return ok;
+}
+
+/* Open a batch of connections, wait until every one of them has answered
+ * and seen a broadcast, then drop them all */
+static bool ipc_churn_batch(struct bench_shared *shared,
+                            struct bench_ipc *conns, int id) {
+    struct bench_subscribe_ping request = {
+        .sub_header = {
+            .size = lw_ipc_message_size(sizeof(struct lw_ipc_subscribe)),
+            .type = LW_IPC_REQUEST_SUBSCRIBE,
+            .version = LW_IPC_VERSION,
+        },
+        .sub = {.classes = LW_IPC_CLASS_ALL},
+        .ping_header = {
+            .size = lw_ipc_message_size(sizeof(struct lw_ipc_ping)),
+            .type = LW_IPC_REQUEST_PING,
+            .version = LW_IPC_VERSION,
+        },
+        .ping = {.token = (uint64_t)id << 32},
+    };
+
+    bool ok = true;
+    int opened = 0;
+    for (; ok && opened < shared->churn_open; opened++) {
+        conns[opened] = (struct bench_ipc){.fd = -1, .id = id};
+        ok = ipc_connect(&conns[opened], shared->ipc_path) &&
+            ipc_write_all(&conns[opened], &request, sizeof(request));
+    }
+    for (int i = 0; ok && i < opened; i++) {
+        struct bench_ipc *conn = &conns[i];
+        while (ok && (!conn->hello || conn->pongs == 0 ||
+                      conn->broadcasts == 0)) {
+            ok = ipc_read(conn);
+        }
+        if (!ok && conn->pongs > 0 && conn->broadcasts == 0) {
+            fprintf(stderr, "bench ipc %d: connection %d got no "
+                    "broadcast event\n", id, i);
+        }
+    }
+    for (int i = 0; i < opened; i++) {
+        if (conns[i].fd >= 0) close(conns[i].fd);
+    }
+    return ok;
+}
+
+bool bench_ipc_churn(struct bench_shared *shared, int id) {
+    struct bench_ipc *conns = calloc(shared->churn_open, sizeof(*conns));
+    if (!conns) return false;
+
+    bool ok = true;
+    int rounds = shared->iterations * BENCH_CHURN_ROUNDS;
+    for (int round = 0; ok && round < rounds; round++) {
+        if (atomic_load(&shared->abort)) {
+            ok = false;
+            break;
+        }
+        int64_t start = now_us();
+        ok = ipc_churn_batch(shared, conns, id);
+        if (!ok) break;
+
+        int64_t elapsed = now_us() - start;
+        lw_histogram_record(&shared->latency[BENCH_PHASE_IPC_CHURN],
+                            elapsed > 0 ? (uint64_t)elapsed : 0);
+        atomic_fetch_add_explicit(&shared->ops[BENCH_PHASE_IPC_CHURN],
+                                  shared->churn_open, memory_order_relaxed);
+    }
+
+    free(conns);
+    return ok;
+}
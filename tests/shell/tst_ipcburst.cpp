@@ -0,0 +1,329 @@
+/*
+ * lwindesk - tests/shell/tst_ipcburst.cpp - ShellManager under an IPC burst
+ *
+ * Plays the compositor end of the IPC socket: walks a real ShellManager
+ * through its startup requests, then writes a burst of 100k window,
+ * focus and workspace events from another thread as fast as the socket
+ * takes them.  Checks that every message is dispatched, that the
+ * taskbar ends up in the state the burst describes, and reports the
+ * time from the first byte written to the last message handled.
+ */
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "ipc_protocol.h"
+#include "shellmanager.h"
+
+/* Events in the burst, and the windows they are spread over */
+static constexpr int kBurstEvents = 100000;
+static constexpr quint32 kViews = 200;
+
+/* HELLO and the STATE_DONE answering QUERY_STATE come before the burst */
+static constexpr int kStartupMessages = 2;
+
+static constexpr int kTimeoutMs = 30000;
+
+static qint64 nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Append one message: fixed payload, then an optional string tail */
+static void appendMessage(std::vector<char> &out, quint16 type,
+                          const void *payload, size_t size,
+                          const QByteArray &tail = QByteArray()) {
+    const quint32 msgSize = lw_ipc_message_size(size + tail.size());
+    const size_t at = out.size();
+    out.resize(at + msgSize, 0);
+    lw_ipc_header header = {msgSize, type, LW_IPC_VERSION, 0};
+    memcpy(out.data() + at, &header, sizeof(header));
+    memcpy(out.data() + at + sizeof(header), payload, size);
+    if (!tail.isEmpty())
+        memcpy(out.data() + at + sizeof(header) + size, tail.constData(),
+               tail.size());
+}
+
+static bool writeAll(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        const ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= size_t(n);
+    }
+    return true;
+}
+
+static bool writeMessage(int fd, quint16 type, const void *payload = nullptr,
+                         size_t size = 0) {
+    std::vector<char> buf;
+    appendMessage(buf, type, payload, size);
+    return writeAll(fd, buf.data(), buf.size());
+}
+
+static bool waitReadable(int fd, int timeoutMs) {
+    pollfd pfd = {fd, POLLIN, 0};
+    return poll(&pfd, 1, timeoutMs) == 1;
+}
+
+/* Answer the requests in one read: no snapshot, an empty state */
+static bool serveRequests(int fd, bool &stateDone) {
+    alignas(LW_IPC_ALIGN) char buf[LW_IPC_MAX_MESSAGE];
+    const ssize_t n = read(fd, buf, sizeof(buf));
+    if (n <= 0) return false;
+
+    ssize_t start = 0;
+    while (n - start >= ssize_t(sizeof(lw_ipc_header))) {
+        const auto *header = reinterpret_cast<const lw_ipc_header *>(
+            buf + start);
+        if (!lw_ipc_header_valid(header, LW_IPC_MAX_MESSAGE) ||
+            ssize_t(header->size) > n - start)
+            return false;
+        if (header->type == LW_IPC_REQUEST_SNAPSHOT) {
+            lw_ipc_snapshot_info info = {0, 0};
+            writeMessage(fd, LW_IPC_EVENT_SNAPSHOT, &info, sizeof(info));
+        } else if (header->type == LW_IPC_REQUEST_QUERY_STATE) {
+            writeMessage(fd, LW_IPC_EVENT_STATE_DONE);
+            stateDone = true;
+        }
+        start += header->size;
+    }
+    return true;
+}
+
+/* Accept the shell and take it through HELLO, SUBSCRIBE, the snapshot
+ * attempt and QUERY_STATE; returns the connection, or -1 */
+static int acceptShell(int listenFd) {
+    if (!waitReadable(listenFd, kTimeoutMs)) return -1;
+    const int fd = accept(listenFd, nullptr, nullptr);
+    if (fd < 0) return -1;
+
+    lw_ipc_hello hello = {LW_IPC_VERSION, LW_IPC_MAX_MESSAGE};
+    writeMessage(fd, LW_IPC_EVENT_HELLO, &hello, sizeof(hello));
+
+    bool stateDone = false;
+    while (!stateDone) {
+        pollfd pfds[2] = {{listenFd, POLLIN, 0}, {fd, POLLIN, 0}};
+        if (poll(pfds, 2, kTimeoutMs) <= 0) break;
+
+        if (pfds[0].revents & POLLIN) {
+            /* StateSnapshot's one-shot handshake connection */
+            const int other = accept(listenFd, nullptr, nullptr);
+            if (other >= 0) {
+                bool ignored = false;
+                writeMessage(other, LW_IPC_EVENT_HELLO, &hello,
+                             sizeof(hello));
+                if (waitReadable(other, kTimeoutMs))
+                    serveRequests(other, ignored);
+                close(other);
+            }
+        }
+        if ((pfds[1].revents & (POLLIN | POLLHUP)) &&
+            !serveRequests(fd, stateDone))
+            break;
+    }
+    if (!stateDone) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static QByteArray titleFor(quint32 id, int round) {
+    return QByteArray("Window ") + QByteArray::number(id) + " - revision " +
+           QByteArray::number(round);
+}
+
+/* What the taskbar must look like once the burst is handled */
+struct Expected {
+    std::vector<QByteArray> titles;     /* by view id */
+    std::vector<bool> minimized;
+    std::vector<bool> destroyed;
+    quint32 focused = 0;
+    qint32 workspace = 0;
+    int views = 0;
+};
+
+/*
+ * Every view is created, then the bulk cycles through title, focus,
+ * state and workspace changes the way a busy session does, and the
+ * last quarter of the views are destroyed at the end.
+ */
+static std::vector<char> buildBurst(Expected &expected) {
+    std::vector<char> out;
+    out.reserve(size_t(kBurstEvents) * 48);
+    expected.titles.assign(kViews + 1, QByteArray());
+    expected.minimized.assign(kViews + 1, false);
+    expected.destroyed.assign(kViews + 1, false);
+
+    const QByteArray appId("org.example.app");
+    for (quint32 id = 1; id <= kViews; id++) {
+        const QByteArray title = titleFor(id, 0);
+        lw_ipc_view view = {id, 0, 0, quint16(appId.size()),
+                            quint16(title.size())};
+        appendMessage(out, LW_IPC_EVENT_VIEW_CREATED, &view, sizeof(view),
+                      appId + title);
+        expected.titles[id] = title;
+    }
+
+    const quint32 destroyFrom = kViews - kViews / 4 + 1;
+    const int bulk = kBurstEvents - int(kViews) - int(kViews / 4);
+    for (int i = 0; i < bulk; i++) {
+        const quint32 id = 1 + quint32(i) % kViews;
+        switch (i % 4) {
+        case 0: {
+            const QByteArray title = titleFor(id, i);
+            lw_ipc_view_string str = {id, quint16(title.size()), 0};
+            appendMessage(out, LW_IPC_EVENT_VIEW_TITLE, &str, sizeof(str),
+                          title);
+            expected.titles[id] = title;
+            break;
+        }
+        case 1: {
+            lw_ipc_view_ref ref = {id, 0};
+            appendMessage(out, LW_IPC_EVENT_FOCUS, &ref, sizeof(ref));
+            expected.focused = id;
+            break;
+        }
+        case 2: {
+            const bool minimized = (i / 4) % 2;
+            lw_ipc_view_state state = {
+                id, minimized ? quint32(LW_IPC_VIEW_MINIMIZED) : 0u, 0, 0};
+            appendMessage(out, LW_IPC_EVENT_VIEW_STATE, &state,
+                          sizeof(state));
+            expected.minimized[id] = minimized;
+            break;
+        }
+        case 3: {
+            lw_ipc_workspace ws = {(i / 4) % 4, 4};
+            appendMessage(out, LW_IPC_EVENT_WORKSPACE, &ws, sizeof(ws));
+            expected.workspace = ws.index;
+            break;
+        }
+        }
+    }
+
+    for (quint32 id = destroyFrom; id <= kViews; id++) {
+        lw_ipc_view_ref ref = {id, 0};
+        appendMessage(out, LW_IPC_EVENT_VIEW_DESTROYED, &ref, sizeof(ref));
+        expected.destroyed[id] = true;
+        if (expected.focused == id) expected.focused = 0;
+    }
+    expected.views = int(destroyFrom - 1);
+    return out;
+}
+
+class TestIpcBurst : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void burst();
+
+private:
+    QTemporaryDir m_runtimeDir;
+    int m_listenFd = -1;
+};
+
+void TestIpcBurst::initTestCase() {
+    QVERIFY(m_runtimeDir.isValid());
+    /* ShellManager finds the socket through XDG_RUNTIME_DIR */
+    qputenv("XDG_RUNTIME_DIR", QFile::encodeName(m_runtimeDir.path()));
+
+    const QByteArray path = QFile::encodeName(
+        m_runtimeDir.filePath(QStringLiteral("lwindesk-ipc")));
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    QVERIFY(size_t(path.size()) < sizeof(addr.sun_path));
+    memcpy(addr.sun_path, path.constData(), path.size());
+
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    QVERIFY(m_listenFd >= 0);
+    QVERIFY2(bind(m_listenFd, reinterpret_cast<sockaddr *>(&addr),
+                  sizeof(addr)) == 0, strerror(errno));
+    QVERIFY(listen(m_listenFd, 4) == 0);
+}
+
+void TestIpcBurst::cleanupTestCase() {
+    if (m_listenFd >= 0) close(m_listenFd);
+}
+
+void TestIpcBurst::burst() {
+    Expected expected;
+    const std::vector<char> burst = buildBurst(expected);
+
+    std::atomic<qint64> startNs{0};
+    std::atomic<bool> feederFailed{false};
+    std::atomic<bool> stop{false};
+    std::thread feeder([&] {
+        const int fd = acceptShell(m_listenFd);
+        if (fd < 0) {
+            feederFailed.store(true);
+            return;
+        }
+        startNs.store(nowNs());
+        if (!writeAll(fd, burst.data(), burst.size()))
+            feederFailed.store(true);
+        /* Hold the connection until the shell has read everything */
+        while (!stop.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        close(fd);
+    });
+
+    ShellManager shell;
+    int handled = 0;
+    qint64 finishedNs = 0;
+    connect(&shell, &ShellManager::ipcMessageHandled, this, [&] {
+        if (++handled == kStartupMessages + kBurstEvents)
+            finishedNs = nowNs();
+    });
+
+    QTRY_VERIFY_WITH_TIMEOUT(
+        feederFailed.load() || handled >= kStartupMessages + kBurstEvents,
+        kTimeoutMs);
+    stop.store(true);
+    feeder.join();
+    QVERIFY(!feederFailed.load());
+    QCOMPARE(handled, kStartupMessages + kBurstEvents);
+
+    const qint64 elapsedNs = finishedNs - startNs.load();
+    QTest::setBenchmarkResult(elapsedNs / 1e6, QTest::WalltimeMilliseconds);
+    qInfo("%d events in %.1f ms (%.0f events/s)", kBurstEvents,
+          elapsedNs / 1e6, kBurstEvents / (elapsedNs / 1e9));
+
+    /* The taskbar reflects the whole burst, in order */
+    const TaskbarModel *model = shell.taskbarModel();
+    QCOMPARE(model->rowCount(), expected.views);
+    for (quint32 id = 1; id <= kViews; id++) {
+        const TaskbarEntry *entry = model->entry(id);
+        if (expected.destroyed[id]) {
+            QVERIFY(!entry);
+            continue;
+        }
+        QVERIFY(entry);
+        QCOMPARE(entry->title, QString::fromUtf8(expected.titles[id]));
+        QCOMPARE(entry->minimized, bool(expected.minimized[id]));
+        QCOMPARE(entry->active, id == expected.focused);
+    }
+    QCOMPARE(shell.activeWorkspace(), expected.workspace);
+    QCOMPARE(shell.workspaceCount(), 4);
+}
+
+QTEST_GUILESS_MAIN(TestIpcBurst)
+#include "tst_ipcburst.moc"